@@ -0,0 +1,134 @@
+/*
+    This file is part of the Kushview Modules for JUCE
+    Copyright (C) 2014-2017  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "Benchmark.h"
+
+namespace kv {
+
+Benchmark::Benchmark (const String& n, const String& c)
+    : name (n), category (c)
+{
+    getAllBenchmarks().add (this);
+}
+
+Benchmark::~Benchmark()
+{
+    getAllBenchmarks().removeFirstMatchingValue (this);
+}
+
+Array<Benchmark*>& Benchmark::getAllBenchmarks()
+{
+    static Array<Benchmark*> benchmarks;
+    return benchmarks;
+}
+
+BenchmarkRunner::BenchmarkRunner (const Options& o)
+    : options (o)
+{
+    options.repetitions = jmax (1, options.repetitions);
+}
+
+void BenchmarkRunner::runAll()
+{
+    if (options.cpu >= 0)
+        Thread::setCurrentThreadAffinityMask ((uint32) 1 << options.cpu);
+
+    Array<var> list;
+    for (Benchmark* benchmark : Benchmark::getAllBenchmarks())
+    {
+        if (options.filter.isNotEmpty()
+            && ! benchmark->getName().containsIgnoreCase (options.filter)
+            && ! benchmark->getCategory().containsIgnoreCase (options.filter))
+            continue;
+
+        std::cerr << benchmark->getCategory() << "/" << benchmark->getName() << std::endl;
+        list.add (run (*benchmark));
+    }
+
+    DynamicObject::Ptr root = new DynamicObject();
+    root->setProperty ("context", getContext());
+    root->setProperty ("benchmarks", list);
+    results = var (root.get());
+}
+
+var BenchmarkRunner::run (Benchmark& benchmark)
+{
+    benchmark.prepare();
+
+    // warm up and find a batch size that runs for at least minBatchTime
+    int64 batch = 1;
+    for (;;)
+    {
+        const int64 start = Time::getHighResolutionTicks();
+        for (int64 i = 0; i < batch; ++i)
+            benchmark.runIteration();
+        const double elapsed = Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - start);
+        if (elapsed >= options.minBatchTime || batch >= ((int64) 1 << 40))
+            break;
+        batch *= elapsed > 0.0 ? jlimit ((int64) 2, (int64) 100, (int64) (options.minBatchTime / elapsed) + 1) : 100;
+    }
+
+    Array<double> times;
+    for (int r = 0; r < options.repetitions; ++r)
+    {
+        const int64 start = Time::getHighResolutionTicks();
+        for (int64 i = 0; i < batch; ++i)
+            benchmark.runIteration();
+        const double elapsed = Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - start);
+        times.add (elapsed * 1.0e9 / (double) batch);
+    }
+
+    benchmark.cleanup();
+
+    times.sort();
+    const double median = times [times.size() / 2];
+
+    DynamicObject::Ptr result = new DynamicObject();
+    result->setProperty ("name", benchmark.getName());
+    result->setProperty ("category", benchmark.getCategory());
+    result->setProperty ("iterations", batch * options.repetitions);
+    result->setProperty ("ns_per_iteration", median);
+    result->setProperty ("min_ns", times.getFirst());
+    result->setProperty ("max_ns", times.getLast());
+    result->setProperty ("items_per_second", median > 0.0
+        ? (double) benchmark.getItemsPerIteration() * 1.0e9 / median : 0.0);
+    return var (result.get());
+}
+
+var BenchmarkRunner::getContext() const
+{
+    DynamicObject::Ptr context = new DynamicObject();
+    context->setProperty ("date", Time::getCurrentTime().toISO8601 (true));
+    context->setProperty ("host", SystemStats::getComputerName());
+    context->setProperty ("os", SystemStats::getOperatingSystemName());
+    context->setProperty ("cpu_vendor", SystemStats::getCpuVendor());
+    context->setProperty ("cpu_mhz", SystemStats::getCpuSpeedInMegaherz());
+    context->setProperty ("num_cpus", SystemStats::getNumCpus());
+    context->setProperty ("pinned_cpu", options.cpu);
+    context->setProperty ("repetitions", options.repetitions);
+    context->setProperty ("juce_version", SystemStats::getJUCEVersion());
+   #if JUCE_DEBUG
+    context->setProperty ("build", "debug");
+   #else
+    context->setProperty ("build", "release");
+   #endif
+    return var (context.get());
+}
+
+}
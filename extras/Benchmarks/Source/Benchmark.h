@@ -0,0 +1,111 @@
+/*
+    This file is part of the Kushview Modules for JUCE
+    Copyright (C) 2014-2017  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+namespace kv {
+
+/** A micro-benchmark.
+
+    Subclasses do one unit of work in runIteration(). The runner calls it in
+    timed batches and reports the time per iteration.  Create benchmarks as
+    static objects and they register themselves, like juce::UnitTest.
+ */
+class Benchmark
+{
+public:
+    Benchmark (const String& name, const String& category);
+    virtual ~Benchmark();
+
+    const String& getName() const       { return name; }
+    const String& getCategory() const   { return category; }
+
+    /** Set up before timing. Allocate everything here */
+    virtual void prepare() { }
+
+    /** Do one unit of work */
+    virtual void runIteration() = 0;
+
+    /** Tear down after timing */
+    virtual void cleanup() { }
+
+    /** Items processed by each iteration, e.g. samples or bytes, used to
+        report throughput */
+    virtual int64 getItemsPerIteration() const { return 1; }
+
+    /** Every benchmark created */
+    static Array<Benchmark*>& getAllBenchmarks();
+
+private:
+    const String name, category;
+    JUCE_DECLARE_NON_COPYABLE (Benchmark)
+};
+
+/** Runs benchmarks and collects results as JSON */
+class BenchmarkRunner
+{
+public:
+    struct Options
+    {
+        Options() : cpu (-1), repetitions (5), minBatchTime (0.05) { }
+
+        /** Pin the benchmark thread to this CPU, -1 to not pin */
+        int cpu;
+
+        /** Batches timed per benchmark, the median is reported */
+        int repetitions;
+
+        /** Seconds each batch should run at least */
+        double minBatchTime;
+
+        /** Only run benchmarks whose name or category contains this */
+        String filter;
+    };
+
+    BenchmarkRunner (const Options& options);
+
+    /** Run every matching benchmark */
+    void runAll();
+
+    /** Results of the last run */
+    var getResults() const { return results; }
+
+private:
+    Options options;
+    var results;
+
+    var run (Benchmark& benchmark);
+    var getContext() const;
+};
+
+/** Stops the compiler removing code whose results aren't used */
+template<typename Type>
+inline void doNotOptimize (const Type& value)
+{
+   #if JUCE_MSVC
+    static volatile const Type* sink;
+    sink = &value;
+   #else
+    asm volatile ("" : : "r,m" (value) : "memory");
+   #endif
+}
+
+}
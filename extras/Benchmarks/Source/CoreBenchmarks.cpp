@@ -0,0 +1,433 @@
+/*
+    This file is part of the Kushview Modules for JUCE
+    Copyright (C) 2014-2017  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include <thread>
+#include "Benchmark.h"
+
+namespace kv {
+
+class RingBufferBenchmark : public Benchmark
+{
+public:
+    RingBufferBenchmark() : Benchmark ("RingBuffer write/read 256 bytes", "kv_core") { }
+
+    void prepare() override
+    {
+        ring = new RingBuffer (4096);
+        data.calloc (blockSize);
+    }
+
+    void runIteration() override
+    {
+        ring->write (data.getData(), blockSize);
+        ring->read (data.getData(), blockSize);
+        doNotOptimize (data[0]);
+    }
+
+    void cleanup() override { ring = nullptr; }
+    int64 getItemsPerIteration() const override { return blockSize; }
+
+private:
+    enum { blockSize = 256 };
+    ScopedPointer<RingBuffer> ring;
+    HeapBlock<uint8> data;
+};
+
+class AudioRingBufferBenchmark : public Benchmark
+{
+public:
+    AudioRingBufferBenchmark()
+        : Benchmark ("AudioRingBuffer stereo 512 samples", "kv_core"),
+          fifo (2, 8192), block (2, blockSize)
+    { }
+
+    void prepare() override { fifo.clear(); block.clear(); }
+
+    void runIteration() override
+    {
+        fifo.addToFifo ((const float**) block.getArrayOfReadPointers(), blockSize);
+        fifo.readFromFifo (block.getArrayOfWritePointers(), blockSize);
+        doNotOptimize (block.getSample (0, 0));
+    }
+
+    int64 getItemsPerIteration() const override { return blockSize; }
+
+private:
+    enum { blockSize = 512 };
+    AudioRingBuffer<float> fifo;
+    AudioSampleBuffer block;
+};
+
+/** A tempo map with a change every 4 bars */
+static void createTempoMap (TimeScale& ts, int numNodes)
+{
+    ts.setSampleRate (48000);
+    ts.setTicksPerBeat (1920);
+    ts.reset();
+    for (int i = 1; i < numNodes; ++i)
+        ts.addNode ((uint64) i * 48000 * 8, 100.0f + (float) (i % 40));
+    ts.updateScale();
+}
+
+class TimeScaleConversionBenchmark : public Benchmark
+{
+public:
+    TimeScaleConversionBenchmark() : Benchmark ("TimeScale tick/frame sequential", "kv_core"), frame (0) { }
+
+    void prepare() override { createTempoMap (ts, 64); frame = 0; }
+
+    void runIteration() override
+    {
+        const uint64 tick = ts.tickFromFrame (frame);
+        doNotOptimize (ts.frameFromTick (tick));
+        frame = (frame + 512) % ((uint64) 48000 * 8 * 64);
+    }
+
+private:
+    TimeScale ts;
+    uint64 frame;
+};
+
+class TimeScaleBatchBenchmark : public Benchmark
+{
+public:
+    TimeScaleBatchBenchmark (TimeScale::Precision p)
+        : Benchmark (p == TimeScale::Exact ? "TimeScale batch frames to ticks, exact"
+                                           : "TimeScale batch frames to ticks, float", "kv_core"),
+          precision (p) { }
+
+    void prepare() override
+    {
+        createTempoMap (ts, 64);
+        ts.setPrecision (precision);
+        for (int i = 0; i < numFrames; ++i)
+            frames[i] = (uint64) i * 750;
+    }
+
+    void runIteration() override
+    {
+        ts.ticksFromFrames (frames, ticks, numFrames);
+        doNotOptimize (ticks [numFrames - 1]);
+    }
+
+    int64 getItemsPerIteration() const override { return numFrames; }
+
+private:
+    enum { numFrames = 4096 };
+    TimeScale ts;
+    TimeScale::Precision precision;
+    uint64 frames [numFrames], ticks [numFrames];
+};
+
+class TimeScaleSeekBenchmark : public Benchmark
+{
+public:
+    TimeScaleSeekBenchmark() : Benchmark ("TimeScale cursor seek random", "kv_core"), index (0) { }
+
+    void prepare() override
+    {
+        createTempoMap (ts, 64);
+        Random random (1234);
+        for (int i = 0; i < numFrames; ++i)
+            frames[i] = (uint64) random.nextInt (48000 * 8 * 64);
+        index = 0;
+    }
+
+    void runIteration() override
+    {
+        doNotOptimize (ts.cursor().seekFrame (frames [index]));
+        index = (index + 1) % numFrames;
+    }
+
+private:
+    enum { numFrames = 1024 };
+    TimeScale ts;
+    uint64 frames [numFrames];
+    int index;
+};
+
+class ArcTableBenchmark : public Benchmark
+{
+public:
+    ArcTableBenchmark() : Benchmark ("ArcTable construction 256 arcs", "kv_core") { }
+
+    void prepare() override
+    {
+        arcs.clear();
+        Random random (4321);
+        for (uint32 i = 0; i < 256; ++i)
+            arcs.add (new Arc ((uint32) random.nextInt (64), 0, (uint32) random.nextInt (64), 0));
+    }
+
+    void runIteration() override
+    {
+        ArcTable<Arc> table (arcs);
+        doNotOptimize (table.isAnInputTo (1, 2));
+    }
+
+    int64 getItemsPerIteration() const override { return arcs.size(); }
+
+private:
+    OwnedArray<Arc> arcs;
+};
+
+class WorkThreadBenchmark : public Benchmark
+{
+public:
+    WorkThreadBenchmark() : Benchmark ("WorkThread round trip", "kv_core") { }
+
+    void prepare() override
+    {
+        thread = new WorkThread ("Benchmark Worker", 4096, 8);
+        worker = new Worker (*thread);
+    }
+
+    void runIteration() override
+    {
+        const uint32 request = ++serial;
+        while (! worker->scheduleWork (sizeof (request), &request)) { }
+        while (worker->lastResponse != request)
+            worker->processWorkResponses();
+    }
+
+    void cleanup() override
+    {
+        worker = nullptr;
+        thread = nullptr;
+    }
+
+private:
+    struct Worker : public WorkerBase
+    {
+        Worker (WorkThread& t) : WorkerBase (t, 1024), lastResponse (0) { }
+
+        void processRequest (uint32 size, const void* data) override  { respondToWork (size, data); }
+        void processResponse (uint32, const void* data) override       { lastResponse = *(const uint32*) data; }
+
+        uint32 lastResponse;
+    };
+
+    ScopedPointer<WorkThread> thread;
+    ScopedPointer<Worker> worker;
+    uint32 serial = 0;
+};
+
+/** Cost of one profiled zone while recording, drained every batch */
+class DspProfilerBenchmark : public Benchmark
+{
+public:
+    DspProfilerBenchmark() : Benchmark ("DspProfiler zone", "kv_core") { }
+
+    void prepare() override
+    {
+        profiler = new DspProfiler();
+        nodeId = profiler->registerNode ("bench");
+        profiler->setEnabled (true);
+    }
+
+    void runIteration() override
+    {
+        {
+            DspProfiler::ScopedZone zone (*profiler, nodeId);
+            doNotOptimize (nodeId);
+        }
+
+        if (++count % 4096 == 0)
+            profiler->collect();
+    }
+
+    void cleanup() override { profiler = nullptr; }
+
+private:
+    ScopedPointer<DspProfiler> profiler;
+    int nodeId = -1;
+    int count = 0;
+};
+
+/** A 512 meter mixer: measure and publish a block, then one UI read */
+class MeterBusBenchmark : public Benchmark
+{
+public:
+    MeterBusBenchmark() : Benchmark ("MeterBus 512 meters, block and read", "kv_core") { }
+
+    void prepare() override
+    {
+        bus.setNumMeters (numMeters);
+        bus.prepare (48000.0);
+        buffer.setSize (numMeters, blockSize);
+        Random random (99);
+        for (int c = 0; c < numMeters; ++c)
+            for (int i = 0; i < blockSize; ++i)
+                buffer.setSample (c, i, random.nextFloat() * 2.0f - 1.0f);
+        slots.allocate (numMeters, true);
+    }
+
+    void runIteration() override
+    {
+        bus.process (0, buffer, 0, blockSize);
+        bus.publish();
+        doNotOptimize (bus.read (slots, 0, numMeters));
+    }
+
+    int64 getItemsPerIteration() const override { return numMeters; }
+
+private:
+    enum { numMeters = 512, blockSize = 256 };
+    MeterBus bus;
+    AudioSampleBuffer buffer;
+    HeapBlock<MeterBus::Slot> slots;
+};
+
+class MatrixStateSaveBenchmark : public Benchmark
+{
+public:
+    MatrixStateSaveBenchmark (const bool useSparseStorage)
+        : Benchmark (useSparseStorage ? "MatrixState 2048x2048 sparse, save and restore"
+                                      : "MatrixState 2048x2048 dense, save and restore", "kv_core"),
+          sparse (useSparseStorage) { }
+
+    void prepare() override
+    {
+        state = MatrixState (size, size, sparse);
+        for (int i = 0; i < size; ++i)
+            state.connect (i, (i * 7) % size);
+    }
+
+    void runIteration() override
+    {
+        restored.restoreFromValueTree (state.createValueTree());
+        doNotOptimize (restored.getNumConnected());
+    }
+
+    int64 getItemsPerIteration() const override { return size; }
+
+private:
+    enum { size = 2048 };
+    const bool sparse;
+    MatrixState state, restored;
+};
+
+class MatrixStateQueueBenchmark : public Benchmark
+{
+public:
+    MatrixStateQueueBenchmark() : Benchmark ("MatrixStateQueue 2048x2048, switch presets", "kv_core") { }
+
+    void prepare() override
+    {
+        presets[0] = presets[1] = audio = MatrixState (size, size);
+        for (int i = 0; i < size; ++i)
+        {
+            presets[0].connect (i, i);
+            presets[1].connect (i, size - 1 - i);
+        }
+
+        queue.reset (audio);
+        current = 0;
+    }
+
+    void runIteration() override
+    {
+        current = 1 - current;
+        queue.post (presets [current]);
+        doNotOptimize (queue.apply (audio));
+    }
+
+    int64 getItemsPerIteration() const override { return size * 2; }
+
+private:
+    enum { size = 2048 };
+    MatrixState presets[2], audio;
+    MatrixStateQueue queue;
+    int current = 0;
+};
+
+/** A 4 KB frame for the snapshot benchmarks */
+struct SnapshotFrame
+{
+    uint32 serial;
+    float data [1023];
+};
+
+/** Cost of reading a frame while another thread keeps writing it */
+template<class Snapshot>
+class SnapshotReadBenchmark : public Benchmark
+{
+public:
+    SnapshotReadBenchmark (const String& name) : Benchmark (name + " read", "kv_core") { }
+
+    void prepare() override
+    {
+        running.store (true);
+        writer = std::thread ([this]() {
+            SnapshotFrame next;
+            zerostruct (next);
+            while (running.load())
+            {
+                ++next.serial;
+                write (snapshot, next);
+            }
+        });
+    }
+
+    void runIteration() override
+    {
+        read (snapshot, frame);
+        doNotOptimize (frame.serial);
+    }
+
+    void cleanup() override
+    {
+        running.store (false);
+        writer.join();
+    }
+
+    int64 getItemsPerIteration() const override { return sizeof (SnapshotFrame); }
+
+private:
+    Snapshot snapshot;
+    SnapshotFrame frame;
+    std::atomic<bool> running;
+    std::thread writer;
+
+    static void write (TripleBuffer<SnapshotFrame>& s, const SnapshotFrame& f)  { s.write (f); }
+    static void read (TripleBuffer<SnapshotFrame>& s, SnapshotFrame& f)         { f = s.read(); }
+    static void write (SeqLock<SnapshotFrame>& s, const SnapshotFrame& f)       { s.write (f); }
+    static void read (SeqLock<SnapshotFrame>& s, SnapshotFrame& f)              { s.read (f); }
+    static void write (AtomicValue<SnapshotFrame>& s, const SnapshotFrame& f)   { s.set (f); }
+    static void read (AtomicValue<SnapshotFrame>& s, SnapshotFrame& f)          { f = s.get(); }
+};
+
+static RingBufferBenchmark sRingBufferBenchmark;
+static AudioRingBufferBenchmark sAudioRingBufferBenchmark;
+static TimeScaleConversionBenchmark sTimeScaleConversionBenchmark;
+static TimeScaleSeekBenchmark sTimeScaleSeekBenchmark;
+static TimeScaleBatchBenchmark sTimeScaleBatchFloatBenchmark (TimeScale::Float);
+static TimeScaleBatchBenchmark sTimeScaleBatchExactBenchmark (TimeScale::Exact);
+static ArcTableBenchmark sArcTableBenchmark;
+static WorkThreadBenchmark sWorkThreadBenchmark;
+static DspProfilerBenchmark sDspProfilerBenchmark;
+static MeterBusBenchmark sMeterBusBenchmark;
+static MatrixStateSaveBenchmark sMatrixStateDenseBenchmark (false);
+static MatrixStateSaveBenchmark sMatrixStateSparseBenchmark (true);
+static MatrixStateQueueBenchmark sMatrixStateQueueBenchmark;
+static SnapshotReadBenchmark<TripleBuffer<SnapshotFrame>> sTripleBufferBenchmark ("TripleBuffer");
+static SnapshotReadBenchmark<SeqLock<SnapshotFrame>> sSeqLockBenchmark ("SeqLock");
+static SnapshotReadBenchmark<AtomicValue<SnapshotFrame>> sAtomicValueBenchmark ("AtomicValue");
+
+}
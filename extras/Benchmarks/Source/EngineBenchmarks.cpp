@@ -0,0 +1,85 @@
+/*
+    This file is part of the Kushview Modules for JUCE
+    Copyright (C) 2014-2017  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "Benchmark.h"
+
+namespace kv {
+
+/** Tick sequence rendering against compiled, frame stamped playback */
+class RenderSequenceBenchmark : public Benchmark
+{
+public:
+    RenderSequenceBenchmark (bool useCompiled)
+        : Benchmark (useCompiled ? "CompiledMidiSequence::render 512 frames"
+                                 : "Midi::renderSequence 512 frames", "kv_engines"),
+          compiled (useCompiled), frame (0)
+    { }
+
+    void prepare() override
+    {
+        ts.setSampleRate (48000);
+        ts.setTicksPerBeat (Shuttle::PPQ);
+        ts.setTempo (120.0f);
+        ts.updateScale();
+
+        // sixteenth notes over 64 bars
+        sequence.clear();
+        for (int i = 0; i < 64 * 16; ++i)
+        {
+            const double tick = (double) i * Shuttle::PPQ / 4.0;
+            sequence.addEvent (MidiMessage::noteOn (1, 36 + (i % 48), (uint8) 100), tick);
+            sequence.addEvent (MidiMessage::noteOff (1, 36 + (i % 48)), tick + Shuttle::PPQ / 8.0);
+        }
+        sequence.updateMatchedPairs();
+        compiledSequence.compile (sequence, ts);
+
+        endFrame = (int32) ts.frameFromTick ((uint64) Shuttle::PPQ * 4 * 64);
+        midi.ensureSize (4096);
+        frame = 0;
+    }
+
+    void runIteration() override
+    {
+        midi.clear();
+        if (compiled)
+            compiledSequence.render (midi, frame, blockSize);
+        else
+            Midi::renderSequence (midi, sequence, ts, frame, blockSize);
+        doNotOptimize (midi.getNumEvents());
+        frame += blockSize;
+        if (frame >= endFrame)
+            frame = 0;
+    }
+
+    int64 getItemsPerIteration() const override { return blockSize; }
+
+private:
+    enum { blockSize = 512 };
+    TimeScale ts;
+    MidiMessageSequence sequence;
+    CompiledMidiSequence compiledSequence;
+    MidiBuffer midi;
+    const bool compiled;
+    int32 frame, endFrame;
+};
+
+static RenderSequenceBenchmark sRenderSequenceBenchmark (false);
+static RenderSequenceBenchmark sCompiledSequenceBenchmark (true);
+
+}
@@ -0,0 +1,72 @@
+/*
+    This file is part of the Kushview Modules for JUCE
+    Copyright (C) 2014-2017  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "Benchmark.h"
+
+namespace kv {
+
+class VideoScalerBenchmark : public Benchmark
+{
+public:
+    VideoScalerBenchmark()
+        : Benchmark ("FFmpegVideoScaler YUV420P to ARGB 1280x720", "kv_ffmpeg"),
+          frame (nullptr)
+    { }
+
+    void prepare() override
+    {
+        frame = av_frame_alloc();
+        frame->width  = width;
+        frame->height = height;
+        frame->format = AV_PIX_FMT_YUV420P;
+        av_frame_get_buffer (frame, 32);
+        av_frame_make_writable (frame);
+        for (int plane = 0; plane < 3; ++plane)
+            memset (frame->data [plane], 96 + plane * 32,
+                    (size_t) frame->linesize [plane] * (size_t) (plane == 0 ? height : height / 2));
+
+        image = Image (Image::ARGB, width, height, false);
+        scaler.setupScaler (width, height, AV_PIX_FMT_YUV420P,
+                            width, height, AV_PIX_FMT_BGRA);
+    }
+
+    void runIteration() override
+    {
+        scaler.convertFrameToImage (image, frame);
+    }
+
+    void cleanup() override
+    {
+        scaler.reset();
+        image = Image();
+        av_frame_free (&frame);
+    }
+
+    int64 getItemsPerIteration() const override { return (int64) width * height; }
+
+private:
+    enum { width = 1280, height = 720 };
+    FFmpegVideoScaler scaler;
+    AVFrame* frame;
+    Image image;
+};
+
+static VideoScalerBenchmark sVideoScalerBenchmark;
+
+}
@@ -0,0 +1,66 @@
+/*
+    This file is part of the Kushview Modules for JUCE
+    Copyright (C) 2014-2017  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "Benchmark.h"
+
+namespace kv {
+
+class PortBufferBenchmark : public Benchmark
+{
+public:
+    PortBufferBenchmark() : Benchmark ("PortBuffer::addEvent 64 MIDI events", "kv_lv2") { }
+
+    void prepare() override
+    {
+        mapFeature = symbols.createMapFeature();
+        uris = new URIs ((LV2_URID_Map*) mapFeature->getFeature()->data);
+        buffer = new PortBuffer (uris, uris->atom_Sequence, 8192);
+        midiType = uris->midi_MidiEvent;
+    }
+
+    void runIteration() override
+    {
+        buffer->reset();
+        const uint8 noteOn[3] = { 0x90, 60, 100 };
+        for (int i = 0; i < numEvents; ++i)
+            buffer->addEvent ((int64) i * 8, 3, midiType, noteOn);
+        doNotOptimize (buffer->getPortData());
+    }
+
+    void cleanup() override
+    {
+        buffer = nullptr;
+        uris = nullptr;
+        mapFeature = nullptr;
+    }
+
+    int64 getItemsPerIteration() const override { return numEvents; }
+
+private:
+    enum { numEvents = 64 };
+    SymbolMap symbols;
+    ScopedPointer<LV2Feature> mapFeature;
+    ScopedPointer<URIs> uris;
+    ScopedPointer<PortBuffer> buffer;
+    uint32 midiType = 0;
+};
+
+static PortBufferBenchmark sPortBufferBenchmark;
+
+}
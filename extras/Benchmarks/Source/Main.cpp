@@ -0,0 +1,78 @@
+/*
+    This file is part of the Kushview Modules for JUCE
+    Copyright (C) 2014-2017  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "Benchmark.h"
+
+static void printUsage()
+{
+    std::cerr << "usage: Benchmarks [options]" << std::endl
+              << "  --filter <text>   only run benchmarks with text in the name or category" << std::endl
+              << "  --cpu <index>     pin to a CPU for stable timing" << std::endl
+              << "  --reps <count>    timed batches per benchmark (default 5)" << std::endl
+              << "  --output <file>   write JSON results here instead of stdout" << std::endl
+              << "  --list            list benchmarks and exit" << std::endl;
+}
+
+int main (int argc, char* argv[])
+{
+    kv::BenchmarkRunner::Options options;
+    File output;
+
+    StringArray args;
+    for (int i = 1; i < argc; ++i)
+        args.add (String::fromUTF8 (argv[i]));
+
+    for (int i = 0; i < args.size(); ++i)
+    {
+        const String& arg (args[i]);
+        const String value (args [i + 1]);
+
+        if (arg == "--filter")          { options.filter = value; ++i; }
+        else if (arg == "--cpu")        { options.cpu = value.getIntValue(); ++i; }
+        else if (arg == "--reps")       { options.repetitions = value.getIntValue(); ++i; }
+        else if (arg == "--output")     { output = File::getCurrentWorkingDirectory().getChildFile (value); ++i; }
+        else if (arg == "--list")
+        {
+            for (auto* benchmark : kv::Benchmark::getAllBenchmarks())
+                std::cout << benchmark->getCategory() << "/" << benchmark->getName() << std::endl;
+            return 0;
+        }
+        else
+        {
+            printUsage();
+            return 1;
+        }
+    }
+
+    kv::BenchmarkRunner runner (options);
+    runner.runAll();
+
+    const String json (JSON::toString (runner.getResults()));
+    if (output == File())
+    {
+        std::cout << json << std::endl;
+    }
+    else if (! output.replaceWithText (json))
+    {
+        std::cerr << "could not write " << output.getFullPathName() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
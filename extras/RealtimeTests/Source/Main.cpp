@@ -0,0 +1,139 @@
+/*
+    This file is part of the Kushview Modules for JUCE
+    Copyright (C) 2014-2017  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+// Built on its own with KV_REALTIME_CHECKS enabled. The checks replace the
+// global allocator and the blocking libc calls, which the rest of the unit
+// tests shouldn't run under.
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+namespace kv {
+
+/** Checks the realtime checker catches violations and that a simple
+    processBlock doesn't make any */
+class RealtimeTest : public UnitTest
+{
+public:
+    RealtimeTest() : UnitTest ("realtime") { }
+
+    void runTest() override
+    {
+       #if KV_REALTIME_CHECKS
+        beginTest ("violations");
+        {
+            RealtimeChecker::resetViolations();
+            {
+                RealtimeChecker::ScopedRealtime rt;
+                String text ("not realtime safe");
+                text << " at all";
+            }
+            expect (RealtimeChecker::getNumViolations() > 0);
+            expect (RealtimeChecker::getViolationReports().size() > 0);
+
+            RealtimeChecker::resetViolations();
+            {
+                RealtimeChecker::ScopedRealtime rt;
+                RealtimeChecker::ScopedNonRealtime allow;
+                String text ("allowed");
+            }
+            expectEquals (RealtimeChecker::getNumViolations(), 0);
+        }
+
+        beginTest ("process block");
+        {
+            GainProcessor proc;
+            AudioSampleBuffer audio (2, 512);
+            MidiBuffer midi;
+            proc.prepareToPlay (44100.0, audio.getNumSamples());
+            audio.clear();
+
+            RealtimeChecker::resetViolations();
+            {
+                RealtimeChecker::ScopedRealtime rt;
+                for (int i = 0; i < 100; ++i)
+                    proc.processBlock (audio, midi);
+            }
+            expectEquals (RealtimeChecker::getNumViolations(), 0);
+            proc.releaseResources();
+        }
+       #else
+        logMessage ("KV_REALTIME_CHECKS is disabled, nothing to test");
+       #endif
+    }
+
+private:
+    class GainProcessor : public AudioProcessor
+    {
+    public:
+        GainProcessor() { }
+
+        const String getName() const override { return "Gain"; }
+        void prepareToPlay (double, int blockSize) override
+        {
+            ramp.setMaxBlockSize (blockSize);
+            ramp.reset (1.f);
+            cv.setSize (1, blockSize);
+        }
+
+        void releaseResources() override { }
+
+        void processBlock (AudioSampleBuffer& audio, MidiBuffer& midi) override
+        {
+            gain = gain > 0.5f ? 0.25f : 1.f;
+            ramp.render (cv.getWritePointer (0), audio.getNumSamples(), gain);
+            for (int c = 0; c < audio.getNumChannels(); ++c)
+                FloatVectorOperations::multiply (audio.getWritePointer (c), cv.getReadPointer (0),
+                                                 audio.getNumSamples());
+            midi.clear();
+        }
+
+        double getTailLengthSeconds() const override { return 0.0; }
+        bool acceptsMidi() const override { return false; }
+        bool producesMidi() const override { return false; }
+        AudioProcessorEditor* createEditor() override { return nullptr; }
+        bool hasEditor() const override { return false; }
+        int getNumPrograms() override { return 1; }
+        int getCurrentProgram() override { return 0; }
+        void setCurrentProgram (int) override { }
+        const String getProgramName (int) override { return String(); }
+        void changeProgramName (int, const String&) override { }
+        void getStateInformation (MemoryBlock&) override { }
+        void setStateInformation (const void*, int) override { }
+
+    private:
+        float gain = 1.f;
+        ControlRamp ramp;
+        AudioSampleBuffer cv;
+    };
+};
+
+static RealtimeTest sRealtimeTest;
+
+}
+
+int main()
+{
+    UnitTestRunner runner;
+    runner.runAllTests();
+
+    int numFailures = 0;
+    for (int i = 0; i < runner.getNumResults(); ++i)
+        numFailures += runner.getResult(i)->failures;
+    return numFailures > 0 ? 1 : 0;
+}
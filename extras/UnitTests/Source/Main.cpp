@@ -17,6 +17,7 @@
     Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
 */
 
+#include <thread>
 #include "../JuceLibraryCode/JuceHeader.h"
 
 namespace kv {
@@ -57,6 +58,1239 @@ public:
 
 static DummyTest sDummyTest;
 
+/** Checks TripleBuffer and SeqLock never tear a 4 KB frame while another
+    thread writes. Their read cost is in the benchmarks */
+class SnapshotTest : public UnitTest
+{
+public:
+    SnapshotTest() : UnitTest ("snapshots") { }
+
+    struct Frame
+    {
+        uint32 serial;
+        float data [1023];
+    };
+
+    void runTest() override
+    {
+        beginTest ("triple buffer");
+        {
+            TripleBuffer<Frame> buffer;
+            expectEquals (countTornReads ([&buffer] (const Frame& f) { buffer.write (f); },
+                                          [&buffer] (Frame& f) { f = buffer.read(); }), 0);
+        }
+
+        beginTest ("seqlock");
+        {
+            SeqLock<Frame> lock;
+            expectEquals (countTornReads ([&lock] (const Frame& f) { lock.write (f); },
+                                          [&lock] (Frame& f) { lock.read (f); }), 0);
+        }
+    }
+
+private:
+    enum { numReads = 200000 };
+
+    static void fill (Frame& frame, uint32 serial)
+    {
+        frame.serial = serial;
+        FloatVectorOperations::fill (frame.data, (float) (serial & 0xffff), 1023);
+    }
+
+    static bool isTorn (const Frame& frame)
+    {
+        const float expected = (float) (frame.serial & 0xffff);
+        for (int i = 0; i < 1023; ++i)
+            if (frame.data[i] != expected)
+                return true;
+        return false;
+    }
+
+    template<class WriteFunction, class ReadFunction>
+    static int countTornReads (WriteFunction write, ReadFunction read)
+    {
+        std::atomic<bool> running (true);
+        std::thread writer ([&running, &write]() {
+            Frame frame;
+            uint32 serial = 0;
+            while (running.load())
+            {
+                fill (frame, ++serial);
+                write (frame);
+            }
+        });
+
+        Frame frame;
+        int numTorn = 0;
+        for (int i = 0; i < numReads; ++i)
+        {
+            read (frame);
+            if (isTorn (frame))
+                ++numTorn;
+        }
+
+        running.store (false);
+        writer.join();
+        return numTorn;
+    }
+};
+
+static SnapshotTest sSnapshotTest;
+
+//==============================================================================
+/** Checks tempo ramps against the closed form positions and tempos */
+class TempoRampTest : public UnitTest
+{
+public:
+    TempoRampTest() : UnitTest ("tempo ramps") { }
+
+    void runTest() override
+    {
+        beginTest ("linear");
+        checkRamp (TimeScale::Linear);
+
+        beginTest ("exponential");
+        checkRamp (TimeScale::Exponential);
+    }
+
+private:
+    void checkRamp (TimeScale::Ramp ramp)
+    {
+        const double t0 = 120.0, t1 = 240.0, rate = 48000.0, tpq = 960.0;
+        const double fpm = 60.0 * rate;
+
+        TimeScale ts;
+        ts.setSampleRate ((unsigned int) rate);
+        ts.setTicksPerBeat ((unsigned short) tpq);
+        ts.addNode (0, (float) t0, 2, 4, 2, ramp);
+        ts.addNode ((uint64) rate * 8, (float) t1);
+        ts.updateScale();
+
+        const TimeScale::Node* const node = ts.nodes().first();
+        const TimeScale::Node* const next = node != nullptr ? node->next() : nullptr;
+        expect (node != nullptr && node->isRamping());
+        expect (next != nullptr);
+        if (next == nullptr)
+            return;
+
+        const double span = (double) next->tick;
+        double maxFrameError = 0.0, maxTempoError = 0.0;
+
+        for (uint64 tick = 0; tick <= next->tick; tick += 97)
+        {
+            const double x = (double) tick;
+            double frame, tempo;
+
+            if (ramp == TimeScale::Linear)
+            {
+                frame = fpm * span / (tpq * (t1 - t0)) * std::log (1.0 + (t1 - t0) * x / (span * t0));
+                tempo = t0 + (t1 - t0) * x / span;
+            }
+            else
+            {
+                const double rho = std::log (t1 / t0) / span;
+                frame = fpm * (1.0 - std::exp (-rho * x)) / (tpq * t0 * rho);
+                tempo = t0 * std::pow (t1 / t0, x / span);
+            }
+
+            maxFrameError = jmax (maxFrameError, std::abs ((double) ts.frameFromTick (tick) - frame));
+            maxTempoError = jmax (maxTempoError, std::abs ((double) ts.getTempoAtFrame ((uint64) (frame + 0.5)) - tempo));
+        }
+
+        // only rounding to whole frames is allowed
+        expect (maxFrameError < 1.0, "frames off by " + String (maxFrameError));
+        expect (maxTempoError < 0.01, "tempo off by " + String (maxTempoError));
+
+        // and the ramp lands exactly on the next node
+        expect (ts.frameFromTick (next->tick) == next->frame);
+        expect (std::abs (ts.getTempoAtFrame (next->frame) - (float) t1) < 0.001f);
+    }
+};
+
+static TempoRampTest sTempoRampTest;
+
+
+//==============================================================================
+/** Renders compiled MIDI in blocks and checks every event lands on its frame,
+    in order, without the target buffer growing */
+class CompiledMidiSequenceTest : public UnitTest
+{
+public:
+    CompiledMidiSequenceTest() : UnitTest ("compiled midi sequence") { }
+
+    void runTest() override
+    {
+        TimeScale ts;
+        ts.setSampleRate (48000);
+        ts.setTicksPerBeat (960);
+        ts.setTempo (120.0f);
+        ts.updateScale();
+
+        // a note every eighth, and a sysex between two of them
+        MidiMessageSequence sequence;
+        for (int i = 0; i < 64; ++i)
+        {
+            sequence.addEvent (MidiMessage::noteOn (1, 60 + (i % 12), (uint8) 100), i * 480.0);
+            sequence.addEvent (MidiMessage::noteOff (1, 60 + (i % 12)), i * 480.0 + 240.0);
+        }
+
+        const uint8 sysex[] = { 0x7e, 0x7f, 0x09, 0x01 };
+        sequence.addEvent (MidiMessage::createSysExMessage (sysex, 4), 8000.0);
+
+        CompiledMidiSequence compiled;
+        compiled.compile (sequence, ts);
+
+        beginTest ("compile");
+        expectEquals (compiled.getNumEvents(), sequence.getNumEvents());
+        expect (compiled.isUpToDate (ts));
+
+        // at 120 bpm a tick is 25 frames
+        beginTest ("render");
+        checkBlocks (compiled, sequence, 25, 512);
+        checkBlocks (compiled, sequence, 25, 37);
+
+        beginTest ("merge");
+        {
+            MidiBuffer buffer;
+            buffer.ensureSize (compiled.getNumBytes() + 16);
+            buffer.addEvent (MidiMessage::controllerEvent (1, 7, 100), 10000);
+            compiled.render (buffer, 0, 24000);
+
+            MidiBuffer::Iterator iter (buffer);
+            const uint8* data;
+            int size, position, last = -1, count = 0;
+            bool sorted = true;
+            while (iter.getNextEvent (data, size, position))
+            {
+                sorted = sorted && position >= last;
+                last = position;
+                ++count;
+            }
+
+            expectEquals (count, 5);
+            expect (sorted, "events out of order");
+        }
+
+        // at 150 bpm a tick is 20 frames
+        beginTest ("tempo change");
+        ts.setTempo (150.0f);
+        ts.updateScale();
+        expect (! compiled.isUpToDate (ts));
+        expect (compiled.update (ts));
+        expect (! compiled.update (ts));
+        checkBlocks (compiled, sequence, 20, 512);
+    }
+
+private:
+    void checkBlocks (CompiledMidiSequence& compiled, const MidiMessageSequence& sequence,
+                      int framesPerTick, int blockSize)
+    {
+        MidiBuffer buffer;
+        buffer.ensureSize (compiled.getNumBytes());
+        const uint8* const storage = buffer.data.getRawDataPointer();
+
+        const int64 length = (int64) sequence.getEndTime() * framesPerTick + blockSize;
+        int numFound = 0;
+        bool matches = true;
+
+        for (int64 frame = 0; frame < length; frame += blockSize)
+        {
+            buffer.clear();
+            compiled.render (buffer, frame, blockSize);
+
+            MidiBuffer::Iterator iter (buffer);
+            const uint8* data;
+            int size, position;
+            while (iter.getNextEvent (data, size, position))
+            {
+                if (numFound >= sequence.getNumEvents())
+                {
+                    matches = false;
+                    break;
+                }
+
+                const MidiMessage& expected (sequence.getEventPointer (numFound++)->message);
+                matches = matches
+                    && frame + position == (int64) expected.getTimeStamp() * framesPerTick
+                    && size == expected.getRawDataSize()
+                    && memcmp (data, expected.getRawData(), (size_t) size) == 0;
+            }
+        }
+
+        expectEquals (numFound, sequence.getNumEvents());
+        expect (matches, "events differ with blocks of " + String (blockSize));
+        expect (buffer.data.getRawDataPointer() == storage, "rendering grew the buffer");
+    }
+};
+
+static CompiledMidiSequenceTest sCompiledMidiSequenceTest;
+
+
+//==============================================================================
+/** Converts frames, ticks, beats and bars there and back. Exact precision
+    has to hold for ten hours at tempos that don't divide the sample rate,
+    Float only for the first minute */
+class TimeScaleRoundTripTest : public UnitTest
+{
+public:
+    TimeScaleRoundTripTest() : UnitTest ("time scale round trips") { }
+
+    void runTest() override
+    {
+        const uint64 oneMinute = (uint64) 48000 * 60;
+        const uint64 tenHours  = oneMinute * 60 * 10;
+
+        const float tempos[] = { 120.0f, 133.7f, 97.3f };
+        for (const float tempo : tempos)
+        {
+            beginTest ("exact at " + String (tempo) + " bpm");
+            checkRoundTrips (TimeScale::Exact, tempo, tenHours);
+
+            beginTest ("float at " + String (tempo) + " bpm");
+            checkRoundTrips (TimeScale::Float, tempo, oneMinute);
+        }
+
+        beginTest ("float is the default");
+        expect (TimeScale().getPrecision() == TimeScale::Float);
+    }
+
+private:
+    void checkRoundTrips (TimeScale::Precision precision, float tempo, uint64 span)
+    {
+        TimeScale ts;
+        ts.setPrecision (precision);
+        ts.setSampleRate (48000);
+        ts.setTicksPerBeat (960);
+        ts.setTempo (tempo);
+        ts.updateScale();
+
+        const double framesPerTick = 48000.0 * 60.0 / ((double) tempo * 960.0);
+        double maxFrameError = 0.0, maxTickError = 0.0;
+
+        // frame to tick is the nearest tick, and back lands within half a tick
+        for (uint64 frame = 0; frame <= span; frame += span / 997)
+        {
+            const uint64 tick = ts.tickFromFrame (frame);
+            maxFrameError = jmax (maxFrameError, std::abs ((double) ts.frameFromTick (tick) - (double) frame));
+            maxTickError  = jmax (maxTickError, std::abs ((double) tick - (double) frame / framesPerTick));
+        }
+
+        expect (maxTickError < 0.501, "ticks off by " + String (maxTickError));
+        expect (maxFrameError <= framesPerTick * 0.5 + 1.0, "frames off by " + String (maxFrameError));
+
+        // ticks, beats and bars are longer than a frame, so come back exactly
+        int tickMisses = 0, beatMisses = 0, barMisses = 0;
+
+        const uint64 lastTick = ts.tickFromFrame (span);
+        for (uint64 tick = 0; tick <= lastTick; tick += lastTick / 1009)
+            if (ts.tickFromFrame (ts.frameFromTick (tick)) != tick)
+                ++tickMisses;
+
+        const unsigned int lastBeat = ts.beatFromFrame (span);
+        for (unsigned int beat = 0; beat <= lastBeat; beat += jmax (1u, lastBeat / 1009))
+            if (ts.beatFromFrame (ts.frameFromBeat (beat)) != beat)
+                ++beatMisses;
+
+        const unsigned int lastBar = ts.barFromFrame (span);
+        for (unsigned int bar = 0; bar <= lastBar; bar += jmax (1u, lastBar / 1009))
+            if (ts.barFromFrame (ts.frameFromBar (bar)) != bar)
+                ++barMisses;
+
+        expectEquals (tickMisses, 0);
+        expectEquals (beatMisses, 0);
+        expectEquals (barMisses, 0);
+    }
+};
+
+static TimeScaleRoundTripTest sTimeScaleRoundTripTest;
+
+
+//==============================================================================
+/** Checks MatrixState cell by cell in dense and sparse storage, and that
+    presets posted through a MatrixStateQueue arrive whole */
+class MatrixStateTest : public UnitTest
+{
+public:
+    MatrixStateTest() : UnitTest ("matrix state") { }
+
+    void runTest() override
+    {
+        Random random (1234);
+
+        beginTest ("valid cells");
+        {
+            MatrixState state (4, 7);
+            expect (state.isValid (0, 0) && state.isValid (3, 6));
+            expect (! state.isValid (-1, 0) && ! state.isValid (0, -1));
+            expect (! state.isValid (4, 0) && ! state.isValid (0, 7));
+            expect (! MatrixState().isValid (0, 0));
+
+            state.connect (4, 0);
+            state.connect (-1, 2);
+            state.set (0, 7, true);
+            expect (! state.toggleCell (0, -1));
+            expectEquals (state.getNumConnected(), 0);
+            expect (! state.connected (4, 0));
+            expect (! state.connectedAtIndex (-1) && ! state.connectedAtIndex (4 * 7));
+        }
+
+        beginTest ("resize");
+        {
+            const bool storage[] = { false, true };
+            for (const bool sparse : storage)
+            {
+                // 70 columns is two words a row, 130 is three
+                MatrixState original (70, 70, sparse);
+                randomise (original, random);
+
+                MatrixState state (original);
+                state.resize (40, 65);
+                expect (keptCells (state, original, 40, 65), "shrinking lost cells");
+                state.resize (100, 130);
+                expect (keptCells (state, original, 40, 65), "growing lost cells");
+            }
+        }
+
+        beginTest ("dense and sparse");
+        for (int i = 0; i < 20; ++i)
+        {
+            MatrixState dense (1 + random.nextInt (150), 1 + random.nextInt (150));
+            randomise (dense, random);
+
+            MatrixState sparse (dense);
+            sparse.setSparse (true);
+            expect (sparse.isSparse() && sameCells (sparse, dense));
+            expect (sparse == dense && dense == sparse);
+
+            sparse.setSparse (false);
+            expect (! sparse.isSparse() && sparse == dense);
+        }
+
+        beginTest ("changes");
+        for (int i = 0; i < 20; ++i)
+        {
+            const int rows = 1 + random.nextInt (100), columns = 1 + random.nextInt (100);
+            MatrixState from (rows, columns, random.nextBool());
+            MatrixState to (rows, columns, random.nextBool());
+            randomise (from, random);
+            randomise (to, random);
+
+            Array<uint32> changes;
+            to.getChangesFrom (from, changes);
+
+            MatrixState applied (from);
+            applied.setSparse (false);
+            applied.applyChanges (changes.getRawDataPointer(), changes.size());
+            expect (sameCells (applied, to));
+        }
+
+        beginTest ("queue");
+        {
+            // holds fewer changes than most presets, those go over whole
+            MatrixStateQueue queue (16);
+            MatrixState posted (64, 64), audio (64, 64);
+            queue.reset (posted);
+
+            for (int i = 0; i < 10; ++i)
+            {
+                const MatrixState previous (posted);
+                randomise (posted, random);
+                if (i == 9)
+                    for (int row = 0; row < posted.getNumRows(); ++row)
+                        posted.setRow (row, true);
+
+                Array<uint32> changes;
+                posted.getChangesFrom (previous, changes);
+
+                expect (queue.post (posted), "post didn't fit");
+                expectEquals (queue.apply (audio), changes.size());
+                expect (sameCells (audio, posted));
+            }
+
+            // presets posted before the audio thread runs arrive in order
+            randomise (posted, random);
+            expect (queue.post (posted));
+            posted.clear();
+            expect (queue.post (posted));
+            queue.apply (audio);
+            expect (sameCells (audio, posted));
+
+            // one whole matrix at a time, small changes queue up behind it
+            MatrixState big (posted), bigger (posted);
+            randomise (big, random);
+            randomise (bigger, random);
+            expect (queue.post (big));
+            expect (! queue.post (bigger), "replaced a whole matrix not yet applied");
+            MatrixState small (big);
+            small.toggleCell (3, 4);
+            expect (queue.post (small));
+            queue.apply (audio);
+            expect (sameCells (audio, small));
+            expect (queue.post (bigger));
+            queue.apply (audio);
+            expect (sameCells (audio, bigger));
+
+            // reset drops what the audio thread never applied
+            posted.clear();
+            expect (queue.post (posted));
+            queue.reset (bigger);
+            expectEquals (queue.apply (audio), 0);
+            expect (sameCells (audio, bigger));
+        }
+
+        beginTest ("legacy toggled restore");
+        {
+            BigInteger bits;
+            bits.setBit (0);
+            bits.setBit (5);
+            bits.setBit (3 * 7 + 6);
+            bits.setBit (200); // outside the matrix, ignored
+
+            ValueTree tree ("matrix");
+            tree.setProperty ("numRows", 4, nullptr);
+            tree.setProperty ("numColumns", 7, nullptr);
+            tree.setProperty ("toggled", bits.toString (2), nullptr);
+
+            MatrixState state;
+            state.restoreFromValueTree (tree);
+            expectEquals (state.getNumRows(), 4);
+            expectEquals (state.getNumColumns(), 7);
+            expectEquals (state.getNumConnected(), 3);
+            expect (state.connected (0, 0) && state.connected (0, 5) && state.connected (3, 6));
+
+            MatrixState restored;
+            restored.restoreFromValueTree (state.createValueTree());
+            expect (restored == state);
+        }
+    }
+
+private:
+    static void randomise (MatrixState& state, Random& random)
+    {
+        for (int row = 0; row < state.getNumRows(); ++row)
+            for (int column = 0; column < state.getNumColumns(); ++column)
+                state.set (row, column, random.nextInt (4) == 0);
+    }
+
+    static bool sameCells (const MatrixState& a, const MatrixState& b)
+    {
+        if (! a.sameSizeAs (b) || a.getNumConnected() != b.getNumConnected())
+            return false;
+
+        for (int row = 0; row < a.getNumRows(); ++row)
+            for (int column = 0; column < a.getNumColumns(); ++column)
+                if (a.connected (row, column) != b.connected (row, column))
+                    return false;
+
+        return true;
+    }
+
+    /** True if state has original's cells inside rows and columns, and
+        nothing outside them */
+    static bool keptCells (const MatrixState& state, const MatrixState& original, int rows, int columns)
+    {
+        int numKept = 0;
+        for (int row = 0; row < state.getNumRows(); ++row)
+        {
+            for (int column = 0; column < state.getNumColumns(); ++column)
+            {
+                const bool expected = row < rows && column < columns && original.connected (row, column);
+                if (state.connected (row, column) != expected)
+                    return false;
+                numKept += expected ? 1 : 0;
+            }
+        }
+
+        return state.getNumConnected() == numKept;
+    }
+};
+
+static MatrixStateTest sMatrixStateTest;
+
+
+//==============================================================================
+/** Checks that Shuttle::prepareBlock splits blocks at loop wraps, pending
+    locates and tempo nodes */
+class ShuttleTest : public UnitTest
+{
+public:
+    ShuttleTest() : UnitTest ("shuttle segments") { }
+
+    void runTest() override
+    {
+        beginTest ("loop wrap");
+        {
+            Shuttle shuttle;
+            shuttle.setSampleRate (48000.0);
+            shuttle.setLengthFrames (1000);
+            shuttle.setLoopStartFrames (200);
+            shuttle.setLooping (true);
+            shuttle.setPlaying (true);
+            shuttle.setPositionFrames (900);
+
+            expectEquals (shuttle.prepareBlock (256), 2);
+            expect (isSegment (shuttle, 0, 0, 100, 900));
+            expect (isSegment (shuttle, 1, 100, 156, 200, true));
+
+            // preparing the same block again gives the same segments
+            expectEquals (shuttle.prepareBlock (256), 2);
+            shuttle.advance (256);
+            expectEquals (shuttle.getPositionFrames(), (int64) 356);
+
+            // a wrap right at the end of a block
+            shuttle.setPositionFrames (744);
+            expectEquals (shuttle.prepareBlock (256), 1);
+            shuttle.advance (256);
+            expectEquals (shuttle.getPositionFrames(), (int64) 200);
+
+            // the next block starts on the wrap, then playback carries on
+            expectEquals (shuttle.prepareBlock (256), 1);
+            expect (isSegment (shuttle, 0, 0, 256, 200, true));
+            shuttle.advance (256);
+            expectEquals (shuttle.prepareBlock (256), 1);
+            expect (isSegment (shuttle, 0, 0, 256, 456));
+        }
+
+        beginTest ("pending locate");
+        {
+            Shuttle shuttle;
+            shuttle.setSampleRate (48000.0);
+            shuttle.setLooping (false);
+            shuttle.setPlaying (true);
+
+            shuttle.locate (5000, 100);
+            expectEquals (shuttle.prepareBlock (256), 2);
+            expect (isSegment (shuttle, 0, 0, 100, 0));
+            expect (isSegment (shuttle, 1, 100, 156, 5000, false, true));
+            shuttle.advance (256);
+            expectEquals (shuttle.getPositionFrames(), (int64) 5156);
+
+            // past the end of this block, so it lands in the next one
+            shuttle.locate (20000, 300);
+            expectEquals (shuttle.prepareBlock (256), 1);
+            shuttle.advance (256);
+            expectEquals (shuttle.getPositionFrames(), (int64) 5412);
+
+            expectEquals (shuttle.prepareBlock (256), 2);
+            expect (isSegment (shuttle, 0, 0, 44, 5412));
+            expect (isSegment (shuttle, 1, 44, 212, 20000, false, true));
+            shuttle.advance (256);
+            expectEquals (shuttle.getPositionFrames(), (int64) 20212);
+
+            // and only once
+            expectEquals (shuttle.prepareBlock (256), 1);
+        }
+
+        beginTest ("tempo node split");
+        {
+            Shuttle shuttle;
+            shuttle.setSampleRate (48000.0);
+            shuttle.setLooping (false);
+
+            // a bar of 4/4 at 120 bpm is 96000 frames
+            TimeScale map;
+            map.setSampleRate (48000);
+            map.addNode (0, 120.0f);
+            map.addNode (96000, 60.0f);
+            shuttle.setTimeScale (map);
+
+            shuttle.setPlaying (true);
+            shuttle.setPositionFrames (95900);
+            expectEquals (shuttle.prepareBlock (256), 2);
+            expect (isSegment (shuttle, 0, 0, 100, 95900));
+            expect (isSegment (shuttle, 1, 100, 156, 96000));
+            expect (shuttle.getSegment (0).bpm == 120.0);
+            expect (shuttle.getSegment (1).bpm == 60.0);
+
+            AudioPlayHead::CurrentPositionInfo info;
+            shuttle.setCurrentSegment (1);
+            expect (shuttle.getCurrentPosition (info));
+            expect (info.bpm == 60.0);
+            expectEquals (info.timeInSamples, (int64) 96000);
+            expectEquals (info.timeSigNumerator, 4);
+            expectEquals (info.timeSigDenominator, 4);
+            expect (std::abs (info.ppqPosition - 4.0) < 1.0e-9);
+
+            // stopped, the play head doesn't move so nothing splits
+            shuttle.setPlaying (false);
+            expectEquals (shuttle.prepareBlock (256), 1);
+        }
+
+        beginTest ("tempo map version");
+        {
+            Shuttle shuttle;
+            const uint32 version = shuttle.getTempoMapVersion();
+            shuttle.setPlaying (true);
+            shuttle.setPositionFrames (1000);
+            expect (shuttle.getTempoMapVersion() == version);
+
+            shuttle.setTempo (90.0f);
+            expect (shuttle.getTempoMapVersion() != version);
+
+            const uint32 afterTempo = shuttle.getTempoMapVersion();
+            TimeScale map;
+            map.setTempo (100.0f);
+            shuttle.setTimeScale (map);
+            expect (shuttle.getTempoMapVersion() != afterTempo);
+        }
+    }
+
+private:
+    /** True if the shuttle's segment at index starts at offset and frame */
+    static bool isSegment (const Shuttle& shuttle, int index, int offset, int numFrames, int64 frame,
+                           bool looped = false, bool located = false)
+    {
+        if (! isPositiveAndBelow (index, shuttle.getNumSegments()))
+            return false;
+
+        const Shuttle::Segment& segment (shuttle.getSegment (index));
+        return segment.offset == offset && segment.numFrames == numFrames && segment.frame == frame
+            && segment.looped == looped && segment.located == located;
+    }
+};
+
+static ShuttleTest sShuttleTest;
+
+
+//==============================================================================
+/** Checks MeterBus's block measurements against a plain scalar loop, over
+    lengths and alignments that use both the vector kernel and its tail */
+class MeterBusTest : public UnitTest
+{
+public:
+    MeterBusTest() : UnitTest ("meter bus") { }
+
+    void runTest() override
+    {
+        Random random (4321);
+        HeapBlock<float> samples (1024 + 4);
+        for (int i = 0; i < 1024 + 4; ++i)
+            samples[i] = random.nextFloat() * 2.5f - 1.25f;
+
+        // full scale counts as a clip, either sign
+        samples[10] = 1.0f;
+        samples[11] = -1.0f;
+        samples[12] = 0.99999994f;
+
+        beginTest ("kernel against scalar");
+        {
+            const int lengths[] = { 1, 3, 4, 5, 7, 16, 17, 64, 131, 1024 };
+            for (const int length : lengths)
+                for (int offset = 0; offset < 4; ++offset)
+                    expectMatchesScalar (samples + offset, length);
+        }
+
+        beginTest ("silence and negative peaks");
+        {
+            HeapBlock<float> block (37, true);
+            expectMatchesScalar (block, 37);
+            block[36] = -0.75f;     // in the tail
+            expectMatchesScalar (block, 37);
+            block[2] = -0.875f;     // in a vector lane
+            expectMatchesScalar (block, 37);
+        }
+    }
+
+private:
+    void expectMatchesScalar (const float* samples, int numSamples)
+    {
+        float peak = 0.0f, sumSquares = 0.0f;
+        uint32 clips = 0;
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const float a = std::abs (samples[i]);
+            peak = jmax (peak, a);
+            sumSquares += samples[i] * samples[i];
+            clips += a >= 1.0f ? 1u : 0u;
+        }
+
+        MeterBus bus (1);
+        bus.prepare (48000.0);
+        bus.process (0, samples, numSamples);
+        bus.publish();
+
+        MeterBus::Slot slot;
+        bus.read (&slot, 0, 1);
+
+        // from silence, the peak and hold are the block's peak and the mean
+        // square is one step of the RMS average. Sums differ by rounding only
+        const float rmsDecay = (float) std::exp (-numSamples / (0.3 * 48000.0));
+        const float rms = std::sqrt ((1.0f - rmsDecay) * (sumSquares / (float) numSamples));
+        expectEquals (slot.peak, peak);
+        expectEquals (slot.hold, peak);
+        expectEquals (slot.clips, clips);
+        expectWithinAbsoluteError (slot.rms, rms, rms * 1.0e-4f);
+    }
+};
+
+static MeterBusTest sMeterBusTest;
+
+
+//==============================================================================
+/** Records through a Shuttle driven block by block, like the audio thread
+    would, and checks overdubs, takes per loop pass and dropped events */
+class MidiRecorderTest : public UnitTest
+{
+public:
+    MidiRecorderTest() : UnitTest ("midi recorder") { }
+
+    void runTest() override
+    {
+        // the loop is half a bar of 4/4 at 120 bpm
+        TimeScale map;
+        map.setSampleRate (48000);
+        map.setTempo (120.0f);
+        map.updateScale();
+
+        MidiMessageSequence original;
+        original.addEvent (MidiMessage::controllerEvent (1, 7, 100), 0.0);
+
+        beginTest ("overdub");
+        {
+            Published published;
+            MidiRecorder recorder;
+            published.listen (recorder);
+            recorder.setTimeScale (map);
+            recorder.setSequence (original);
+            recorder.setLoopMode (MidiRecorder::Overdub);
+
+            Shuttle shuttle;
+            prepareLoop (shuttle, map);
+
+            // blocks end on the loop end, so passes start with a block
+            MidiBuffer input;
+            input.addEvent (MidiMessage::noteOn (1, 60, (uint8) 100), 1000);
+            input.addEvent (MidiMessage::noteOff (1, 60), 2000);
+            record (recorder, shuttle, input, 24000);
+            record (recorder, shuttle, MidiBuffer(), 24000);
+
+            // held when recording stops
+            input.clear();
+            input.addEvent (MidiMessage::noteOn (1, 62, (uint8) 100), 500);
+            record (recorder, shuttle, input, 24000);
+            record (recorder, shuttle, MidiBuffer(), 24000);
+
+            shuttle.setRecording (false);
+            record (recorder, shuttle, MidiBuffer(), 24000);
+
+            expect (published.waitFor (5));
+            const MidiMessageSequence sequence (published.get());
+            expectEquals (recorder.getNumTakes(), 0);
+            expect (sequence.getEventPointer (0)->message.isController());
+            expect (isEvent (sequence, 1, true, 62, tick (map, 500)));
+            expect (isEvent (sequence, 2, true, 60, tick (map, 1000)));
+            expect (isEvent (sequence, 3, false, 60, tick (map, 2000)));
+            expect (isEvent (sequence, 4, false, 62, tick (map, 48000)));
+            expectEquals (recorder.getNumDroppedEvents(), 0);
+        }
+
+        beginTest ("new take passes");
+        {
+            Published published;
+            MidiRecorder recorder;
+            published.listen (recorder);
+            recorder.setTimeScale (map);
+            recorder.setSequence (original);
+            recorder.setLoopMode (MidiRecorder::NewTake);
+
+            Shuttle shuttle;
+            prepareLoop (shuttle, map);
+
+            // blocks wrap part way through, passes start mid block
+            MidiBuffer input;
+            input.addEvent (MidiMessage::noteOn (1, 60, (uint8) 100), 100);
+            input.addEvent (MidiMessage::noteOff (1, 60), 200);
+            record (recorder, shuttle, input, 20000);
+            record (recorder, shuttle, MidiBuffer(), 20000);
+
+            // the wrap is at 8000, so pass 1 starts here
+            input.clear();
+            input.addEvent (MidiMessage::noteOn (1, 61, (uint8) 100), 8100);
+            input.addEvent (MidiMessage::noteOff (1, 61), 8200);
+            input.addEvent (MidiMessage::noteOn (1, 62, (uint8) 100), 8300);
+            record (recorder, shuttle, input, 20000);
+            record (recorder, shuttle, MidiBuffer(), 20000);
+
+            // and pass 2 at 16000
+            input.clear();
+            input.addEvent (MidiMessage::noteOn (1, 63, (uint8) 100), 16100);
+            input.addEvent (MidiMessage::noteOff (1, 63), 16200);
+            input.addEvent (MidiMessage::noteOn (1, 64, (uint8) 100), 16300);
+            input.addEvent (MidiMessage::noteOff (1, 64), 16400);
+            input.addEvent (MidiMessage::noteOn (1, 65, (uint8) 100), 16500);
+            record (recorder, shuttle, input, 20000);
+
+            shuttle.setRecording (false);
+            record (recorder, shuttle, MidiBuffer(), 20000);
+
+            // the original and the last take
+            expect (published.waitFor (1 + 6));
+            expectEquals (recorder.getNumTakes(), 3);
+
+            const MidiMessageSequence first (recorder.getTake (0));
+            expectEquals (first.getNumEvents(), 2);
+            expect (isEvent (first, 0, true, 60, tick (map, 100)));
+
+            // a note held over the wrap ends with the pass
+            const MidiMessageSequence second (recorder.getTake (1));
+            expectEquals (second.getNumEvents(), 4);
+            expect (isEvent (second, 0, true, 61, tick (map, 100)));
+            expect (isEvent (second, 3, false, 62, tick (map, 48000)));
+
+            const MidiMessageSequence third (recorder.getTake (2));
+            expectEquals (third.getNumEvents(), 6);
+            expect (isEvent (third, 0, true, 63, tick (map, 100)));
+            expect (isEvent (third, 5, false, 65, tick (map, 4000)));
+
+            recorder.selectTake (0);
+            expect (published.waitFor (1 + 2));
+            expect (isEvent (published.get(), 1, true, 60, tick (map, 100)));
+        }
+
+        beginTest ("dropped events");
+        {
+            Published published;
+            MidiRecorder recorder (64);
+            published.listen (recorder);
+            recorder.setTimeScale (map);
+
+            Shuttle shuttle;
+            prepareLoop (shuttle, map);
+
+            // the ring holds two of these, and the sysex is too large to record
+            const int numControllers = 10;
+            MidiBuffer input;
+            for (int i = 0; i < numControllers; ++i)
+                input.addEvent (MidiMessage::controllerEvent (1, 1, i), i);
+            uint8 sysex [298] = { 0 };
+            input.addEvent (MidiMessage::createSysExMessage (sysex, (int) sizeof (sysex)), numControllers);
+            record (recorder, shuttle, input, 512);
+
+            const int dropped = recorder.getNumDroppedEvents();
+            expect (dropped > 1);
+
+            // everything else gets recorded
+            expect (published.waitFor (numControllers + 1 - dropped));
+        }
+    }
+
+private:
+    /** Keeps the latest sequence the recorder hands on */
+    struct Published
+    {
+        void listen (MidiRecorder& recorder)
+        {
+            recorder.onSequenceChanged = [this] (const MidiMessageSequence& newSequence, const TimeScale&)
+            {
+                const ScopedLock sl (lock);
+                sequence = newSequence;
+                changed.signal();
+            };
+        }
+
+        MidiMessageSequence get() const
+        {
+            const ScopedLock sl (lock);
+            return sequence;
+        }
+
+        /** Waits up to five seconds for a sequence with numEvents */
+        bool waitFor (int numEvents)
+        {
+            for (int i = 0; i < 100; ++i)
+            {
+                if (get().getNumEvents() == numEvents)
+                    return true;
+                changed.wait (50);
+            }
+
+            return false;
+        }
+
+        CriticalSection lock;
+        MidiMessageSequence sequence;
+        WaitableEvent changed;
+    };
+
+    static void prepareLoop (Shuttle& shuttle, const TimeScale& map)
+    {
+        shuttle.setSampleRate (48000.0);
+        shuttle.setTimeScale (map);
+        shuttle.setLengthFrames (48000);
+        shuttle.setLoopStartFrames (0);
+        shuttle.setLooping (true);
+        shuttle.setRecording (true);
+        shuttle.setPlaying (true);
+    }
+
+    /** Captures a block the way the audio thread does */
+    static void record (MidiRecorder& recorder, Shuttle& shuttle, const MidiBuffer& input, int numFrames)
+    {
+        shuttle.prepareBlock (numFrames);
+        recorder.capture (shuttle, input);
+        shuttle.advance (numFrames);
+    }
+
+    static double tick (const TimeScale& map, int64 frame)
+    {
+        return (double) map.tickFromFrame ((uint64) frame);
+    }
+
+    static bool isEvent (const MidiMessageSequence& sequence, int index, bool noteOn, int note, double time)
+    {
+        if (! isPositiveAndBelow (index, sequence.getNumEvents()))
+            return false;
+
+        const MidiMessage& message (sequence.getEventPointer (index)->message);
+        return (noteOn ? message.isNoteOn() : message.isNoteOff()) && message.getNoteNumber() == note
+            && message.getTimeStamp() == time;
+    }
+};
+
+static MidiRecorderTest sMidiRecorderTest;
+
+
+//==============================================================================
+/** Checks LatencyGraph's path latencies and arc delays, and that delays
+    follow latency and arc changes */
+class LatencyGraphTest : public UnitTest
+{
+public:
+    LatencyGraphTest() : UnitTest ("latency graph") { }
+
+    void runTest() override
+    {
+        // 1 feeds 2 and 3, which both feed 4
+        const Arc arc12 (1, 0, 2, 0), arc13 (1, 0, 3, 0), arc24 (2, 0, 4, 0), arc34 (3, 0, 4, 1);
+
+        beginTest ("path sums");
+        {
+            LatencyGraph graph;
+            graph.setNodeLatency (2, 64);
+            graph.setNodeLatency (3, 16);
+            graph.setNodeLatency (4, 8);
+            graph.addArc (arc12);
+            graph.addArc (arc13);
+            graph.addArc (arc24);
+            graph.addArc (arc34);
+
+            expect (graph.update());
+            expectEquals (graph.getPathLatency (1), 0);
+            expectEquals (graph.getPathLatency (2), 64);
+            expectEquals (graph.getPathLatency (3), 16);
+            expectEquals (graph.getInputLatency (4), 64);
+            expectEquals (graph.getPathLatency (4), 72);
+            expectEquals (graph.getMaxPathLatency(), 72);
+            expectEquals (graph.getArcDelay (arc24), 0);
+            expectEquals (graph.getArcDelay (arc34), 48);
+
+            Array<uint32> order;
+            graph.getProcessingOrder (order);
+            expectEquals (order.size(), 4);
+            expect (order.getFirst() == 1 && order.getLast() == 4);
+        }
+
+        beginTest ("delay updates");
+        {
+            LatencyGraph graph;
+            graph.setNodeLatency (2, 64);
+            graph.setNodeLatency (3, 16);
+            graph.addArc (arc12);
+            graph.addArc (arc13);
+            graph.addArc (arc24);
+            graph.addArc (arc34);
+            graph.update();
+
+            graph.prepareDelayLines (1000, 64);
+            expect (graph.getDelayLine (arc24) != nullptr);
+            expectEquals (graph.getDelayLine (arc34)->getDelay(), 48);
+
+            // the short path becomes the long one
+            graph.setNodeLatency (3, 100);
+            expect (graph.update());
+            expectEquals (graph.getArcDelay (arc24), 36);
+            expectEquals (graph.getArcDelay (arc34), 0);
+            expectEquals (graph.getDelayLine (arc24)->getDelay(), 36);
+            expectEquals (graph.getDelayLine (arc34)->getDelay(), 0);
+            expectEquals (graph.getPathLatency (4), 100);
+
+            // nothing changed
+            graph.setNodeLatency (3, 100);
+            expect (! graph.update());
+
+            graph.removeArc (arc34);
+            expect (graph.update());
+            expectEquals (graph.getPathLatency (4), 64);
+            expectEquals (graph.getArcDelay (arc24), 0);
+
+            // a new arc gets a delay line while prepared
+            graph.addArc (arc34);
+            expect (graph.update());
+            expect (graph.getDelayLine (arc34) != nullptr);
+            expectEquals (graph.getDelayLine (arc24)->getDelay(), 36);
+
+            graph.releaseDelayLines();
+            expect (graph.getDelayLine (arc24) == nullptr);
+        }
+
+        beginTest ("delay line");
+        {
+            DelayLine line;
+            line.prepare (100, 16);
+            line.setDelay (500);
+            expectEquals (line.getDelay(), 100);
+
+            line.setDelay (5);
+            float block [16] = { 1.0f };
+            line.process (block, 16);
+            for (int i = 0; i < 16; ++i)
+                expect (block[i] == (i == 5 ? 1.0f : 0.0f));
+
+            // the ring wraps without losing anything
+            int found = 0;
+            for (int i = 0; i < 20; ++i)
+            {
+                float pulse [16] = { 0.0f };
+                if (i == 9)
+                    pulse[15] = 1.0f;
+                line.process (pulse, 16);
+                for (int j = 0; j < 16; ++j)
+                    if (pulse[j] != 0.0f)
+                        found += (i == 10 && j == 4) ? 1 : 100;
+            }
+            expectEquals (found, 1);
+        }
+    }
+};
+
+static LatencyGraphTest sLatencyGraphTest;
+
+
+//==============================================================================
+/** Checks that GraphProcessor lines up parallel paths with different
+    latencies, and follows a node's latency when it changes */
+class GraphProcessorTest : public UnitTest
+{
+public:
+    GraphProcessorTest() : UnitTest ("graph processor") { }
+
+    void runTest() override
+    {
+        beginTest ("compensation");
+        GraphProcessor graph (1, 1);
+        LatentProcessor* const latent = new LatentProcessor (10);
+        const uint32 node = graph.addNode (latent);
+
+        // a lookahead path and a dry one, mixed at the output
+        expect (graph.connect (GraphProcessor::audioInputNode, 0, node, 0));
+        expect (graph.connect (node, 0, GraphProcessor::audioOutputNode, 0));
+        expect (graph.connect (GraphProcessor::audioInputNode, 0, GraphProcessor::audioOutputNode, 0));
+        expect (! graph.canConnect (node, 0, GraphProcessor::audioOutputNode, 0));
+        expectEquals (graph.getLatencySamples(), 10);
+
+        graph.prepareToPlay (48000.0, 64);
+        expectEquals (findImpulse (graph), 10);
+
+        beginTest ("latency change");
+        latent->setLatency (20);
+        graph.updateLatencies();    // done on the message thread when running
+        expectEquals (graph.getLatencySamples(), 20);
+        expectEquals (findImpulse (graph), 20);
+
+        beginTest ("cycles");
+        const uint32 other = graph.addNode (new LatentProcessor (0));
+        expect (graph.connect (node, 0, other, 0));
+        expect (! graph.canConnect (other, 0, node, 0));
+        expect (! graph.canConnect (node, 0, node, 0));
+
+        graph.removeNode (other);
+        expect (graph.getNodeProcessor (other) == nullptr);
+        expectEquals (findImpulse (graph), 20);
+        graph.releaseResources();
+    }
+
+private:
+    /** Delays its input and reports it as latency, like a lookahead limiter */
+    class LatentProcessor : public AudioProcessor
+    {
+    public:
+        explicit LatentProcessor (int samples)
+        {
+            setPlayConfigDetails (1, 1, 44100.0, 512);
+            setLatency (samples);
+        }
+
+        void setLatency (int samples)
+        {
+            setLatencySamples (samples);
+            line.setDelay (samples);
+        }
+
+        const String getName() const override { return "Latent"; }
+
+        void prepareToPlay (double, int blockSize) override
+        {
+            line.prepare (1000, blockSize);
+            line.setDelay (getLatencySamples());
+        }
+
+        void releaseResources() override { }
+
+        void processBlock (AudioSampleBuffer& buffer, MidiBuffer&) override
+        {
+            line.process (buffer.getWritePointer (0), buffer.getNumSamples());
+        }
+
+        double getTailLengthSeconds() const override { return 0.0; }
+        bool acceptsMidi() const override { return false; }
+        bool producesMidi() const override { return false; }
+        AudioProcessorEditor* createEditor() override { return nullptr; }
+        bool hasEditor() const override { return false; }
+        int getNumPrograms() override { return 1; }
+        int getCurrentProgram() override { return 0; }
+        void setCurrentProgram (int) override { }
+        const String getProgramName (int) override { return String(); }
+        void changeProgramName (int, const String&) override { }
+        void getStateInformation (MemoryBlock&) override { }
+        void setStateInformation (const void*, int) override { }
+
+    private:
+        DelayLine line;
+    };
+
+    /** Sends an impulse through after some silence. Returns where it comes
+        out, if both paths land on the same sample, or -1 */
+    static int findImpulse (GraphProcessor& graph)
+    {
+        AudioSampleBuffer buffer (1, 64);
+        MidiBuffer midi;
+        for (int i = 0; i < 4; ++i)
+        {
+            buffer.clear();
+            graph.processBlock (buffer, midi);
+        }
+
+        buffer.clear();
+        buffer.setSample (0, 0, 1.0f);
+        graph.processBlock (buffer, midi);
+
+        int position = -1;
+        for (int i = 0; i < buffer.getNumSamples(); ++i)
+        {
+            const float sample = buffer.getSample (0, i);
+            if (sample == 0.0f)
+                continue;
+            if (position >= 0 || sample != 2.0f)
+                return -1;
+            position = i;
+        }
+
+        return position;
+    }
+};
+
+static GraphProcessorTest sGraphProcessorTest;
+
 }
 
 int main (int argc, char* argv[])
@@ -0,0 +1,131 @@
+/*
+    This file is part of the Kushview Modules for JUCE
+    Copyright (C) 2014-2017  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#ifndef KV_ADAPTIVE_LOCK_SPIN_COUNT
+ #define KV_ADAPTIVE_LOCK_SPIN_COUNT 200
+#endif
+
+AdaptiveLock::AdaptiveLock()
+    : spinCount (KV_ADAPTIVE_LOCK_SPIN_COUNT),
+      acquiredAt (0)
+{
+    state.store (0);
+    waiters.store (0);
+    tracing.store (false);
+    parked.setSpinCount (0);
+    resetStats();
+}
+
+AdaptiveLock::~AdaptiveLock()
+{
+    jassert (! isLocked()); // deleting a lock that's still held
+}
+
+void AdaptiveLock::acquired() const noexcept
+{
+    numAcquired.fetch_add (1, std::memory_order_relaxed);
+    if (tracing.load (std::memory_order_relaxed))
+        acquiredAt = Time::getHighResolutionTicks();
+}
+
+bool AdaptiveLock::tryEnter() const noexcept
+{
+    if (! tryAcquire())
+    {
+        numFailedTries.fetch_add (1, std::memory_order_relaxed);
+        return false;
+    }
+
+    acquired();
+    return true;
+}
+
+void AdaptiveLock::enter() const noexcept
+{
+    if (tryAcquire())
+    {
+        acquired();
+        return;
+    }
+
+    numContended.fetch_add (1, std::memory_order_relaxed);
+
+    // holders are usually done within microseconds, so spin first
+    for (int i = 0; i < spinCount; ++i)
+    {
+        if (state.load (std::memory_order_relaxed) == 0 && tryAcquire())
+        {
+            acquired();
+            return;
+        }
+
+        if (i < spinCount / 2)
+            KV_SPIN_PAUSE();
+        else
+            Thread::yield();
+    }
+
+    // then park.  waiters is raised before trying again, so an exit() that
+    // comes after the try always sees it and posts
+    numParked.fetch_add (1, std::memory_order_relaxed);
+    waiters.fetch_add (1);
+    while (! tryAcquire())
+        parked.wait();
+    waiters.fetch_sub (1);
+    acquired();
+}
+
+void AdaptiveLock::exit() const noexcept
+{
+    if (tracing.load (std::memory_order_relaxed) && acquiredAt != 0)
+    {
+        const int64 held = Time::getHighResolutionTicks() - acquiredAt;
+        acquiredAt = 0;
+        totalHoldTicks.fetch_add (held, std::memory_order_relaxed);
+        int64 longest = maxHoldTicks.load (std::memory_order_relaxed);
+        while (held > longest && ! maxHoldTicks.compare_exchange_weak (longest, held, std::memory_order_relaxed))
+            { }
+    }
+
+    state.store (0);
+    if (waiters.load() > 0)
+        parked.post();
+}
+
+AdaptiveLock::Stats AdaptiveLock::getStats() const noexcept
+{
+    Stats stats;
+    stats.numAcquired    = numAcquired.load (std::memory_order_relaxed);
+    stats.numContended   = numContended.load (std::memory_order_relaxed);
+    stats.numParked      = numParked.load (std::memory_order_relaxed);
+    stats.numFailedTries = numFailedTries.load (std::memory_order_relaxed);
+    stats.maxHoldTime    = Time::highResolutionTicksToSeconds (maxHoldTicks.load (std::memory_order_relaxed));
+    stats.totalHoldTime  = Time::highResolutionTicksToSeconds (totalHoldTicks.load (std::memory_order_relaxed));
+    return stats;
+}
+
+void AdaptiveLock::resetStats() noexcept
+{
+    numAcquired.store (0);
+    numContended.store (0);
+    numParked.store (0);
+    numFailedTries.store (0);
+    maxHoldTicks.store (0);
+    totalHoldTicks.store (0);
+}
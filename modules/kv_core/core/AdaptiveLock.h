@@ -0,0 +1,161 @@
+/*
+    This file is part of the Kushview Modules for JUCE
+    Copyright (C) 2014-2017  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+/** A lock for sharing data between the audio thread and other threads.
+
+    The audio thread should only ever call tryEnter(), which never blocks or
+    spins, and skip its work when the lock is busy. Other threads call
+    enter(), which spins briefly and then parks on a semaphore instead of
+    burning the CPU a preempted holder needs to finish.
+
+    Contention is counted and hold times can be traced, so priority inversion
+    shows up in the stats rather than as unexplained xruns.
+
+    This isn't recursive, see AtomicLock for that.
+ */
+class AdaptiveLock
+{
+public:
+    struct Stats
+    {
+        Stats() { zerostruct (*this); }
+
+        int64 numAcquired;      ///< times the lock was taken
+        int64 numContended;     ///< times enter() found it busy
+        int64 numParked;        ///< times enter() had to block
+        int64 numFailedTries;   ///< times tryEnter() found it busy
+        double maxHoldTime;     ///< seconds, only if tracing
+        double totalHoldTime;   ///< seconds, only if tracing
+    };
+
+    AdaptiveLock();
+    ~AdaptiveLock();
+
+    /** Take the lock, spinning a little and then blocking. Not realtime safe */
+    void enter() const noexcept;
+
+    /** Take the lock if it's free. Never blocks, realtime safe */
+    bool tryEnter() const noexcept;
+
+    /** Release the lock. Realtime safe */
+    void exit() const noexcept;
+
+    /** Returns true if some thread has the lock */
+    bool isLocked() const noexcept { return state.load (std::memory_order_relaxed) != 0; }
+
+    /** Set how many times enter() tries before parking */
+    void setSpinCount (int count) noexcept { spinCount = jmax (0, count); }
+
+    /** Turn hold time tracing on or off. This costs a clock read on every
+        enter and exit, so is off by default */
+    void setTracingEnabled (bool enabled) noexcept { tracing.store (enabled); }
+
+    Stats getStats() const noexcept;
+    void resetStats() noexcept;
+
+    typedef GenericScopedLock<AdaptiveLock>       ScopedLockType;
+    typedef GenericScopedTryLock<AdaptiveLock>    ScopedTryLockType;
+    typedef GenericScopedUnlock<AdaptiveLock>     ScopedUnlockType;
+
+private:
+    mutable std::atomic<int> state;
+    mutable std::atomic<int> waiters;
+    mutable Semaphore parked;
+    int spinCount;
+
+    std::atomic<bool> tracing;
+    mutable int64 acquiredAt;
+
+    mutable std::atomic<int64> numAcquired, numContended, numParked, numFailedTries;
+    mutable std::atomic<int64> maxHoldTicks, totalHoldTicks;
+
+    inline bool tryAcquire() const noexcept
+    {
+        int expected = 0;
+        return state.compare_exchange_strong (expected, 1, std::memory_order_acquire,
+                                              std::memory_order_relaxed);
+    }
+
+    void acquired() const noexcept;
+
+    JUCE_DECLARE_NON_COPYABLE (AdaptiveLock)
+};
+
+/** A recursive AdaptiveLock.
+
+    The same thread can lock() it more than once, and it's released when
+    unlock() has been called as many times.
+ */
+class AtomicLock : public AdaptiveLock
+{
+public:
+    AtomicLock() : owner (nullptr), count (0) { }
+
+    /** Take the lock if free or already held by this thread. Realtime safe */
+    inline bool acquire()
+    {
+        const Thread::ThreadID self = Thread::getCurrentThreadId();
+        if (owner.load (std::memory_order_relaxed) == self)
+        {
+            ++count;
+            return true;
+        }
+
+        if (! tryEnter())
+            return false;
+        owner.store (self, std::memory_order_relaxed);
+        count = 1;
+        return true;
+    }
+
+    inline void release() { unlock(); }
+
+    inline void lock()
+    {
+        const Thread::ThreadID self = Thread::getCurrentThreadId();
+        if (owner.load (std::memory_order_relaxed) == self)
+        {
+            ++count;
+            return;
+        }
+
+        enter();
+        owner.store (self, std::memory_order_relaxed);
+        count = 1;
+    }
+
+    inline void unlock()
+    {
+        jassert (owner.load (std::memory_order_relaxed) == Thread::getCurrentThreadId());
+        if (--count > 0)
+            return;
+
+        count = 0;
+        owner.store (nullptr, std::memory_order_relaxed);
+        exit();
+    }
+
+    inline bool isBusy() const { return isLocked(); }
+
+private:
+    std::atomic<Thread::ThreadID> owner;
+    int count;
+};
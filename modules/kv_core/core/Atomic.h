@@ -19,6 +19,10 @@
 
 #pragma once
 
+/** A double buffered value for small types.
+
+    get() returns a reference into a slot a later set() may overwrite, so
+    for anything bigger than a few words use TripleBuffer or SeqLock */
 template<typename ValueType>
 class AtomicValue
 {
@@ -92,47 +96,3 @@ private:
     ValueType                  values[2];
 };
 
-
-class AtomicLock
-{
-public:
-
-    AtomicLock()
-        : a_mutex(),
-          a_locks(0)
-    { }
-
-    inline bool acquire()
-    {
-        return ! a_mutex.test_and_set (std::memory_order_acquire);
-    }
-
-    inline void release()
-    {
-        a_mutex.clear (std::memory_order_release);
-    }
-
-    inline void lock()
-    {
-        a_locks.set (a_locks.get() + 1);
-        if (a_locks.get() == 1)
-            while (! acquire())
-                ; // spin
-    }
-
-    inline void unlock()
-    {
-        a_locks.set (a_locks.get() - 1);
-        if (a_locks.get() < 1)
-        {
-            a_locks.set(0);
-            release();
-        }
-    }
-
-    inline bool isBusy() const { return a_locks.get() > 0; }
-
-private:
-    std::atomic_flag    a_mutex;
-    AtomicValue<int>    a_locks;
-};
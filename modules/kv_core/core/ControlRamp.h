@@ -0,0 +1,82 @@
+/*
+    This file is part of the Kushview Modules for JUCE
+    Copyright (C) 2014-2017  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+/** Up-samples a block rate control value into an audio rate CV buffer.
+
+    Each call to render() writes a linear ramp from the last rendered value
+    to the new target over the length of the block.  The ramp is computed
+    with FloatVectorOperations against a precomputed index table, so it
+    costs about the same as a buffer copy.  LV2Module drives each CV input
+    that isn't bound to host memory with one, from the port's control value.
+ */
+class ControlRamp
+{
+public:
+    ControlRamp() : value (0.0f), maxBlockSize (0) { }
+    ~ControlRamp() { }
+
+    /** Allocate the ramp table. This is NOT realtime safe */
+    inline void setMaxBlockSize (const int newMaxBlockSize)
+    {
+        if (newMaxBlockSize == maxBlockSize)
+            return;
+
+        maxBlockSize = jmax (0, newMaxBlockSize);
+        table.allocate ((size_t) jmax (1, maxBlockSize), true);
+        for (int i = 0; i < maxBlockSize; ++i)
+            table[i] = (float) (i + 1);
+    }
+
+    inline int getMaxBlockSize() const { return maxBlockSize; }
+
+    /** Jump to a value without ramping */
+    inline void reset (const float newValue) { value = newValue; }
+
+    /** Returns the last value rendered */
+    inline float getValue() const { return value; }
+
+    /** Render a ramp from the current value to target.  The last sample
+        written will equal the target. Realtime safe. */
+    inline void render (float* dest, int numSamples, const float target)
+    {
+        jassert (numSamples <= maxBlockSize);
+        numSamples = jmin (numSamples, maxBlockSize);
+        if (numSamples <= 0)
+            return;
+
+        if (target == value)
+        {
+            FloatVectorOperations::fill (dest, value, numSamples);
+            return;
+        }
+
+        const float delta = (target - value) / (float) numSamples;
+        FloatVectorOperations::copyWithMultiply (dest, table.getData(), delta, numSamples);
+        FloatVectorOperations::add (dest, value, numSamples);
+        dest [numSamples - 1] = value = target;
+    }
+
+private:
+    float value;
+    int maxBlockSize;
+    HeapBlock<float> table;
+    JUCE_DECLARE_NON_COPYABLE (ControlRamp)
+};
@@ -0,0 +1,100 @@
+/*
+    This file is part of the Kushview Modules for JUCE
+    Copyright (C) 2014-2017  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+/** A single channel delay with a variable, whole sample, delay time.
+    Used to line up signals which took paths with different latencies. */
+class DelayLine
+{
+public:
+    DelayLine() : maxDelay (0), maxBlockSize (0), size (0), writePos (0) { delay.set (0); }
+    ~DelayLine() { }
+
+    /** Allocate the delay buffer. This is NOT realtime safe */
+    inline void prepare (const int newMaxDelay, const int newMaxBlockSize)
+    {
+        maxDelay     = jmax (0, newMaxDelay);
+        maxBlockSize = jmax (1, newMaxBlockSize);
+        size         = maxDelay + maxBlockSize;
+        buffer.calloc ((size_t) size);
+        writePos = 0;
+        delay.set (jmin (delay.get(), maxDelay));
+    }
+
+    /** Clear delayed samples. Realtime safe */
+    inline void clear()
+    {
+        FloatVectorOperations::clear (buffer.getData(), size);
+    }
+
+    /** Set the delay in samples.  This can be called from any thread, the
+        new delay takes effect on the next call to process */
+    inline void setDelay (const int samples)    { delay.set (jlimit (0, maxDelay, samples)); }
+
+    /** Get the delay in samples */
+    inline int getDelay() const                 { return delay.get(); }
+
+    /** Get the largest delay this can be set to */
+    inline int getMaxDelay() const              { return maxDelay; }
+
+    /** Delay a block of samples in place. Realtime safe */
+    inline void process (float* data, const int numSamples)
+    {
+        jassert (numSamples <= maxBlockSize);
+        const int d = delay.get();
+        if (d <= 0 || size <= 0)
+            return;
+
+        // the block is written before reading, so the ring only needs to
+        // hold the delay plus one block
+        copyIn (data, writePos, numSamples);
+        int readPos = writePos - d;
+        if (readPos < 0)
+            readPos += size;
+        copyOut (data, readPos, numSamples);
+
+        writePos += numSamples;
+        if (writePos >= size)
+            writePos -= size;
+    }
+
+private:
+    int maxDelay, maxBlockSize, size, writePos;
+    Atomic<int> delay;
+    HeapBlock<float> buffer;
+
+    inline void copyIn (const float* src, const int pos, const int numSamples)
+    {
+        const int size1 = jmin (numSamples, size - pos);
+        FloatVectorOperations::copy (buffer + pos, src, size1);
+        if (numSamples > size1)
+            FloatVectorOperations::copy (buffer.getData(), src + size1, numSamples - size1);
+    }
+
+    inline void copyOut (float* dest, const int pos, const int numSamples)
+    {
+        const int size1 = jmin (numSamples, size - pos);
+        FloatVectorOperations::copy (dest, buffer + pos, size1);
+        if (numSamples > size1)
+            FloatVectorOperations::copy (dest + size1, buffer.getData(), numSamples - size1);
+    }
+
+    JUCE_DECLARE_NON_COPYABLE (DelayLine)
+};
@@ -0,0 +1,458 @@
+/*
+    This file is part of the Kushview Modules for JUCE
+    Copyright (C) 2014-2017  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+/** A single producer, single consumer ring of zones, claimed by one thread.
+    Each claim is numbered, so a thread can tell when its ring was given
+    back and claimed by another */
+struct DspProfiler::Ring : public ReferenceCountedObject
+{
+    Ring (int ringIndex) : index (ringIndex)
+    {
+        claimed.store (false);
+        claims.store (0);
+        writePos.store (0);
+        readPos.store (0);
+        events.calloc (ringSize);
+    }
+
+    /** Returns the claim's number, or 0 if another thread has the ring */
+    uint32 claim() noexcept
+    {
+        bool expected = false;
+        if (! claimed.compare_exchange_strong (expected, true))
+            return 0;
+        uint32 number = claims.load() + 1;
+        number = number != 0 ? number : 1;
+        claims.store (number, std::memory_order_release);
+        return number;
+    }
+
+    inline bool push (const Event& event) noexcept
+    {
+        const uint32 w = writePos.load (std::memory_order_relaxed);
+        if (w - readPos.load (std::memory_order_acquire) >= (uint32) ringSize)
+            return false;
+        events [w & (ringSize - 1)] = event;
+        writePos.store (w + 1, std::memory_order_release);
+        return true;
+    }
+
+    template<class Function>
+    inline void drain (Function f)
+    {
+        uint32 r = readPos.load (std::memory_order_relaxed);
+        const uint32 w = writePos.load (std::memory_order_acquire);
+        while (r != w)
+            f (events [r++ & (ringSize - 1)]);
+        readPos.store (r, std::memory_order_release);
+    }
+
+    const int index;
+    std::atomic<bool> claimed;
+    std::atomic<uint32> claims;
+    std::atomic<uint32> writePos, readPos;
+    HeapBlock<Event> events;
+};
+
+/** The ring a thread records into. The profiler keeps its rings until it
+    is deleted, so the ring is only looked at when the IDs match */
+struct DspProfiler::ThreadRing
+{
+    uint32 profilerId;
+    uint32 claim;
+    Ring* ring;
+    bool prepared;
+};
+
+/** Gives a prepared thread's ring back when the thread exits. It holds a
+    reference, so the ring outlives a profiler deleted before the thread */
+struct DspProfiler::ThreadExit
+{
+    ~ThreadExit()
+    {
+        if (ring != nullptr && ring->claims.load() == claim)
+            ring->claimed.store (false);
+    }
+
+    ReferenceCountedObjectPtr<Ring> ring;
+    uint32 claim = 0;
+};
+
+struct DspProfiler::Node
+{
+    Node() : active (false), id (-1), generation (0) { recent.calloc (numRecentDurations); clear(); }
+
+    void clear()
+    {
+        count = total = 0;
+        minTicks = std::numeric_limits<int64>::max();
+        maxTicks = 0;
+        numRecent = recentPos = 0;
+    }
+
+    void add (int64 ticks)
+    {
+        ++count;
+        total += ticks;
+        minTicks = jmin (minTicks, ticks);
+        maxTicks = jmax (maxTicks, ticks);
+        recent [recentPos] = ticks;
+        recentPos = (recentPos + 1) % numRecentDurations;
+        numRecent = jmin (numRecent + 1, (int) numRecentDurations);
+    }
+
+    String name;
+    bool active;
+    int id, generation;
+    int64 count, total, minTicks, maxTicks;
+    HeapBlock<int64> recent;
+    int numRecent, recentPos;
+};
+
+thread_local DspProfiler::ThreadRing DspProfiler::threadRing = { 0, 0, nullptr, false };
+thread_local DspProfiler::ThreadExit DspProfiler::threadExit;
+
+// profilers are told apart by ID, a new one can have a deleted one's address
+static std::atomic<uint32> lastProfilerId (0);
+
+// node IDs are a slot plus how many times the slot has been registered
+static const int maxNodeGenerations = std::numeric_limits<int>::max() / DspProfiler::maxNodes;
+
+DspProfiler::DspProfiler()
+    : profilerId (++lastProfilerId),
+      tracing (false)
+{
+    enabled.store (false);
+    dropped.store (0);
+    periodMs.store (0.0);
+    numRings.store (0);
+}
+
+DspProfiler::~DspProfiler()
+{
+    enabled.store (false);
+}
+
+DspProfiler& DspProfiler::getDefault()
+{
+    static DspProfiler profiler;
+    return profiler;
+}
+
+void DspProfiler::setEnabled (bool shouldBeEnabled)
+{
+    if (shouldBeEnabled)
+    {
+        const ScopedLock sl (lock);
+        enabled.store (true);
+        addSpareRings();
+    }
+    else
+    {
+        enabled.store (false);
+    }
+}
+
+void DspProfiler::addSpareRings()
+{
+    // threads claim rings from the audio thread, so keep a few free ones ready
+    int n = numRings.load();
+    int numFree = 0;
+    for (int i = 0; i < n; ++i)
+        if (! rings[i]->claimed.load())
+            ++numFree;
+
+    for (; numFree < numSpareRings && n < maxThreads; ++numFree)
+    {
+        rings[n] = new Ring (n);
+        numRings.store (++n, std::memory_order_release);
+    }
+}
+
+void DspProfiler::setTracingEnabled (bool shouldTrace)
+{
+    const ScopedLock sl (lock);
+    tracing = shouldTrace;
+    if (tracing)
+        trace.ensureStorageAllocated (ringSize);
+}
+
+void DspProfiler::setCallbackPeriod (double sampleRate, int blockSize)
+{
+    periodMs.store (sampleRate > 0.0 ? 1000.0 * (double) blockSize / sampleRate : 0.0);
+}
+
+int DspProfiler::registerNode (const String& name)
+{
+    const ScopedLock sl (lock);
+
+    int nodeId = 0;
+    while (nodeId < nodes.size() && nodes.getUnchecked(nodeId)->active)
+        ++nodeId;
+
+    if (nodeId >= maxNodes)
+        return -1;
+    if (nodeId == nodes.size())
+        nodes.add (new Node());
+
+    Node* const node = nodes.getUnchecked (nodeId);
+    node->name = name;
+    node->active = true;
+    node->generation = (node->generation + 1) % maxNodeGenerations;
+    node->id = nodeId + maxNodes * node->generation;
+    node->clear();
+    return node->id;
+}
+
+void DspProfiler::unregisterNode (int nodeId)
+{
+    if (nodeId < 0)
+        return;
+
+    const ScopedLock sl (lock);
+    Node* const node = nodes [nodeId % maxNodes];
+    if (node != nullptr && node->id == nodeId)
+    {
+        node->active = false;
+        node->name = String();
+        node->clear();
+    }
+}
+
+bool DspProfiler::holdsRing (const ThreadRing& local) const noexcept
+{
+    return local.profilerId == profilerId && local.ring != nullptr
+        && local.ring->claims.load (std::memory_order_acquire) == local.claim;
+}
+
+void DspProfiler::claimRing (ThreadRing& local) noexcept
+{
+    // a ring still held from another profiler can't be given back here,
+    // that profiler may have been deleted
+    local.profilerId = profilerId;
+    local.ring = nullptr;
+    local.claim = 0;
+
+    const int n = numRings.load (std::memory_order_acquire);
+    for (int i = 0; i < n; ++i)
+    {
+        if (const uint32 number = rings[i]->claim())
+        {
+            local.ring = rings[i].get();
+            local.claim = number;
+
+            // prepareThread() already registered the exit handler
+            if (local.prepared)
+            {
+                threadExit.ring  = rings[i];
+                threadExit.claim = number;
+            }
+            return;
+        }
+    }
+}
+
+void DspProfiler::prepareThread()
+{
+    // first use of the exit handler registers it, so do that here rather
+    // than on the first zone
+    ThreadRing& local = threadRing;
+    threadExit.ring  = holdsRing (local) ? local.ring : nullptr;
+    threadExit.claim = local.claim;
+    local.prepared = true;
+
+    if (isEnabled() && ! holdsRing (local))
+    {
+        const ScopedLock sl (lock);
+        addSpareRings();
+        claimRing (local);
+    }
+}
+
+int DspProfiler::reserveRing()
+{
+    const ScopedLock sl (lock);
+    addSpareRings();
+
+    for (int i = 0; i < numRings.load(); ++i)
+        if (rings[i]->claim() != 0)
+            return i;
+
+    return -1;
+}
+
+void DspProfiler::useRing (int ringIndex) noexcept
+{
+    if (! isPositiveAndBelow (ringIndex, numRings.load (std::memory_order_acquire)))
+        return;
+
+    ThreadRing& local = threadRing;
+    Ring* const ring = rings[ringIndex].get();
+    local.profilerId = profilerId;
+    local.ring = ring;
+    local.claim = ring->claims.load (std::memory_order_acquire);
+}
+
+void DspProfiler::releaseRing (int ringIndex)
+{
+    const ScopedLock sl (lock);
+    if (isPositiveAndBelow (ringIndex, numRings.load()))
+        rings[ringIndex]->claimed.store (false);
+}
+
+void DspProfiler::record (int nodeId, int64 startTicks, int64 endTicks) noexcept
+{
+    if (nodeId < 0)
+        return;
+
+    ThreadRing& local = threadRing;
+    if (! holdsRing (local))
+        claimRing (local);
+    Ring* const ring = local.ring;
+
+    Event event;
+    event.node   = nodeId;
+    event.thread = ring != nullptr ? ring->index : -1;
+    event.start  = startTicks;
+    event.end    = endTicks;
+
+    if (ring == nullptr || ! ring->push (event))
+        ++dropped;
+}
+
+void DspProfiler::collect()
+{
+    const ScopedLock sl (lock);
+
+    // rings of threads that exited may still hold zones, so drain them all
+    for (int i = 0; i < numRings.load(); ++i)
+    {
+        rings[i]->drain ([this] (const Event& event)
+        {
+            Node* const node = nodes [event.node % maxNodes];
+            if (node == nullptr || ! node->active || node->id != event.node)
+                return;
+
+            node->add (event.end - event.start);
+            if (tracing && trace.size() < maxTraceEvents)
+                trace.add (event);
+        });
+    }
+
+    if (enabled.load())
+        addSpareRings();
+}
+
+Array<DspProfiler::NodeStats> DspProfiler::getNodeStats()
+{
+    collect();
+
+    const ScopedLock sl (lock);
+    const double msPerTick = 1000.0 / (double) Time::getHighResolutionTicksPerSecond();
+    const double period = periodMs.load();
+
+    Array<NodeStats> stats;
+    Array<int64> sorted;
+
+    for (int i = 0; i < nodes.size(); ++i)
+    {
+        const Node& node = *nodes.getUnchecked (i);
+        if (! node.active || node.count <= 0)
+            continue;
+
+        sorted.clearQuick();
+        sorted.addArray (node.recent.getData(), node.numRecent);
+        std::sort (sorted.begin(), sorted.end());
+        const int p99Index = jlimit (0, sorted.size() - 1,
+                                     roundToInt (std::ceil (0.99 * sorted.size())) - 1);
+
+        NodeStats s;
+        s.nodeId    = node.id;
+        s.name      = node.name;
+        s.count     = node.count;
+        s.minMs     = msPerTick * (double) node.minTicks;
+        s.avgMs     = msPerTick * (double) node.total / (double) node.count;
+        s.p99Ms     = msPerTick * (double) sorted.getUnchecked (p99Index);
+        s.maxMs     = msPerTick * (double) node.maxTicks;
+        s.avgBudget = period > 0.0 ? 100.0 * s.avgMs / period : 0.0;
+        s.maxBudget = period > 0.0 ? 100.0 * s.maxMs / period : 0.0;
+        stats.add (s);
+    }
+
+    return stats;
+}
+
+void DspProfiler::reset()
+{
+    collect();
+
+    const ScopedLock sl (lock);
+    for (Node* const node : nodes)
+        node->clear();
+    trace.clearQuick();
+    dropped.store (0);
+}
+
+Result DspProfiler::exportTrace (const File& file)
+{
+    collect();
+
+    const ScopedLock sl (lock);
+
+    if (file.existsAsFile() && ! file.deleteFile())
+        return Result::fail ("Could not replace " + file.getFullPathName());
+
+    FileOutputStream out (file);
+    if (out.failedToOpen())
+        return Result::fail ("Could not open " + file.getFullPathName());
+
+    const double usPerTick = 1000000.0 / (double) Time::getHighResolutionTicksPerSecond();
+    int64 origin = std::numeric_limits<int64>::max();
+    for (const Event& event : trace)
+        origin = jmin (origin, event.start);
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+    bool first = true;
+    for (int i = 0; i < numRings.load(); ++i)
+    {
+        out << (first ? "" : ",") << newLine
+            << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << i
+            << ",\"args\":{\"name\":\"Thread " << i << "\"}}";
+        first = false;
+    }
+
+    for (const Event& event : trace)
+    {
+        const Node* const node = nodes [event.node % maxNodes];
+        const String name (node != nullptr && node->id == event.node && node->name.isNotEmpty() ? node->name : String ("Node ") + String (event.node));
+
+        out << (first ? "" : ",") << newLine
+            << "{\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread
+            << ",\"name\":" << JSON::toString (var (name))
+            << ",\"ts\":" << String (usPerTick * (double) (event.start - origin), 3)
+            << ",\"dur\":" << String (usPerTick * (double) (event.end - event.start), 3) << "}";
+        first = false;
+    }
+
+    out << newLine << "]}" << newLine;
+    out.flush();
+
+    return out.getStatus();
+}
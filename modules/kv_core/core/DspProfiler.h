@@ -0,0 +1,183 @@
+/*
+    This file is part of the Kushview Modules for JUCE
+    Copyright (C) 2014-2017  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+/** Measures how long each node of a realtime graph takes to process.
+
+    Nodes (plugins, workers, device callbacks) are registered by name, then
+    their processing is wrapped in a ScopedZone. Each thread writes its zones
+    into its own lock free ring, so recording is realtime safe and costs two
+    clock reads. Audio threads use a ring reserved before the device starts,
+    other threads call prepareThread() so their ring goes back when they exit.
+    A non-realtime thread calls collect() regularly to gather per-node
+    min/avg/p99/max and the share of the callback period used, and can export
+    everything as a Chrome trace (chrome://tracing or Perfetto).
+
+    Recording is off until setEnabled (true) is called.
+ */
+class DspProfiler
+{
+public:
+    enum
+    {
+        maxNodes            = 1024,
+        maxThreads          = 64,
+        numSpareRings       = 2,
+        ringSize            = 8192,
+        numRecentDurations  = 2048,
+        maxTraceEvents      = 1 << 20
+    };
+
+    /** Timing of a single node. Times are milliseconds, budgets are percent
+        of the callback period (0 if the period isn't known) */
+    struct NodeStats
+    {
+        int nodeId;
+        String name;
+        int64 count;
+        double minMs, avgMs, p99Ms, maxMs;
+        double avgBudget, maxBudget;
+    };
+
+    DspProfiler();
+    ~DspProfiler();
+
+    /** The profiler used by the kv modules' own instrumentation */
+    static DspProfiler& getDefault();
+
+    /** Turn recording on or off. Enabling allocates the first thread rings,
+        so this isn't realtime safe */
+    void setEnabled (bool shouldBeEnabled);
+    inline bool isEnabled() const noexcept { return enabled.load (std::memory_order_relaxed); }
+
+    /** Keep each zone for exportTrace(). Default is false */
+    void setTracingEnabled (bool shouldTrace);
+
+    /** Set the budget that nodes are measured against */
+    void setCallbackPeriod (double sampleRate, int blockSize);
+    double getCallbackPeriodMs() const noexcept { return periodMs.load(); }
+
+    /** Register a node. Returns its ID, or -1 when there are too many nodes.
+        IDs aren't handed out twice in a row, so zones of an unregistered
+        node that finish late are dropped instead of counted for the next one.
+        Not realtime safe */
+    int registerNode (const String& name);
+
+    /** Free a node's ID for reuse. Not realtime safe */
+    void unregisterNode (int nodeId);
+
+    /** Record a zone. Realtime safe */
+    void record (int nodeId, int64 startTicks, int64 endTicks) noexcept;
+
+    /** Claim a ring for the calling thread and give it back when the thread
+        exits. Call this before the thread does realtime work, registering
+        the exit handler can allocate. A ring is claimed here if recording is
+        on, otherwise with the first zone. Threads that record without
+        calling this keep their ring for the life of the profiler. Not
+        realtime safe */
+    void prepareThread();
+
+    /** Claim a ring for a thread that hasn't started yet, e.g. from an audio
+        device's about to start. Returns the ring's index, or -1 if there
+        are too many threads. Allocates a ring if none are free, so this
+        isn't realtime safe */
+    int reserveRing();
+
+    /** Record the calling thread's zones into a reserved ring. Call this
+        at the top of each callback. Realtime safe */
+    void useRing (int ringIndex) noexcept;
+
+    /** Give back a reserved ring once its thread has stopped recording */
+    void releaseRing (int ringIndex);
+
+    /** Times the lifetime of this object as one zone of a node */
+    class ScopedZone
+    {
+    public:
+        ScopedZone (DspProfiler& p, int node) noexcept
+            : profiler (p), nodeId (node),
+              start (node >= 0 && p.isEnabled() ? Time::getHighResolutionTicks() : 0) { }
+
+        ~ScopedZone() noexcept
+        {
+            if (start != 0)
+                profiler.record (nodeId, start, Time::getHighResolutionTicks());
+        }
+
+    private:
+        DspProfiler& profiler;
+        const int nodeId;
+        const int64 start;
+        JUCE_DECLARE_NON_COPYABLE (ScopedZone)
+    };
+
+    /** Drain the thread rings into the node stats and trace. Call this
+        regularly from a non-realtime thread */
+    void collect();
+
+    /** Collects, then returns stats for every node that has run */
+    Array<NodeStats> getNodeStats();
+
+    /** Number of zones lost because a ring was full or no ring was free for
+        the recording thread */
+    int getNumDroppedEvents() const noexcept { return dropped.load(); }
+
+    /** Clear stats and the trace. Registered nodes are kept */
+    void reset();
+
+    /** Collects, then writes the trace as Chrome trace event JSON */
+    Result exportTrace (const File& file);
+
+private:
+    struct Event
+    {
+        int32 node;
+        int32 thread;
+        int64 start, end;
+    };
+
+    struct Ring;
+    struct Node;
+    struct ThreadRing;
+    struct ThreadExit;
+
+    const uint32 profilerId;
+    std::atomic<bool> enabled;
+    std::atomic<int> dropped;
+    std::atomic<double> periodMs;
+
+    CriticalSection lock;
+    ReferenceCountedObjectPtr<Ring> rings [maxThreads];
+    std::atomic<int> numRings;
+    OwnedArray<Node> nodes;
+    Array<Event> trace;
+    bool tracing;
+
+    // the ring the calling thread records into. This is trivially
+    // destructible so first use doesn't register a thread exit handler
+    static thread_local ThreadRing threadRing;
+    static thread_local ThreadExit threadExit;
+
+    bool holdsRing (const ThreadRing&) const noexcept;
+    void claimRing (ThreadRing&) noexcept;
+    void addSpareRings();
+
+    JUCE_DECLARE_NON_COPYABLE (DspProfiler)
+};
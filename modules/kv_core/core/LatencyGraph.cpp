@@ -0,0 +1,322 @@
+/*
+    This file is part of the Kushview Modules for JUCE
+    Copyright (C) 2014-2017  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+struct LatencyGraph::Node
+{
+    Node (uint32 i) : id (i), latency (0), inputLatency (0), pathLatency (0), dirty (true) { }
+    const uint32 id;
+    int latency, inputLatency, pathLatency;
+    bool dirty;
+    Array<Edge*> inputs, outputs;
+};
+
+struct LatencyGraph::Edge
+{
+    Edge (const Arc& a, Node* s, Node* d)
+        : arc (a.sourceNode, a.sourcePort, a.destNode, a.destPort),
+          source (s), dest (d), delay (0) { }
+    Arc arc;
+    Node* source;
+    Node* dest;
+    int delay;
+    ScopedPointer<DelayLine> delayLine;
+
+    inline bool matches (const Arc& other) const
+    {
+        return arc.sourceNode == other.sourceNode && arc.sourcePort == other.sourcePort &&
+               arc.destNode == other.destNode && arc.destPort == other.destPort;
+    }
+};
+
+struct LatencyNodeSorter
+{
+    template<class NodeType>
+    static int compareElements (const NodeType* first, const NodeType* second) noexcept
+    {
+        return first->id < second->id ? -1 : (first->id > second->id ? 1 : 0);
+    }
+};
+
+LatencyGraph::LatencyGraph()
+    : needsSorting (false), maxDelay (0), maxBlockSize (0)
+{ }
+
+LatencyGraph::~LatencyGraph()
+{
+    clear();
+}
+
+void LatencyGraph::clear()
+{
+    order.clear();
+    edges.clear();
+    nodes.clear();
+    needsSorting = false;
+}
+
+LatencyGraph::Node* LatencyGraph::findNode (uint32 id) const
+{
+    int start = 0, end = nodes.size();
+    while (start < end)
+    {
+        const int mid = (start + end) / 2;
+        Node* const node = nodes.getUnchecked (mid);
+        if (node->id == id)
+            return node;
+        if (node->id < id)
+            start = mid + 1;
+        else
+            end = mid;
+    }
+
+    return nullptr;
+}
+
+LatencyGraph::Node* LatencyGraph::getOrCreateNode (uint32 id)
+{
+    if (Node* node = findNode (id))
+        return node;
+
+    LatencyNodeSorter sorter;
+    Node* const node = new Node (id);
+    nodes.addSorted (sorter, node);
+    needsSorting = true;
+    return node;
+}
+
+void LatencyGraph::setNodeLatency (uint32 id, int latencySamples)
+{
+    Node* const node = getOrCreateNode (id);
+    latencySamples = jmax (0, latencySamples);
+    if (node->latency != latencySamples)
+    {
+        node->latency = latencySamples;
+        node->dirty = true;
+    }
+}
+
+int LatencyGraph::getNodeLatency (uint32 id) const
+{
+    const Node* const node = findNode (id);
+    return node != nullptr ? node->latency : 0;
+}
+
+void LatencyGraph::removeNode (uint32 id)
+{
+    Node* const node = findNode (id);
+    if (node == nullptr)
+        return;
+
+    for (int i = edges.size(); --i >= 0;)
+        if (edges.getUnchecked(i)->source == node || edges.getUnchecked(i)->dest == node)
+            removeEdge (i);
+
+    nodes.removeObject (node);
+    needsSorting = true;
+}
+
+void LatencyGraph::addArc (const Arc& arc)
+{
+    if (indexOfEdge (arc) >= 0)
+        return;
+
+    Node* const source = getOrCreateNode (arc.sourceNode);
+    Node* const dest   = getOrCreateNode (arc.destNode);
+    Edge* const edge   = edges.add (new Edge (arc, source, dest));
+    source->outputs.add (edge);
+    dest->inputs.add (edge);
+    dest->dirty = true;
+
+    if (maxBlockSize > 0)
+    {
+        edge->delayLine = new DelayLine();
+        edge->delayLine->prepare (maxDelay, maxBlockSize);
+    }
+
+    needsSorting = true;
+}
+
+void LatencyGraph::removeArc (const Arc& arc)
+{
+    const int index = indexOfEdge (arc);
+    if (index >= 0)
+        removeEdge (index);
+}
+
+int LatencyGraph::indexOfEdge (const Arc& arc) const
+{
+    for (int i = 0; i < edges.size(); ++i)
+        if (edges.getUnchecked(i)->matches (arc))
+            return i;
+    return -1;
+}
+
+void LatencyGraph::removeEdge (int index)
+{
+    Edge* const edge = edges.getUnchecked (index);
+    edge->source->outputs.removeFirstMatchingValue (edge);
+    edge->dest->inputs.removeFirstMatchingValue (edge);
+    edge->dest->dirty = true;
+    edges.remove (index);
+    needsSorting = true;
+}
+
+void LatencyGraph::sort()
+{
+    // Kahn's algorithm. Nodes in a cycle can't be compensated and are
+    // appended in id order
+    order.clearQuick();
+    order.ensureStorageAllocated (nodes.size());
+
+    HashMap<uint32, int> pending;
+    for (Node* node : nodes)
+    {
+        pending.set (node->id, node->inputs.size());
+        if (node->inputs.size() == 0)
+            order.add (node);
+    }
+
+    for (int i = 0; i < order.size(); ++i)
+    {
+        for (Edge* edge : order.getUnchecked(i)->outputs)
+        {
+            const int remaining = pending [edge->dest->id] - 1;
+            pending.set (edge->dest->id, remaining);
+            if (remaining == 0)
+                order.add (edge->dest);
+        }
+    }
+
+    jassert (order.size() == nodes.size()); // graph has a cycle
+    for (Node* node : nodes)
+    {
+        if (pending [node->id] > 0)
+            order.add (node);
+        node->dirty = true;
+    }
+
+    needsSorting = false;
+}
+
+bool LatencyGraph::update()
+{
+    if (needsSorting)
+        sort();
+
+    bool delaysChanged = false;
+
+    for (Node* node : order)
+    {
+        if (! node->dirty)
+            continue;
+
+        node->dirty = false;
+
+        int inputLatency = 0;
+        for (const Edge* edge : node->inputs)
+            inputLatency = jmax (inputLatency, edge->source->pathLatency);
+
+        for (Edge* edge : node->inputs)
+        {
+            const int delay = inputLatency - edge->source->pathLatency;
+            if (delay != edge->delay)
+            {
+                edge->delay = delay;
+                if (edge->delayLine != nullptr)
+                    edge->delayLine->setDelay (delay);
+                delaysChanged = true;
+            }
+        }
+
+        node->inputLatency = inputLatency;
+        const int pathLatency = inputLatency + node->latency;
+        if (pathLatency != node->pathLatency)
+        {
+            node->pathLatency = pathLatency;
+            for (const Edge* edge : node->outputs)
+                edge->dest->dirty = true;
+        }
+    }
+
+    return delaysChanged;
+}
+
+int LatencyGraph::getPathLatency (uint32 id) const
+{
+    const Node* const node = findNode (id);
+    return node != nullptr ? node->pathLatency : 0;
+}
+
+int LatencyGraph::getInputLatency (uint32 id) const
+{
+    const Node* const node = findNode (id);
+    return node != nullptr ? node->inputLatency : 0;
+}
+
+int LatencyGraph::getArcDelay (const Arc& arc) const
+{
+    const int index = indexOfEdge (arc);
+    return index >= 0 ? edges.getUnchecked(index)->delay : 0;
+}
+
+int LatencyGraph::getMaxPathLatency() const
+{
+    int latency = 0;
+    for (const Node* node : nodes)
+        latency = jmax (latency, node->pathLatency);
+    return latency;
+}
+
+void LatencyGraph::getProcessingOrder (Array<uint32>& ids)
+{
+    if (needsSorting)
+        update();
+
+    ids.clearQuick();
+    ids.ensureStorageAllocated (order.size());
+    for (const Node* node : order)
+        ids.add (node->id);
+}
+
+void LatencyGraph::prepareDelayLines (int newMaxDelay, int newMaxBlockSize)
+{
+    maxDelay = jmax (0, newMaxDelay);
+    maxBlockSize = jmax (1, newMaxBlockSize);
+
+    for (Edge* edge : edges)
+    {
+        if (edge->delayLine == nullptr)
+            edge->delayLine = new DelayLine();
+        edge->delayLine->prepare (maxDelay, maxBlockSize);
+        edge->delayLine->setDelay (edge->delay);
+    }
+}
+
+void LatencyGraph::releaseDelayLines()
+{
+    maxDelay = maxBlockSize = 0;
+    for (Edge* edge : edges)
+        edge->delayLine = nullptr;
+}
+
+DelayLine* LatencyGraph::getDelayLine (const Arc& arc) const
+{
+    const int index = indexOfEdge (arc);
+    return index >= 0 ? edges.getUnchecked(index)->delayLine.get() : nullptr;
+}
@@ -0,0 +1,106 @@
+/*
+    This file is part of the Kushview Modules for JUCE
+    Copyright (C) 2014-2017  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+/** Computes delay compensation for nodes connected by Arcs.
+
+    Each node has a latency, e.g. what a plugin reports.  The latency of a
+    path is the sum of the node latencies along it, and every input to a node
+    is delayed so it lines up with that node's longest input path.  The
+    delays are kept on the arcs.
+
+    Changing latencies is incremental, only nodes downstream of a change are
+    visited by update().  Adding or removing arcs re-sorts the graph.
+
+    Optionally a DelayLine is kept for each arc, sized with prepare(), so
+    compensation can be applied on the audio thread.  None of the methods
+    here are realtime safe, except for the DelayLines themselves. */
+class LatencyGraph
+{
+public:
+    LatencyGraph();
+    ~LatencyGraph();
+
+    /** Remove all nodes and arcs */
+    void clear();
+
+    /** Add a node, or change an existing node's latency */
+    void setNodeLatency (uint32 node, int latencySamples);
+
+    /** Get a node's own latency */
+    int getNodeLatency (uint32 node) const;
+
+    /** Remove a node and the arcs connected to it */
+    void removeNode (uint32 node);
+
+    /** Add an arc. Nodes are created as needed */
+    void addArc (const Arc& arc);
+
+    /** Remove an arc */
+    void removeArc (const Arc& arc);
+
+    /** Recompute path latencies and arc delays.
+        @returns true if any arc's delay changed */
+    bool update();
+
+    /** Get the latency from the graph's inputs to a node's output */
+    int getPathLatency (uint32 node) const;
+
+    /** Get the latency a node's inputs are aligned to */
+    int getInputLatency (uint32 node) const;
+
+    /** Get the delay needed on an arc */
+    int getArcDelay (const Arc& arc) const;
+
+    /** Get the largest path latency in the graph */
+    int getMaxPathLatency() const;
+
+    /** Get node ids in processing order, every node after the nodes that
+        feed it. Nodes in a cycle come last */
+    void getProcessingOrder (Array<uint32>& ids);
+
+    /** Allocate a DelayLine for every arc. New arcs are given one as they
+        are added, until the next call to releaseDelayLines */
+    void prepareDelayLines (int maxDelay, int maxBlockSize);
+
+    /** Free the DelayLines */
+    void releaseDelayLines();
+
+    /** Get an arc's DelayLine, the delay is kept up to date by update()
+        @returns nullptr if not prepared or the arc doesn't exist */
+    DelayLine* getDelayLine (const Arc& arc) const;
+
+private:
+    struct Node;
+    struct Edge;
+    OwnedArray<Node> nodes;   // sorted by id
+    OwnedArray<Edge> edges;
+    Array<Node*> order;       // topological order
+    bool needsSorting;
+    int maxDelay, maxBlockSize;
+
+    Node* findNode (uint32 id) const;
+    Node* getOrCreateNode (uint32 id);
+    int indexOfEdge (const Arc& arc) const;
+    void removeEdge (int index);
+    void sort();
+
+    JUCE_DECLARE_NON_COPYABLE (LatencyGraph)
+};
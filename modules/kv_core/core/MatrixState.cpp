@@ -17,16 +17,483 @@
     Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
 */
 
+static inline int findLowestSetBit (const uint64 word) noexcept
+{
+    jassert (word != 0);
+   #if JUCE_GCC || JUCE_CLANG
+    return __builtin_ctzll (word);
+   #else
+    int bit = 0;
+    uint64 w = word;
+    while ((w & 0xffffffff) == 0) { w >>= 32; bit += 32; }
+    while ((w & 1) == 0) { w >>= 1; ++bit; }
+    return bit;
+   #endif
+}
+
+MatrixState::MatrixState()
+    : numRows (0), numColumns (0), wordsPerRow (0), sparse (false)
+{
+    allocate (0, 0);
+}
+
+MatrixState::MatrixState (const int rows, const int cols, const bool useSparseStorage)
+    : numRows (0), numColumns (0), wordsPerRow (0), sparse (useSparseStorage)
+{
+    jassert (rows >= 0 && cols >= 0);
+    allocate (rows, cols);
+}
+
+MatrixState::MatrixState (const MatrixState& o)
+    : numRows (0), numColumns (0), wordsPerRow (0), sparse (false)
+{
+    this->operator= (o);
+}
+
+MatrixState& MatrixState::operator= (const MatrixState& o)
+{
+    if (this == &o)
+        return *this;
+
+    sparse = o.sparse;
+    allocate (o.numRows, o.numColumns);
+    if (sparse)
+    {
+        rowStarts = o.rowStarts;
+        columns = o.columns;
+    }
+    else
+    {
+        memcpy (words.getData(), o.words.getData(), sizeof (uint64) * (size_t) (numRows * wordsPerRow));
+    }
+
+    return *this;
+}
+
+const bool MatrixState::operator== (const MatrixState& o) const
+{
+    if (! sameSizeAs (o))
+        return false;
+    if (! sparse && ! o.sparse)
+        return 0 == memcmp (words.getData(), o.words.getData(), sizeof (uint64) * (size_t) (numRows * wordsPerRow));
+    if (sparse && o.sparse)
+        return rowStarts == o.rowStarts && columns == o.columns;
+
+    for (int row = 0; row < numRows; ++row)
+    {
+        int a = findNextConnectedInRow (row, 0);
+        int b = o.findNextConnectedInRow (row, 0);
+        while (a == b && a >= 0)
+        {
+            a = findNextConnectedInRow (row, a + 1);
+            b = o.findNextConnectedInRow (row, b + 1);
+        }
+
+        if (a != b)
+            return false;
+    }
+
+    return true;
+}
+
+void MatrixState::allocate (const int rows, const int cols)
+{
+    numRows = jmax (0, rows);
+    numColumns = jmax (0, cols);
+    wordsPerRow = (numColumns + 63) / 64;
+
+    rowStarts.clearQuick();
+    columns.clearQuick();
+    words.free();
+
+    if (sparse)
+        rowStarts.insertMultiple (0, 0, numRows + 1);
+    else
+        words.calloc ((size_t) jmax (1, numRows * wordsPerRow));
+}
+
+bool MatrixState::getCell (const int row, const int column) const
+{
+    if (! sparse)
+        return ((words [row * wordsPerRow + (column >> 6)] >> (column & 63)) & 1) != 0;
+
+    const int* const first = columns.begin() + rowStarts.getUnchecked (row);
+    const int* const last  = columns.begin() + rowStarts.getUnchecked (row + 1);
+    const int* const pos = std::lower_bound (first, last, column);
+    return pos != last && *pos == column;
+}
+
+void MatrixState::setCell (const int row, const int column, const bool on)
+{
+    if (! sparse)
+    {
+        uint64& word = words [row * wordsPerRow + (column >> 6)];
+        const uint64 bit = (uint64) 1 << (column & 63);
+        word = on ? (word | bit) : (word & ~bit);
+        return;
+    }
+
+    const int* const first = columns.begin() + rowStarts.getUnchecked (row);
+    const int* const last  = columns.begin() + rowStarts.getUnchecked (row + 1);
+    const int* const pos = std::lower_bound (first, last, column);
+    const int at = (int) (pos - columns.begin());
+    const bool isOn = pos != last && *pos == column;
+
+    if (on == isOn)
+        return;
+
+    if (on)
+        columns.insert (at, column);
+    else
+        columns.remove (at);
+
+    const int delta = on ? 1 : -1;
+    int* const starts = rowStarts.getRawDataPointer();
+    for (int r = row + 1; r <= numRows; ++r)
+        starts[r] += delta;
+}
+
+int MatrixState::getNumConnected() const
+{
+    if (sparse)
+        return columns.size();
+
+    int count = 0;
+    for (int i = numRows * wordsPerRow; --i >= 0;)
+        count += countNumberOfBits (words[i]);
+    return count;
+}
+
+int MatrixState::getNumConnectedInRow (const int row) const
+{
+    if (! isPositiveAndBelow (row, numRows))
+        return 0;
+    if (sparse)
+        return rowStarts.getUnchecked (row + 1) - rowStarts.getUnchecked (row);
+
+    const uint64* const bits = words.getData() + row * wordsPerRow;
+    int count = 0;
+    for (int w = 0; w < wordsPerRow; ++w)
+        count += countNumberOfBits (bits[w]);
+    return count;
+}
+
+int MatrixState::getNumConnectedInColumn (const int column) const
+{
+    if (! isPositiveAndBelow (column, numColumns))
+        return 0;
+
+    int count = 0;
+    for (int row = 0; row < numRows; ++row)
+        if (getCell (row, column))
+            ++count;
+    return count;
+}
+
+int MatrixState::findNextConnected (const int index) const
+{
+    if (numColumns <= 0)
+        return -1;
+
+    const int start = jmax (0, index);
+    for (int row = start / numColumns, column = start % numColumns; row < numRows; ++row, column = 0)
+    {
+        const int found = findNextConnectedInRow (row, column);
+        if (found >= 0)
+            return getIndexForCell (row, found);
+    }
+
+    return -1;
+}
+
+int MatrixState::findNextConnectedInRow (const int row, const int column) const
+{
+    if (! isPositiveAndBelow (row, numRows) || column >= numColumns)
+        return -1;
+
+    const int start = jmax (0, column);
+    if (sparse)
+    {
+        const int* const first = columns.begin() + rowStarts.getUnchecked (row);
+        const int* const last  = columns.begin() + rowStarts.getUnchecked (row + 1);
+        const int* const pos = std::lower_bound (first, last, start);
+        return pos != last ? *pos : -1;
+    }
+
+    // skip whole words of unconnected cells
+    const uint64* const bits = words.getData() + row * wordsPerRow;
+    int w = start >> 6;
+    uint64 word = bits[w] & (~(uint64) 0 << (start & 63));
+    for (;;)
+    {
+        if (word != 0)
+            return (w << 6) + findLowestSetBit (word);
+        if (++w >= wordsPerRow)
+            return -1;
+        word = bits[w];
+    }
+}
+
+void MatrixState::setRow (const int row, const bool on)
+{
+    if (! isPositiveAndBelow (row, numRows))
+        return;
+
+    if (! sparse)
+    {
+        uint64* const bits = words.getData() + row * wordsPerRow;
+        for (int w = 0; w < wordsPerRow; ++w)
+            bits[w] = on ? ~(uint64) 0 : 0;
+        if (on && wordsPerRow > 0)
+            bits [wordsPerRow - 1] &= getLastWordMask();
+        return;
+    }
+
+    const int first = rowStarts.getUnchecked (row);
+    const int oldSize = rowStarts.getUnchecked (row + 1) - first;
+    columns.removeRange (first, oldSize);
+
+    if (on)
+    {
+        Array<int> all;
+        all.ensureStorageAllocated (numColumns);
+        for (int c = 0; c < numColumns; ++c)
+            all.add (c);
+        columns.insertArray (first, all.getRawDataPointer(), numColumns);
+    }
+
+    const int delta = (on ? numColumns : 0) - oldSize;
+    int* const starts = rowStarts.getRawDataPointer();
+    for (int r = row + 1; r <= numRows; ++r)
+        starts[r] += delta;
+}
+
+void MatrixState::setColumn (const int column, const bool on)
+{
+    if (! isPositiveAndBelow (column, numColumns))
+        return;
+
+    if (sparse)
+    {
+        for (int row = 0; row < numRows; ++row)
+            setCell (row, column, on);
+        return;
+    }
+
+    const uint64 bit = (uint64) 1 << (column & 63);
+    uint64* word = words.getData() + (column >> 6);
+    for (int row = 0; row < numRows; ++row, word += wordsPerRow)
+        *word = on ? (*word | bit) : (*word & ~bit);
+}
+
+void MatrixState::clear()
+{
+    allocate (numRows, numColumns);
+}
+
 void MatrixState::resize (int r, int c)
 {
     if (r < 0) r = 0;
     if (c < 0) c = 0;
     
-    BigInteger bits;
-    bits.setRange (0, r * c, false);
-    
-    // TODO: retain set bits
-    
-    numRows = r; numColumns = c;
-    toggled.swapWith (bits);
+    MatrixState resized (r, c, sparse);
+    const int rowsToKeep = jmin (r, numRows);
+
+    if (sparse)
+    {
+        resized.columns.ensureStorageAllocated (columns.size());
+        for (int row = 0; row < rowsToKeep; ++row)
+        {
+            for (int i = rowStarts.getUnchecked (row); i < rowStarts.getUnchecked (row + 1); ++i)
+                if (columns.getUnchecked (i) < c)
+                    resized.columns.add (columns.getUnchecked (i));
+            resized.rowStarts.set (row + 1, resized.columns.size());
+        }
+
+        for (int row = rowsToKeep + 1; row <= r; ++row)
+            resized.rowStarts.set (row, resized.columns.size());
+    }
+    else
+    {
+        const int wordsToKeep = jmin (wordsPerRow, resized.wordsPerRow);
+        for (int row = 0; row < rowsToKeep; ++row)
+        {
+            uint64* const dest = resized.words.getData() + row * resized.wordsPerRow;
+            memcpy (dest, words.getData() + row * wordsPerRow, sizeof (uint64) * (size_t) wordsToKeep);
+            if (c < numColumns && wordsToKeep > 0)
+                dest [wordsToKeep - 1] &= resized.getLastWordMask();
+        }
+    }
+
+    *this = resized;
+}
+
+void MatrixState::setSparse (const bool useSparseStorage)
+{
+    if (sparse == useSparseStorage)
+        return;
+
+    if (useSparseStorage)
+    {
+        rowStarts.clearQuick();
+        columns.clearQuick();
+        columns.ensureStorageAllocated (getNumConnected());
+        rowStarts.add (0);
+        for (int row = 0; row < numRows; ++row)
+        {
+            for (int c = findNextConnectedInRow (row, 0); c >= 0; c = findNextConnectedInRow (row, c + 1))
+                columns.add (c);
+            rowStarts.add (columns.size());
+        }
+
+        words.free();
+    }
+    else
+    {
+        words.calloc ((size_t) jmax (1, numRows * wordsPerRow));
+        for (int row = 0; row < numRows; ++row)
+            for (int i = rowStarts.getUnchecked (row); i < rowStarts.getUnchecked (row + 1); ++i)
+                words [row * wordsPerRow + (columns.getUnchecked (i) >> 6)] |= (uint64) 1 << (columns.getUnchecked (i) & 63);
+
+        rowStarts.clear();
+        columns.clear();
+    }
+
+    sparse = useSparseStorage;
+}
+
+void MatrixState::getChangesFrom (const MatrixState& other, Array<uint32>& changes) const
+{
+    changes.clearQuick();
+    if (! sameSizeAs (other))
+    {
+        jassertfalse; // changes are only between matrices of the same size
+        return;
+    }
+
+    for (int row = 0; row < numRows; ++row)
+    {
+        if (! sparse && ! other.sparse)
+        {
+            const uint64* const bits = words.getData() + row * wordsPerRow;
+            const uint64* const otherBits = other.words.getData() + row * wordsPerRow;
+            for (int w = 0; w < wordsPerRow; ++w)
+            {
+                for (uint64 diff = bits[w] ^ otherBits[w]; diff != 0; diff &= diff - 1)
+                {
+                    const int bit = findLowestSetBit (diff);
+                    const uint32 on = (uint32) ((bits[w] >> bit) & 1);
+                    changes.add (((uint32) getIndexForCell (row, (w << 6) + bit) << 1) | on);
+                }
+            }
+
+            continue;
+        }
+
+        int a = findNextConnectedInRow (row, 0);
+        int b = other.findNextConnectedInRow (row, 0);
+        while (a >= 0 || b >= 0)
+        {
+            if (b < 0 || (a >= 0 && a < b))
+            {
+                changes.add (((uint32) getIndexForCell (row, a) << 1) | 1);
+                a = findNextConnectedInRow (row, a + 1);
+            }
+            else if (a < 0 || b < a)
+            {
+                changes.add ((uint32) getIndexForCell (row, b) << 1);
+                b = other.findNextConnectedInRow (row, b + 1);
+            }
+            else
+            {
+                a = findNextConnectedInRow (row, a + 1);
+                b = other.findNextConnectedInRow (row, b + 1);
+            }
+        }
+    }
+}
+
+void MatrixState::copyCellsFrom (const MatrixState& o)
+{
+    if (this == &o)
+        return;
+
+    if (sparse || o.sparse || ! sameSizeAs (o))
+    {
+        operator= (o);
+        return;
+    }
+
+    memcpy (words.getData(), o.words.getData(), sizeof (uint64) * (size_t) (numRows * wordsPerRow));
+}
+
+void MatrixState::applyChanges (const uint32* changes, const int numChanges)
+{
+    const uint32 numCells = (uint32) (numRows * numColumns);
+    for (int i = 0; i < numChanges; ++i)
+    {
+        const uint32 index = changes[i] >> 1;
+        jassert (index < numCells);
+        if (index < numCells)
+            setCell ((int) index / numColumns, (int) index % numColumns, (changes[i] & 1) != 0);
+    }
+}
+
+String MatrixState::getConnectionsAsString() const
+{
+    MemoryOutputStream out;
+    int last = -1;
+    for (int i = findNextConnected (0); i >= 0; i = findNextConnected (i + 1))
+    {
+        // gaps are at least 1, store them less one as LEB128
+        uint32 gap = (uint32) (i - last - 1);
+        while (gap >= 0x80)
+        {
+            out.writeByte ((char) ((gap & 0x7f) | 0x80));
+            gap >>= 7;
+        }
+        out.writeByte ((char) gap);
+        last = i;
+    }
+
+    return out.getMemoryBlock().toBase64Encoding();
+}
+
+void MatrixState::setConnectionsFromString (const String& connections)
+{
+    MemoryBlock block;
+    block.fromBase64Encoding (connections);
+
+    const uint8* data = static_cast<const uint8*> (block.getData());
+    const uint8* const end = data + block.getSize();
+    const int numCells = numRows * numColumns;
+    int index = -1;
+
+    clear();
+    if (sparse)
+        columns.ensureStorageAllocated ((int) block.getSize());
+
+    while (data < end)
+    {
+        uint32 gap = 0;
+        int shift = 0;
+        while (data < end && shift < 32)
+        {
+            const uint8 byte = *data++;
+            gap |= (uint32) (byte & 0x7f) << shift;
+            shift += 7;
+            if ((byte & 0x80) == 0)
+                break;
+        }
+
+        const int64 next = (int64) index + gap + 1;
+        if (next >= numCells)
+        {
+            jassertfalse; // connections don't fit this matrix
+            break;
+        }
+
+        index = (int) next;
+        setCell (index / numColumns, index % numColumns, true);
+    }
 }
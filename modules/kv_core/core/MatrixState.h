@@ -19,29 +19,32 @@
 
 #pragma once
 
+/** Which cells of a routing matrix are connected.
+
+    By default cells are held as one bit each in 64 bit words, each row
+    starting on a new word, so whole rows and columns are set, counted and
+    scanned a word at a time. Large matrices with few connections, e.g.
+    2048 x 2048 channels, can be switched to sparse storage, which keeps the
+    connected columns of each row in compressed sparse row (CSR) form.
+
+    Cells are also numbered by index, row * getNumColumns() + column, which
+    is what the change lists and saved states use.
+
+    @see MatrixStateQueue
+ */
 class MatrixState
 {
 public:
-    MatrixState()
-    {
-        numRows = numColumns = 0;
-    }
-
-    MatrixState (const int rows, const int cols)
-    {
-        numRows = rows;
-        numColumns = cols;
-        jassert (rows >= 0 && cols >= 0);
-        toggled.setRange (0, numRows * numColumns, false);
-    }
-
+    MatrixState();
+    MatrixState (const int rows, const int cols, const bool useSparseStorage = false);
+    MatrixState (const MatrixState& o);
     virtual ~MatrixState() { }
     
     inline const bool isEmpty() const { return numRows <= 0 && numColumns <= 0; }
     inline const bool isNotEmpty() const { return !isEmpty(); }
-    inline const bool isValid (int row, int column)
+    inline const bool isValid (int row, int column) const
     {
-        return isPositiveAndBelow (row, numRows) ||
+        return isPositiveAndBelow (row, numRows) &&
                isPositiveAndBelow (column, numColumns);
     }
     
@@ -51,31 +54,24 @@ public:
    
     inline void connect (int row, int column)
     {
-        if (isValid (row, column)) {
-            const int index = getIndexForCell (row, column);
-            toggled.setBit (index, true);
-        }
+        if (isValid (row, column))
+            setCell (row, column, true);
     }
     
     inline void set (int r, int c, bool on)
     {
         if (isValid (r, c))
-        {
-            const int index = getIndexForCell (r, c);
-            toggled.setBit (index, on);
-        }
+            setCell (r, c, on);
     }
     
     inline void disconnect (int row, int column)
     {
-        if (! isValid (row, column))
-            return;
-        const int index = getIndexForCell (row, column);
-        toggled.setBit (index, false);
+        if (isValid (row, column))
+            setCell (row, column, false);
     }
     
     inline bool connected (const int row, const int col) const {
-        return toggled [getIndexForCell (row, col)];
+        return isValid (row, col) && getCell (row, col);
     }
     
     inline bool isCellToggled (int r, int c) const { return connected (r, c); }
@@ -83,15 +79,82 @@ public:
     {
         if (isValid (row, column))
         {
-            const int index = getIndexForCell (row, column);
-            toggled.setBit (index, ! toggled[index]);
+            setCell (row, column, ! getCell (row, column));
             return true;
         }
 
         return false;
     }
 
-    inline bool connectedAtIndex (const int index) const { return toggled [index]; }
+    inline bool connectedAtIndex (const int index) const
+    {
+        return isPositiveAndBelow (index, numRows * numColumns)
+            && getCell (index / numColumns, index % numColumns);
+    }
+
+    /** Returns the number of connected cells */
+    int getNumConnected() const;
+
+    /** Returns the number of connected cells in a row or column */
+    int getNumConnectedInRow (const int row) const;
+    int getNumConnectedInColumn (const int column) const;
+
+    /** Returns the index of the first connected cell at or after index, or -1
+        if there are no more. Use it to visit only connected cells:
+        @code
+        for (int i = state.findNextConnected (0); i >= 0; i = state.findNextConnected (i + 1))
+        @endcode
+     */
+    int findNextConnected (const int index) const;
+
+    /** Returns the first connected column of a row at or after column, or -1
+        if there are no more. This is the fast way for a mixer to find the
+        inputs of an output */
+    int findNextConnectedInRow (const int row, const int column) const;
+
+    /** Connect or disconnect every cell of a row or column */
+    void setRow (const int row, const bool on);
+    void setColumn (const int column, const bool on);
+
+    /** Disconnect everything */
+    void clear();
+
+    /** Returns the bits of a row, column n being bit (n & 63) of word n / 64,
+        or nullptr if storage is sparse */
+    inline const uint64* getRowBits (const int row) const
+    {
+        return sparse || ! isPositiveAndBelow (row, numRows) ? nullptr
+                                                             : words.getData() + row * wordsPerRow;
+    }
+
+    /** Switch between one bit per cell and CSR storage. Connections are kept */
+    void setSparse (const bool useSparseStorage);
+
+    /** Returns true if only connected cells are stored */
+    inline bool isSparse() const { return sparse; }
+
+    /** Returns the connected cells as base64 encoded varint gaps between
+        connected cell indexes. This is a few bytes per connection no matter
+        how big the matrix is */
+    String getConnectionsAsString() const;
+
+    /** Set the connected cells from a string made with getConnectionsAsString().
+        The matrix size isn't changed */
+    void setConnectionsFromString (const String& connections);
+
+    /** Fills changes with the cells that differ from another matrix of the same
+        size, each packed as (index << 1) | 1 if connected here, or
+        (index << 1) if not. Applying them to other makes it equal this */
+    void getChangesFrom (const MatrixState& other, Array<uint32>& changes) const;
+
+    /** Apply changes made by getChangesFrom(). This doesn't allocate when
+        storage is dense, so it can be done on the audio thread */
+    void applyChanges (const uint32* changes, const int numChanges);
+
+    /** Make this equal another matrix. When both are dense and the same size
+        only the bits are copied, which doesn't allocate and can be done on
+        the audio thread. Otherwise this is the same as assigning */
+    void copyCellsFrom (const MatrixState& other);
 
    #if JUCE_MODULE_AVAILABLE_juce_data_structures
     inline ValueTree createValueTree (const String& type = "matrix") const
@@ -99,19 +162,34 @@ public:
         ValueTree tree (Identifier::isValidIdentifier(type) ? type : "matrix");
         tree.setProperty ("numRows", numRows, nullptr);
         tree.setProperty ("numColumns", numColumns, nullptr);
-        tree.setProperty ("toggled", toggled.toString(2), nullptr);
+        tree.setProperty ("sparse", sparse, nullptr);
+        tree.setProperty ("cells", getConnectionsAsString(), nullptr);
         return tree;
     }
 
     inline void restoreFromValueTree (const ValueTree& tree)
     {
-        numRows = tree.getProperty ("numRows", 0);
-        numColumns = tree.getProperty ("numColumns", 0);
-        toggled.parseString (tree.getProperty("toggled").toString(), 2);
+        sparse = tree.getProperty ("sparse", false);
+        allocate (tree.getProperty ("numRows", 0), tree.getProperty ("numColumns", 0));
+
+        if (tree.hasProperty ("cells"))
+        {
+            setConnectionsFromString (tree.getProperty ("cells").toString());
+        }
+        else
+        {
+            // older sessions saved every cell as a binary string
+            BigInteger bits;
+            bits.parseString (tree.getProperty("toggled").toString(), 2);
+            for (int i = bits.findNextSetBit (0); i >= 0; i = bits.findNextSetBit (i + 1))
+                if (isPositiveAndBelow (i, numRows * numColumns))
+                    setCell (i / numColumns, i % numColumns, true);
+        }
     }
    #endif
     
-    /** Resize the matrix to the specified rows and column sizes */
+    /** Resize the matrix to the specified rows and column sizes. Cells that
+        are still inside the matrix keep their state */
     void resize (int newNumRows, int newNumColumns);
     
     /** Returns true if the matrices are the same size */
@@ -121,22 +199,22 @@ public:
                this->numColumns == o.numColumns;
     }
     
-    MatrixState (const MatrixState& o) {
-        this->operator=(o);
-    }
-    
-    MatrixState& operator= (const MatrixState& o) {
-        this->numRows = o.numRows;
-        this->numColumns = o.numColumns;
-        this->toggled = o.toggled;
-        return *this;
-    }
-    
-    const bool operator==(const MatrixState& o) const {
-        return this->sameSizeAs(o) && this->toggled == o.toggled;
-    }
+    MatrixState& operator= (const MatrixState& o);
+    const bool operator== (const MatrixState& o) const;
     
 private:
-    BigInteger toggled;
-    int numRows, numColumns;
+    int numRows, numColumns, wordsPerRow;
+    bool sparse;
+
+    HeapBlock<uint64> words;    // dense: rows of wordsPerRow words, unused bits are 0
+    Array<int> rowStarts;       // sparse: row r's columns are columns [rowStarts[r], rowStarts[r + 1])
+    Array<int> columns;
+
+    void allocate (const int rows, const int cols);
+    bool getCell (const int row, const int column) const;
+    void setCell (const int row, const int column, const bool on);
+    inline uint64 getLastWordMask() const
+    {
+        return (numColumns & 63) != 0 ? (((uint64) 1 << (numColumns & 63)) - 1) : ~(uint64) 0;
+    }
 };
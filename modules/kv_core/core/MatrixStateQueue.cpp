@@ -0,0 +1,106 @@
+/*
+    This file is part of the Kushview Modules for JUCE
+    Copyright (C) 2014-2017  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+MatrixStateQueue::MatrixStateQueue (const int maxChangesToHold)
+    : maxChanges (jmax (1, maxChangesToHold)),
+      fifo ((int32) sizeof (uint32) * (maxChanges + 2)),
+      numWholeChanges (0)
+{
+    wholePending.store (false);
+}
+
+MatrixStateQueue::~MatrixStateQueue() { }
+
+void MatrixStateQueue::reset (const MatrixState& state)
+{
+    fifo.reset();
+    last = state;
+    whole = MatrixState (state.getNumRows(), state.getNumColumns());
+    wholePending.store (false);
+}
+
+bool MatrixStateQueue::post (const MatrixState& newState)
+{
+    if (! newState.sameSizeAs (last))
+    {
+        jassertfalse; // resize the audio side's matrix and call reset() instead
+        return false;
+    }
+
+    newState.getChangesFrom (last, changes);
+    if (changes.size() <= 0)
+        return true;
+
+    if (changes.size() > maxChanges)
+    {
+        // too many for the fifo, so the audio thread copies the whole matrix.
+        // The marker keeps it in order with the changes around it
+        if (wholePending.load (std::memory_order_acquire) || ! fifo.canWrite (sizeof (uint32)))
+            return false;
+
+        whole.copyCellsFrom (newState);
+        numWholeChanges = changes.size();
+        wholePending.store (true, std::memory_order_release);
+        const uint32 marker = wholeMatrix;
+        fifo.write (marker);
+        last = newState;
+        return true;
+    }
+
+    // count first, written in one go so the reader gets all or nothing
+    changes.insert (0, (uint32) changes.size());
+    const uint32 bytes = (uint32) (sizeof (uint32) * (size_t) changes.size());
+    if (! fifo.canWrite (bytes))
+        return false;
+
+    fifo.write (changes.getRawDataPointer(), bytes);
+    last = newState;
+    return true;
+}
+
+int MatrixStateQueue::apply (MatrixState& state)
+{
+    jassert (! state.isSparse());
+    int numApplied = 0;
+    uint32 numChanges = 0;
+
+    while (fifo.canRead (sizeof (uint32)))
+    {
+        fifo.read (numChanges);
+        if (numChanges == wholeMatrix)
+        {
+            jassert (wholePending.load());
+            state.copyCellsFrom (whole);
+            numApplied += numWholeChanges;
+            wholePending.store (false, std::memory_order_release);
+            continue;
+        }
+
+        while (numChanges > 0)
+        {
+            const int numThisTime = (int) jmin (numChanges, (uint32) chunkSize);
+            fifo.read (chunk, sizeof (uint32) * (uint32) numThisTime);
+            state.applyChanges (chunk, numThisTime);
+            numChanges -= (uint32) numThisTime;
+            numApplied += numThisTime;
+        }
+    }
+
+    return numApplied;
+}
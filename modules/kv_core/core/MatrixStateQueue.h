@@ -0,0 +1,75 @@
+/*
+    This file is part of the Kushview Modules for JUCE
+    Copyright (C) 2014-2017  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+/** Passes routing changes from the message thread to the audio thread.
+
+    The message thread posts whole matrix states, and only the cells that
+    differ from the last posted state go through a lock-free fifo, written as
+    a single block. The audio thread applies them to its own dense copy of the
+    matrix, so a routing preset costs a few bit flips there no matter how big
+    the console is, and the audio side never sees half of a preset.
+
+    The fifo's size is fixed. A post with more changes than it can ever hold
+    hands over a copy of the whole matrix instead, which the audio thread
+    copies in one go when it reaches that point in the fifo.
+
+    There must be one posting thread and one audio thread.
+ */
+class MatrixStateQueue
+{
+public:
+    /** Create a queue which holds up to maxChanges pending cell changes.
+        Posts with more go over as a whole matrix */
+    explicit MatrixStateQueue (const int maxChanges = 8192);
+    ~MatrixStateQueue();
+
+    /** Start over from state. The audio thread must not be applying, e.g.
+        call it from prepareToPlay with the audio side holding a dense copy of
+        the same state. This allocates one dense matrix of the same size for
+        handing over large posts. Not realtime safe */
+    void reset (const MatrixState& state);
+
+    /** Queue the cells that differ from the last posted state.
+        @returns false if the queue didn't have room, or the last whole
+                 matrix handed over hasn't been applied yet. Nothing was
+                 queued then and the same state can be posted again later */
+    bool post (const MatrixState& newState);
+
+    /** Audio thread: apply everything queued to state. Realtime safe as long
+        as state isn't sparse.
+        @returns the number of cells changed */
+    int apply (MatrixState& state);
+
+private:
+    enum { chunkSize = 256 };
+    static const uint32 wholeMatrix = 0xffffffff;  // posted instead of a count
+    const int maxChanges;
+    RingBuffer fifo;
+    MatrixState last;
+    Array<uint32> changes;
+    uint32 chunk [chunkSize];
+
+    MatrixState whole;              // written by post() while not pending
+    std::atomic<bool> wholePending;
+    int numWholeChanges;
+
+    JUCE_DECLARE_NON_COPYABLE (MatrixStateQueue)
+};
@@ -0,0 +1,214 @@
+/*
+    This file is part of the Kushview Modules for JUCE
+    Copyright (C) 2014-2017  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+/** Peak, sum of squares and number of samples at or over full scale */
+static void measureMeterBlock (const float* samples, int numSamples,
+                               float& peak, float& sumSquares, uint32& clips) noexcept
+{
+    int i = 0;
+    peak = sumSquares = 0.0f;
+    clips = 0;
+
+   #if JUCE_INTEL
+    const __m128 absMask = _mm_castsi128_ps (_mm_set1_epi32 (0x7fffffff));
+    const __m128 one = _mm_set1_ps (1.0f);
+    __m128 peaks = _mm_setzero_ps();
+    __m128 sums  = _mm_setzero_ps();
+    __m128i overs = _mm_setzero_si128();
+
+    for (; i + 4 <= numSamples; i += 4)
+    {
+        const __m128 x = _mm_loadu_ps (samples + i);
+        const __m128 a = _mm_and_ps (x, absMask);
+        peaks = _mm_max_ps (peaks, a);
+        sums  = _mm_add_ps (sums, _mm_mul_ps (x, x));
+        // a comparison is all ones where true, which is -1
+        overs = _mm_sub_epi32 (overs, _mm_castps_si128 (_mm_cmpge_ps (a, one)));
+    }
+
+    float p[4], s[4];
+    int32 c[4];
+    _mm_storeu_ps (p, peaks);
+    _mm_storeu_ps (s, sums);
+    _mm_storeu_si128 ((__m128i*) c, overs);
+    peak = jmax (jmax (p[0], p[1]), jmax (p[2], p[3]));
+    sumSquares = (s[0] + s[1]) + (s[2] + s[3]);
+    clips = (uint32) (c[0] + c[1] + c[2] + c[3]);
+   #else
+    // independent lanes, so the compiler can vectorise it
+    float p[4] = { 0.0f }, s[4] = { 0.0f };
+    uint32 c[4] = { 0 };
+
+    for (; i + 4 <= numSamples; i += 4)
+    {
+        for (int lane = 0; lane < 4; ++lane)
+        {
+            const float x = samples [i + lane];
+            const float a = std::abs (x);
+            p[lane] = jmax (p[lane], a);
+            s[lane] += x * x;
+            c[lane] += a >= 1.0f ? 1u : 0u;
+        }
+    }
+
+    peak = jmax (jmax (p[0], p[1]), jmax (p[2], p[3]));
+    sumSquares = (s[0] + s[1]) + (s[2] + s[3]);
+    clips = c[0] + c[1] + c[2] + c[3];
+   #endif
+
+    for (; i < numSamples; ++i)
+    {
+        const float x = samples[i];
+        const float a = std::abs (x);
+        peak = jmax (peak, a);
+        sumSquares += x * x;
+        clips += a >= 1.0f ? 1u : 0u;
+    }
+}
+
+MeterBus::MeterBus (int n)
+    : numMeters (0), published (nullptr), working (nullptr),
+      sampleRate (44100.0), peakRelease (0.5), rmsWindow (0.3), holdTime (2.0),
+      holdSamples (0)
+{
+    sequence.store (0);
+    resetPending.store (false);
+    prepare (sampleRate);
+    setNumMeters (n);
+}
+
+MeterBus::~MeterBus() { }
+
+void MeterBus::setNumMeters (int newNumMeters)
+{
+    numMeters = jmax (0, newNumMeters);
+
+    // published then working, each starting on a cache line so the UI's
+    // reads don't share lines with the audio thread's writes
+    const size_t slotBytes = ((sizeof (Slot) * (size_t) jmax (1, numMeters)) + 63) & ~(size_t) 63;
+    storage.allocate (2 * slotBytes + 64, true);
+    char* const aligned = (char*) (((pointer_sized_uint) storage.getData() + 63) & ~(pointer_sized_uint) 63);
+    published = reinterpret_cast<Slot*> (aligned);
+    working   = reinterpret_cast<Slot*> (aligned + slotBytes);
+
+    ballistics.allocate ((size_t) jmax (1, numMeters), true);
+    sequence.store (0);
+}
+
+void MeterBus::prepare (double newSampleRate, double newPeakRelease,
+                        double newRmsWindow, double newHoldTime)
+{
+    sampleRate  = jmax (1.0, newSampleRate);
+    peakRelease = jmax (0.001, newPeakRelease);
+    rmsWindow   = jmax (0.001, newRmsWindow);
+    holdTime    = jmax (0.0, newHoldTime);
+    holdSamples = roundToInt (holdTime * sampleRate);
+
+    for (int i = 0; i < numMeters; ++i)
+        ballistics[i].decayBlockSize = 0;
+}
+
+void MeterBus::updateDecay (Ballistics& state, int numSamples) const
+{
+    // blocks are usually the same size, so this is rarely recomputed
+    if (numSamples == state.decayBlockSize)
+        return;
+
+    state.decayBlockSize = numSamples;
+    state.peakDecay = (float) std::exp (-numSamples / (peakRelease * sampleRate));
+    state.rmsDecay  = (float) std::exp (-numSamples / (rmsWindow * sampleRate));
+}
+
+void MeterBus::process (int meter, const float* samples, int numSamples)
+{
+    jassert (isPositiveAndBelow (meter, numMeters));
+    if (! isPositiveAndBelow (meter, numMeters) || numSamples <= 0)
+        return;
+
+    float blockPeak, sumSquares;
+    uint32 clips;
+    measureMeterBlock (samples, numSamples, blockPeak, sumSquares, clips);
+
+    Slot& slot (working [meter]);
+    Ballistics& state (ballistics [meter]);
+    updateDecay (state, numSamples);
+
+    slot.peak = jmax (blockPeak, slot.peak * state.peakDecay);
+    state.meanSquare = state.meanSquare * state.rmsDecay + (1.0f - state.rmsDecay) * (sumSquares / (float) numSamples);
+    slot.rms = std::sqrt (state.meanSquare);
+    slot.clips += clips;
+
+    if (blockPeak >= slot.hold)
+    {
+        slot.hold = blockPeak;
+        state.holdRemaining = holdSamples;
+    }
+    else if ((state.holdRemaining -= numSamples) <= 0)
+    {
+        // hold is over, fall with the peak
+        slot.hold = slot.peak;
+        state.holdRemaining = 0;
+    }
+}
+
+void MeterBus::process (int firstMeter, const AudioSampleBuffer& buffer, int startSample, int numSamples)
+{
+    const int numChannels = jmin (buffer.getNumChannels(), numMeters - firstMeter);
+    for (int channel = 0; channel < numChannels; ++channel)
+        process (firstMeter + channel, buffer.getReadPointer (channel, startSample), numSamples);
+}
+
+void MeterBus::publish()
+{
+    if (resetPending.exchange (false))
+    {
+        for (int i = 0; i < numMeters; ++i)
+        {
+            working[i].hold = working[i].peak;
+            working[i].clips = 0;
+            ballistics[i].holdRemaining = 0;
+        }
+    }
+
+    const uint32 seq = sequence.load (std::memory_order_relaxed);
+    sequence.store (seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence (std::memory_order_release);
+    std::memcpy (published, working, sizeof (Slot) * (size_t) numMeters);
+    sequence.store (seq + 2, std::memory_order_release);
+}
+
+uint32 MeterBus::read (Slot* dest, int firstMeter, int numToRead) const
+{
+    jassert (firstMeter >= 0 && firstMeter + numToRead <= numMeters);
+    numToRead = jmin (numToRead, numMeters - firstMeter);
+    if (firstMeter < 0 || numToRead <= 0)
+        return getVersion();
+
+    for (;;)
+    {
+        const uint32 before = sequence.load (std::memory_order_acquire);
+        if ((before & 1u) != 0)
+            continue; // a publish is in progress, it won't be long
+
+        std::memcpy (dest, published + firstMeter, sizeof (Slot) * (size_t) numToRead);
+        std::atomic_thread_fence (std::memory_order_acquire);
+        if (sequence.load (std::memory_order_relaxed) == before)
+            return before >> 1;
+    }
+}
@@ -0,0 +1,107 @@
+/*
+    This file is part of the Kushview Modules for JUCE
+    Copyright (C) 2014-2017  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+/** Level meters for many channels, written by the audio thread and read by
+    the UI in one go.
+
+    The audio thread measures blocks with process(), which applies peak
+    release, RMS averaging, peak hold and clip counting, then calls
+    publish() once per cycle. Published meters are one cache aligned block
+    guarded by a sequence counter, so a reader copies every meter it draws
+    with a single read() per frame instead of polling a value per port.
+
+    process() may run on several threads for different meters, but only
+    one thread may publish(), after every process() of the cycle.
+ */
+class MeterBus
+{
+public:
+    /** A meter as read by the UI. Levels are linear gain */
+    struct Slot
+    {
+        float peak;     ///< block peaks with release applied
+        float rms;      ///< RMS over the averaging window
+        float hold;     ///< highest peak, held for the hold time then released
+        uint32 clips;   ///< samples at or over full scale since resetPeaks()
+    };
+
+    explicit MeterBus (int numMeters = 0);
+    ~MeterBus();
+
+    /** Resize and clear. Not realtime safe, and not while processing */
+    void setNumMeters (int numMeters);
+    int getNumMeters() const { return numMeters; }
+
+    /** Set the sample rate and ballistics. Not while processing
+        @param peakRelease  Time for the peak to fall to about a third, in seconds
+        @param rmsWindow    RMS averaging time constant, in seconds
+        @param holdTime     How long the peak hold stays up, in seconds */
+    void prepare (double sampleRate, double peakRelease = 0.5,
+                  double rmsWindow = 0.3, double holdTime = 2.0);
+
+    /** Audio thread: measure a block for a meter. Realtime safe */
+    void process (int meter, const float* samples, int numSamples);
+
+    /** Audio thread: measure a buffer's channels into consecutive meters */
+    void process (int firstMeter, const AudioSampleBuffer& buffer, int startSample, int numSamples);
+
+    /** Audio thread: make everything processed so far visible to readers */
+    void publish();
+
+    /** Copy published meters, retrying if a publish happened meanwhile.
+        Returns the version read, which changes with every publish() */
+    uint32 read (Slot* dest, int firstMeter, int numMeters) const;
+
+    /** Returns the version of the published meters */
+    uint32 getVersion() const { return sequence.load (std::memory_order_acquire) >> 1; }
+
+    /** Clear peak holds and clip counts at the next publish. Any thread */
+    void resetPeaks() { resetPending.store (true); }
+
+private:
+    /** Per meter state. The decay factors are cached here rather than in
+        the bus, since meters may be processed on different threads */
+    struct Ballistics
+    {
+        float meanSquare;
+        int holdRemaining;
+        int decayBlockSize;
+        float peakDecay, rmsDecay;
+    };
+
+    int numMeters;
+    HeapBlock<char> storage;
+    Slot* published;
+    Slot* working;
+    HeapBlock<Ballistics> ballistics;
+
+    char pad0 [64];
+    std::atomic<uint32> sequence;
+    std::atomic<bool> resetPending;
+    char pad1 [64];
+
+    double sampleRate, peakRelease, rmsWindow, holdTime;
+    int holdSamples;
+
+    void updateDecay (Ballistics& state, int numSamples) const;
+
+    JUCE_DECLARE_NON_COPYABLE (MeterBus)
+};
@@ -270,15 +270,17 @@ public:
     inline uint32 getInputPort  (const PortType type, const int32 channel) const { return inputs.getPort (type, channel); }
     inline uint32 getOutputPort (const PortType type, const int32 channel) const { return outputs.getPort (type, channel); }
 
-    inline uint32 getAtomPort (int32 channel, bool isInput) const { return getChannelMapping(isInput).getAudioPort(channel); }
+    inline uint32 getAtomPort (int32 channel, bool isInput) const { return getChannelMapping(isInput).getAtomPort(channel); }
     inline uint32 getAudioPort (int32 channel, bool isInput) const { return getChannelMapping(isInput).getAudioPort(channel); }
-    inline uint32 getControlPort (int32 channel, bool isInput) const { return getChannelMapping(isInput).getAudioPort(channel); }
-    inline uint32 getCVPort (int32 channel, bool isInput) const { return getChannelMapping(isInput).getAudioPort(channel); }
+    inline uint32 getControlPort (int32 channel, bool isInput) const { return getChannelMapping(isInput).getControlPort(channel); }
+    inline uint32 getCVPort (int32 channel, bool isInput) const { return getChannelMapping(isInput).getCVPort(channel); }
 
     inline uint32 getAudioInputPort    (const int32 channel) const { return inputs.getAudioPort (channel); }
     inline uint32 getAudioOutputPort   (const int32 channel) const { return outputs.getAudioPort (channel); }
     inline uint32 getControlInputPort  (const int32 channel) const { return inputs.getControlPort (channel); }
     inline uint32 getControlOutputPort (const int32 channel) const { return outputs.getControlPort (channel); }
+    inline uint32 getCVInputPort       (const int32 channel) const { return inputs.getCVPort (channel); }
+    inline uint32 getCVOutputPort      (const int32 channel) const { return outputs.getCVPort (channel); }
 
     inline int32 getNumChannels (const PortType type, bool isInput) const
     {
@@ -0,0 +1,133 @@
+/*
+    This file is part of the Kushview Modules for JUCE
+    Copyright (C) 2014-2017  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+// plain thread locals, so they're usable from inside malloc at any time. The
+// initial-exec model reads them straight off the thread pointer. The default
+// model can go through __tls_get_addr, which may allocate and re-enter malloc
+#if JUCE_GCC || JUCE_CLANG
+ #define KV_REALTIME_TLS static thread_local __attribute__ ((tls_model ("initial-exec")))
+#else
+ #define KV_REALTIME_TLS static thread_local
+#endif
+
+KV_REALTIME_TLS int realtimeDepth       = 0;
+KV_REALTIME_TLS int realtimeAllowDepth  = 0;
+KV_REALTIME_TLS bool realtimeThread     = false;
+KV_REALTIME_TLS bool realtimeReporting  = false;
+
+#undef KV_REALTIME_TLS
+
+static std::atomic<int>  realtimeNumViolations (0);
+static std::atomic<bool> realtimeAssertOnViolation (false);
+
+enum { maxRealtimeReports = 32 };
+
+static CriticalSection& getRealtimeReportLock()
+{
+    static CriticalSection lock;
+    return lock;
+}
+
+static StringArray& getRealtimeReports()
+{
+    static StringArray reports;
+    return reports;
+}
+
+void RealtimeChecker::enterRealtime() noexcept      { ++realtimeDepth; }
+void RealtimeChecker::exitRealtime() noexcept       { --realtimeDepth; jassert (realtimeDepth >= 0); }
+void RealtimeChecker::enterNonRealtime() noexcept   { ++realtimeAllowDepth; }
+void RealtimeChecker::exitNonRealtime() noexcept    { --realtimeAllowDepth; jassert (realtimeAllowDepth >= 0); }
+
+void RealtimeChecker::setThreadIsRealtime (bool isRealtime) noexcept
+{
+    realtimeThread = isRealtime;
+}
+
+bool RealtimeChecker::shouldCheck() noexcept
+{
+    return (realtimeDepth > 0 || realtimeThread) && realtimeAllowDepth == 0 && ! realtimeReporting;
+}
+
+int RealtimeChecker::getNumViolations() noexcept
+{
+    return realtimeNumViolations.load();
+}
+
+void RealtimeChecker::resetViolations()
+{
+    const ScopedNonRealtime allow;
+    const ScopedLock sl (getRealtimeReportLock());
+    getRealtimeReports().clearQuick();
+    realtimeNumViolations.store (0);
+}
+
+StringArray RealtimeChecker::getViolationReports()
+{
+    const ScopedNonRealtime allow;
+    const ScopedLock sl (getRealtimeReportLock());
+    return getRealtimeReports();
+}
+
+void RealtimeChecker::setAssertOnViolation (bool shouldAssert) noexcept
+{
+    realtimeAssertOnViolation.store (shouldAssert);
+}
+
+const char* RealtimeChecker::getViolationName (Violation type) noexcept
+{
+    switch (type)
+    {
+        case Allocation:    return "allocation";
+        case Deallocation:  return "deallocation";
+        case Lock:          return "lock";
+        case Wait:          return "wait";
+        case Sleep:         return "sleep";
+        case InputOutput:   return "I/O";
+        default:            break;
+    }
+
+    return "unknown";
+}
+
+void RealtimeChecker::reportViolation (Violation type, const char* function)
+{
+    // everything below allocates and locks, don't report any of it
+    realtimeReporting = true;
+    ++realtimeNumViolations;
+
+    String report;
+    report << "[kv] realtime violation: " << getViolationName (type)
+           << " in " << function << newLine
+           << SystemStats::getStackBacktrace();
+
+    {
+        const ScopedLock sl (getRealtimeReportLock());
+        StringArray& reports (getRealtimeReports());
+        reports.add (report);
+        if (reports.size() > maxRealtimeReports)
+            reports.remove (0);
+    }
+
+    std::cerr << report << std::endl;
+    if (realtimeAssertOnViolation.load())
+        jassertfalse;
+
+    realtimeReporting = false;
+}
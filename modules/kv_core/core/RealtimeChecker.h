@@ -0,0 +1,108 @@
+/*
+    This file is part of the Kushview Modules for JUCE
+    Copyright (C) 2014-2017  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+/** Finds code that isn't realtime safe.
+
+    With KV_REALTIME_CHECKS enabled, anything done in a ScopedRealtime region,
+    or on a thread marked realtime, that may block is reported along with a
+    stack trace:
+
+    - allocating or freeing memory (which catches String construction too)
+    - locking a mutex, e.g. a CriticalSection
+    - sleeping, waiting on a semaphore or joining a thread
+    - reading or writing file descriptors
+
+    On Linux with glibc all of these are intercepted. Elsewhere only C++
+    allocations are. With checks disabled the scoped regions compile to
+    nothing, so they can stay in release code.
+ */
+class RealtimeChecker
+{
+public:
+    enum Violation
+    {
+        Allocation = 0,
+        Deallocation,
+        Lock,
+        Wait,
+        Sleep,
+        InputOutput,
+        numViolationTypes
+    };
+
+   #if KV_REALTIME_CHECKS
+    /** Marks the current scope as realtime code */
+    class ScopedRealtime
+    {
+    public:
+        ScopedRealtime() noexcept   { enterRealtime(); }
+        ~ScopedRealtime() noexcept  { exitRealtime(); }
+    private:
+        JUCE_DECLARE_NON_COPYABLE (ScopedRealtime)
+    };
+
+    /** Allows things inside a realtime region that would otherwise be
+        reported, for code known to be safe in context */
+    class ScopedNonRealtime
+    {
+    public:
+        ScopedNonRealtime() noexcept    { enterNonRealtime(); }
+        ~ScopedNonRealtime() noexcept   { exitNonRealtime(); }
+    private:
+        JUCE_DECLARE_NON_COPYABLE (ScopedNonRealtime)
+    };
+   #else
+    class ScopedRealtime     { public: ScopedRealtime() noexcept { } };
+    class ScopedNonRealtime  { public: ScopedNonRealtime() noexcept { } };
+   #endif
+
+    /** Mark the calling thread as realtime, e.g. from an audio device's
+        thread. Everything it does is checked until this is set false */
+    static void setThreadIsRealtime (bool isRealtime) noexcept;
+
+    /** Returns true if what the calling thread does now is being checked */
+    static bool shouldCheck() noexcept;
+
+    /** Total violations reported since the last reset, on all threads */
+    static int getNumViolations() noexcept;
+
+    /** Clear the count and stored reports */
+    static void resetViolations();
+
+    /** The most recent violations, each with its stack trace */
+    static StringArray getViolationReports();
+
+    /** If true, each violation also hits a jassert. Default is false */
+    static void setAssertOnViolation (bool shouldAssert) noexcept;
+
+    static const char* getViolationName (Violation type) noexcept;
+
+    /** @internal Called by the interceptors */
+    static void reportViolation (Violation type, const char* function);
+
+private:
+    static void enterRealtime() noexcept;
+    static void exitRealtime() noexcept;
+    static void enterNonRealtime() noexcept;
+    static void exitNonRealtime() noexcept;
+
+    RealtimeChecker() = delete;
+};
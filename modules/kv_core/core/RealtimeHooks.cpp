@@ -0,0 +1,149 @@
+/*
+    This file is part of the Kushview Modules for JUCE
+    Copyright (C) 2014-2017  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+// Global interceptors for RealtimeChecker. This is included outside the kv
+// namespace and only when KV_REALTIME_CHECKS is enabled.
+
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <new>
+
+#define KV_REALTIME_CHECK(type, function) \
+    if (kv::RealtimeChecker::shouldCheck()) \
+        kv::RealtimeChecker::reportViolation (kv::RealtimeChecker::type, function);
+
+#if JUCE_LINUX && defined (__GLIBC__)
+
+#include <dlfcn.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <time.h>
+
+// Replacing malloc and friends also catches operator new, which calls malloc
+extern "C" {
+
+void* __libc_malloc (size_t);
+void* __libc_calloc (size_t, size_t);
+void* __libc_realloc (void*, size_t);
+void* __libc_memalign (size_t, size_t);
+void  __libc_free (void*);
+
+void* malloc (size_t size)
+{
+    KV_REALTIME_CHECK (Allocation, "malloc");
+    return __libc_malloc (size);
+}
+
+void* calloc (size_t num, size_t size)
+{
+    KV_REALTIME_CHECK (Allocation, "calloc");
+    return __libc_calloc (num, size);
+}
+
+void* realloc (void* ptr, size_t size)
+{
+    KV_REALTIME_CHECK (Allocation, "realloc");
+    return __libc_realloc (ptr, size);
+}
+
+int posix_memalign (void** ptr, size_t alignment, size_t size)
+{
+    KV_REALTIME_CHECK (Allocation, "posix_memalign");
+    if (alignment % sizeof (void*) != 0 || ! juce::isPowerOfTwo (alignment))
+        return EINVAL;
+    *ptr = __libc_memalign (alignment, size);
+    return *ptr != nullptr ? 0 : ENOMEM;
+}
+
+void free (void* ptr)
+{
+    if (ptr != nullptr)
+        KV_REALTIME_CHECK (Deallocation, "free");
+    __libc_free (ptr);
+}
+
+// Everything else is forwarded to the next definition. The lookup isn't
+// guarded by a lock so it can't recurse into the hooks. Racing threads all
+// find the same symbol, and the atomic makes storing it well defined.
+#define KV_REALTIME_FORWARD(type, function, returnType, params, args) \
+    returnType function params \
+    { \
+        KV_REALTIME_CHECK (type, #function) \
+        typedef returnType (*FunctionType) params; \
+        static std::atomic<FunctionType> next (nullptr); \
+        FunctionType fn = next.load (std::memory_order_acquire); \
+        if (fn == nullptr) \
+        { \
+            fn = (FunctionType) dlsym (RTLD_NEXT, #function); \
+            next.store (fn, std::memory_order_release); \
+        } \
+        return fn args; \
+    }
+
+KV_REALTIME_FORWARD (Lock,  pthread_mutex_lock, int, (pthread_mutex_t* m), (m))
+KV_REALTIME_FORWARD (Lock,  pthread_rwlock_rdlock, int, (pthread_rwlock_t* l), (l))
+KV_REALTIME_FORWARD (Lock,  pthread_rwlock_wrlock, int, (pthread_rwlock_t* l), (l))
+KV_REALTIME_FORWARD (Wait,  pthread_join, int, (pthread_t t, void** r), (t, r))
+KV_REALTIME_FORWARD (Wait,  sem_wait, int, (sem_t* s), (s))
+KV_REALTIME_FORWARD (Wait,  sem_timedwait, int, (sem_t* s, const struct timespec* t), (s, t))
+KV_REALTIME_FORWARD (Sleep, nanosleep, int, (const struct timespec* t, struct timespec* r), (t, r))
+KV_REALTIME_FORWARD (Sleep, usleep, int, (useconds_t u), (u))
+KV_REALTIME_FORWARD (Sleep, sleep, unsigned int, (unsigned int s), (s))
+KV_REALTIME_FORWARD (InputOutput, read, ssize_t, (int fd, void* b, size_t n), (fd, b, n))
+KV_REALTIME_FORWARD (InputOutput, write, ssize_t, (int fd, const void* b, size_t n), (fd, b, n))
+
+#undef KV_REALTIME_FORWARD
+
+}
+
+#else
+
+// Other platforms only get the C++ allocator
+void* operator new (std::size_t size)
+{
+    KV_REALTIME_CHECK (Allocation, "operator new");
+    if (void* ptr = std::malloc (size > 0 ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new (std::size_t size, const std::nothrow_t&) noexcept
+{
+    KV_REALTIME_CHECK (Allocation, "operator new");
+    return std::malloc (size > 0 ? size : 1);
+}
+
+void* operator new[] (std::size_t size)                             { return ::operator new (size); }
+void* operator new[] (std::size_t size, const std::nothrow_t& nt) noexcept  { return ::operator new (size, nt); }
+
+void operator delete (void* ptr) noexcept
+{
+    if (ptr != nullptr)
+        KV_REALTIME_CHECK (Deallocation, "operator delete");
+    std::free (ptr);
+}
+
+void operator delete (void* ptr, const std::nothrow_t&) noexcept    { ::operator delete (ptr); }
+void operator delete[] (void* ptr) noexcept                         { ::operator delete (ptr); }
+void operator delete[] (void* ptr, const std::nothrow_t&) noexcept  { ::operator delete (ptr); }
+
+#endif
+
+#undef KV_REALTIME_CHECK
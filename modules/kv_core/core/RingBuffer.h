@@ -27,6 +27,9 @@ public:
     ~RingBuffer();
 
     void setCapacity (int32 newCapacity);
+
+    /** Drop everything in the buffer. Neither side may be reading or writing */
+    inline void reset() { fifo.reset(); }
     inline size_t size() const { return (size_t) fifo.getTotalSize(); }
 
     inline bool canRead  (uint32 bytes) const { return bytes <= (uint32) fifo.getNumReady() && bytes != 0; }
@@ -44,7 +47,9 @@ public:
     inline uint32
     read (void* dest, uint32 size, bool advance = true)
     {
-        buffer = block.getData();
+        // reader and writer may be on different threads, so scratch state stays local
+        const uint8* buffer = block.getData();
+        Vec vec1, vec2;
         fifo.prepareToRead (size, vec1.index, vec1.size, vec2.index, vec2.size);
 
         if (vec1.size > 0)
@@ -72,7 +77,8 @@ public:
     inline uint32
     write (const void* src, uint32 bytes)
     {
-        buffer = block.getData();
+        uint8* buffer = block.getData();
+        Vec vec1, vec2;
         fifo.prepareToWrite (bytes, vec1.index, vec1.size, vec2.index, vec2.size);
 
         if (vec1.size > 0)
@@ -88,7 +94,7 @@ public:
     template <typename T>
     inline uint32 write (const T& src)
     {
-        write (&src, sizeof (T));
+        return write (&src, sizeof (T));
     }
 
     struct Vector {
@@ -104,7 +110,6 @@ private:
         int32 index;
     };
 
-    Vec vec1, vec2;
     AbstractFifo fifo;
     HeapBlock<uint8> block;
     uint8* buffer;
@@ -17,14 +17,18 @@
     Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
 */
 
+#ifndef KV_SEMAPHORE_SPIN_COUNT
+ #define KV_SEMAPHORE_SPIN_COUNT 100
+#endif
+
 #ifdef __APPLE__
 
-Semaphore::Semaphore()
+Semaphore::Semaphore() : spinCount (KV_SEMAPHORE_SPIN_COUNT)
 {
     init(0);
 }
 
-Semaphore::Semaphore(unsigned initial)
+Semaphore::Semaphore(unsigned initial) : spinCount (KV_SEMAPHORE_SPIN_COUNT)
 {
     init(initial);
 }
@@ -34,9 +38,9 @@ Semaphore::~Semaphore()
     destroy();
 }
 
-bool Semaphore::init(unsigned /* initial */)
+bool Semaphore::init(unsigned initial)
 {
-    return semaphore_create(mach_task_self(), &semaphore, SYNC_POLICY_FIFO, 0)
+    return semaphore_create(mach_task_self(), &semaphore, SYNC_POLICY_FIFO, (int) initial)
         ? false : true;
 }
 
@@ -50,11 +54,31 @@ void Semaphore::post()
     semaphore_signal(semaphore);
 }
 
+void Semaphore::post (unsigned count)
+{
+    while (count-- > 0)
+        semaphore_signal(semaphore);
+}
+
 void Semaphore::wait()
 {
+    if (spinWait())
+        return;
     semaphore_wait(semaphore);
 }
 
+bool Semaphore::waitFor (int timeoutMilliseconds)
+{
+    if (spinWait())
+        return true;
+    if (timeoutMilliseconds < 0)
+        return semaphore_wait(semaphore) == KERN_SUCCESS;
+
+    const mach_timespec_t timeout = { (unsigned int) (timeoutMilliseconds / 1000),
+                                      (clock_res_t) ((timeoutMilliseconds % 1000) * 1000000) };
+    return semaphore_timedwait(semaphore, timeout) == KERN_SUCCESS;
+}
+
 bool
 Semaphore::tryWait()
 {
@@ -64,11 +88,16 @@ Semaphore::tryWait()
 
 #elif defined(_WIN32) || defined(_WIN64)
 
-Semaphore::Semaphore()
+Semaphore::Semaphore() : spinCount (KV_SEMAPHORE_SPIN_COUNT)
 {
     init (0);
 }
 
+Semaphore::Semaphore (unsigned initial) : spinCount (KV_SEMAPHORE_SPIN_COUNT)
+{
+    init (initial);
+}
+
 bool Semaphore::init(unsigned initial)
 {
     semaphore = CreateSemaphore (NULL, initial, LONG_MAX, NULL);
@@ -77,7 +106,14 @@ bool Semaphore::init(unsigned initial)
 
 Semaphore::~Semaphore()
 {
-    CloseHandle(semaphore);
+    destroy();
+}
+
+void Semaphore::destroy()
+{
+    if (semaphore != nullptr)
+        CloseHandle (semaphore);
+    semaphore = nullptr;
 }
 
 void Semaphore::post()
@@ -85,23 +121,150 @@ void Semaphore::post()
     ReleaseSemaphore(semaphore, 1, NULL);
 }
 
+void Semaphore::post (unsigned count)
+{
+    if (count > 0)
+        ReleaseSemaphore (semaphore, (LONG) count, NULL);
+}
+
 void Semaphore::wait()
 {
+    if (spinWait())
+        return;
     WaitForSingleObject (semaphore, INFINITE);
 }
 
+bool Semaphore::waitFor (int timeoutMilliseconds)
+{
+    if (spinWait())
+        return true;
+    return WAIT_OBJECT_0 == WaitForSingleObject (semaphore,
+        timeoutMilliseconds < 0 ? INFINITE : (DWORD) timeoutMilliseconds);
+}
+
 bool Semaphore::tryWait()
 {
-    return WAIT_FAILED != WaitForSingleObject (semaphore, 0);
+    return WAIT_OBJECT_0 == WaitForSingleObject (semaphore, 0);
+}
+
+#elif KV_SEMAPHORE_FUTEX
+
+static inline long kv_futex_wait (std::atomic<int>* addr, int expected, const struct timespec* timeout)
+{
+    return syscall (SYS_futex, reinterpret_cast<int*> (addr), FUTEX_WAIT_PRIVATE,
+                    expected, timeout, nullptr, 0);
 }
 
-#else  /* !defined(__APPLE__) && !defined(_WIN32) */
+static inline long kv_futex_wake (std::atomic<int>* addr, int count)
+{
+    return syscall (SYS_futex, reinterpret_cast<int*> (addr), FUTEX_WAKE_PRIVATE,
+                    count, nullptr, nullptr, 0);
+}
 
+/** Blocks on addr while it holds expected, until woken or the deadline
+    passes. A deadline of zero or less means no timeout. Returns false
+    once the deadline has passed */
+static bool kv_futex_wait_until (std::atomic<int>* addr, int expected, double deadline)
+{
+    if (deadline <= 0.0)
+    {
+        kv_futex_wait (addr, expected, nullptr);
+        return true;
+    }
+
+    const double remaining = deadline - Time::getMillisecondCounterHiRes();
+    if (remaining <= 0.0)
+        return false;
+
+    struct timespec timeout;
+    timeout.tv_sec  = (time_t) (remaining / 1000.0);
+    timeout.tv_nsec = (long) ((remaining - (double) timeout.tv_sec * 1000.0) * 1000000.0);
+    kv_futex_wait (addr, expected, &timeout);
+    return true;
+}
 
-Semaphore::Semaphore() { init (0); }
+Semaphore::Semaphore() : spinCount (KV_SEMAPHORE_SPIN_COUNT) { init (0); }
+
+Semaphore::Semaphore (unsigned initial) : spinCount (KV_SEMAPHORE_SPIN_COUNT)
+{
+    init (initial);
+}
 
+bool Semaphore::init (unsigned initial)
+{
+    semaphore.store ((int) initial);
+    waiters.store (0);
+    return true;
+}
 
-Semaphore::Semaphore(unsigned initial)
+Semaphore::~Semaphore()
+{
+    destroy();
+}
+
+void Semaphore::destroy()
+{
+    jassert (waiters.load() == 0); // destroying while threads are waiting
+}
+
+void Semaphore::post()
+{
+    post (1);
+}
+
+void Semaphore::post (unsigned count)
+{
+    if (count == 0)
+        return;
+
+    // waiters are counted before they check the value, so when nobody is
+    // counted a waiter still to come will see this increment
+    semaphore.fetch_add ((int) count);
+    if (waiters.load() > 0)
+        kv_futex_wake (&semaphore, (int) count);
+}
+
+void Semaphore::wait()
+{
+    waitFor (-1);
+}
+
+bool Semaphore::waitFor (int timeoutMilliseconds)
+{
+    if (spinWait())
+        return true;
+    if (timeoutMilliseconds == 0)
+        return false;
+
+    const double deadline = timeoutMilliseconds > 0
+        ? Time::getMillisecondCounterHiRes() + (double) timeoutMilliseconds : 0.0;
+
+    waiters.fetch_add (1);
+    bool acquired = tryWait();
+    while (! acquired && kv_futex_wait_until (&semaphore, 0, deadline))
+        acquired = tryWait();
+    waiters.fetch_sub (1);
+
+    return acquired;
+}
+
+bool Semaphore::tryWait()
+{
+    int value = semaphore.load (std::memory_order_relaxed);
+    while (value > 0)
+        if (semaphore.compare_exchange_weak (value, value - 1, std::memory_order_acquire,
+                                             std::memory_order_relaxed))
+            return true;
+    return false;
+}
+
+#else  /* !defined(__APPLE__) && !defined(_WIN32) && !defined(__linux__) */
+
+
+Semaphore::Semaphore() : spinCount (KV_SEMAPHORE_SPIN_COUNT) { init (0); }
+
+
+Semaphore::Semaphore(unsigned initial) : spinCount (KV_SEMAPHORE_SPIN_COUNT)
 {
     init(initial);
 }
@@ -113,6 +276,11 @@ bool Semaphore::init(unsigned initial)
 }
 
 Semaphore::~Semaphore()
+{
+    destroy();
+}
+
+void Semaphore::destroy()
 {
     sem_destroy(&semaphore);
 }
@@ -122,9 +290,18 @@ void Semaphore::post()
     sem_post(&semaphore);
 }
 
+void Semaphore::post (unsigned count)
+{
+    while (count-- > 0)
+        sem_post(&semaphore);
+}
+
 
 void Semaphore::wait()
 {
+    if (spinWait())
+        return;
+
     /* Note that sem_wait always returns 0 in practice, except in
     gdb (at least), where it returns nonzero, so the while is
     necessary (and is the correct/safe solution in any case).
@@ -132,9 +309,100 @@ void Semaphore::wait()
     while (sem_wait(&semaphore) != 0) {}
 }
 
+bool Semaphore::waitFor (int timeoutMilliseconds)
+{
+    if (spinWait())
+        return true;
+    if (timeoutMilliseconds < 0)
+    {
+        wait();
+        return true;
+    }
+
+    struct timespec deadline;
+    clock_gettime (CLOCK_REALTIME, &deadline);
+    deadline.tv_sec  += timeoutMilliseconds / 1000;
+    deadline.tv_nsec += (long) (timeoutMilliseconds % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L)
+    {
+        deadline.tv_nsec -= 1000000000L;
+        ++deadline.tv_sec;
+    }
+
+    while (sem_timedwait (&semaphore, &deadline) != 0)
+        if (errno != EINTR)
+            return false;
+    return true;
+}
+
 bool Semaphore::tryWait()
 {
     return (sem_trywait(&semaphore) == 0);
 }
 
 #endif
+
+bool Semaphore::spinWait()
+{
+    for (int i = 0; i < spinCount; ++i)
+    {
+        if (tryWait())
+            return true;
+        KV_SPIN_PAUSE();
+    }
+
+    return false;
+}
+
+#if KV_SEMAPHORE_FUTEX
+
+Notification::Notification()
+{
+    state.store (0);
+    waiters.store (0);
+}
+
+Notification::~Notification()
+{
+    jassert (waiters.load() == 0);
+}
+
+void Notification::notify()
+{
+    if (state.exchange (1) == 0 && waiters.load() > 0)
+        kv_futex_wake (&state, INT_MAX);
+}
+
+void Notification::reset()              { state.store (0); }
+bool Notification::isNotified() const   { return state.load() != 0; }
+void Notification::wait()               { waitFor (-1); }
+
+bool Notification::waitFor (int timeoutMilliseconds)
+{
+    if (isNotified())
+        return true;
+    if (timeoutMilliseconds == 0)
+        return false;
+
+    const double deadline = timeoutMilliseconds > 0
+        ? Time::getMillisecondCounterHiRes() + (double) timeoutMilliseconds : 0.0;
+
+    waiters.fetch_add (1);
+    while (! isNotified() && kv_futex_wait_until (&state, 0, deadline)) { }
+    waiters.fetch_sub (1);
+
+    return isNotified();
+}
+
+#else
+
+Notification::Notification() : event (true) { }
+Notification::~Notification() { }
+
+void Notification::notify()             { event.signal(); }
+void Notification::reset()              { event.reset(); }
+bool Notification::isNotified() const   { return event.wait (0); }
+void Notification::wait()               { event.wait (-1); }
+bool Notification::waitFor (int timeoutMilliseconds) { return event.wait (timeoutMilliseconds); }
+
+#endif
@@ -25,6 +25,10 @@
  typedef semaphore_t SemType;
 #elif defined(_WIN32)
  typedef void* SemType;
+#elif defined(__linux__)
+ // futex backed, see Semaphore.cpp
+ #define KV_SEMAPHORE_FUTEX 1
+ typedef std::atomic<int> SemType;
 #else
  #include <semaphore.h>
  typedef sem_t SemType;
@@ -46,6 +50,10 @@
    particular, at least on Linux, post is async-signal-safe, which means it
    does not block and will not be interrupted.  If you need to signal from
    a realtime thread, this is the most appropriate primitive to use.
+
+   On Linux this is a futex, and post only enters the kernel when a thread
+   is actually waiting.  Waits spin a little before blocking, since the
+   post often comes a few microseconds later and sleeping costs far more.
 */
 
 struct Semaphore
@@ -66,14 +74,74 @@ void destroy();
     Realtime safe. */
 void post();
 
+/** Increment by count, waking up to as many waiters.
+    Realtime safe. */
+void post (unsigned count);
+
 /** Wait until count is > 0 */
 void wait();
 
+/** Wait until count is > 0 or the timeout elapses.
+    @return true if decrement was successful, false on timeout */
+bool waitFor (int timeoutMilliseconds);
+
 /** Non-blocking version of wait().
     @return true if decrement was successful (lock was acquired). */
 bool tryWait();
 
+/** Set how many times a wait tries to decrement before blocking. The
+    default is 100, use 0 to never spin */
+void setSpinCount (int count) { spinCount = count > 0 ? count : 0; }
+
 private:
   SemType semaphore;
+ #if KV_SEMAPHORE_FUTEX
+  std::atomic<int> waiters;
+ #endif
+  int spinCount;
+
+  /** @internal try to decrement spinCount times */
+  bool spinWait();
+
+};
+
+/**
+   A flag that threads can wait on.
+
+   Once notified it stays set, releasing every waiter, until it is reset.
+   Use it in place of polling with sleeps, e.g. waiting for a thread to
+   finish a job.  notify() is realtime safe on Linux, where it only enters
+   the kernel when a thread is waiting.
+*/
+
+struct Notification
+{
+
+Notification();
+~Notification();
+
+/** Set the flag and wake every waiter */
+void notify();
+
+/** Clear the flag */
+void reset();
+
+/** Returns true if notified and not reset since */
+bool isNotified() const;
+
+/** Wait until notified */
+void wait();
+
+/** Wait until notified or the timeout elapses.
+    @return true if notified, false on timeout */
+bool waitFor (int timeoutMilliseconds);
+
+private:
+ #if KV_SEMAPHORE_FUTEX
+  std::atomic<int> state;
+  std::atomic<int> waiters;
+ #else
+  WaitableEvent event;
+ #endif
 
 };
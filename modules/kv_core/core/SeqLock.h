@@ -0,0 +1,91 @@
+/*
+    This file is part of the Kushview Modules for JUCE
+    Copyright (C) 2014-2017  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+/** A sequence locked snapshot of plain data.
+
+    The writer never waits. Readers copy the value and retry if a write
+    happened during the copy, so they never see a torn value, and any number
+    of readers can read at once. Use it for state many threads poll, like
+    transport info, where a TripleBuffer's single reader isn't enough.
+
+    There must be only one writer. ValueType must be trivially copyable.
+ */
+template<typename ValueType>
+class SeqLock
+{
+public:
+    SeqLock (const ValueType& initial = ValueType())
+    {
+        sequence.store (0);
+        std::memcpy (&value, &initial, sizeof (ValueType));
+    }
+
+    /** Writer: store a new value. Wait free */
+    inline void write (const ValueType& newValue)
+    {
+        const uint32 seq = sequence.load (std::memory_order_relaxed);
+        sequence.store (seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence (std::memory_order_release);
+        std::memcpy (&value, &newValue, sizeof (ValueType));
+        sequence.store (seq + 2, std::memory_order_release);
+    }
+
+    /** Reader: try to copy the value once
+        @returns false if a write got in the way and result may be torn */
+    inline bool tryRead (ValueType& result) const
+    {
+        const uint32 before = sequence.load (std::memory_order_acquire);
+        if ((before & 1u) != 0)
+            return false;
+
+        std::memcpy (&result, &value, sizeof (ValueType));
+        std::atomic_thread_fence (std::memory_order_acquire);
+        return sequence.load (std::memory_order_relaxed) == before;
+    }
+
+    /** Reader: copy the value, retrying until it's consistent */
+    inline void read (ValueType& result) const
+    {
+        while (! tryRead (result))
+            ; // a write is in progress, it won't be long
+    }
+
+    inline ValueType read() const
+    {
+        ValueType result;
+        read (result);
+        return result;
+    }
+
+    /** Returns a number that changes every time the value is written */
+    inline uint32 getVersion() const { return sequence.load (std::memory_order_acquire) >> 1; }
+
+private:
+    std::atomic<uint32> sequence;
+    char pad [60];
+    ValueType value;
+
+   #if ! JUCE_GCC || (__GNUC__ >= 5)
+    static_assert (std::is_trivially_copyable<ValueType>::value, "SeqLock needs trivially copyable types");
+   #endif
+
+    JUCE_DECLARE_NON_COPYABLE (SeqLock)
+};
@@ -0,0 +1,96 @@
+/*
+    This file is part of the Kushview Modules for JUCE
+    Copyright (C) 2014-2017  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+/** A wait-free triple buffer for passing state from one thread to another.
+
+    The writer fills a back buffer and publishes it, the reader picks up the
+    latest published buffer. Neither side ever waits or retries, so this
+    suits state too large to copy atomically, like analyser or scope frames,
+    where the reader only cares about the newest value.
+
+    There must be one writer thread and one reader thread.
+ */
+template<typename ValueType>
+class TripleBuffer
+{
+public:
+    TripleBuffer (const ValueType& initial = ValueType())
+        : writeIndex (1), readIndex (0)
+    {
+        buffers[0] = buffers[1] = buffers[2] = initial;
+        middle.store (2);
+    }
+
+    /** Writer: the buffer to fill before calling publish() */
+    inline ValueType& getWriteBuffer() { return buffers [writeIndex]; }
+
+    /** Writer: make the write buffer the latest value */
+    inline void publish()
+    {
+        const uint8 previous = middle.exchange ((uint8) (writeIndex | newDataBit), std::memory_order_acq_rel);
+        writeIndex = previous & indexMask;
+    }
+
+    /** Writer: copy and publish a value */
+    inline void write (const ValueType& value)
+    {
+        getWriteBuffer() = value;
+        publish();
+    }
+
+    /** Reader: returns true if something was published since the last update() */
+    inline bool hasNewData() const { return (middle.load (std::memory_order_relaxed) & newDataBit) != 0; }
+
+    /** Reader: swap in the latest published buffer
+        @returns true if there was a new one */
+    inline bool update()
+    {
+        if (! hasNewData())
+            return false;
+
+        const uint8 previous = middle.exchange (readIndex, std::memory_order_acq_rel);
+        readIndex = previous & indexMask;
+        return true;
+    }
+
+    /** Reader: the current read buffer. It stays valid and unchanged until
+        the next update() */
+    inline const ValueType& getReadBuffer() const { return buffers [readIndex]; }
+
+    /** Reader: update and return the latest value */
+    inline const ValueType& read()
+    {
+        update();
+        return getReadBuffer();
+    }
+
+private:
+    enum { indexMask = 0x03, newDataBit = 0x04 };
+
+    ValueType buffers[3];
+    uint8 writeIndex;
+    char pad1 [64];
+    std::atomic<uint8> middle;
+    char pad2 [64];
+    uint8 readIndex;
+
+    JUCE_DECLARE_NON_COPYABLE (TripleBuffer)
+};
@@ -31,6 +31,7 @@ WorkThread::WorkThread (const String& name, uint32 bufsize, int32 priority)
     : Thread (name)
 {
     nextWorkId = 0;
+    doExit.set (0);
     bufferSize = (uint32) nextPowerOfTwo (bufsize);
     requests   = new RingBuffer (bufferSize);
     startThread (priority);
@@ -39,9 +40,12 @@ WorkThread::WorkThread (const String& name, uint32 bufsize, int32 priority)
 WorkThread::~WorkThread()
 {
     signalThreadShouldExit();
-    doExit = true;
+    doExit.set (1);
     sem.post();
-    waitForThreadToExit (100);
+
+    // the post above wakes the thread right away, so there's no need for a
+    // timeout, and one could free the requests while the thread reads them
+    waitForThreadToExit (-1);
     requests = nullptr;
 }
 
@@ -61,6 +65,8 @@ WorkerBase* WorkThread::getWorker (uint32 workerId) const
 void WorkThread::registerWorker (WorkerBase* worker)
 {
     worker->workId = ++nextWorkId;
+    worker->profileId = DspProfiler::getDefault().registerNode (
+        getThreadName() + ": worker " + String (worker->workId));
     KV_WORKER_LOG (getThreadName() + " Registering worker: id = " + String (worker->workId));
     workers.addIfNotAlreadyThere (worker);
 }
@@ -70,6 +76,8 @@ void WorkThread::removeWorker (WorkerBase* worker)
     KV_WORKER_LOG (getThreadName() + " Removing worker: id = " + String (worker->workId));
     workers.removeFirstMatchingValue (worker);
     worker->workId = 0;
+    DspProfiler::getDefault().unregisterNode (worker->profileId);
+    worker->profileId = -1;
 }
 
 
@@ -77,16 +85,19 @@ void WorkThread::run()
 {
     HeapBlock<uint8> buffer;
     int32 readBufferSize = 0;
+    DspProfiler::getDefault().prepareThread();
 
     while (true)
     {
         sem.wait();
-        if (doExit || threadShouldExit()) break;
+        if (doExit.get() != 0 || threadShouldExit()) break;
 
+        // requests are written whole before the post, so this is only ever
+        // a very short wait
         while (! validateMessage (*requests))
-            Thread::sleep (6);
+            Thread::yield();
 
-        if (doExit || threadShouldExit()) break;
+        if (doExit.get() != 0 || threadShouldExit()) break;
 
         uint32 size = 0;
         if (requests->read (&size, sizeof (size)) < sizeof (size))
@@ -123,12 +134,15 @@ void WorkThread::run()
             if (WorkerBase* const worker = getWorker (workId))
             {
                 while (! worker->flag.setWorking (true)) {}
-                worker->processRequest (size, buffer.getData());
+                {
+                    DspProfiler::ScopedZone zone (DspProfiler::getDefault(), worker->profileId);
+                    worker->processRequest (size, buffer.getData());
+                }
                 while (! worker->flag.setWorking (false)) {}
             }
         }
 
-        if (threadShouldExit() || doExit)
+        if (threadShouldExit() || doExit.get() != 0)
             break;
     }
 
@@ -165,7 +179,7 @@ bool WorkThread::validateMessage (RingBuffer& ring)
 }
 
 WorkerBase::WorkerBase (WorkThread& thread, uint32 bufsize)
-    : owner (thread)
+    : owner (thread), profileId (-1)
 {
     responses = new RingBuffer (bufsize);
     response.calloc (bufsize);
@@ -174,9 +188,7 @@ WorkerBase::WorkerBase (WorkThread& thread, uint32 bufsize)
 
 WorkerBase::~WorkerBase()
 {
-    while (flag.isWorking()) {
-        Thread::sleep (100);
-    }
+    flag.waitUntilIdle();
 
     owner.removeWorker (this);
     responses = nullptr;
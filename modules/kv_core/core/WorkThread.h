@@ -53,7 +53,7 @@ private:
     uint32 nextWorkId;
 
     Semaphore sem;
-    bool doExit;
+    Atomic<int> doExit;
 
     ScopedPointer<RingBuffer> requests;  ///< requests to process
 
@@ -68,12 +68,27 @@ private:
 class WorkFlag
 {
 public:
-    WorkFlag() { flag = 0; }
+    WorkFlag() { flag = 0; idle.notify(); }
     inline bool isWorking() const { return flag.get() != 0; }
 
+    /** Block until not working */
+    inline void waitUntilIdle() { while (isWorking()) idle.wait(); }
+
 private:
     Atomic<int32> flag;
-    inline bool setWorking (bool status) { return flag.compareAndSetBool (status ? 1 : 0, status ? 0 : 1); }
+    Notification idle;
+
+    inline bool setWorking (bool status)
+    {
+        if (status)
+            idle.reset();
+        if (! flag.compareAndSetBool (status ? 1 : 0, status ? 0 : 1))
+            return false;
+        if (! status)
+            idle.notify();
+        return true;
+    }
+
     friend class WorkThread;
 };
 
@@ -117,6 +132,7 @@ protected:
 private:
     WorkThread& owner;
     uint32 workId;                       ///< The thread assigned id for this worker
+    int profileId;                       ///< DspProfiler node for processRequest
     WorkFlag flag;                       ///< A flag for when work is being processed
 
     ScopedPointer<RingBuffer> responses; ///< responses from work
@@ -27,20 +27,41 @@
 #endif
 
 #include <map>
+#include <iostream>
 #include <juce_core/juce_core.h>
 #include "kv_core.h"
 
 #if JUCE_WINDOWS
  #include <windows.h>
+#elif JUCE_LINUX || JUCE_ANDROID
+ #include <climits>
+ #include <linux/futex.h>
+ #include <sys/syscall.h>
+ #include <unistd.h>
+#endif
+
+#if JUCE_INTEL
+ #include <emmintrin.h>
 #endif
 
 namespace kv {
  #include "core/Arc.cpp"
+ #include "core/DspProfiler.cpp"
+ #include "core/LatencyGraph.cpp"
  #include "core/MatrixState.cpp"
+ #include "core/MatrixStateQueue.cpp"
+ #include "core/MeterBus.cpp"
+ #include "core/RealtimeChecker.cpp"
  #include "core/RingBuffer.cpp"
  #include "core/Semaphore.cpp"
+ #include "core/AdaptiveLock.cpp"
  #include "core/WorkThread.cpp"
+ #include "time/DeviceClock.cpp"
  #include "time/TimeScale.cpp"
  #include "util/FileHelpers.cpp"
  #include "util/UUID.cpp"
 }
+
+#if KV_REALTIME_CHECKS
+ #include "core/RealtimeHooks.cpp"
+#endif
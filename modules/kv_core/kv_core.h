@@ -27,6 +27,7 @@
     license:          GPL
 
     dependencies:     juce_core, juce_cryptography
+    linuxLibs:        dl
 
     END_JUCE_MODULE_DECLARATION
  */
@@ -54,6 +55,16 @@
 #endif
 
 #include <set>
+#include <type_traits>
+
+/** Config: KV_REALTIME_CHECKS
+    Set this to report allocations, locks and other blocking calls made
+    from realtime code. Replaces the global allocator, so only enable it
+    in debug and test builds (default is disabled)
+ */
+#ifndef KV_REALTIME_CHECKS
+ #define KV_REALTIME_CHECKS 0
+#endif
 
 #if _MSC_VER
  #ifdef min
@@ -68,26 +79,44 @@
  #endif
 #endif
 
+/** Hint to the CPU that the caller is busy waiting, used by the spinning
+    locks and semaphores */
+#if JUCE_INTEL && ! JUCE_MSVC
+ #define KV_SPIN_PAUSE() __builtin_ia32_pause()
+#else
+ #define KV_SPIN_PAUSE()
+#endif
+
 namespace kv {
 using namespace juce;
 #include "core/AudioRingBuffer.h"
 #include "core/Arc.h"
 #include "core/Atomic.h"
+#include "core/ControlRamp.h"
+#include "core/DelayLine.h"
+#include "core/DspProfiler.h"
+#include "core/LatencyGraph.h"
 #include "core/LinkedList.h"
 #include "core/MatrixState.h"
-#include "core/Monitor.h"
+#include "core/MeterBus.h"
 #include "core/Parameter.h"
 #include "core/Pointer.h"
 #include "core/PortType.h"
+#include "core/RealtimeChecker.h"
 #include "core/RingBuffer.h"
+#include "core/MatrixStateQueue.h"
 #include "core/Semaphore.h"
+#include "core/AdaptiveLock.h"
+#include "core/SeqLock.h"
 #include "core/Slugs.h"
+#include "core/TripleBuffer.h"
 #include "core/Types.h"
 #include "core/WorkThread.h"
 
 #include "math/Rational.h"
 
 #include "time/DelayLockedLoop.h"
+#include "time/DeviceClock.h"
 #include "time/Tempo.h"
 #include "time/TimeScale.h"
 #include "time/TimeStamp.h"
@@ -74,6 +74,12 @@ public:
         resetLPF();
     }
 
+    /** Return the filtered time of the last update */
+    inline double getTime() const
+    {
+        return t0;
+    }
+
     /**  Return the difference in filtered time (t1 - t0) */
     inline double timeDiff()
     {
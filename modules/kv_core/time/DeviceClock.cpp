@@ -0,0 +1,144 @@
+/*
+    This file is part of the Kushview Modules for JUCE
+    Copyright (C) 2014-2017  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+const double DeviceClock::jitterBinLimits [DeviceClock::numJitterBins] = {
+    50.0, 100.0, 250.0, 500.0, 1000.0, 2000.0, 5000.0, 1.0e12
+};
+
+DeviceClock::DeviceClock()
+    : lateThreshold (1.5),
+      lastTime (0.0),
+      callbackStart (0.0),
+      lastNumFrames (0),
+      locked (false)
+{
+    resetRequested.set (0);
+}
+
+DeviceClock::~DeviceClock() { }
+
+double DeviceClock::now()
+{
+    return Time::getMillisecondCounterHiRes() * 0.001;
+}
+
+void DeviceClock::prepare (double sampleRate, int blockSize)
+{
+    jassert (sampleRate > 0.0 && blockSize > 0);
+
+    stats = Stats();
+    stats.nominalSampleRate = stats.sampleRate = sampleRate;
+    stats.nominalPeriod = stats.filteredPeriod = (double) blockSize / sampleRate;
+    publish();
+
+    // one Hz of bandwidth follows drift well while ignoring scheduler jitter
+    dll.setParams (1.0, sampleRate / (double) blockSize);
+    locked = false;
+    lastNumFrames = blockSize;
+    resetRequested.set (0);
+}
+
+void DeviceClock::setLateThreshold (double periods)
+{
+    lateThreshold = jmax (1.0, periods);
+}
+
+void DeviceClock::begin (int numFrames)
+{
+    jassert (stats.nominalSampleRate > 0.0); // call prepare() first
+    if (numFrames <= 0 || stats.nominalSampleRate <= 0.0)
+        return;
+
+    const double time = now();
+    callbackStart = time;
+
+    if (resetRequested.compareAndSetBool (0, 1))
+    {
+        stats.numCallbacks = stats.numLateCallbacks = stats.numOverloads = 0;
+        stats.maxJitter = stats.maxLoad = 0.0;
+        zeromem (stats.jitterHistogram, sizeof (stats.jitterHistogram));
+    }
+
+    const double nominal = (double) lastNumFrames / stats.nominalSampleRate;
+    if (locked)
+        stats.frame += (int64) lastNumFrames;
+
+    if (! locked || numFrames != lastNumFrames || time - lastTime > nominal * 4.0)
+    {
+        // first callback, block size change or a large dropout. the loop
+        // would take ages to settle from there, so start it over
+        if (locked)
+            ++stats.numLateCallbacks;
+        dll.reset (time, (double) numFrames, stats.nominalSampleRate);
+        locked = true;
+    }
+    else
+    {
+        if (time - lastTime > nominal * lateThreshold)
+            ++stats.numLateCallbacks;
+
+        const double error = std::abs (time - (stats.time + stats.filteredPeriod));
+        const double micros = error * 1.0e6;
+        int bin = 0;
+        while (bin < numJitterBins - 1 && micros >= jitterBinLimits [bin])
+            ++bin;
+        ++stats.jitterHistogram [bin];
+        stats.maxJitter = jmax (stats.maxJitter, error);
+
+        dll.update (time);
+    }
+
+    stats.time = dll.getTime();
+    stats.filteredPeriod = dll.timeDiff();
+    if (stats.filteredPeriod > 0.0)
+    {
+        stats.sampleRate = (double) numFrames / stats.filteredPeriod;
+        stats.driftPpm = (stats.sampleRate / stats.nominalSampleRate - 1.0) * 1.0e6;
+    }
+
+    ++stats.numCallbacks;
+    publish();
+
+    lastTime = time;
+    lastNumFrames = numFrames;
+}
+
+void DeviceClock::end()
+{
+    if (stats.nominalSampleRate <= 0.0)
+        return;
+
+    const double elapsed = now() - callbackStart;
+    const double period = (double) lastNumFrames / stats.nominalSampleRate;
+
+    if (elapsed > period)
+        ++stats.numOverloads;
+    stats.maxLoad = jmax (stats.maxLoad, elapsed / period);
+    publish();
+}
+
+DeviceClock::Stats DeviceClock::getStats() const
+{
+    return published.read();
+}
+
+void DeviceClock::resetCounters()
+{
+    resetRequested.set (1);
+}
@@ -0,0 +1,114 @@
+/*
+    This file is part of the Kushview Modules for JUCE
+    Copyright (C) 2014-2017  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+/** Estimates an audio device's real clock from its callbacks.
+
+    Call begin() at the start of every audio callback and end() when
+    processing is done. Callback times are filtered with a DelayLockedLoop,
+    which gives the device's real period and sample rate, drift from the
+    nominal rate and a way to map frames to and from wall-clock time.
+
+    begin() and end() are realtime safe. Stats can be read from any thread
+    without locking with getStats().
+ */
+class DeviceClock
+{
+public:
+    enum { numJitterBins = 8 };
+
+    /** Upper bounds of the jitter histogram bins in microseconds, the last
+        bin takes everything above the one before it */
+    static const double jitterBinLimits [numJitterBins];
+
+    struct Stats
+    {
+        Stats() { zerostruct (*this); }
+
+        double nominalSampleRate;
+        double sampleRate;          ///< estimated from the filtered period
+        double nominalPeriod;       ///< seconds
+        double filteredPeriod;      ///< seconds
+        double driftPpm;
+
+        double maxJitter;           ///< seconds, largest error seen against the filtered time
+        double maxLoad;             ///< largest share of a period spent processing
+
+        int64 numCallbacks;
+        int64 numLateCallbacks;     ///< callbacks arriving later than the late threshold
+        int64 numOverloads;         ///< callbacks where processing took longer than a period
+        int64 jitterHistogram [numJitterBins];
+
+        double time;                ///< filtered time of the last callback, in seconds
+        int64 frame;                ///< frame at the start of the last callback
+
+        /** Map a frame to wall-clock time in seconds, on the same clock as
+            Time::getMillisecondCounterHiRes() / 1000 */
+        double frameToTime (int64 f) const
+        {
+            return sampleRate > 0.0 ? time + (double) (f - frame) / sampleRate : time;
+        }
+
+        /** Map wall-clock time in seconds to a frame */
+        int64 timeToFrame (double t) const
+        {
+            return frame + (int64) std::floor ((t - time) * sampleRate + 0.5);
+        }
+    };
+
+    DeviceClock();
+    ~DeviceClock();
+
+    /** Reset for a device's rate and block size. Not realtime safe */
+    void prepare (double sampleRate, int blockSize);
+
+    /** A callback arriving later than this many nominal periods after the
+        last counts as late. Default is 1.5 */
+    void setLateThreshold (double periods);
+
+    /** Call at the start of an audio callback */
+    void begin (int numFrames);
+
+    /** Call when the audio callback is done processing */
+    void end();
+
+    /** Take a consistent copy of the current stats. Lock free */
+    Stats getStats() const;
+
+    /** Clear counters and the histogram, the loop is left locked */
+    void resetCounters();
+
+    /** Returns seconds on a high resolution clock */
+    static double now();
+
+private:
+    DelayLockedLoop dll;
+    Stats stats;                // the audio thread's working copy
+    SeqLock<Stats> published;   // what getStats() reads
+    Atomic<int> resetRequested;
+    double lateThreshold;
+    double lastTime, callbackStart;
+    int lastNumFrames;
+    bool locked;
+
+    void publish() { published.write (stats); }
+
+    JUCE_DECLARE_NON_COPYABLE (DeviceClock)
+};
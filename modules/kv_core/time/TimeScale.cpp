@@ -44,6 +44,7 @@ void TimeScale::clear (void)
     mVerticalZoom = 100;
 
     mDisplayFmt    = Frames;
+    mPrecision     = Float;
 
     mSampleRate     = 44100;
     mTicksPerBeat   = 960;
@@ -78,7 +79,7 @@ void TimeScale::sync (const TimeScale& ts)
     {
         mNodes.append (new Node (this, other->frame,
                        other->tempo, other->beatType,
-                       other->beatsPerBar, other->beatDivisor));
+                       other->beatsPerBar, other->beatDivisor, other->ramp));
         other = other->next();
 	}
 
@@ -98,6 +99,7 @@ TimeScale& TimeScale::copyFrom (const TimeScale& ts)
         mHorizontalZoom = ts.mHorizontalZoom;
         mVerticalZoom   = ts.mVerticalZoom;
         mDisplayFmt     = ts.mDisplayFmt;
+        mPrecision      = ts.mPrecision;
 
 		// Sync/copy tempo-map nodes...
         sync (ts);
@@ -106,6 +108,18 @@ TimeScale& TimeScale::copyFrom (const TimeScale& ts)
 	return *this;
 }
 
+static uint64 greatestCommonDivisor (uint64 a, uint64 b)
+{
+    while (b != 0)
+    {
+        const uint64 r = a % b;
+        a = b;
+        b = r;
+    }
+
+    return a > 0 ? a : 1;
+}
+
 void TimeScale::Node::update()
 {
     ticksPerBeat = ts->ticksPerBeat();
@@ -124,14 +138,198 @@ void TimeScale::Node::update()
         ticksPerBeat <<= n;
         beatRate /= float (1 << n);
 	}
+
+    // a float is its 24 bit mantissa times a power of two, so the tempo is
+    // exactly mantissa / 2^shift beats per minute, with no rounding
+    int exponent = 0;
+    const double fraction = std::frexp ((double) jmax (tempo, 1.0e-3f), &exponent);
+    const uint64 mantissa = (uint64) std::ldexp (fraction, 24);
+    const int shift = jlimit (0, 40, 24 - exponent);
+    const uint64 framesPerMinute = ((uint64) 60 * jmax (1u, ts->getSampleRate())) << shift;
+
+    tickNum = mantissa * ts->ticksPerBeat();
+    tickDen = framesPerMinute;
+    beatNum = mantissa;
+    beatDen = framesPerMinute;
+
+    if (beatDivisor > beatType)
+        beatNum <<= (beatDivisor - beatType);
+    else if (beatDivisor < beatType)
+        beatDen <<= (beatType - beatDivisor);
+
+    const uint64 tickGcd = greatestCommonDivisor (tickNum, tickDen);
+    tickNum /= tickGcd;
+    tickDen /= tickGcd;
+
+    const uint64 beatGcd = greatestCommonDivisor (beatNum, beatDen);
+    beatNum /= beatGcd;
+    beatDen /= beatGcd;
+
+    // set again by the next node, if there is one
+    rampTicks = rampFrames = 0.0;
+}
+
+void TimeScale::Node::allocateRamp()
+{
+    // done when the node gets its ramp, updating the scale never allocates
+    if (ramp != Step && rampTable == nullptr)
+        rampTable.allocate ((size_t) (4 * (rampTableSize + 1)), false);
+}
+
+void TimeScale::Node::updateRamp (const Node* next, double spanTicks, double spanFrames)
+{
+    rampTicks = rampFrames = 0.0;
+    rampEndTempo = tempo;
+
+    // ramp was set on the node directly, use addNode() so it has a table
+    jassert (ramp == Step || rampTable != nullptr);
+
+    if (ramp == Step || rampTable == nullptr || next == nullptr || next->tempo == tempo || tempo <= 0.0f || next->tempo <= 0.0f)
+        return;
+
+    const double t0  = tempo;
+    const double t1  = next->tempo;
+    const double tpq = ts->ticksPerBeat();
+    const double fpm = 60.0 * ts->getSampleRate();
+    const double logRatio = std::log (t1 / t0);
+
+    // the next node was placed by frame, find the ticks that take that long
+    if (spanTicks <= 0.0)
+        spanTicks = (ramp == Linear) ? spanFrames * tpq * (t1 - t0) / (fpm * logRatio)
+                                     : spanFrames * tpq * t0 * logRatio / (fpm * (1.0 - t0 / t1));
+    if (spanTicks <= 0.0)
+        return;
+
+    rampEndTempo = next->tempo;
+    rampTicks    = spanTicks;
+    rampFrames   = rampFramesAtTicks (spanTicks);
+
+    // values and slopes on an even grid for both directions, for hermite interpolation
+    const int n = rampTableSize;
+    double* const framesAtTicks = rampTable;
+    double* const framesSlope   = rampTable + (n + 1);
+    double* const ticksAtFrames = rampTable + 2 * (n + 1);
+    double* const ticksSlope    = rampTable + 3 * (n + 1);
+
+    for (int i = 0; i <= n; ++i)
+    {
+        const double x = rampTicks * i / n;
+        framesAtTicks[i] = rampFramesAtTicks (x);
+        framesSlope[i]   = fpm / (tpq * rampTempoAtTicks (x));
+
+        const double f = rampFrames * i / n;
+        ticksAtFrames[i] = i == n ? rampTicks : rampTicksAtFrames (f);
+        ticksSlope[i]    = tpq * rampTempoAtTicks (ticksAtFrames[i]) / fpm;
+    }
+}
+
+double TimeScale::Node::rampTempoAtTicks (double x) const
+{
+    const double t0 = tempo, t1 = rampEndTempo, u = jlimit (0.0, 1.0, x / rampTicks);
+    return ramp == Linear ? t0 + (t1 - t0) * u : t0 * std::pow (t1 / t0, u);
+}
+
+double TimeScale::Node::rampFramesAtTicks (double x) const
+{
+    const double t0 = tempo, t1 = rampEndTempo;
+    const double tpq = ts->ticksPerBeat();
+    const double fpm = 60.0 * ts->getSampleRate();
+
+    if (ramp == Linear)
+        return fpm * rampTicks / (tpq * (t1 - t0)) * std::log (rampTempoAtTicks (x) / t0);
+
+    const double rho = std::log (t1 / t0) / rampTicks;
+    return fpm * (1.0 - std::exp (-rho * x)) / (tpq * t0 * rho);
+}
+
+double TimeScale::Node::rampTicksAtFrames (double f) const
+{
+    const double t0 = tempo, t1 = rampEndTempo;
+    const double tpq = ts->ticksPerBeat();
+    const double fpm = 60.0 * ts->getSampleRate();
+
+    if (ramp == Linear)
+        return t0 * rampTicks / (t1 - t0) * (std::exp (f * tpq * (t1 - t0) / (fpm * rampTicks)) - 1.0);
+
+    const double rho = std::log (t1 / t0) / rampTicks;
+    return -std::log (1.0 - f * tpq * t0 * rho / fpm) / rho;
+}
+
+/** Cubic hermite lookup in a table of n + 1 values followed by n + 1 slopes.
+    Past the end the last slope continues, that's the tempo the ramp ends on */
+static double lookupRamp (const double* table, int n, double span, double x)
+{
+    const double* const values = table;
+    const double* const slopes = table + (n + 1);
+
+    if (x >= span)
+        return values[n] + (x - span) * slopes[n];
+
+    const double step = span / n;
+    const double u = jmax (0.0, x) / step;
+    const int i = jmin ((int) u, n - 1);
+    const double t = u - i, t2 = t * t, t3 = t2 * t;
+
+    return (2.0 * t3 - 3.0 * t2 + 1.0) * values[i]
+         + (t3 - 2.0 * t2 + t) * step * slopes[i]
+         + (3.0 * t2 - 2.0 * t3) * values[i + 1]
+         + (t3 - t2) * step * slopes[i + 1];
+}
+
+double TimeScale::Node::rampFramesFromTicks (double x) const
+{
+    return lookupRamp (rampTable, rampTableSize, rampTicks, x);
+}
+
+/** Slope of the lookupRamp() curve, the derivative of the same hermite */
+static double lookupRampSlope (const double* table, int n, double span, double x)
+{
+    const double* const values = table;
+    const double* const slopes = table + (n + 1);
+
+    if (x >= span)
+        return slopes[n];
+
+    const double step = span / n;
+    const double u = jmax (0.0, x) / step;
+    const int i = jmin ((int) u, n - 1);
+    const double t = u - i, t2 = t * t;
+
+    return ((6.0 * t2 - 6.0 * t) * (values[i] - values[i + 1])) / step
+         + (3.0 * t2 - 4.0 * t + 1.0) * slopes[i]
+         + (3.0 * t2 - 2.0 * t) * slopes[i + 1];
+}
+
+double TimeScale::Node::rampTicksFromFrames (double f) const
+{
+    return lookupRamp (rampTable + 2 * (rampTableSize + 1), rampTableSize, rampFrames, f);
+}
+
+float TimeScale::Node::tempoAtFrame (uint64 iFrame) const
+{
+    if (! isRamping() || iFrame <= frame)
+        return tempo;
+
+    // ticks per frame is proportional to tempo, so the table gives it
+    // without the pow() of rampTempoAtTicks()
+    const double ticksPerFrame = lookupRampSlope (rampTable + 2 * (rampTableSize + 1), rampTableSize,
+                                                  rampFrames, (double) (iFrame - frame));
+    return (float) (ticksPerFrame * 60.0 * ts->getSampleRate() / ts->ticksPerBeat());
 }
 
 void TimeScale::Node::reset (TimeScale::Node *node)
 {
+    // the previous node ramps to this one, ticks between bars don't depend on tempo
     if (bar > node->bar)
+    {
+        node->updateRamp (this, (double) (node->tickFromBar (bar) - node->tick), 0.0);
         frame = node->frameFromBar (bar);
+    }
 	else
+    {
+        node->updateRamp (this, 0.0, (double) (frame - node->frame));
         bar = node->barFromFrame (frame);
+    }
 
     beat  = node->beatFromFrame (frame);
     tick  = node->tickFromFrame (frame);
@@ -203,7 +401,7 @@ TimeScale::Node* TimeScale::Cursor::seekFrame (uint64 iFrame) const
 	return node;
 }
 
-TimeScale::Node* TimeScale::Cursor::seekBar (unsigned short sbar) const
+TimeScale::Node* TimeScale::Cursor::seekBar (unsigned int sbar) const
 {
     if (node == 0)
     {
@@ -309,7 +507,7 @@ TimeScale::Node* TimeScale::Cursor::seekPixel (int px) const
 }
 
 TimeScale::Node* TimeScale::addNode (uint64 frame_, float tempo_, unsigned short beat_type_,
-                     unsigned short beats_per_bar_, unsigned short beat_divisor_)
+                     unsigned short beats_per_bar_, unsigned short beat_divisor_, Ramp ramp_)
 {
     Node *node	= 0;
 
@@ -332,11 +530,14 @@ TimeScale::Node* TimeScale::addNode (uint64 frame_, float tempo_, unsigned short
         node->beatType = beat_type_;
         node->beatsPerBar = beats_per_bar_;
         node->beatDivisor = beat_divisor_;
+        node->ramp = ramp_;
+        node->allocateRamp();
     }
     else if (prev && prev->tempo == tempo_
                   && prev->beatType == beat_type_
                   && prev->beatsPerBar == beats_per_bar_
-                  && prev->beatDivisor == beat_divisor_)
+                  && prev->beatDivisor == beat_divisor_
+                  && prev->ramp == Step && ramp_ == Step)
     {
 		// No need for a new node...
         return prev;
@@ -344,7 +545,8 @@ TimeScale::Node* TimeScale::addNode (uint64 frame_, float tempo_, unsigned short
     else if (next && next->tempo == tempo_
                   && next->beatType == beat_type_
                   && next->beatsPerBar == beats_per_bar_
-                  && next->beatDivisor == beat_divisor_)
+                  && next->beatDivisor == beat_divisor_
+                  && next->ramp == ramp_)
     {
 		// Update next exact matching node...
         node = next;
@@ -354,7 +556,7 @@ TimeScale::Node* TimeScale::addNode (uint64 frame_, float tempo_, unsigned short
     else
     {
 		// Add/insert a new node...
-        node = new Node (this, frame_, tempo_, beat_type_, beats_per_bar_, beat_divisor_);
+        node = new Node (this, frame_, tempo_, beat_type_, beats_per_bar_, beat_divisor_, ramp_);
         if (prev)
             mNodes.insertAfter (node, prev);
 		else
@@ -405,6 +607,8 @@ void TimeScale::removeNode (TimeScale::Node *node)
 	// Update positioning on all nodes thereafter...
     Node *prev = node_prev;
     Node *next = node->next();
+    if (next == 0)
+        node_prev->updateRamp (0, 0.0, 0.0);
     while (next)
     {
         if (prev)
@@ -480,6 +684,52 @@ uint64 TimeScale::frameFromTickRange (uint64 iTickStart, uint64 iTickEnd)
 }
 
 
+void TimeScale::ticksFromFrames (const uint64* frames, uint64* ticks, int numValues) const
+{
+    Node* node = nullptr;
+    uint64 nodeEnd = 0;
+
+    for (int i = 0; i < numValues; ++i)
+    {
+        const uint64 frame = frames[i];
+        if (node == nullptr || frame < node->frame || frame >= nodeEnd)
+        {
+            if (nullptr == (node = mCursor.seekFrame (frame)))
+            {
+                zeromem (ticks + i, sizeof (uint64) * (size_t) (numValues - i));
+                return;
+            }
+
+            nodeEnd = node->next() != nullptr ? node->next()->frame : std::numeric_limits<uint64>::max();
+        }
+
+        ticks[i] = node->tickFromFrame (frame);
+    }
+}
+
+void TimeScale::framesFromTicks (const uint64* ticks, uint64* frames, int numValues) const
+{
+    Node* node = nullptr;
+    uint64 nodeEnd = 0;
+
+    for (int i = 0; i < numValues; ++i)
+    {
+        const uint64 tick = ticks[i];
+        if (node == nullptr || tick < node->tick || tick >= nodeEnd)
+        {
+            if (nullptr == (node = mCursor.seekTick (tick)))
+            {
+                zeromem (frames + i, sizeof (uint64) * (size_t) (numValues - i));
+                return;
+            }
+
+            nodeEnd = node->next() != nullptr ? node->next()->tick : std::numeric_limits<uint64>::max();
+        }
+
+        frames[i] = node->frameFromTick (tick);
+    }
+}
+
 uint64 TimeScale::tickFromFrameRange (uint64 iFrameStart, uint64 iFrameEnd)
 {
     Node *pNode = mCursor.seekFrame(iFrameStart);
@@ -522,7 +772,7 @@ TimeScale::Marker* TimeScale::MarkerCursor::seekFrame (uint64 iFrame )
 	return marker;
 }
 
-TimeScale::Marker* TimeScale::MarkerCursor::seekBar (unsigned short iBar )
+TimeScale::Marker* TimeScale::MarkerCursor::seekBar (unsigned int iBar )
 {
     return seekFrame (ts->frameFromBar (iBar));
 }
@@ -551,7 +801,7 @@ TimeScale::Marker* TimeScale::addMarker (uint64 target_frame, const std::string&
     Marker *marker	= 0;
 
 	// Snap to nearest bar...
-    unsigned short nearest_bar = 0;
+    unsigned int nearest_bar = 0;
 
     Node *prev = mCursor.seekFrame (target_frame);
     if (prev)
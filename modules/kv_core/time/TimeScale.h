@@ -36,7 +36,31 @@ public:
         BBT
     };
 
-    TimeScale() : mDisplayFmt (Frames), mCursor (this), mMarkerCursor (this) { clear(); }
+    /** How frames are converted to ticks, beats and bars.
+        Float is the original single precision math, which drifts by several
+        ticks over long sessions. Exact uses integer ratios per node, taken
+        from the exact value of the float tempo, so a position converts the
+        same at bar 1 as ten hours in. */
+    enum Precision
+    {
+        Float = 0,
+        Exact
+    };
+
+    /** How a node's tempo reaches the next node's.
+        Step holds it until the next node. Linear and Exponential move it
+        continuously, linearly or by a constant ratio per tick, so an
+        accelerando is two nodes. Ramps are converted in double precision
+        whatever the Precision, with a per node table so the audio thread
+        never needs exp() or log(). Pixels follow ramps stepwise. */
+    enum Ramp
+    {
+        Step = 0,
+        Linear,
+        Exponential
+    };
+
+    TimeScale() : mDisplayFmt (Frames), mPrecision (Float), mCursor (this), mMarkerCursor (this) { clear(); }
     TimeScale (const TimeScale& ts) : mCursor (this), mMarkerCursor (this) { copyFrom (ts); }
     TimeScale& operator=(const TimeScale& ts) { return copyFrom (ts); }
 
@@ -79,10 +103,27 @@ public:
     void setVerticalZoom (unsigned short vzoom) { mVerticalZoom = vzoom; }
     unsigned short verticalZoom() const { return mVerticalZoom; }
 
+    /** Conversion precision, Float by default. Pixel conversions are always Float */
+    void setPrecision (Precision precision) { mPrecision = precision; }
+    Precision getPrecision() const { return mPrecision; }
+    bool isExact() const { return mPrecision == Exact; }
+
 	// Fastest rounding-from-float helper.
     static uint64_t uroundf (float x) { return static_cast<uint64_t> (x >= 0.0f ? x + 0.5f : x - 0.5f); }
     static int64_t  roundf  (float x) { return static_cast<int64_t> (x >= 0.0f ? x + 0.5f : x - 0.5f); }
 
+    /** a * b / c rounded to nearest, without overflowing on a * b */
+    static uint64 mulDivRound (uint64 a, uint64 b, uint64 c)
+    {
+        const uint64 q = a / c, r = a % c;
+       #if defined (__SIZEOF_INT128__)
+        return q * b + (uint64) (((unsigned __int128) r * b + c / 2) / c);
+       #else
+        // r * b / c is less than b, so a double is within a fraction of a tick
+        return q * b + (uint64) ((double) r * (double) b / (double) c + 0.5);
+       #endif
+    }
+
 	// Beat divisor (snap index) accessors.
     static unsigned short snapFromIndex (int index);
     static int indexFromSnap (unsigned short snap);
@@ -94,14 +135,19 @@ public:
 		// Constructor.
         Node (TimeScale *timescale, uint64 frame_ = 0, float tempo_ = 120.0f,
               unsigned short beattype_ = 2, unsigned short beats_per_bar_ = 4,
-              unsigned short beat_divisor_ = 2)
+              unsigned short beat_divisor_ = 2, Ramp ramp_ = Step)
             : frame(frame_), bar(0), beat(0), tick(0), pixel(0),
               tempo(tempo_), beatType (beattype_),
               beatsPerBar (beats_per_bar_),
               beatDivisor (beat_divisor_),
+              ramp (ramp_),
               ticksPerBeat(0), ts (timescale),
-              tickRate (1.0f), beatRate (1.0f)
-        { }
+              tickRate (1.0f), beatRate (1.0f),
+              tickNum (1), tickDen (1), beatNum (1), beatDen (1),
+              rampTicks (0.0), rampFrames (0.0), rampEndTempo (tempo_)
+        {
+            allocateRamp();
+        }
 
 		// Update node scale coefficients.
 		void update();
@@ -113,25 +159,70 @@ public:
         void setTempoEx (float tempo, unsigned short beatType = 2);
         float tempoEx (unsigned short beatType = 2) const;
 
+        /** True if the tempo ramps to the next node's */
+        bool isRamping() const { return rampTicks > 0.0; }
+
+        /** The tempo at a frame in this node, which only varies if ramping */
+        float tempoAtFrame (uint64 iFrame) const;
+
 		// Frame/bar convertors.
-        unsigned short barFromFrame (uint64 iFrame) const { return bar + (unsigned short) uroundf ((beatRate * (iFrame - frame)) / (ts->frameRate() * beatsPerBar)); }
-        uint64 frameFromBar (unsigned short iBar)   const { return frame + (uint64) uroundf ((ts->frameRate() * beatsPerBar * (iBar - bar)) / beatRate); }
+        unsigned int barFromFrame (uint64 iFrame) const
+        {
+            if (isRamping())
+                return bar + (unsigned int) (rampTicksFromFrames ((double) (iFrame - frame)) / (ticksPerBeat * beatsPerBar) + 0.5);
+            return bar + (unsigned int) (ts->isExact() ? mulDivRound (iFrame - frame, beatNum, beatDen * beatsPerBar)
+                                                       : uroundf ((beatRate * (iFrame - frame)) / (ts->frameRate() * beatsPerBar)));
+        }
+
+        uint64 frameFromBar (unsigned int iBar) const
+        {
+            if (isRamping())
+                return frameFromTick (tickFromBar (iBar));
+            return frame + (ts->isExact() ? mulDivRound ((uint64) (iBar - bar) * beatsPerBar, beatDen, beatNum)
+                                          : (uint64) uroundf ((ts->frameRate() * beatsPerBar * (iBar - bar)) / beatRate));
+        }
 
 		// Frame/beat convertors.
-        unsigned int beatFromFrame (uint64 iFrame) const { return beat + (unsigned int) uroundf ((beatRate * (iFrame - frame)) / ts->frameRate()); }
-        uint64 frameFromBeat (unsigned int iBeat) const { return frame + (uint64) uroundf ((ts->frameRate() * (iBeat - beat)) / beatRate); }
+        unsigned int beatFromFrame (uint64 iFrame) const
+        {
+            if (isRamping())
+                return beat + (unsigned int) (rampTicksFromFrames ((double) (iFrame - frame)) / ticksPerBeat + 0.5);
+            return beat + (unsigned int) (ts->isExact() ? mulDivRound (iFrame - frame, beatNum, beatDen)
+                                                        : uroundf ((beatRate * (iFrame - frame)) / ts->frameRate()));
+        }
+
+        uint64 frameFromBeat (unsigned int iBeat) const
+        {
+            if (isRamping())
+                return frameFromTick (tickFromBeat (iBeat));
+            return frame + (ts->isExact() ? mulDivRound ((uint64) (iBeat - beat), beatDen, beatNum)
+                                          : (uint64) uroundf ((ts->frameRate() * (iBeat - beat)) / beatRate));
+        }
 
 		// Frame/tick convertors.
-        uint64 tickFromFrame (uint64 iFrame) const { return tick + (uint64) uroundf ((tickRate * (iFrame - frame)) / ts->frameRate()); }
-		uint64 frameFromTick(uint64 iTick) const { return frame + (uint64) uroundf((ts->frameRate() * (iTick - tick)) / tickRate); }
+        uint64 tickFromFrame (uint64 iFrame) const
+        {
+            if (isRamping())
+                return tick + (uint64) (rampTicksFromFrames ((double) (iFrame - frame)) + 0.5);
+            return tick + (ts->isExact() ? mulDivRound (iFrame - frame, tickNum, tickDen)
+                                         : (uint64) uroundf ((tickRate * (iFrame - frame)) / ts->frameRate()));
+        }
+
+        uint64 frameFromTick (uint64 iTick) const
+        {
+            if (isRamping())
+                return frame + (uint64) (rampFramesFromTicks ((double) (iTick - tick)) + 0.5);
+            return frame + (ts->isExact() ? mulDivRound (iTick - tick, tickDen, tickNum)
+                                          : (uint64) uroundf ((ts->frameRate() * (iTick - tick)) / tickRate));
+        }
 
 		// Tick/beat convertors.
 		unsigned int beatFromTick(uint64 iTick) const { return beat + (unsigned int) ((iTick - tick) / ticksPerBeat); }
 		uint64 tickFromBeat(unsigned int iBeat) const { return tick + (uint64) (ticksPerBeat * (iBeat - beat)); }
 
 		// Tick/bar convertors.
-		unsigned short barFromTick(uint64 iTick) const { return bar + (unsigned short) ((iTick - tick) / (ticksPerBeat * beatsPerBar)); }
-		uint64 tickFromBar(unsigned short iBar) const { return tick + (uint64) (ticksPerBeat * beatsPerBar * (iBar - bar)); }
+		unsigned int barFromTick(uint64 iTick) const { return bar + (unsigned int) ((iTick - tick) / (ticksPerBeat * beatsPerBar)); }
+		uint64 tickFromBar(unsigned int iBar) const { return tick + (uint64) ticksPerBeat * beatsPerBar * (iBar - bar); }
 
 		// Tick/pixel convertors.
 		uint64 tickFromPixel(int x) const { return tick + (uint64) uroundf((tickRate * (x - pixel)) / ts->pixelRate()); }
@@ -145,12 +236,12 @@ public:
 		unsigned short pixelsPerBeat() const { return (unsigned short) uroundf(ts->pixelRate() / beatRate); }
 
 		// Bar/pixel convertors.
-		unsigned short barFromPixel(int x) const { return bar + (unsigned short) uroundf((beatRate * (x - pixel)) / (ts->pixelRate() * beatsPerBar)); }
-		int pixelFromBar(unsigned short b) const { return pixel + (int) uroundf((ts->pixelRate() * beatsPerBar * (b - bar)) / beatRate); }
+		unsigned int barFromPixel(int x) const { return bar + (unsigned int) uroundf((beatRate * (x - pixel)) / (ts->pixelRate() * beatsPerBar)); }
+		int pixelFromBar(unsigned int b) const { return pixel + (int) uroundf((ts->pixelRate() * beatsPerBar * (b - bar)) / beatRate); }
 
 		// Bar/beat convertors.
-		unsigned short barFromBeat(unsigned int iBeat) const { return bar + (unsigned short)((iBeat - beat) / beatsPerBar); }
-        unsigned int beatFromBar (unsigned short iBar) const  { return beat + (int)(beatsPerBar * (iBar - bar)); }
+		unsigned int barFromBeat(unsigned int iBeat) const { return bar + (unsigned int)((iBeat - beat) / beatsPerBar); }
+        unsigned int beatFromBar (unsigned int iBar) const  { return beat + (int)(beatsPerBar * (iBar - bar)); }
 
         bool beatIsBar (unsigned int iBeat) const { return ((iBeat - beat) % beatsPerBar) == 0; }
 
@@ -164,7 +255,7 @@ public:
 
 		// Node keys.
 		uint64  frame;
-		unsigned short bar;
+		unsigned int   bar;
 		unsigned int   beat;
 		uint64  tick;
 		int            pixel;
@@ -174,6 +265,7 @@ public:
         unsigned short beatType;
         unsigned short beatsPerBar;
         unsigned short beatDivisor;
+        Ramp           ramp;
 
         unsigned short ticksPerBeat;
 
@@ -184,6 +276,25 @@ public:
 		// Node cached coefficients.
         float tickRate;
         float beatRate;
+
+        // Exact coefficients, ticks and beats per frame as reduced ratios.
+        uint64 tickNum, tickDen;
+        uint64 beatNum, beatDen;
+
+        // Ramp to the next node, rampTicks is 0 when not ramping.
+        enum { rampTableSize = 64 };
+        double rampTicks, rampFrames;
+        float rampEndTempo;
+        HeapBlock<double> rampTable;
+
+        friend class TimeScale;
+        void allocateRamp();
+        void updateRamp (const Node* next, double spanTicks, double spanFrames);
+        double rampTempoAtTicks (double ticks) const;
+        double rampFramesAtTicks (double ticks) const;
+        double rampTicksAtFrames (double frames) const;
+        double rampTicksFromFrames (double frames) const;
+        double rampFramesFromTicks (double ticks) const;
 	};
 
 	// Node list accessor.
@@ -200,7 +311,7 @@ public:
         void reset (Node *node = 0);
 
         Node* seekFrame (uint64 frame) const;
-        Node* seekBar   (unsigned short bar) const;
+        Node* seekBar   (unsigned int bar) const;
         Node* seekBeat  (unsigned int beat) const;
         Node* seekTick  (uint64 tick) const;
         Node* seekPixel (int x) const;
@@ -212,10 +323,13 @@ public:
 
     Cursor& cursor() { return mCursor; }
 
+    /** The node in effect at a frame, e.g. for the meter there */
+    const Node* getNodeAtFrame (uint64 frame) const { return mCursor.seekFrame (frame); }
+
 	// Node list specifics.
     Node *addNode (uint64 iFrame = 0, float fTempo = 120.0f,
                    unsigned short iBeatType = 2, unsigned short iBeatsPerBar = 4,
-                   unsigned short iBeatDivisor = 2);
+                   unsigned short iBeatDivisor = 2, Ramp ramp = Step);
 
     void updateNode (Node *node);
     void removeNode (Node *node);
@@ -228,13 +342,13 @@ public:
     int64_t frameFromPixel (int x) const { return roundf ((mFrameRate * x) / mPixelRate); }
 
 	// Frame/bar general converters.
-    unsigned short barFromFrame (uint64 frame)
+    unsigned int barFromFrame (uint64 frame)
 	{
         Node *node = mCursor.seekFrame (frame);
         return (node ? node->barFromFrame (frame) : 0);
 	}
 
-    uint64 frameFromBar (unsigned short bar)
+    uint64 frameFromBar (unsigned int bar)
 	{
         Node *node = mCursor.seekBar (bar);
         return (node ? node->frameFromBar (bar) : 0);
@@ -267,6 +381,13 @@ public:
         return (node ? node->frameFromTick (tick) : 0);
 	}
 
+    /** Convert many frames to ticks. The node is only looked up again when
+        a frame leaves it, so sorted input costs one seek per tempo change */
+    void ticksFromFrames (const uint64* frames, uint64* ticks, int numValues) const;
+
+    /** Convert many ticks to frames, see ticksFromFrames() */
+    void framesFromTicks (const uint64* ticks, uint64* frames, int numValues) const;
+
 	// Tick/pixel general converters.
     uint64
     tickFromPixel (int x) const
@@ -350,6 +471,13 @@ public:
             node->tempo = tempo;
 	}
 
+    /** The tempo at a frame, following ramps */
+    float getTempoAtFrame (uint64 frame) const
+    {
+        Node *node = mCursor.seekFrame (frame);
+        return (node ? node->tempoAtFrame (frame) : 120.0f);
+    }
+
     /** Return the timescale's current tempo (at the first node) */
     float getTempo() const
 	{
@@ -429,7 +557,7 @@ public:
 	public:
 
 		// Constructor.
-        Marker (uint64 iFrame, unsigned short iBar,
+        Marker (uint64 iFrame, unsigned int iBar,
                 const std::string& sText, const std::string& rgbColor = std::string("#545454"))
             : frame (iFrame), bar(iBar), text(sText), color (rgbColor) { }
 
@@ -439,7 +567,7 @@ public:
 
 		// Marker keys.
 		uint64  frame;
-		unsigned short bar;
+		unsigned int   bar;
 
 		// Marker payload.
         std::string text;
@@ -463,7 +591,7 @@ public:
 
 		// Seek methods.
         Marker *seekFrame (uint64 iFrame);
-        Marker *seekBar (unsigned short iBar);
+        Marker *seekBar (unsigned int iBar);
         Marker *seekBeat (unsigned int iBeat);
         Marker *seekTick (uint64 iTick);
         Marker *seekPixel (int x);
@@ -506,6 +634,7 @@ private:
     unsigned short mVerticalZoom;   ///< Vertical zoom factor.
 
     DisplayFormat  mDisplayFmt;     ///< Textual display format.
+    Precision      mPrecision;      ///< Frame conversion precision.
 
     unsigned int   mSampleRate;     ///< Sample rate (frames per second)
     unsigned short mTicksPerBeat;   ///< Tticks per quarter note (PPQN)
@@ -0,0 +1,218 @@
+/*
+    This file is part of the Kushview Modules for JUCE
+    Copyright (C) 2014-2017  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+// bytes MidiBuffer stores ahead of each event's data
+static const size_t compiledMidiHeaderSize = sizeof (int32) + sizeof (uint16);
+
+bool CompiledMidiSequence::NodeKey::operator== (const NodeKey& o) const noexcept
+{
+    return frame == o.frame && tick == o.tick && tempo == o.tempo
+        && beatType == o.beatType && beatsPerBar == o.beatsPerBar
+        && beatDivisor == o.beatDivisor && ramp == o.ramp;
+}
+
+CompiledMidiSequence::CompiledMidiSequence()
+    : numEvents (0), bufferBytes (0), sampleRate (0), ticksPerBeat (0),
+      cursor (0), nextFrame (-1)
+{
+    offsets.calloc (1);
+}
+
+CompiledMidiSequence::CompiledMidiSequence (const CompiledMidiSequence& o)
+    : numEvents (o.numEvents), data (o.data), bufferBytes (o.bufferBytes), keys (o.keys),
+      sampleRate (o.sampleRate), ticksPerBeat (o.ticksPerBeat),
+      cursor (0), nextFrame (-1)
+{
+    frames.malloc ((size_t) jmax (1, numEvents));
+    ticks.malloc ((size_t) jmax (1, numEvents));
+    offsets.malloc ((size_t) numEvents + 1);
+
+    if (numEvents > 0)
+    {
+        memcpy (frames.getData(), o.frames.getData(), sizeof (int64) * (size_t) numEvents);
+        memcpy (ticks.getData(), o.ticks.getData(), sizeof (uint64) * (size_t) numEvents);
+    }
+
+    memcpy (offsets.getData(), o.offsets.getData(), sizeof (int32) * ((size_t) numEvents + 1));
+}
+
+CompiledMidiSequence::~CompiledMidiSequence() { }
+
+void CompiledMidiSequence::clear()
+{
+    numEvents = 0;
+    frames.free();
+    ticks.free();
+    offsets.calloc (1);
+    data.setSize (0);
+    bufferBytes = 0;
+    keys.clearQuick();
+    cursor = 0;
+    nextFrame = -1;
+}
+
+void CompiledMidiSequence::compile (const MidiMessageSequence& sequence, const TimeScale& ts)
+{
+    clear();
+
+    // MidiBuffer stores sizes as 16 bits, anything bigger can't be played
+    int count = 0;
+    size_t numBytes = 0;
+    for (int i = 0; i < sequence.getNumEvents(); ++i)
+    {
+        const int size = sequence.getEventPointer(i)->message.getRawDataSize();
+        jassert (size <= 0xffff);
+        if (size > 0xffff)
+            continue;
+
+        ++count;
+        numBytes += (size_t) size;
+    }
+
+    frames.malloc ((size_t) jmax (1, count));
+    ticks.malloc ((size_t) jmax (1, count));
+    offsets.malloc ((size_t) count + 1);
+    data.setSize (numBytes);
+    bufferBytes = numBytes + (size_t) count * compiledMidiHeaderSize;
+
+    uint8* const dest = static_cast<uint8*> (data.getData());
+    int32 offset = 0;
+
+    for (int i = 0; i < sequence.getNumEvents(); ++i)
+    {
+        const MidiMessage& msg (sequence.getEventPointer(i)->message);
+        const int size = msg.getRawDataSize();
+        if (size > 0xffff)
+            continue;
+
+        memcpy (dest + offset, msg.getRawData(), (size_t) size);
+
+        ticks [numEvents] = static_cast<uint64> (jmax (0.0, msg.getTimeStamp()));
+        offsets [numEvents] = offset;
+        offset += size;
+        ++numEvents;
+    }
+
+    offsets [numEvents] = offset;
+
+    getKeys (ts, keys);
+    sampleRate   = ts.getSampleRate();
+    ticksPerBeat = ts.ticksPerBeat();
+    retime (ts, 0);
+}
+
+bool CompiledMidiSequence::update (const TimeScale& ts)
+{
+    Array<NodeKey> current;
+    getKeys (ts, current);
+
+    if (sampleRate != ts.getSampleRate() || ticksPerBeat != ts.ticksPerBeat())
+    {
+        sampleRate   = ts.getSampleRate();
+        ticksPerBeat = ts.ticksPerBeat();
+        keys.swapWith (current);
+        retime (ts, 0);
+        return true;
+    }
+
+    int changed = 0;
+    while (changed < keys.size() && changed < current.size()
+            && keys.getReference (changed) == current.getReference (changed))
+        ++changed;
+
+    if (changed == keys.size() && changed == current.size())
+        return false;
+
+    // a node ramping into the change is timed by it too
+    if (changed > 0 && keys.getReference (changed - 1).ramp != TimeScale::Step)
+        --changed;
+
+    // nodes before the change are the same, so events before it are too
+    uint64 fromTick = std::numeric_limits<uint64>::max();
+    if (changed < keys.size())
+        fromTick = jmin (fromTick, keys.getReference(changed).tick);
+    if (changed < current.size())
+        fromTick = jmin (fromTick, current.getReference(changed).tick);
+
+    keys.swapWith (current);
+    retime (ts, (int) (std::lower_bound (ticks.getData(), ticks.getData() + numEvents, fromTick) - ticks.getData()));
+    return true;
+}
+
+bool CompiledMidiSequence::isUpToDate (const TimeScale& ts) const
+{
+    if (sampleRate != ts.getSampleRate() || ticksPerBeat != ts.ticksPerBeat())
+        return false;
+
+    Array<NodeKey> current;
+    getKeys (ts, current);
+    return current == keys;
+}
+
+void CompiledMidiSequence::getKeys (const TimeScale& ts, Array<NodeKey>& dest)
+{
+    dest.clearQuick();
+    for (const TimeScale::Node* node = ts.nodes().first(); node != nullptr; node = node->next())
+    {
+        NodeKey key;
+        key.frame       = node->frame;
+        key.tick        = node->tick;
+        key.tempo       = node->tempo;
+        key.beatType    = node->beatType;
+        key.beatsPerBar = node->beatsPerBar;
+        key.beatDivisor = node->beatDivisor;
+        key.ramp        = (int) node->ramp;
+        dest.add (key);
+    }
+}
+
+void CompiledMidiSequence::retime (const TimeScale& ts, int startIndex)
+{
+    // ticks are sorted, so this is one seek per tempo change
+    if (startIndex < numEvents)
+        ts.framesFromTicks (ticks + startIndex, reinterpret_cast<uint64*> (frames + startIndex),
+                            numEvents - startIndex);
+    nextFrame = -1;
+}
+
+int CompiledMidiSequence::getIndexAtFrame (int64 frame) const noexcept
+{
+    return (int) (std::lower_bound (frames.getData(), frames.getData() + numEvents, frame) - frames.getData());
+}
+
+void CompiledMidiSequence::render (MidiBuffer& target, int64 startFrame, int numSamples, int offset) noexcept
+{
+    if (numEvents <= 0 || numSamples <= 0)
+        return;
+
+    if (startFrame != nextFrame)
+        cursor = getIndexAtFrame (startFrame);
+    nextFrame = startFrame + numSamples;
+
+    const int first = cursor;
+    while (cursor < numEvents && frames[cursor] < nextFrame)
+        ++cursor;
+    if (cursor == first)
+        return;
+
+    const uint8* const src = static_cast<const uint8*> (data.getData());
+    for (int i = first; i < cursor; ++i)
+        target.addEvent (src + offsets[i], offsets[i + 1] - offsets[i],
+                         offset + (int) (frames[i] - startFrame));
+}
@@ -0,0 +1,103 @@
+/*
+    This file is part of the Kushview Modules for JUCE
+    Copyright (C) 2014-2017  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+/** A MIDI sequence compiled for playback against a tempo map.
+
+    The raw bytes of a tick-stamped MidiMessageSequence's events are stored
+    contiguously, alongside their frame positions in a TimeScale. Rendering
+    a block is a cursor advance and an addEvent() per event, with no tick to
+    frame conversions on the audio thread.
+
+    When the tempo map changes, update() re-times only the events after the
+    first node that differs from the map the sequence was compiled with.
+    compile() and update() are not realtime safe. render() is, as long as
+    the target buffer has room for the events, see getNumBytes().
+ */
+class CompiledMidiSequence
+{
+public:
+    CompiledMidiSequence();
+    CompiledMidiSequence (const CompiledMidiSequence& other);
+    ~CompiledMidiSequence();
+
+    /** Compile a sequence whose timestamps are ticks */
+    void compile (const MidiMessageSequence& sequence, const TimeScale& ts);
+
+    /** Re-time events for changes to the tempo map. Returns false if
+        nothing needed to change */
+    bool update (const TimeScale& ts);
+
+    /** Returns true if the tempo map is the one events were timed with */
+    bool isUpToDate (const TimeScale& ts) const;
+
+    /** Clear all events */
+    void clear();
+
+    inline int getNumEvents() const noexcept { return numEvents; }
+
+    /** Returns the most render() can add to an empty MidiBuffer, which is
+        every event. Ensure targets are this size so rendering never has to
+        allocate */
+    inline size_t getNumBytes() const noexcept { return bufferBytes; }
+
+    /** Frame of an event */
+    inline int64 getEventFrame (int index) const noexcept { return frames [index]; }
+
+    /** Index of the first event at or after a frame */
+    int getIndexAtFrame (int64 frame) const noexcept;
+
+    /** Add the events in a block into a MidiBuffer, with timestamps relative
+        to startFrame plus offset. Consecutive blocks only advance the cursor,
+        anything else is a binary search */
+    void render (MidiBuffer& target, int64 startFrame, int numSamples, int offset = 0) noexcept;
+
+private:
+    struct NodeKey
+    {
+        uint64 frame, tick;
+        float tempo;
+        unsigned short beatType, beatsPerBar, beatDivisor;
+        int ramp;
+
+        bool operator== (const NodeKey& o) const noexcept;
+        bool operator!= (const NodeKey& o) const noexcept { return ! operator== (o); }
+    };
+
+    int numEvents;
+    HeapBlock<int64>  frames;    ///< frame of each event
+    HeapBlock<uint64> ticks;     ///< tick of each event, for re-timing
+    HeapBlock<int32>  offsets;   ///< byte offset of each event, plus one past the end
+    MemoryBlock data;            ///< raw bytes of the events
+    size_t bufferBytes;          ///< size of every event in a MidiBuffer
+
+    Array<NodeKey> keys;
+    unsigned int sampleRate;
+    unsigned short ticksPerBeat;
+
+    int cursor;
+    int64 nextFrame;
+
+    static void getKeys (const TimeScale& ts, Array<NodeKey>& dest);
+    void retime (const TimeScale& ts, int startIndex);
+
+    CompiledMidiSequence& operator= (const CompiledMidiSequence&) = delete;
+    JUCE_LEAK_DETECTOR (CompiledMidiSequence)
+};
@@ -0,0 +1,147 @@
+/*
+    This file is part of the Kushview Modules for JUCE
+    Copyright (C) 2014-2017  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#if KV_JACK_AUDIO
+ typedef JackDeviceCallback DeviceClockCallbackBase;
+#else
+ typedef AudioIODeviceCallback DeviceClockCallbackBase;
+#endif
+
+/** Wraps another audio callback and times it with a DeviceClock.
+
+    Works the same with JUCE's devices and the JACK device. With JACK, MIDI
+    is passed through if the wrapped callback is a JackDeviceCallback. Each
+    callback is also a zone in the default DspProfiler, which is given the
+    device's period as its budget. The profiler ring for the device's thread
+    is reserved before it starts, so recording never allocates.
+ */
+class DeviceClockCallback : public DeviceClockCallbackBase
+{
+public:
+    DeviceClockCallback (AudioIODeviceCallback* callbackToWrap = nullptr)
+        : callback (nullptr)
+       #if KV_JACK_AUDIO
+        , jackCallback (nullptr)
+       #endif
+    {
+        profileId = DspProfiler::getDefault().registerNode ("Audio Device Callback");
+        profileRing = -1;
+        setCallback (callbackToWrap);
+    }
+
+    ~DeviceClockCallback()
+    {
+        DspProfiler::getDefault().releaseRing (profileRing);
+        DspProfiler::getDefault().unregisterNode (profileId);
+    }
+
+    /** Set the wrapped callback. Only do this while the device isn't running */
+    void setCallback (AudioIODeviceCallback* newCallback)
+    {
+        callback = newCallback;
+       #if KV_JACK_AUDIO
+        jackCallback = dynamic_cast<JackDeviceCallback*> (newCallback);
+       #endif
+    }
+
+    DeviceClock& getClock() { return clock; }
+    const DeviceClock& getClock() const { return clock; }
+
+    void audioDeviceAboutToStart (AudioIODevice* device) override
+    {
+        clock.prepare (device->getCurrentSampleRate(), device->getCurrentBufferSizeSamples());
+        DspProfiler::getDefault().setCallbackPeriod (device->getCurrentSampleRate(),
+                                                     device->getCurrentBufferSizeSamples());
+        DspProfiler::getDefault().releaseRing (profileRing);
+        profileRing = DspProfiler::getDefault().reserveRing();
+        if (callback != nullptr)
+            callback->audioDeviceAboutToStart (device);
+    }
+
+    void audioDeviceStopped() override
+    {
+        if (callback != nullptr)
+            callback->audioDeviceStopped();
+        DspProfiler::getDefault().releaseRing (profileRing);
+        profileRing = -1;
+    }
+
+    void audioDeviceError (const String& errorMessage) override
+    {
+        if (callback != nullptr)
+            callback->audioDeviceError (errorMessage);
+    }
+
+   #if KV_JACK_AUDIO
+    void jackDeviceIOCallback (const float** inputs, int numInputs,
+                               float** outputs, int numOutputs,
+                               const MidiBuffer& midiIn, MidiBuffer& midiOut,
+                               int numSamples) override
+    {
+        clock.begin (numSamples);
+        DspProfiler::getDefault().useRing (profileRing);
+        {
+            DspProfiler::ScopedZone zone (DspProfiler::getDefault(), profileId);
+            if (jackCallback != nullptr)
+                jackCallback->jackDeviceIOCallback (inputs, numInputs, outputs, numOutputs,
+                                                    midiIn, midiOut, numSamples);
+            else
+                process (inputs, numInputs, outputs, numOutputs, numSamples);
+        }
+        clock.end();
+    }
+   #else
+    void audioDeviceIOCallback (const float** inputs, int numInputs,
+                                float** outputs, int numOutputs, int numSamples) override
+    {
+        clock.begin (numSamples);
+        DspProfiler::getDefault().useRing (profileRing);
+        {
+            DspProfiler::ScopedZone zone (DspProfiler::getDefault(), profileId);
+            process (inputs, numInputs, outputs, numOutputs, numSamples);
+        }
+        clock.end();
+    }
+   #endif
+
+private:
+    DeviceClock clock;
+    AudioIODeviceCallback* callback;
+    int profileId, profileRing;
+   #if KV_JACK_AUDIO
+    JackDeviceCallback* jackCallback;
+   #endif
+
+    void process (const float** inputs, int numInputs, float** outputs, int numOutputs, int numSamples)
+    {
+        if (callback != nullptr)
+        {
+            callback->audioDeviceIOCallback (inputs, numInputs, outputs, numOutputs, numSamples);
+            return;
+        }
+
+        for (int i = 0; i < numOutputs; ++i)
+            if (outputs[i] != nullptr)
+                FloatVectorOperations::clear (outputs[i], numSamples);
+    }
+
+    JUCE_DECLARE_NON_COPYABLE (DeviceClockCallback)
+};
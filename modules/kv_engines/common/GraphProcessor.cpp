@@ -0,0 +1,302 @@
+/*
+    This file is part of the Kushview Modules for JUCE
+    Copyright (C) 2014-2017  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+struct GraphProcessor::Node
+{
+    Node (uint32 i, AudioProcessor* p) : id (i), processor (p) { }
+
+    const uint32 id;
+    ScopedPointer<AudioProcessor> processor;
+    AudioSampleBuffer buffer;   ///< inputs are summed here, then processed in place
+
+    void prepare (double sampleRate, int blockSize)
+    {
+        processor->setRateAndBufferSizeDetails (sampleRate, blockSize);
+        processor->prepareToPlay (sampleRate, blockSize);
+        buffer.setSize (jmax (1, processor->getTotalNumInputChannels(),
+                                 processor->getTotalNumOutputChannels()), blockSize);
+    }
+};
+
+/** A node as the audio thread runs it */
+struct GraphProcessor::Step
+{
+    struct Input
+    {
+        const AudioSampleBuffer* source;
+        int sourceChannel, destChannel;
+        DelayLine* delay;
+    };
+
+    AudioProcessor* processor;  ///< nullptr for the graph's outputs
+    AudioSampleBuffer* buffer;
+    Array<Input> inputs;
+};
+
+GraphProcessor::GraphProcessor (int numInputs, int numOutputs)
+    : nextNodeId (audioOutputNode + 1), prepared (false)
+{
+    setPlayConfigDetails (numInputs, numOutputs, 44100.0, 512);
+    latency.setNodeLatency (audioInputNode, 0);
+    latency.setNodeLatency (audioOutputNode, 0);
+    rebuild();
+}
+
+GraphProcessor::~GraphProcessor()
+{
+    cancelPendingUpdate();
+    steps.clear();
+    for (Node* node : nodes)
+        node->processor->removeListener (this);
+    nodes.clear();
+    arcs.clear();
+    latency.clear();
+}
+
+GraphProcessor::Node* GraphProcessor::findNode (uint32 id) const
+{
+    for (Node* node : nodes)
+        if (node->id == id)
+            return node;
+    return nullptr;
+}
+
+AudioProcessor* GraphProcessor::getNodeProcessor (uint32 id) const
+{
+    const Node* const node = findNode (id);
+    return node != nullptr ? node->processor.get() : nullptr;
+}
+
+int GraphProcessor::getNumChannels (uint32 id, bool isInput) const
+{
+    if (id == audioInputNode)
+        return isInput ? 0 : getTotalNumInputChannels();
+    if (id == audioOutputNode)
+        return isInput ? getTotalNumOutputChannels() : 0;
+    if (const Node* const node = findNode (id))
+        return isInput ? node->processor->getTotalNumInputChannels()
+                       : node->processor->getTotalNumOutputChannels();
+    return 0;
+}
+
+int GraphProcessor::indexOfArc (uint32 sourceNode, int sourceChannel, uint32 destNode, int destChannel) const
+{
+    for (int i = 0; i < arcs.size(); ++i)
+    {
+        const Arc* const arc = arcs.getUnchecked (i);
+        if (arc->sourceNode == sourceNode && arc->sourcePort == (uint32) sourceChannel &&
+            arc->destNode == destNode && arc->destPort == (uint32) destChannel)
+            return i;
+    }
+
+    return -1;
+}
+
+uint32 GraphProcessor::addNode (AudioProcessor* processor)
+{
+    jassert (processor != nullptr);
+    Node* const node = nodes.add (new Node (nextNodeId++, processor));
+    if (prepared)
+        node->prepare (getSampleRate(), getBlockSize());
+
+    processor->addListener (this);
+    latency.setNodeLatency (node->id, processor->getLatencySamples());
+    rebuild();
+    return node->id;
+}
+
+void GraphProcessor::removeNode (uint32 id)
+{
+    const int index = nodes.indexOf (findNode (id));
+    if (index < 0)
+        return;
+
+    for (int i = arcs.size(); --i >= 0;)
+        if (arcs.getUnchecked(i)->sourceNode == id || arcs.getUnchecked(i)->destNode == id)
+            arcs.remove (i);
+
+    // the audio thread lets go of the node and its delay lines first
+    ScopedPointer<Node> removed (nodes.removeAndReturn (index));
+    rebuild();
+    latency.removeNode (id);
+    updateLatencies();
+
+    removed->processor->removeListener (this);
+    if (prepared)
+        removed->processor->releaseResources();
+}
+
+bool GraphProcessor::canConnect (uint32 sourceNode, int sourceChannel, uint32 destNode, int destChannel) const
+{
+    if (sourceNode == destNode
+         || ! isPositiveAndBelow (sourceChannel, getNumChannels (sourceNode, false))
+         || ! isPositiveAndBelow (destChannel, getNumChannels (destNode, true))
+         || indexOfArc (sourceNode, sourceChannel, destNode, destChannel) >= 0)
+        return false;
+
+    // a cycle can't be compensated, or run
+    const ArcTable<Arc> table (arcs);
+    return ! table.isAnInputTo (destNode, sourceNode);
+}
+
+bool GraphProcessor::connect (uint32 sourceNode, int sourceChannel, uint32 destNode, int destChannel)
+{
+    if (! canConnect (sourceNode, sourceChannel, destNode, destChannel))
+        return false;
+
+    // the new arc's delay is set before the audio thread uses it
+    const Arc* const arc = arcs.add (new Arc (sourceNode, (uint32) sourceChannel, destNode, (uint32) destChannel));
+    latency.addArc (*arc);
+    updateLatencies();
+    rebuild();
+    return true;
+}
+
+void GraphProcessor::disconnect (uint32 sourceNode, int sourceChannel, uint32 destNode, int destChannel)
+{
+    const int index = indexOfArc (sourceNode, sourceChannel, destNode, destChannel);
+    if (index < 0)
+        return;
+
+    ScopedPointer<Arc> removed (arcs.removeAndReturn (index));
+    rebuild();
+    latency.removeArc (*removed);
+    updateLatencies();
+}
+
+void GraphProcessor::updateLatencies()
+{
+    // LatencyGraph only visits what is downstream of a changed node
+    for (const Node* node : nodes)
+        latency.setNodeLatency (node->id, node->processor->getLatencySamples());
+    latency.update();
+    setLatencySamples (latency.getInputLatency (audioOutputNode));
+}
+
+void GraphProcessor::rebuild()
+{
+    Array<uint32> order;
+    latency.getProcessingOrder (order);
+
+    OwnedArray<Step> newSteps;
+    for (const uint32 id : order)
+    {
+        Node* const node = findNode (id);
+        if (node == nullptr && id != audioOutputNode)
+            continue;
+
+        Step* const step = newSteps.add (new Step());
+        step->processor = node != nullptr ? node->processor.get() : nullptr;
+        step->buffer    = node != nullptr ? &node->buffer : &outputs;
+
+        for (const Arc* arc : arcs)
+        {
+            if (arc->destNode != id)
+                continue;
+
+            const Node* const source = findNode (arc->sourceNode);
+            const Step::Input input = { source != nullptr ? &source->buffer : &inputs,
+                                        (int) arc->sourcePort, (int) arc->destPort,
+                                        latency.getDelayLine (*arc) };
+            step->inputs.add (input);
+        }
+    }
+
+    const ScopedLock sl (getCallbackLock());
+    steps.swapWith (newSteps);
+}
+
+void GraphProcessor::prepareToPlay (double sampleRate, int blockSize)
+{
+    setRateAndBufferSizeDetails (sampleRate, blockSize);
+    inputs.setSize (jmax (1, getTotalNumInputChannels()), blockSize);
+    outputs.setSize (jmax (1, getTotalNumOutputChannels()), blockSize);
+    scratch.setSize (1, blockSize);
+    midiScratch.ensureSize (2048);
+
+    for (Node* node : nodes)
+        node->prepare (sampleRate, blockSize);
+
+    latency.prepareDelayLines (roundToInt (sampleRate), blockSize);
+    prepared = true;
+    updateLatencies();
+    rebuild();
+}
+
+void GraphProcessor::releaseResources()
+{
+    prepared = false;
+    for (Node* node : nodes)
+        node->processor->releaseResources();
+    latency.releaseDelayLines();
+    rebuild();
+}
+
+void GraphProcessor::processBlock (AudioSampleBuffer& buffer, MidiBuffer& midi)
+{
+    const int numSamples = buffer.getNumSamples();
+    jassert (prepared && numSamples <= scratch.getNumSamples());
+
+    for (int channel = 0; channel < getTotalNumInputChannels(); ++channel)
+        inputs.copyFrom (channel, 0, buffer, channel, 0, numSamples);
+
+    for (const Step* step : steps)
+    {
+        AudioSampleBuffer& dest (*step->buffer);
+        dest.clear (0, numSamples);
+
+        for (const Step::Input& input : step->inputs)
+        {
+            // sources feed more than one arc, so each is delayed in a copy
+            float* const data = scratch.getWritePointer (0);
+            FloatVectorOperations::copy (data, input.source->getReadPointer (input.sourceChannel), numSamples);
+            if (input.delay != nullptr)
+                input.delay->process (data, numSamples);
+            dest.addFrom (input.destChannel, 0, data, numSamples);
+        }
+
+        if (step->processor != nullptr)
+        {
+            AudioSampleBuffer block (dest.getArrayOfWritePointers(), dest.getNumChannels(), numSamples);
+            midiScratch.clear();
+            step->processor->processBlock (block, midiScratch);
+        }
+    }
+
+    for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+    {
+        if (channel < getTotalNumOutputChannels())
+            buffer.copyFrom (channel, 0, outputs, channel, 0, numSamples);
+        else
+            buffer.clear (channel, 0, numSamples);
+    }
+
+    midi.clear();
+}
+
+void GraphProcessor::audioProcessorChanged (AudioProcessor*)
+{
+    // may be the audio thread, the delays are updated on the message thread
+    triggerAsyncUpdate();
+}
+
+void GraphProcessor::handleAsyncUpdate()
+{
+    updateLatencies();
+}
@@ -0,0 +1,122 @@
+/*
+    This file is part of the Kushview Modules for JUCE
+    Copyright (C) 2014-2017  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+/** Runs AudioProcessors connected by Arcs, with delay compensation.
+
+    Arcs connect an output channel of one node to an input channel of
+    another, the graph's own inputs and outputs are the audioInputNode and
+    audioOutputNode. A LatencyGraph keeps a DelayLine on every arc, so the
+    inputs to each node line up however long the paths feeding them are.
+
+    Node latencies are read when nodes are added and whenever a node tells
+    its listeners it changed, e.g. from setLatencySamples(). Only what is
+    downstream of a change is recomputed, and the graph's own latency is
+    what reaches the outputs. Delays are capped at a second.
+
+    Only audio is routed, nodes get an empty MidiBuffer. Adding, removing
+    and connecting nodes must be done on the message thread. The audio
+    thread is only held off while the new processing order is swapped in.
+ */
+class GraphProcessor : public AudioProcessor,
+                       private AudioProcessorListener,
+                       private AsyncUpdater
+{
+public:
+    enum { audioInputNode = 0, audioOutputNode = 1 };
+
+    GraphProcessor (int numInputs = 2, int numOutputs = 2);
+    ~GraphProcessor();
+
+    /** Add a node, the graph takes ownership of the processor
+        @returns the new node's id */
+    uint32 addNode (AudioProcessor* processor);
+
+    /** Remove a node and its arcs, deleting its processor */
+    void removeNode (uint32 node);
+
+    /** Returns a node's processor or nullptr */
+    AudioProcessor* getNodeProcessor (uint32 node) const;
+
+    /** Returns true if the channels exist, aren't connected already and the
+        arc wouldn't make a cycle */
+    bool canConnect (uint32 sourceNode, int sourceChannel, uint32 destNode, int destChannel) const;
+
+    /** Connect an output channel to an input channel */
+    bool connect (uint32 sourceNode, int sourceChannel, uint32 destNode, int destChannel);
+
+    /** Remove a connection */
+    void disconnect (uint32 sourceNode, int sourceChannel, uint32 destNode, int destChannel);
+
+    /** Read every node's latency and update the delays. This is done when a
+        node reports a change, call it directly if one changed silently */
+    void updateLatencies();
+
+    /** The latencies and delays in use. Don't modify it */
+    const LatencyGraph& getLatencyGraph() const { return latency; }
+
+    //==========================================================================
+    const String getName() const override { return "Graph"; }
+    void prepareToPlay (double sampleRate, int maximumExpectedSamplesPerBlock) override;
+    void releaseResources() override;
+    void processBlock (AudioSampleBuffer& buffer, MidiBuffer& midi) override;
+
+    double getTailLengthSeconds() const override { return 0.0; }
+    bool acceptsMidi() const override { return false; }
+    bool producesMidi() const override { return false; }
+
+    AudioProcessorEditor* createEditor() override { return nullptr; }
+    bool hasEditor() const override { return false; }
+
+    int getNumPrograms() override { return 1; }
+    int getCurrentProgram() override { return 0; }
+    void setCurrentProgram (int) override { }
+    const String getProgramName (int) override { return String(); }
+    void changeProgramName (int, const String&) override { }
+
+    void getStateInformation (MemoryBlock&) override { }
+    void setStateInformation (const void*, int) override { }
+
+private:
+    struct Node;
+    struct Step;
+
+    OwnedArray<Node> nodes;
+    OwnedArray<Arc> arcs;
+    LatencyGraph latency;
+    uint32 nextNodeId;
+
+    // audio thread, swapped in with the callback lock held
+    OwnedArray<Step> steps;
+    AudioSampleBuffer inputs, outputs, scratch;
+    MidiBuffer midiScratch;
+    bool prepared;
+
+    Node* findNode (uint32 id) const;
+    int getNumChannels (uint32 node, bool isInput) const;
+    int indexOfArc (uint32 sourceNode, int sourceChannel, uint32 destNode, int destChannel) const;
+    void rebuild();
+
+    void audioProcessorParameterChanged (AudioProcessor*, int, float) override { }
+    void audioProcessorChanged (AudioProcessor*) override;
+    void handleAsyncUpdate() override;
+
+    JUCE_DECLARE_NON_COPYABLE (GraphProcessor)
+};
@@ -0,0 +1,292 @@
+/*
+    This file is part of the Kushview Modules for JUCE
+    Copyright (C) 2014-2017  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+MidiRecorder::MidiRecorder (int ringSizeBytes)
+    : Thread ("MIDI Recorder"),
+      ring (ringSizeBytes),
+      wasRecording (false), session (0), pass (0), lastFrame (0),
+      loopMode (Overdub), currentSession (0), currentPass (0), selectedTake (-1)
+{
+    startThread();
+}
+
+MidiRecorder::~MidiRecorder()
+{
+    signalThreadShouldExit();
+    wake.post();
+    waitForThreadToExit (-1);
+}
+
+void MidiRecorder::setSequence (const MidiMessageSequence& newSequence)
+{
+    const ScopedLock sl (lock);
+    sequence = newSequence;
+}
+
+void MidiRecorder::setTimeScale (const TimeScale& newTimeScale)
+{
+    const ScopedLock sl (lock);
+    timeScale = newTimeScale;
+    timeScale.updateScale();
+}
+
+void MidiRecorder::setLoopMode (LoopMode mode)
+{
+    const ScopedLock sl (lock);
+    loopMode = mode;
+}
+
+MidiRecorder::LoopMode MidiRecorder::getLoopMode() const
+{
+    const ScopedLock sl (lock);
+    return loopMode;
+}
+
+int MidiRecorder::getNumTakes() const
+{
+    const ScopedLock sl (lock);
+    return takes.size();
+}
+
+MidiMessageSequence MidiRecorder::getTake (int index) const
+{
+    const ScopedLock sl (lock);
+    if (const MidiMessageSequence* const take = takes [index])
+        return *take;
+    return MidiMessageSequence();
+}
+
+void MidiRecorder::selectTake (int index)
+{
+    const ScopedLock sl (lock);
+    if (! isPositiveAndBelow (index, takes.size()) || index == selectedTake)
+        return;
+
+    selectedTake = index;
+    publish();
+}
+
+void MidiRecorder::capture (const Shuttle& shuttle, const MidiBuffer& input, int64 frameOffset)
+{
+    bool wrote = false;
+
+    for (int i = 0; i < shuttle.getNumSegments(); ++i)
+    {
+        const Shuttle::Segment& segment (shuttle.getSegment (i));
+        const bool recording = segment.recording && segment.playing;
+
+        if (wasRecording && (! recording || segment.located))
+        {
+            // stopped or jumped, end what was recorded where it left off
+            const Header header = { lastFrame, session, pass, recordingEnd, 0 };
+            wrote |= writeEvent (header, nullptr);
+            wasRecording = false;
+        }
+        else if (wasRecording && segment.looped)
+        {
+            const Header header = { lastFrame, session, pass, passEnd, 0 };
+            wrote |= writeEvent (header, nullptr);
+            ++pass;
+        }
+
+        if (recording && ! wasRecording)
+        {
+            ++session;
+            pass = 0;
+        }
+
+        wasRecording = recording;
+        if (! recording)
+            continue;
+
+        const int64 segmentFrame = frameOffset + segment.frame;
+        const int endSample = segment.offset + segment.numFrames;
+
+        MidiBuffer::Iterator iter (input);
+        iter.setNextSamplePosition (segment.offset);
+
+        const uint8* data = nullptr;
+        int size = 0, sample = 0;
+        while (iter.getNextEvent (data, size, sample) && sample < endSample)
+        {
+            const Header header = { segmentFrame + (sample - segment.offset), session, pass,
+                                    midiEvent, (uint16) jmin (size, 0xffff) };
+            wrote |= writeEvent (header, data);
+        }
+
+        lastFrame = segmentFrame + segment.numFrames;
+    }
+
+    if (wrote)
+        wake.post();
+}
+
+bool MidiRecorder::writeEvent (const Header& header, const uint8* data)
+{
+    const uint32 total = (uint32) sizeof (Header) + header.size;
+    if (header.size > maxEventSize || ! ring.canWrite (total))
+    {
+        ++dropped;
+        return false;
+    }
+
+    // one write per event, so the reader never sees part of one
+    uint8 buffer [sizeof (Header) + maxEventSize];
+    memcpy (buffer, &header, sizeof (Header));
+    if (header.size > 0)
+        memcpy (buffer + sizeof (Header), data, header.size);
+
+    return ring.write (buffer, total) == total;
+}
+
+void MidiRecorder::run()
+{
+    bool dirty = false;
+    uint32 lastPublish = 0;
+
+    while (! threadShouldExit())
+    {
+        wake.waitFor (publishInterval);
+
+        const ScopedLock sl (lock);
+        bool ended = false;
+        dirty |= readEvents (ended);
+
+        // merging and copying the whole sequence is costly, so input is batched
+        const uint32 now = Time::getMillisecondCounter();
+        if (dirty && (ended || now - lastPublish >= (uint32) publishInterval))
+        {
+            publish();
+            dirty = false;
+            lastPublish = now;
+        }
+    }
+}
+
+bool MidiRecorder::readEvents (bool& ended)
+{
+    bool changed = false;
+    Header header;
+    uint8 data [maxEventSize];
+
+    while (ring.getReadSpace() >= (uint32) sizeof (Header))
+    {
+        ring.peak (&header, sizeof (Header));
+        if (ring.getReadSpace() < (uint32) sizeof (Header) + header.size)
+            break;
+
+        ring.read (&header, sizeof (Header));
+        if (header.size > 0)
+            ring.read (data, header.size);
+
+        if (header.session != currentSession)
+            startSession (header.session);
+        if (header.pass != currentPass)
+            startPass (header.pass);
+
+        const double tick = (double) timeScale.tickFromFrame ((uint64) jmax ((int64) 0, header.frame));
+
+        if (header.type == midiEvent)
+        {
+            if (header.size > 0)
+                addEvent (MidiMessage (data, (int) header.size, tick));
+        }
+        else
+        {
+            endNotes (tick);
+            ended = true;
+        }
+
+        changed = true;
+    }
+
+    return changed;
+}
+
+void MidiRecorder::startSession (int32 newSession)
+{
+    currentSession = newSession;
+    currentPass = 0;
+    notes.reset();
+
+    original = sequence;
+    takes.clear();
+    selectedTake = -1;
+
+    if (loopMode == NewTake)
+    {
+        takes.add (new MidiMessageSequence());
+        selectedTake = 0;
+    }
+}
+
+void MidiRecorder::startPass (int32 newPass)
+{
+    currentPass = newPass;
+    notes.reset();
+
+    if (loopMode == NewTake)
+    {
+        takes.add (new MidiMessageSequence());
+        selectedTake = takes.size() - 1;
+    }
+}
+
+MidiMessageSequence& MidiRecorder::getTarget()
+{
+    return loopMode == NewTake && takes.size() > 0 ? *takes.getLast() : sequence;
+}
+
+void MidiRecorder::addEvent (const MidiMessage& message)
+{
+    const uint8* data = message.getRawData();
+
+    // the note on was in an earlier pass, which has already ended it
+    if (message.isNoteOff() && notes.getCount (data[0] & 0x0f, data[1]) == 0)
+        return;
+
+    notes.process (data, message.getRawDataSize());
+    getTarget().addEvent (message);
+}
+
+void MidiRecorder::endNotes (double tick)
+{
+    MidiMessageSequence& target (getTarget());
+
+    for (int channel = 0; channel < 16 && ! notes.isEmpty(); ++channel)
+        for (int note = 0; note < 128; ++note)
+            for (int count = notes.getCount (channel, note); count > 0; --count)
+                target.addEvent (MidiMessage::noteOff (channel + 1, note), tick);
+
+    notes.reset();
+}
+
+void MidiRecorder::publish()
+{
+    if (loopMode == NewTake && isPositiveAndBelow (selectedTake, takes.size()))
+    {
+        sequence = original;
+        sequence.addSequence (*takes.getUnchecked (selectedTake), 0.0);
+    }
+
+    sequence.updateMatchedPairs();
+
+    if (onSequenceChanged)
+        onSequenceChanged (sequence, timeScale);
+}
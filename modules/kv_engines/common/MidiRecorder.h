@@ -0,0 +1,124 @@
+/*
+    This file is part of the Kushview Modules for JUCE
+    Copyright (C) 2014-2017  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+class Shuttle;
+
+/** Records MIDI played into a Shuttle's blocks.
+
+    The audio thread stamps incoming events with their transport frame and
+    writes them to a lock-free ring, nothing is allocated or locked there.
+    A background thread converts frames to ticks with its own copy of the
+    tempo map, merges the events into a sequence and hands the result to
+    onSequenceChanged, so playback never waits on a merge. Merged results are
+    handed on at most every publishInterval milliseconds while recording,
+    and straight away when a pass or the recording ends.
+
+    While looping each pass over the loop is numbered. In Overdub mode every
+    pass is merged into the sequence, in NewTake mode each pass is kept as a
+    separate take and the latest is played over what was there when
+    recording started. Notes still held at the end of a pass or recording
+    are ended there.
+ */
+class MidiRecorder : private Thread
+{
+public:
+    enum LoopMode
+    {
+        Overdub = 0,
+        NewTake
+    };
+
+    /** Create a recorder. The ring should hold a few blocks of dense input */
+    explicit MidiRecorder (int ringSizeBytes = 64 * 1024);
+    ~MidiRecorder();
+
+    /** Called with the merged sequence and the tempo map it was timed with,
+        on the recorder's thread when something was recorded, or on the
+        thread calling selectTake() */
+    std::function<void (const MidiMessageSequence&, const TimeScale&)> onSequenceChanged;
+
+    /** Set what's being recorded over. Not realtime safe */
+    void setSequence (const MidiMessageSequence& sequence);
+
+    /** Set the tempo map used to convert frames to ticks. Not realtime safe */
+    void setTimeScale (const TimeScale& timeScale);
+
+    void setLoopMode (LoopMode mode);
+    LoopMode getLoopMode() const;
+
+    /** Takes recorded in NewTake mode, the current one last */
+    int getNumTakes() const;
+    MidiMessageSequence getTake (int index) const;
+
+    /** Play a different take over the original sequence */
+    void selectTake (int index);
+
+    /** Capture input for the shuttle's prepared segments that are recording.
+        frameOffset is added to the transport frame, like MidiSequencePlayer's.
+        Realtime safe */
+    void capture (const Shuttle& shuttle, const MidiBuffer& input, int64 frameOffset = 0);
+
+    /** Events that didn't fit in the ring, or were too large to record */
+    int getNumDroppedEvents() const { return dropped.get(); }
+
+private:
+    enum { maxEventSize = 256, publishInterval = 100 };
+    enum EventType { midiEvent = 0, passEnd, recordingEnd };
+
+    struct Header
+    {
+        int64 frame;
+        int32 session;
+        int32 pass;
+        uint16 type;
+        uint16 size;
+    };
+
+    // audio thread
+    RingBuffer ring;
+    Semaphore wake;
+    Atomic<int> dropped;
+    bool wasRecording;
+    int32 session, pass;
+    int64 lastFrame;
+
+    // recorder thread, guarded by lock
+    CriticalSection lock;
+    TimeScale timeScale;
+    MidiMessageSequence sequence, original;
+    OwnedArray<MidiMessageSequence> takes;
+    NoteTracker notes;
+    LoopMode loopMode;
+    int32 currentSession, currentPass;
+    int selectedTake;
+
+    void run() override;
+    bool writeEvent (const Header& header, const uint8* data);
+    bool readEvents (bool& ended);
+    void startSession (int32 newSession);
+    void startPass (int32 newPass);
+    void addEvent (const MidiMessage& message);
+    void endNotes (double tick);
+    MidiMessageSequence& getTarget();
+    void publish();
+
+    JUCE_DECLARE_NON_COPYABLE (MidiRecorder)
+};
@@ -22,22 +22,42 @@
 #define NOTE_PREFRAMES     0.001
 
 MidiSequencePlayer::MidiSequencePlayer()
-    : midiSequence (new MidiMessageSequence())
+    : midiSequence (new MidiMessageSequence()),
+      playing (nullptr)
 {
     numBars     = 4;
     frameOffset = 0;
-    shuttle.setOwned (new Shuttle());
+    ownShuttle = new Shuttle();
+    shuttle = ownShuttle;
+
+    compiledVersion.set (shuttle->getTempoMapVersion());
+    compiled = new CompiledMidiSequence();
+    compiled->compile (*midiSequence, shuttle->getTimeScale());
+    playing = new CompiledMidiSequence (*compiled);
 }
 
 MidiSequencePlayer::~MidiSequencePlayer ()
 {
+    // the audio thread may be capturing, let it finish before the recorder goes
+    activeRecorder.set (nullptr);
+    while (rendering.get() != 0)
+        Thread::yield();
+
+    recorder = nullptr;
+    cancelPendingUpdate();
+
+    delete pending.exchange (nullptr);
+    delete retired.exchange (nullptr);
+    deleteAndZero (playing);
+    compiled = nullptr;
     midiSequence = nullptr;
-    shuttle.clear();
+    shuttle = nullptr;
+    ownShuttle = nullptr;
 }
 
 void MidiSequencePlayer::prepareToPlay (double /*sampleRate*/, int /* blockSize */)
 {
-	noteOffs.clear();
+    activeNotes.reset();
 }
 
 void MidiSequencePlayer::releaseResources()
@@ -45,14 +65,141 @@ void MidiSequencePlayer::releaseResources()
 
 void MidiSequencePlayer::renderSequence (int numSamples, MidiBuffer& midiMessages)
 {
-    renderSequence (midiMessages, *midiSequence, 0, numSamples);
+    rendering.set (1);
+    const int numSegments = shuttle->prepareBlock (numSamples);
+
+    // capture the input before playback is rendered into the same buffer
+    if (MidiRecorder* const r = activeRecorder.get())
+        r->capture (*shuttle, midiMessages, frameOffset);
+
+    // re-timing can't happen here, the message thread does it
+    if (shuttle->getTempoMapVersion() != compiledVersion.get())
+        triggerAsyncUpdate();
+
+    // take a newly compiled sequence once the last replaced one was collected
+    if (retired.get() == nullptr)
+    {
+        if (CompiledMidiSequence* const next = pending.exchange (nullptr))
+        {
+            retired.set (playing);
+            playing = next;
+        }
+    }
+
+    for (int i = 0; i < numSegments; ++i)
+    {
+        const Shuttle::Segment& segment (shuttle->getSegment (i));
+
+        // notes would hang when playback stops, jumps or wraps
+        if (segment.looped || segment.located || ! segment.playing)
+            activeNotes.flush (midiMessages, segment.offset);
+
+        if (! segment.playing)
+            continue;
+
+        playing->render (midiMessages, frameOffset + segment.frame, segment.numFrames, segment.offset);
+        activeNotes.process (midiMessages, segment.offset, segment.numFrames);
+    }
+
+    rendering.set (0);
+}
+
+int32 MidiSequencePlayer::getBeatsPerBar() const
+{
+    return shuttle->getBeatsPerBar();
+}
+
+MidiRecorder& MidiSequencePlayer::getRecorder()
+{
+    if (recorder == nullptr)
+    {
+        recorder = new MidiRecorder();
+        recorder->setTimeScale (shuttle->getTimeScale());
+        recorder->setSequence (*midiSequence);
+        recorder->onSequenceChanged = [this] (const MidiMessageSequence& sequence, const TimeScale&) {
+            recordedSequenceChanged (sequence);
+        };
+
+        activeRecorder.set (recorder.get());
+    }
+
+    return *recorder;
+}
+
+void MidiSequencePlayer::recordedSequenceChanged (const MidiMessageSequence& sequence)
+{
+    // on the recorder's thread, the message thread swaps it in. Updates that
+    // arrive before it gets there replace each other
+    ScopedPointer<MidiMessageSequence> newSequence (new MidiMessageSequence (sequence));
+    {
+        const ScopedLock sl (recordedLock);
+        recorded.swapWith (newSequence);
+    }
+
+    triggerAsyncUpdate();
+}
+
+void MidiSequencePlayer::handleAsyncUpdate()
+{
+    ScopedPointer<MidiMessageSequence> newSequence;
+    {
+        const ScopedLock sl (recordedLock);
+        newSequence.swapWith (recorded);
+    }
+
+    if (newSequence == nullptr)
+    {
+        if (shuttle->getTempoMapVersion() != compiledVersion.get())
+            tempoMapChanged();
+        return;
+    }
+
+    midiSequence.swapWith (newSequence);
+    compiledVersion.set (shuttle->getTempoMapVersion());
+    compiled = new CompiledMidiSequence();
+    compiled->compile (*midiSequence, shuttle->getTimeScale());
+    publishCompiled();
+}
+
+void MidiSequencePlayer::publishCompiled()
+{
+    // the audio thread has let go of the retired one, and never took a
+    // pending one that's replaced here
+    delete retired.exchange (nullptr);
+    delete pending.exchange (new CompiledMidiSequence (*compiled));
+}
+
+void MidiSequencePlayer::compileSequence()
+{
+    if (recorder != nullptr)
+        recorder->setSequence (*midiSequence);
+
+    compiledVersion.set (shuttle->getTempoMapVersion());
+    compiled = new CompiledMidiSequence();
+    compiled->compile (*midiSequence, shuttle->getTimeScale());
+    publishCompiled();
+}
+
+size_t MidiSequencePlayer::getNumBytes() const
+{
+    return compiled->getNumBytes();
+}
+
+void MidiSequencePlayer::tempoMapChanged()
+{
+    compiledVersion.set (shuttle->getTempoMapVersion());
+    if (recorder != nullptr)
+        recorder->setTimeScale (shuttle->getTimeScale());
+
+    if (compiled->update (shuttle->getTimeScale()))
+        publishCompiled();
 }
 
 void MidiSequencePlayer::renderSequence (MidiBuffer& target, const MidiMessageSequence& seq,
-                                         int32 startInSequence, int32 numSamples)
+                                         int32 startInSequence, int32 numSamples, int32 offset)
 {
 #if 1
-    Midi::renderSequence (target, seq, shuttle->getTimeScale(), startInSequence, numSamples);
+    Midi::renderSequence (target, seq, shuttle->getTimeScale(), startInSequence, numSamples, offset);
 #else
     const TimeScale& ts (shuttle->getTimeScale());
     const int32 numEvents = seq.getNumEvents();
@@ -101,7 +248,7 @@ namespace Midi {
 
 
 void renderSequence (MidiBuffer& target, const MidiMessageSequence& seq, const TimeScale& ts,
-                     int32 startFrame, int32 numSamples)
+                     int32 startFrame, int32 numSamples, int32 offset)
 {
 #if 1
     const int32 numEvents = seq.getNumEvents();
@@ -116,7 +263,7 @@ void renderSequence (MidiBuffer& target, const MidiMessageSequence& seq, const T
         if (timeStamp >= numSamples)
             break;
 
-        target.addEvent (ev->message, timeStamp);
+        target.addEvent (ev->message, offset + timeStamp);
 
         /* if (ev->message.isNoteOn())
          {
@@ -24,11 +24,18 @@ class Shuttle;
 class TimeScale;
 
 namespace Midi {
-    void renderSequence (MidiBuffer& target, const MidiMessageSequence& seq, const TimeScale& ts, int32 startFrame, int32 numSamples);
+    void renderSequence (MidiBuffer& target, const MidiMessageSequence& seq, const TimeScale& ts,
+                         int32 startFrame, int32 numSamples, int32 offset = 0);
 }
 
-/** A single track midi sequencer with record functionality */
-class MidiSequencePlayer
+/** A single track midi sequencer with record functionality, see getRecorder()
+
+    The sequence is compiled on the message thread and handed to the audio
+    thread through an atomic pointer, the sequence it replaces is deleted
+    on the message thread the next time one is handed over. Playback never
+    waits or skips a block while that happens.
+ */
+class MidiSequencePlayer : private AsyncUpdater
 {
 public:
 
@@ -37,8 +44,32 @@ public:
     MidiSequencePlayer();
     ~MidiSequencePlayer();
 
+    /** Render a block at the shuttle's position, one segment at a time so
+        loop wraps and locates are sample accurate. Plays the last sequence
+        compiled with compileSequence(), re-timed in the background when the
+        shuttle's tempo map changes. midiMessages should have room for
+        getNumBytes() more, or adding the events can allocate */
     void renderSequence (int numSamples, MidiBuffer& midiMessages);
-    void renderSequence (MidiBuffer& target, const MidiMessageSequence& seq, int32 startFrame, int32 numSamples);
+    void renderSequence (MidiBuffer& target, const MidiMessageSequence& seq, int32 startFrame,
+                         int32 numSamples, int32 offset = 0);
+
+    /** Compile the sequence against the shuttle's tempo map. Call this after
+        changing the sequence. Not realtime safe */
+    void compileSequence();
+
+    /** Space the compiled sequence's events take in a MidiBuffer, so hosts
+        can reserve their buffers to it */
+    size_t getNumBytes() const;
+
+    /** Re-time the compiled sequence after the shuttle's tempo map changed.
+        Only events after the change are touched. Not realtime safe */
+    void tempoMapChanged();
+
+    /** Returns the recorder, creating it the first time. Input passed to
+        renderSequence() is recorded while the shuttle is, merged in the
+        background and then replaces the sequence on the message thread.
+        Not realtime safe */
+    MidiRecorder& getRecorder();
 
     void prepareToPlay (double sampleRate, int blockSize);
     void releaseResources();
@@ -58,23 +89,45 @@ public:
     inline int32 getBarLength() const { return numBars; }
     inline void setBarLength (int32 newNumBars) { numBars = newNumBars; }
 
-    /* Get the number of beats per bar (currently hard-coded to four) */
-    int32 getBeatsPerBar() const { return 4; }
+    /* Get the number of beats per bar, from the meter at the shuttle's position */
+    int32 getBeatsPerBar() const;
 
-    inline void setShuttle (Shuttle* s) { shuttle.setNonOwned(s); }
+    /** Play against another shuttle, re-timing the sequence to its tempo
+        map. The player's own shuttle is kept, pass nullptr to go back to
+        it. Not realtime safe */
+    inline void setShuttle (Shuttle* s) { shuttle = s != nullptr ? s : ownShuttle.get(); tempoMapChanged(); }
     inline Shuttle* getShuttle() const { return shuttle; }
     inline void setFrameOffset (int32 offset) { frameOffset = offset; }
 
 protected:
-    MidiMessageSequence noteOffs;
+    NoteTracker activeNotes;
+
+    /** The sequence played. Subclasses that change it must call
+        compileSequence() afterwards, playback uses the compiled copy */
     ScopedPointer<MidiMessageSequence> midiSequence;
     MidiMessage allNotesOff;
 
 private:
-    OptionalScopedPointer<Shuttle> shuttle;
+    ScopedPointer<Shuttle> ownShuttle;
+    Shuttle* shuttle;
+    ScopedPointer<CompiledMidiSequence> compiled;   // message thread's copy, re-timed in place
+    CompiledMidiSequence* playing;                  // audio thread's copy
+    Atomic<CompiledMidiSequence*> pending, retired;
+    Atomic<int> rendering;
+    Atomic<uint32> compiledVersion;                 // tempo map version compiled against
+
+    ScopedPointer<MidiRecorder> recorder;
+    Atomic<MidiRecorder*> activeRecorder;
+    CriticalSection recordedLock;
+    ScopedPointer<MidiMessageSequence> recorded;
+
     int32 frameOffset;
     double lastEventTime;
     int32 numBars;
+
+    void publishCompiled();
+    void recordedSequenceChanged (const MidiMessageSequence& sequence);
+    void handleAsyncUpdate() override;
 };
 
 #endif
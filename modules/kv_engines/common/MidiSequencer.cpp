@@ -0,0 +1,351 @@
+/*
+    This file is part of the Kushview Modules for JUCE
+    Copyright (C) 2014-2017  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+/** What a track plays. Replaced whole when its sequence or the tempo map
+    changes, so the audio side never sees one half updated */
+struct MidiSequencer::Playback
+{
+    Playback() { }
+    explicit Playback (const CompiledMidiSequence& other) : sequence (other) { }
+
+    void reserve (int blockSize)
+    {
+        scratch.ensureSize (jmax ((size_t) jmax (4096, blockSize * 16), sequence.getNumBytes()));
+    }
+
+    CompiledMidiSequence sequence;
+    MidiBuffer scratch;     ///< played into when the track has no output
+};
+
+struct MidiSequencer::Track
+{
+    Track() : serial (1), playedSerial (0), wasMuted (false) { muted.store (false); }
+
+    ScopedPointer<Playback> playback;   ///< edits replace this, then publish
+    uint32 serial;                      ///< goes up when the sequence is replaced
+    std::atomic<bool> muted;
+
+    // only touched by the audio side
+    NoteTracker notes;
+    uint32 playedSerial;
+    bool wasMuted;
+};
+
+/** What render() plays, never changed once published */
+struct MidiSequencer::TrackList
+{
+    struct Entry
+    {
+        Track* track;
+        Playback* playback;
+        uint32 serial;
+    };
+
+    TrackList() : shuttle (nullptr) { }
+
+    Shuttle* shuttle;
+    Array<Entry> entries;
+};
+
+class MidiSequencer::Worker : public Thread
+{
+public:
+    Worker (MidiSequencer& s, int index)
+        : Thread ("MIDI Sequencer " + String (index + 1)), owner (s) { }
+
+    void run() override
+    {
+        while (! threadShouldExit())
+        {
+            owner.start.wait();
+            if (threadShouldExit())
+                break;
+            owner.renderPendingTracks();
+        }
+    }
+
+private:
+    MidiSequencer& owner;
+};
+
+MidiSequencer::MidiSequencer (int numWorkerThreads)
+    : shuttle (nullptr), bufferSize (512),
+      blockList (nullptr), blockOutputs (nullptr), blockNumOutputs (0)
+{
+    published.store (new TrackList());
+    renders.store (0);
+    jobs.store (0);
+    remaining.store (0);
+
+    if (numWorkerThreads < 0)
+        numWorkerThreads = jmax (0, SystemStats::getNumCpus() - 1);
+
+    // the rendering thread waits on tracks a worker has claimed, so workers
+    // run at the top priority, which is realtime where JUCE supports it
+    for (int i = 0; i < numWorkerThreads; ++i)
+        workers.add (new Worker (*this, i))->startThread (10);
+}
+
+MidiSequencer::~MidiSequencer()
+{
+    for (Worker* const worker : workers)
+        worker->signalThreadShouldExit();
+    start.post ((unsigned) workers.size());
+    for (Worker* const worker : workers)
+        worker->waitForThreadToExit (-1);
+
+    workers.clear();
+    delete published.exchange (nullptr);
+    tracks.clear();
+}
+
+void MidiSequencer::setShuttle (Shuttle* newShuttle)
+{
+    const ScopedLock sl (editLock);
+    shuttle = newShuttle;
+    publish();
+}
+
+MidiSequencer::Playback* MidiSequencer::createPlayback (const MidiMessageSequence& sequence) const
+{
+    jassert (shuttle != nullptr);
+    const TimeScale defaultScale;
+
+    Playback* const playback = new Playback();
+    playback->sequence.compile (sequence, shuttle != nullptr ? shuttle->getTimeScale() : defaultScale);
+    playback->reserve (bufferSize);
+    return playback;
+}
+
+void MidiSequencer::publish()
+{
+    ScopedPointer<TrackList> list (new TrackList());
+    list->shuttle = shuttle;
+    list->entries.ensureStorageAllocated (tracks.size());
+    for (Track* const track : tracks)
+    {
+        const TrackList::Entry entry = { track, track->playback.get(), track->serial };
+        list->entries.add (entry);
+    }
+
+    ScopedPointer<TrackList> old (published.exchange (list.release()));
+
+    // a block that loaded the old list may still be rendering it. Wait for
+    // that block to finish, then the caller can delete what was replaced
+    const uint32 count = renders.load();
+    if ((count & 1) != 0)
+        while (renders.load() == count)
+            Thread::yield();
+}
+
+int MidiSequencer::addTrack (const MidiMessageSequence& sequence)
+{
+    const ScopedLock sl (editLock);
+    Track* const track = tracks.add (new Track());
+    track->playback = createPlayback (sequence);
+    publish();
+    return tracks.size() - 1;
+}
+
+void MidiSequencer::setTrackSequence (int index, const MidiMessageSequence& sequence)
+{
+    const ScopedLock sl (editLock);
+    if (Track* const track = tracks [index])
+    {
+        // the replaced one is deleted once published, the audio side sees
+        // the new serial and stops the old one's notes
+        ScopedPointer<Playback> replaced (createPlayback (sequence));
+        track->playback.swapWith (replaced);
+        ++track->serial;
+        publish();
+    }
+}
+
+void MidiSequencer::removeTrack (int index)
+{
+    const ScopedLock sl (editLock);
+    ScopedPointer<Track> removed (tracks.removeAndReturn (index));
+    if (removed != nullptr)
+        publish();
+}
+
+void MidiSequencer::clearTracks()
+{
+    const ScopedLock sl (editLock);
+    OwnedArray<Track> removed;
+    removed.swapWith (tracks);
+    publish();
+}
+
+int MidiSequencer::getNumTracks() const
+{
+    const ScopedLock sl (editLock);
+    return tracks.size();
+}
+
+void MidiSequencer::setTrackMuted (int index, bool muted)
+{
+    const ScopedLock sl (editLock);
+    if (Track* const track = tracks [index])
+        track->muted.store (muted);
+}
+
+bool MidiSequencer::isTrackMuted (int index) const
+{
+    const ScopedLock sl (editLock);
+    const Track* const track = tracks [index];
+    return track != nullptr && track->muted.load();
+}
+
+void MidiSequencer::tempoMapChanged()
+{
+    const ScopedLock sl (editLock);
+    if (shuttle == nullptr)
+        return;
+
+    const TimeScale& ts (shuttle->getTimeScale());
+
+    // re-time copies, the tracks keep playing the published ones meanwhile.
+    // Copies don't take the render cursor, so nothing the audio side writes
+    // is read here
+    OwnedArray<Playback> replaced;
+    for (Track* const track : tracks)
+    {
+        if (track->playback->sequence.isUpToDate (ts))
+            continue;
+
+        ScopedPointer<Playback> playback (new Playback (track->playback->sequence));
+        if (! playback->sequence.update (ts))
+            continue;
+
+        playback->reserve (bufferSize);
+        track->playback.swapWith (playback);
+        replaced.add (playback.release());
+    }
+
+    if (replaced.size() > 0)
+        publish();
+}
+
+void MidiSequencer::prepareToPlay (double, int blockSize)
+{
+    const ScopedLock sl (editLock);
+    bufferSize = blockSize;
+    for (Track* const track : tracks)
+    {
+        track->playback->reserve (bufferSize);
+        track->notes.reset();
+    }
+}
+
+void MidiSequencer::releaseResources() { }
+
+bool MidiSequencer::render (int numSamples, MidiBuffer* const* outputs, int numOutputs)
+{
+    // counted before the list is loaded, so publish() can tell whether
+    // this block might be using the list it replaced
+    renders.fetch_add (1);
+    const TrackList* const list = published.load();
+
+    if (list->shuttle == nullptr)
+    {
+        renders.fetch_add (1, std::memory_order_release);
+        return false;
+    }
+
+    list->shuttle->prepareBlock (numSamples);
+
+    const int numTracks = list->entries.size();
+    if (numTracks > 0)
+    {
+        blockList       = list;
+        blockOutputs    = outputs;
+        blockNumOutputs = outputs != nullptr ? numOutputs : 0;
+        remaining.store (numTracks, std::memory_order_relaxed);
+        jobs.store ((uint64) numTracks << 32, std::memory_order_release);
+
+        const int numHelpers = jmin (workers.size(), numTracks - 1);
+        if (numHelpers > 0)
+            start.post ((unsigned) numHelpers);
+
+        renderPendingTracks();
+        done.wait();
+    }
+
+    renders.fetch_add (1, std::memory_order_release);
+    return true;
+}
+
+void MidiSequencer::renderPendingTracks()
+{
+    // jobs holds the number of tracks in the high word and the next one to
+    // claim in the low word. A worker that wakes late either finds nothing
+    // left or claims a track of the block being rendered now
+    for (;;)
+    {
+        uint64 job = jobs.load (std::memory_order_acquire);
+        for (;;)
+        {
+            if ((uint32) job >= (uint32) (job >> 32))
+                return;
+            if (jobs.compare_exchange_weak (job, job + 1, std::memory_order_acq_rel,
+                                                           std::memory_order_acquire))
+                break;
+        }
+
+        renderTrack ((int) (uint32) job);
+
+        if (remaining.fetch_sub (1, std::memory_order_acq_rel) == 1)
+            done.post();
+    }
+}
+
+void MidiSequencer::renderTrack (int index)
+{
+    const TrackList::Entry& entry (blockList->entries.getReference (index));
+    const Shuttle& transport (*blockList->shuttle);
+    Track& track (*entry.track);
+
+    MidiBuffer* dest = index < blockNumOutputs ? blockOutputs [index] : nullptr;
+    if (dest == nullptr)
+    {
+        entry.playback->scratch.clear();
+        dest = &entry.playback->scratch;
+    }
+
+    const bool muted = track.muted.load (std::memory_order_relaxed);
+    if (entry.serial != track.playedSerial || (muted && ! track.wasMuted))
+        track.notes.flush (*dest, 0);
+    track.playedSerial = entry.serial;
+    track.wasMuted = muted;
+
+    for (int i = 0; i < transport.getNumSegments(); ++i)
+    {
+        const Shuttle::Segment& segment (transport.getSegment (i));
+
+        if (segment.looped || segment.located || ! segment.playing)
+            track.notes.flush (*dest, segment.offset);
+
+        if (muted || ! segment.playing)
+            continue;
+
+        entry.playback->sequence.render (*dest, segment.frame, segment.numFrames, segment.offset);
+        track.notes.process (*dest, segment.offset, segment.numFrames);
+    }
+}
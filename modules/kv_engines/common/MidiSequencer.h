@@ -0,0 +1,117 @@
+/*
+    This file is part of the Kushview Modules for JUCE
+    Copyright (C) 2014-2017  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+/** Plays many MIDI tracks against one Shuttle.
+
+    Each track is compiled against the shuttle's tempo map and rendered into
+    its own MidiBuffer, one transport segment at a time, so meter and tempo
+    changes, loop wraps and locates land on the right sample. Tracks are
+    shared between the calling thread and a set of worker threads, so a
+    block with hundreds of tracks renders in parallel.
+
+    Sounding notes are tracked per track in a fixed table and stopped when
+    playback stops, jumps, wraps, or a track is muted or replaced. Removing
+    a track doesn't stop its notes, so mute it for a block first.
+
+    Track edits aren't realtime safe, but can be made while rendering. Each
+    edit publishes a new immutable list of tracks and their sequences with
+    an atomic swap, which the next block picks up. What the edit replaced
+    is deleted once a block that may be using it has finished, so rendering
+    never waits on an edit or skips a block.
+ */
+class MidiSequencer
+{
+public:
+    /** Create a sequencer.
+        @param numWorkerThreads Threads to help the rendering thread, or -1
+                                for one less than the number of cores */
+    explicit MidiSequencer (int numWorkerThreads = -1);
+    ~MidiSequencer();
+
+    /** Set the transport. It isn't owned, and must outlive rendering with it */
+    void setShuttle (Shuttle* shuttle);
+    Shuttle* getShuttle() const { return shuttle; }
+
+    /** Add a track with a sequence stamped in ticks. Returns its index */
+    int addTrack (const MidiMessageSequence& sequence);
+
+    /** Replace a track's sequence */
+    void setTrackSequence (int track, const MidiMessageSequence& sequence);
+
+    /** Remove a track. Later tracks move down one index */
+    void removeTrack (int track);
+
+    /** Remove every track */
+    void clearTracks();
+
+    int getNumTracks() const;
+
+    /** Mute or unmute a track. This only sets a flag the audio side reads */
+    void setTrackMuted (int track, bool muted);
+    bool isTrackMuted (int track) const;
+
+    /** Re-time every track after the shuttle's tempo map changed */
+    void tempoMapChanged();
+
+    /** Size internal buffers */
+    void prepareToPlay (double sampleRate, int blockSize);
+    void releaseResources();
+
+    /** Render a block for all tracks at the shuttle's prepared segments.
+        Advancing the shuttle is left to the caller.
+
+        Track i is written to outputs[i], which should be cleared and have
+        enough space reserved. Tracks without an output are still played so
+        their notes are tracked. Returns false if there is no shuttle.
+        Realtime safe */
+    bool render (int numSamples, MidiBuffer* const* outputs, int numOutputs);
+
+private:
+    struct Playback;
+    struct Track;
+    struct TrackList;
+    class Worker;
+
+    // edits work on these, then publish them as a TrackList
+    mutable CriticalSection editLock;
+    Shuttle* shuttle;
+    OwnedArray<Track> tracks;
+    int bufferSize;
+
+    std::atomic<TrackList*> published;
+    std::atomic<uint32> renders;    ///< odd while render() runs
+    OwnedArray<Worker> workers;
+
+    // the block being rendered, see renderPendingTracks()
+    std::atomic<uint64> jobs;
+    std::atomic<int> remaining;
+    Semaphore start, done;
+    const TrackList* blockList;
+    MidiBuffer* const* blockOutputs;
+    int blockNumOutputs;
+
+    void renderPendingTracks();
+    void renderTrack (int index);
+    Playback* createPlayback (const MidiMessageSequence& sequence) const;
+    void publish();
+
+    JUCE_DECLARE_NON_COPYABLE (MidiSequencer)
+};
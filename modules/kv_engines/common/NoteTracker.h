@@ -0,0 +1,108 @@
+/*
+    This file is part of the Kushview Modules for JUCE
+    Copyright (C) 2014-2017  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+/** Keeps track of sounding notes so they can be stopped.
+
+    A fixed table of counts per channel and note, so nothing is allocated
+    and any number of overlapping notes can be tracked. Feed it what's been
+    played, then flush() when the transport stops, jumps or wraps.
+ */
+class NoteTracker
+{
+public:
+    NoteTracker()   { reset(); }
+
+    /** Forget every note without sending note offs */
+    inline void reset() noexcept
+    {
+        zeromem (counts, sizeof (counts));
+        numActive = 0;
+    }
+
+    /** True if nothing is sounding */
+    inline bool isEmpty() const noexcept { return numActive == 0; }
+
+    /** Number of channel/note pairs sounding */
+    inline int getNumActive() const noexcept { return numActive; }
+
+    /** Times a note is sounding. channel is 0 to 15 */
+    inline int getCount (int channel, int note) const noexcept
+    {
+        return (int) counts [channel & 0x0f][note & 0x7f];
+    }
+
+    /** Update from a raw message */
+    inline void process (const uint8* data, int size) noexcept
+    {
+        if (size < 3)
+            return;
+
+        const int status  = data[0] & 0xf0;
+        uint8& count (counts [data[0] & 0x0f][data[1] & 0x7f]);
+
+        if (status == 0x90 && data[2] != 0)
+        {
+            if (count == 0)
+                ++numActive;
+            if (count < 0xff)
+                ++count;
+        }
+        else if ((status == 0x80 || status == 0x90) && count > 0)
+        {
+            if (--count == 0)
+                --numActive;
+        }
+    }
+
+    /** Update from the events of a buffer in a range of samples */
+    inline void process (const MidiBuffer& buffer, int startSample, int numSamples) noexcept
+    {
+        MidiBuffer::Iterator iter (buffer);
+        iter.setNextSamplePosition (startSample);
+
+        const uint8* data = nullptr;
+        int size = 0, sample = 0;
+        while (iter.getNextEvent (data, size, sample) && sample < startSample + numSamples)
+            process (data, size);
+    }
+
+    /** Add a note off for every sounding note, then forget them */
+    inline void flush (MidiBuffer& target, int sample) noexcept
+    {
+        for (int channel = 0; channel < 16 && numActive > 0; ++channel)
+        {
+            for (int note = 0; note < 128; ++note)
+            {
+                for (uint8& count = counts [channel][note]; count > 0; --count)
+                {
+                    const uint8 off[3] = { (uint8) (0x80 | channel), (uint8) note, 0 };
+                    target.addEvent (off, 3, sample);
+                }
+            }
+        }
+
+        reset();
+    }
+
+private:
+    uint8 counts [16][128];
+    int numActive;
+};
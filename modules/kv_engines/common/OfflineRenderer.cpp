@@ -0,0 +1,296 @@
+/*
+    This file is part of the Kushview Modules for JUCE
+    Copyright (C) 2014-2017  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#if KV_JACK_AUDIO
+class OfflineRenderer::FreewheelCallback : public JackDeviceCallback
+{
+public:
+    FreewheelCallback (OfflineRenderer& r) : renderer (r) { }
+
+    void audioDeviceAboutToStart (AudioIODevice*) override { }
+    void audioDeviceStopped() override { }
+
+    void jackDeviceIOCallback (const float**, int, float** outputs, int numOutputs,
+                               const MidiBuffer&, MidiBuffer&, int numSamples) override
+    {
+        if (renderer.renderBlock (outputs, numOutputs, numSamples))
+            renderer.renderedAll.signal();
+    }
+
+private:
+    OfflineRenderer& renderer;
+};
+#endif
+
+OfflineRenderer::OfflineRenderer (AudioProcessor& p)
+    : Thread ("Offline Render"),
+      processor (p),
+      player (nullptr),
+      playerShuttle (nullptr),
+      finished (true),
+      renderedAll (true),
+      result (Result::ok()),
+      started (false),
+      writerThread ("Offline Render Writer")
+     #if KV_JACK_AUDIO
+      , jackClient (nullptr),
+      jackDevice (nullptr)
+     #endif
+{
+    shuttle.setOwned (new Shuttle());
+    numRendered.set (0);
+    cancelled.set (0);
+}
+
+OfflineRenderer::~OfflineRenderer()
+{
+    cancel();
+    waitForThreadToExit (-1);
+    writerThread.stopThread (1000);
+}
+
+void OfflineRenderer::setShuttle (Shuttle* newShuttle)
+{
+    jassert (! isThreadRunning());
+    if (newShuttle == nullptr)
+        shuttle.setOwned (new Shuttle());
+    else
+        shuttle.setNonOwned (newShuttle);
+}
+
+void OfflineRenderer::setMidiSequencePlayer (MidiSequencePlayer* newPlayer)
+{
+    jassert (! isThreadRunning());
+    player = newPlayer;
+}
+
+Result OfflineRenderer::start (const Options& newOptions)
+{
+    if (isThreadRunning())
+        return Result::fail ("Already rendering");
+
+    options = newOptions;
+    const Result prepared (prepare (options.sampleRate, options.blockSize));
+    if (prepared.wasOk())
+        startThread();
+    return prepared;
+}
+
+#if KV_JACK_AUDIO
+Result OfflineRenderer::startFreewheel (const Options& newOptions, JackClient& client, AudioIODevice& device)
+{
+    if (isThreadRunning())
+        return Result::fail ("Already rendering");
+    if (! client.isOpen())
+        return Result::fail ("JACK client is not open");
+
+    options = newOptions;
+    options.sampleRate = (double) client.sampleRate();
+    options.blockSize  = client.bufferSize();
+
+    const Result prepared (prepare (options.sampleRate, options.blockSize));
+    if (prepared.failed())
+        return prepared;
+
+    jackClient = &client;
+    jackDevice = &device;
+    freewheel = new FreewheelCallback (*this);
+    device.start (freewheel);
+
+    // without freewheel this still works, just in realtime
+    if (jack_set_freewheel (client, 1) != 0)
+        DBG ("[kv] could not start JACK freewheel, rendering in realtime");
+
+    startThread();
+    return prepared;
+}
+#endif
+
+void OfflineRenderer::cancel()
+{
+    cancelled.set (1);
+    renderedAll.signal();
+}
+
+bool OfflineRenderer::isFinished() const
+{
+    return started && finished.wait (0);
+}
+
+bool OfflineRenderer::waitForCompletion (int timeoutMilliseconds)
+{
+    return started && finished.wait (timeoutMilliseconds);
+}
+
+double OfflineRenderer::getProgress() const
+{
+    return options.lengthInSamples > 0
+        ? jlimit (0.0, 1.0, (double) numRendered.get() / (double) options.lengthInSamples)
+        : 0.0;
+}
+
+Result OfflineRenderer::prepare (double sampleRate, int blockSize)
+{
+    if (options.lengthInSamples <= 0)
+        return Result::fail ("Nothing to render");
+    if (options.numChannels <= 0 || sampleRate <= 0.0 || blockSize <= 0)
+        return Result::fail ("Invalid render options");
+
+    AudioFormatManager formats;
+    formats.registerBasicFormats();
+    AudioFormat* const format = formats.findFormatForFileExtension (options.file.getFileExtension());
+    if (format == nullptr)
+        return Result::fail (String ("No audio format for ") + options.file.getFileName());
+
+    options.file.deleteFile();
+    ScopedPointer<FileOutputStream> stream (options.file.createOutputStream());
+    if (stream == nullptr || stream->failedToOpen())
+        return Result::fail (String ("Could not open ") + options.file.getFullPathName());
+
+    AudioFormatWriter* const fileWriter = format->createWriterFor (
+        stream, sampleRate, (unsigned int) options.numChannels,
+        options.bitsPerSample, StringPairArray(), 0);
+    if (fileWriter == nullptr)
+        return Result::fail (String ("Could not write ") + options.file.getFileName());
+    stream.release();
+
+    writerThread.startThread();
+    writer = new AudioFormatWriter::ThreadedWriter (fileWriter, writerThread, 1 << 16);
+
+    processor.setNonRealtime (true);
+    processor.setRateAndBufferSizeDetails (sampleRate, blockSize);
+    processor.prepareToPlay (sampleRate, blockSize);
+    processor.setPlayHead (shuttle);
+
+    buffer.setSize (jmax (options.numChannels, processor.getTotalNumInputChannels(),
+                          processor.getTotalNumOutputChannels()), blockSize);
+    midi.ensureSize (4096);
+
+    shuttle->stopFollowing();
+    shuttle->setSampleRate (sampleRate);
+    shuttle->setPositionFrames (0);
+    shuttle->setPlaying (true);
+
+    if (player != nullptr)
+    {
+        playerShuttle = player->getShuttle();
+        player->setShuttle (shuttle);
+        player->prepareToPlay (sampleRate, blockSize);
+        midi.ensureSize (jmax ((size_t) 4096, player->getNumBytes()));
+    }
+
+    numRendered.set (0);
+    cancelled.set (0);
+    finished.reset();
+    renderedAll.reset();
+    result = Result::ok();
+    started = true;
+    return result;
+}
+
+bool OfflineRenderer::renderBlock (float** outputs, int numOutputs, int numSamples)
+{
+    const int64 remaining = options.lengthInSamples - numRendered.get();
+    if (remaining <= 0 || cancelled.get() != 0)
+    {
+        for (int i = 0; i < numOutputs; ++i)
+            FloatVectorOperations::clear (outputs[i], numSamples);
+        return true;
+    }
+
+    const int numToRender = (int) jmin ((int64) numSamples, remaining, (int64) buffer.getNumSamples());
+    buffer.clear();
+    midi.clear();
+    shuttle->prepareBlock (numToRender);
+
+    if (player != nullptr)
+        player->renderSequence (numToRender, midi);
+
+    AudioSampleBuffer block (buffer.getArrayOfWritePointers(), buffer.getNumChannels(), numToRender);
+    processor.processBlock (block, midi);
+
+    // there's no deadline offline, so wait on the writer rather than drop audio
+    while (! writer->write (buffer.getArrayOfReadPointers(), numToRender))
+    {
+        if (cancelled.get() != 0)
+            break;
+        Thread::sleep (1);
+    }
+
+    for (int i = 0; i < numOutputs; ++i)
+    {
+        if (i < buffer.getNumChannels())
+            FloatVectorOperations::copy (outputs[i], buffer.getReadPointer (i), numToRender);
+        if (numToRender < numSamples)
+            FloatVectorOperations::clear (outputs[i] + numToRender, numSamples - numToRender);
+    }
+
+    shuttle->advance (numToRender);
+    numRendered += (int64) numToRender;
+    return numRendered.get() >= options.lengthInSamples;
+}
+
+void OfflineRenderer::finish()
+{
+   #if KV_JACK_AUDIO
+    if (jackClient != nullptr)
+    {
+        jack_set_freewheel (*jackClient, 0);
+        jackDevice->start (nullptr);
+        freewheel = nullptr;
+        jackClient = nullptr;
+        jackDevice = nullptr;
+    }
+   #endif
+
+    // deleting the writer flushes what's left to disk
+    writer = nullptr;
+
+    processor.setPlayHead (nullptr);
+    processor.releaseResources();
+    processor.setNonRealtime (false);
+    if (player != nullptr)
+    {
+        player->releaseResources();
+        player->setShuttle (playerShuttle);
+        playerShuttle = nullptr;
+    }
+
+    if (cancelled.get() != 0)
+        result = Result::fail ("Render cancelled");
+
+    finished.signal();
+    if (onFinished)
+        onFinished();
+}
+
+void OfflineRenderer::run()
+{
+   #if KV_JACK_AUDIO
+    if (jackClient != nullptr)
+    {
+        while (! threadShouldExit() && ! renderedAll.wait (50)) { }
+        finish();
+        return;
+    }
+   #endif
+
+    while (! threadShouldExit() && ! renderBlock (nullptr, 0, options.blockSize)) { }
+    finish();
+}
@@ -0,0 +1,127 @@
+/*
+    This file is part of the Kushview Modules for JUCE
+    Copyright (C) 2014-2017  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+/** Renders an AudioProcessor to a file as fast as the CPU allows.
+
+    A virtual clock drives the processor, an optional MidiSequencePlayer and
+    the Shuttle used as play head, so nothing here needs an audio device.
+    Audio is handed to a streaming writer thread so disk I/O never stalls
+    rendering.
+
+    With JACK, startFreewheel() renders through a JACK device instead with
+    the server in freewheel mode, so other JACK clients keep running in sync
+    with the bounce.
+ */
+class OfflineRenderer : private Thread
+{
+public:
+    struct Options
+    {
+        Options()
+            : sampleRate (48000.0), blockSize (512), numChannels (2),
+              lengthInSamples (0), bitsPerSample (24)
+        { }
+
+        /** The file to write, the format is chosen by its extension */
+        File file;
+        double sampleRate;
+        int blockSize;
+        int numChannels;
+        int64 lengthInSamples;
+        int bitsPerSample;
+    };
+
+    OfflineRenderer (AudioProcessor& processor);
+
+    /** Destructor. This cancels a render that hasn't finished */
+    ~OfflineRenderer();
+
+    /** Set the shuttle used as play head, it is started from zero on render.
+        If not set, an internal one is used */
+    void setShuttle (Shuttle* shuttle);
+
+    /** Set a sequence player to feed MIDI to the processor. It plays against
+        this renderer's shuttle while rendering and goes back to its own
+        shuttle once finished, so leave it alone until then */
+    void setMidiSequencePlayer (MidiSequencePlayer* player);
+
+    /** Render in a background thread without any audio device */
+    Result start (const Options& options);
+
+   #if KV_JACK_AUDIO
+    /** Render through a JACK device with the server freewheeling.  The
+        device's callback is replaced by the renderer, the caller should
+        restart its own once finished. Sample rate and block size are
+        taken from JACK */
+    Result startFreewheel (const Options& options, JackClient& client, AudioIODevice& device);
+   #endif
+
+    /** Stop rendering. What was rendered so far is kept */
+    void cancel();
+
+    /** Returns true if a render was started and has finished */
+    bool isFinished() const;
+
+    /** Wait for the render to finish
+        @returns true if finished before the timeout */
+    bool waitForCompletion (int timeoutMilliseconds = -1);
+
+    /** Returns the amount rendered, from 0.0 to 1.0 */
+    double getProgress() const;
+
+    /** Get the result once finished */
+    Result getResult() const { return result; }
+
+    /** Called from the render thread when finished */
+    std::function<void()> onFinished;
+
+private:
+    AudioProcessor& processor;
+    OptionalScopedPointer<Shuttle> shuttle;
+    MidiSequencePlayer* player;
+    Shuttle* playerShuttle;
+
+    Options options;
+    AudioSampleBuffer buffer;
+    MidiBuffer midi;
+    Atomic<int64> numRendered;
+    Atomic<int> cancelled;
+    WaitableEvent finished, renderedAll;
+    Result result;
+    bool started;
+
+    TimeSliceThread writerThread;
+    ScopedPointer<AudioFormatWriter::ThreadedWriter> writer;
+
+   #if KV_JACK_AUDIO
+    class FreewheelCallback;
+    ScopedPointer<FreewheelCallback> freewheel;
+    JackClient* jackClient;
+    AudioIODevice* jackDevice;
+   #endif
+
+    Result prepare (double sampleRate, int blockSize);
+    bool renderBlock (float** outputs, int numOutputs, int numSamples);
+    void finish();
+    void run() override;
+
+    JUCE_DECLARE_NON_COPYABLE (OfflineRenderer)
+};
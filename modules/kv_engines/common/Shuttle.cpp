@@ -33,13 +33,25 @@ Shuttle::Shuttle()
     ts.setSampleRate (48000);
     ts.setTicksPerBeat (Shuttle::PPQ);
     ts.updateScale();
+    tempoMapVersion.store (0);
 
     duration = 48000 * 4;
     framePos = 0;
+    loopStart = 0;
+    sampleRate = (double) ts.getSampleRate();
     framesPerBeat  = Tempo::audioFramesPerBeat ((double) ts.getSampleRate(), ts.getTempo());
     beatsPerFrame  = 1.0f / framesPerBeat;
-    playing = recording = false;
+    playing = recording = following = false;
     looping = true;
+    external.resetToDefault();
+
+    numSegments = currentSegment = 0;
+    preparedFrames = -1;
+    preparedPosition = endPosition = 0;
+    locatePending = locateReached = wrapPending = false;
+    locateFrame = 0;
+    locateOffset = 0;
+    updateLoopPositions();
 }
 
 Shuttle::~Shuttle() { }
@@ -50,23 +62,38 @@ double Shuttle::getFramesPerBeat() const { return framesPerBeat; }
 bool
 Shuttle::getCurrentPosition (CurrentPositionInfo &result)
 {
-    result.bpm = (double) ts.getTempo();
+    if (following)
+    {
+        result = external;
+        return true;
+    }
+
+    const Segment* const segment = numSegments > 0 ? &segments [currentSegment] : nullptr;
+    const int64 frame = segment != nullptr ? segment->frame : framePos;
+    const uint64 tick = ts.tickFromFrame ((uint64) frame);
+    const double ppq = (double) ts.ticksPerBeat();
+
+    result.bpm = segment != nullptr ? segment->bpm : (double) ts.getTempo();
     result.frameRate = AudioPlayHead::fps24;
 
-    result.isLooping   = true;
+    result.isLooping   = this->isLooping();
     result.isPlaying   = this->isPlaying();
     result.isRecording = this->isRecording();
 
     result.ppqLoopStart = ppqLoopStart;
     result.ppqLoopEnd   = ppqLoopEnd;
-    result.ppqPosition  = ts.tickFromFrame (framePos);
-    result.ppqPositionOfLastBarStart = 0.0f;
+    result.ppqPosition  = (double) tick / ppq;
+    result.ppqPositionOfLastBarStart = 0.0;
+    if (const TimeScale::Node* node = ts.cursor().seekTick (tick))
+        result.ppqPositionOfLastBarStart = (double) node->tickFromBar (node->barFromTick (tick)) / ppq;
 
     result.editOriginTime = 0.0f;
-    result.timeInSamples  = getPositionFrames();
-    result.timeInSeconds  = getPositionSeconds();
-    result.timeSigNumerator = ts.beatsPerBar();
-    result.timeSigDenominator = ts.beatDivisor();
+    result.timeInSamples  = frame;
+    result.timeInSeconds  = (double) frame / (double) ts.getSampleRate();
+    // the scale keeps the beat unit as a power of two
+    const TimeScale::Node* const node = ts.getNodeAtFrame ((uint64) frame);
+    result.timeSigNumerator = segment != nullptr ? segment->beatsPerBar : getBeatsPerBar();
+    result.timeSigDenominator = 1 << (node != nullptr ? node->beatDivisor : ts.beatDivisor());
 
     return true;
 }
@@ -87,6 +114,45 @@ const TimeScale& Shuttle::getTimeScale()    const { return ts; }
 bool Shuttle::isLooping()   const { return looping; }
 bool Shuttle::isPlaying()   const { return playing; }
 bool Shuttle::isRecording() const { return recording; }
+bool Shuttle::isFollowing() const { return following; }
+
+void Shuttle::follow (const CurrentPositionInfo& pos)
+{
+    external  = pos;
+    following = true;
+    playing   = pos.isPlaying;
+    recording = pos.isRecording;
+
+    // the scale is only touched when the external tempo or meter changes.
+    // updateScale() doesn't allocate, ramp tables come with their nodes
+    const bool meterChanged = pos.timeSigNumerator > 0
+        && (unsigned short) pos.timeSigNumerator != ts.beatsPerBar();
+    const bool tempoChanged = pos.bpm > 0.0 && (float) pos.bpm != ts.getTempo();
+
+    if (meterChanged)
+        ts.setBeatsPerBar ((unsigned short) pos.timeSigNumerator);
+
+    if (tempoChanged)
+        ts.setTempo ((float) pos.bpm);
+
+    if (meterChanged || tempoChanged)
+    {
+        // no rescaling of framePos here, the external position is the truth
+        ts.updateScale();
+        framesPerBeat = Tempo::audioFramesPerBeat ((double) ts.getSampleRate(), ts.getTempo());
+        beatsPerFrame = 1.0f / framesPerBeat;
+        updateLoopPositions();
+        tempoMapVersion.fetch_add (1, std::memory_order_release);
+    }
+
+    framePos = pos.timeInSamples;
+    invalidateBlock();
+}
+
+void Shuttle::stopFollowing()
+{
+    following = false;
+}
 
 void Shuttle::resetRecording()
 {
@@ -95,7 +161,28 @@ void Shuttle::resetRecording()
 
 void Shuttle::setLengthBeats   (const float beats) { setLengthFrames (framesPerBeat * beats); }
 void Shuttle::setLengthSeconds (const double seconds) { setLengthFrames (roundDoubleToInt (getSampleRate() * seconds)); }
-void Shuttle::setLengthFrames  (const uint32 df) { duration = df; jassertfalse; }
+
+void Shuttle::setLengthFrames (const uint32 df)
+{
+    duration = df;
+    updateLoopPositions();
+    invalidateBlock();
+}
+
+void Shuttle::setLooping (bool shouldLoop)
+{
+    looping = shouldLoop;
+    invalidateBlock();
+}
+
+void Shuttle::setLoopStartFrames (int64 frame)
+{
+    loopStart = jlimit ((int64) 0, (int64) duration, frame);
+    updateLoopPositions();
+    invalidateBlock();
+}
+
+int64 Shuttle::getLoopStartFrames() const { return loopStart; }
 
 void Shuttle::setTempo (float bpm)
 {
@@ -111,9 +198,29 @@ void Shuttle::setTempo (float bpm)
         beatsPerFrame  = 1.0f / framesPerBeat;
         framePos = llrint (oldTime * framesPerBeat);
         duration = (uint32) llrint (oldLen * framesPerBeat);
+        updateLoopPositions();
+        invalidateBlock();
+        tempoMapVersion.fetch_add (1, std::memory_order_release);
     }
 }
 
+void Shuttle::setTimeScale (const TimeScale& newScale)
+{
+    const double oldTime = getPositionSeconds();
+
+    ts.copyFrom (newScale);
+    ts.setSampleRate ((unsigned int) sampleRate);
+    ts.setTicksPerBeat (Shuttle::PPQ);
+    ts.updateScale();
+
+    framePos       = llrint (oldTime * sampleRate);
+    framesPerBeat  = Tempo::audioFramesPerBeat ((double) ts.getSampleRate(), ts.getTempo());
+    beatsPerFrame  = 1.0f / framesPerBeat;
+    updateLoopPositions();
+    invalidateBlock();
+    tempoMapVersion.fetch_add (1, std::memory_order_release);
+}
+
 void Shuttle::setSampleRate (double rate)
 {
     if (sampleRate == rate)
@@ -121,18 +228,188 @@ void Shuttle::setSampleRate (double rate)
 
     const double oldTime = getPositionSeconds();
     const double oldLenSec = (double) getLengthSeconds();
-    ts.setSampleRate (rate);
+    const double oldLoopStart = (double) loopStart / (double) ts.getSampleRate();
+    sampleRate = rate;
+    ts.setSampleRate ((unsigned int) rate);
     ts.updateScale();
 
     framePos        = llrint (oldTime * ts.getSampleRate());
     duration        = (uint32) (oldLenSec * (float) ts.getSampleRate());
+    loopStart       = jmin ((int64) duration, (int64) llrint (oldLoopStart * ts.getSampleRate()));
     framesPerBeat  = Tempo::audioFramesPerBeat (ts.getSampleRate(), ts.getTempo());
     beatsPerFrame  = 1.0f / framesPerBeat;
+    updateLoopPositions();
+    invalidateBlock();
+    tempoMapVersion.fetch_add (1, std::memory_order_release);
+}
+
+void Shuttle::setPlaying (bool shouldBePlaying)
+{
+    if (playing == shouldBePlaying)
+        return;
+    playing = shouldBePlaying;
+    invalidateBlock();
+}
+
+void Shuttle::setRecording (bool shouldRecord)
+{
+    if (recording == shouldRecord)
+        return;
+    recording = shouldRecord;
+    invalidateBlock();
+}
+
+void Shuttle::setPositionFrames (int64 frame)
+{
+    framePos = jmax ((int64) 0, frame);
+    wrapPending = false;
+    invalidateBlock();
+}
+
+void Shuttle::locate (int64 frame, int offset)
+{
+    locatePending = true;
+    locateReached = false;
+    locateFrame   = jmax ((int64) 0, frame);
+    locateOffset  = jmax (0, offset);
+    invalidateBlock();
+}
+
+void Shuttle::invalidateBlock()
+{
+    numSegments = currentSegment = 0;
+    preparedFrames = -1;
+}
+
+void Shuttle::updateLoopPositions()
+{
+    const double ppq = (double) ts.ticksPerBeat();
+    ppqLoopStart = (double) ts.tickFromFrame ((uint64) loopStart) / ppq;
+    ppqLoopEnd   = (double) ts.tickFromFrame ((uint64) duration) / ppq;
+}
+
+void Shuttle::addSegment (int offset, int numFrames, int64 frame, bool looped, bool located)
+{
+    Segment& segment (segments [numSegments++]);
+    segment.offset    = offset;
+    segment.numFrames = numFrames;
+    segment.frame     = frame;
+    segment.playing   = playing;
+    segment.recording = recording;
+    segment.looped    = looped;
+    segment.located   = located;
+
+    if (following)
+    {
+        segment.ppqPosition = external.ppqPosition;
+        segment.bpm         = external.bpm;
+        segment.beatsPerBar = external.timeSigNumerator;
+        return;
+    }
+
+    const TimeScale::Node* node = ts.getNodeAtFrame ((uint64) frame);
+    segment.ppqPosition = (double) ts.tickFromFrame ((uint64) frame) / (double) ts.ticksPerBeat();
+    segment.bpm         = node != nullptr ? (double) node->tempoAtFrame ((uint64) frame) : (double) ts.getTempo();
+    segment.beatsPerBar = node != nullptr ? (int) node->beatsPerBar : (int) ts.beatsPerBar();
+}
+
+int Shuttle::getBeatsPerBar() const
+{
+    const TimeScale::Node* node = ts.getNodeAtFrame ((uint64) framePos);
+    return node != nullptr ? (int) node->beatsPerBar : (int) ts.beatsPerBar();
+}
+
+int Shuttle::prepareBlock (int numFrames)
+{
+    if (numFrames == preparedFrames && framePos == preparedPosition)
+        return numSegments;
+
+    numSegments = currentSegment = 0;
+    preparedFrames = numFrames;
+    preparedPosition = framePos;
+    locateReached = false;
+
+    const int64 loopEnd = (int64) duration;
+    const int64 loopLength = loopEnd - loopStart;
+    const bool wraps = looping && ! following && loopLength > 0;
+    const bool locates = locatePending && locateOffset < numFrames;
+    const bool splits = playing && ! following;
+
+    int64 pos = framePos;
+    bool looped = wrapPending, located = false;
+    int offset = 0;
+
+    while (offset < numFrames)
+    {
+        if (locates && offset == locateOffset)
+        {
+            pos = locateFrame;
+            located = locateReached = true;
+        }
+
+        if (wraps && pos >= loopEnd)
+        {
+            pos = loopStart + (pos - loopStart) % loopLength;
+            looped = true;
+        }
+
+        int len = numFrames - offset;
+
+        // out of segments, the rest of the block is played as one
+        if (numSegments < maxSegments - 1)
+        {
+            if (locates && locateOffset > offset)
+                len = jmin (len, locateOffset - offset);
+
+            if (splits && wraps && pos < loopEnd)
+                len = (int) jmin ((int64) len, loopEnd - pos);
+
+            if (splits)
+            {
+                const TimeScale::Node* node = ts.getNodeAtFrame ((uint64) pos);
+                const TimeScale::Node* next = node != nullptr ? node->next() : nullptr;
+                if (next != nullptr && (int64) next->frame > pos && (int64) next->frame < pos + len)
+                    len = (int) ((int64) next->frame - pos);
+            }
+        }
+
+        addSegment (offset, len, pos, looped, located);
+        looped = located = false;
+        offset += len;
+        if (playing)
+            pos += len;
+    }
+
+    endPosition = pos;
+    return numSegments;
+}
+
+void Shuttle::setCurrentSegment (int index)
+{
+    currentSegment = jlimit (0, jmax (0, numSegments - 1), index);
 }
 
 void Shuttle::advance (int nframes)
 {
-    framePos += nframes;
-    if (duration > 0 && framePos >= duration)
-        framePos = framePos - duration;
+    prepareBlock (nframes);
+    framePos = endPosition;
+
+    // a wrap right at the end of the block, the next block's first
+    // segment is the one marked looped
+    const int64 loopLength = (int64) duration - loopStart;
+    wrapPending = looping && ! following && loopLength > 0 && framePos >= (int64) duration;
+    if (wrapPending)
+        framePos = loopStart + (framePos - loopStart) % loopLength;
+
+    // a locate inside the last segment, once they ran out, happens at the
+    // start of the next block instead of being lost
+    if (locatePending)
+    {
+        if (locateReached)
+            locatePending = false;
+        else
+            locateOffset = jmax (0, locateOffset - nframes);
+    }
+
+    invalidateBlock();
 }
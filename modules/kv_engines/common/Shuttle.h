@@ -19,7 +19,13 @@
 
 #pragma once
 
-/** A mini-transport for use in a processable that can loop */
+/** A mini-transport for use in a processable that can loop
+
+    Each block is split into segments at loop wraps, tempo changes and
+    locates, so everything in a segment moves continuously. A host calls
+    prepareBlock(), processes each segment (selecting it with
+    setCurrentSegment() so getCurrentPosition() reports it), then advance().
+    Loop wraps are sample accurate. */
 class Shuttle : public AudioPlayHead
 {
 public:
@@ -35,6 +41,23 @@ public:
         double timeInBeats;
     };
 
+    /** A part of a block over which the transport moves continuously */
+    struct Segment
+    {
+        int offset;             ///< first sample of the segment in the block
+        int numFrames;          ///< length of the segment
+        int64 frame;            ///< transport position at offset
+        double ppqPosition;     ///< position at offset in quarter notes
+        double bpm;             ///< tempo at offset, constant unless ramping
+        int beatsPerBar;        ///< meter throughout the segment
+        bool playing;
+        bool recording;
+        bool looped;            ///< starts at the loop start after a wrap
+        bool located;           ///< starts at a locate point
+    };
+
+    enum { maxSegments = 32 };
+
     Shuttle();
     ~Shuttle();
 
@@ -45,10 +68,16 @@ public:
     double getFramesPerBeat() const;
     double getBeatsPerFrame() const;
 
+    /** The length is the loop end */
     void setLengthBeats (const float beats);
     void setLengthFrames (const uint32 df);
     void setLengthSeconds (const double seconds);
 
+    /** Loop from the loop start to the length */
+    void setLooping (bool shouldLoop);
+    void setLoopStartFrames (int64 frame);
+    int64 getLoopStartFrames() const;
+
     const double getLengthBeats()    const;
     const int64  getLengthFrames()   const;
     const double getLengthSeconds()  const;
@@ -62,17 +91,69 @@ public:
     void resetRecording();
 
     const TimeScale& getTimeScale() const;
+
+    /** Replace the tempo map, e.g. with tempo and meter changes. The play
+        head keeps its time in seconds. Node frames are taken to be at the
+        shuttle's sample rate, and the ticks per beat stay the shuttle's.
+        Not realtime safe */
+    void setTimeScale (const TimeScale& newScale);
+
+    /** Goes up each time the tempo map changes, including changes taken
+        from an external transport, so anything timed against the map can
+        tell it needs re-timing. Realtime safe */
+    uint32 getTempoMapVersion() const { return tempoMapVersion.load (std::memory_order_acquire); }
+
     float getTempo() const;
     void setTempo (float bpm);
 
+    /** The meter at the play head */
+    int getBeatsPerBar() const;
+
     double getSampleRate() const;
     void setSampleRate (double rate);
     
+    /** Start or stop playback */
+    void setPlaying (bool shouldBePlaying);
+
+    /** Arm or disarm recording. Segments record while playing */
+    void setRecording (bool shouldRecord);
+
+    /** Move the play head */
+    void setPositionFrames (int64 frame);
+
+    /** Move the play head at a sample in the next block, or a later one if
+        offset is past its end. Call this from the processing thread */
+    void locate (int64 frame, int offset = 0);
+
+    /** Split the next block into segments. Calling this again for the same
+        block returns the same segments, unless the position or state changed
+        in between. Realtime safe */
+    int prepareBlock (int numFrames);
+
+    int getNumSegments() const { return numSegments; }
+    const Segment& getSegment (int index) const { return segments [index]; }
+
+    /** Makes getCurrentPosition() report a segment of the prepared block */
+    void setCurrentSegment (int index);
+
+    /** Move past a block, preparing it first if needed */
     void advance (int nframes);
     bool getCurrentPosition (CurrentPositionInfo &result);
 
+    /** Follow an external transport, e.g. JACK's.  Play state, position,
+        tempo and meter are taken from pos and getCurrentPosition() reports
+        it as given until stopFollowing() is called.  Call this once per
+        cycle before processing, it's realtime safe */
+    void follow (const CurrentPositionInfo& pos);
+
+    /** Go back to running from the internal position */
+    void stopFollowing();
+
+    /** True if following an external transport */
+    bool isFollowing() const;
+
 protected:
-    bool playing, recording, looping;
+    bool playing, recording, looping, following;
 
 private:
     double framesPerBeat;
@@ -80,9 +161,26 @@ private:
 
     int64 framePos;
     uint32 duration;
+    int64 loopStart;
     double sampleRate;
     kv::TimeScale ts;
+    std::atomic<uint32> tempoMapVersion;
 
     double ppqLoopStart;
     double ppqLoopEnd;
+
+    CurrentPositionInfo external;
+
+    Segment segments [maxSegments];
+    int numSegments, currentSegment, preparedFrames;
+    int64 preparedPosition, endPosition;
+
+    bool locatePending, locateReached;
+    bool wrapPending;       ///< the last block ended on a wrap, the next one starts looped
+    int64 locateFrame;
+    int locateOffset;
+
+    void invalidateBlock();
+    void updateLoopPositions();
+    void addSegment (int offset, int numFrames, int64 frame, bool looped, bool located);
 };
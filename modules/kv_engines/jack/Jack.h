@@ -24,6 +24,33 @@ class JackCallback;
 class JackClient;
 class JackPort;
 
+/** An audio callback which also gets JACK MIDI.  When used with the
+    JACK device, jackDeviceIOCallback is called instead of
+    audioDeviceIOCallback. Elsewhere it's called with empty MIDI */
+class JackDeviceCallback : public AudioIODeviceCallback
+{
+public:
+    JackDeviceCallback() { }
+    virtual ~JackDeviceCallback() { }
+
+    /** Process a period.  Audio buffers are JACK's own port buffers, and
+        events added to midiOut are written to the MIDI output port */
+    virtual void jackDeviceIOCallback (const float** inputs, int numInputs,
+                                       float** outputs, int numOutputs,
+                                       const MidiBuffer& midiIn, MidiBuffer& midiOut,
+                                       int numSamples) = 0;
+
+    void audioDeviceIOCallback (const float** inputs, int numInputs,
+                                float** outputs, int numOutputs, int numSamples) override
+    {
+        midiOut.clear();
+        jackDeviceIOCallback (inputs, numInputs, outputs, numOutputs, midiIn, midiOut, numSamples);
+    }
+
+private:
+    MidiBuffer midiIn, midiOut;
+};
+
 class Jack
 {
 public:
@@ -94,8 +121,8 @@ public:
 
     bool isInput()  const { return getFlags() & JackPortIsInput; }
     bool isOutput() const { return getFlags() & JackPortIsOutput; }
-    bool isAudio()  const { return true; }
-    bool isMidi()   const { return false; }
+    bool isAudio()  const { return std::strcmp (jack_port_type (port), JACK_DEFAULT_AUDIO_TYPE) == 0; }
+    bool isMidi()   const { return std::strcmp (jack_port_type (port), JACK_DEFAULT_MIDI_TYPE) == 0; }
 
     int connect (const JackPort& other) { return jack_connect (client, getName(), other.getName()); }
 
@@ -55,23 +55,40 @@ public:
         : AudioIODevice (deviceName, "JACK"),
           inputId (inId),
           outputId (outId),
-          callback (nullptr),
-          client (client_)
-    { }
+          client (client_),
+          midiInPort (nullptr),
+          midiOutPort (nullptr),
+          numActiveIns (0),
+          numActiveOuts (0)
+    {
+        zerostruct (slots);
+        currentSlot.set (0);
+        inCallback.set (0);
+    }
 
     ~JackDevice()
     {
         close();
     }
 
+    /** Names of the physical ports on the other end, empty if the client
+        isn't open */
     StringArray getChannelNames (bool forInput) const
     {
         StringArray names;
+        if (! client.isOpen())
+            return names;
+
+        client.getPorts (names, String(), Jack::audioPort,
+                         JackPortIsPhysical | (forInput ? JackPortIsOutput : JackPortIsInput));
+        for (int i = 0; i < names.size(); ++i)
+            names.set (i, names[i].fromFirstOccurrenceOf (":", false, false));
         return names;
     }
 
-    StringArray getOutputChannelNames()         { return getChannelNames (false); }
-    StringArray getInputChannelNames()          { return getChannelNames (true); }
+    // a client is needed to find the physical ports, so these open one
+    StringArray getOutputChannelNames()         { openClient(); return getChannelNames (false); }
+    StringArray getInputChannelNames()          { openClient(); return getChannelNames (true); }
     int getNumSampleRates()                     { return 1; }
     double getSampleRate (int /*index*/)        { return client.sampleRate(); }
     int getNumBufferSizesAvailable()            { return 1; }
@@ -81,55 +98,116 @@ public:
     String open (const BigInteger& inputChannels, const BigInteger& outputChannels,
                  double /* sampleRate */, int /* bufferSizeSamples */)
     {
+        // ports and buffers are only touched while the client is inactive
+        if (! inputPorts.isEmpty() || ! outputPorts.isEmpty())
+            close();
+
         jack_Log ("opening client");
-        lastError = client.open (KV_JACK_NAME, 0);
+        lastError = openClient();
         if (lastError.isNotEmpty())
         {
             jack_Log (lastError);
             return lastError;
         }
 
-        DBG("num inputs: " << inputChannels.getHighestBit());
-        DBG("num outputs: " << outputChannels.getHighestBit());
+        const StringArray inNames (getChannelNames (true));
+        const StringArray outNames (getChannelNames (false));
+        activeIns.clear();  activeIns.setRange (0, inNames.size(), false);
+        activeOuts.clear(); activeOuts.setRange (0, outNames.size(), false);
 
+        // a port is registered for every active channel, the process callback
+        // then gets JACK's own buffers for them
+        inputPorts.clearQuick();
+        for (int i = 0; i < inNames.size(); ++i)
+        {
+            if (! inputChannels [i])
+                continue;
 
-        jack_on_shutdown (client, JackDevice::shutdownCallback, this);
-        jack_set_error_function (JackDevice::errorCallback);
-        jack_set_port_connect_callback (client, JackDevice::portConnectCallback, this);
-        jack_set_process_callback (client, JackDevice::processCallback, this);
-        jack_set_thread_init_callback (client, JackDevice::threadInitCallback, this);
-        jack_set_port_registration_callback (client, JackDevice::_portRegistration, this);
+            jack_port_t* const port = client.registerPort (String ("in_") + String (i + 1), Jack::audioPort, JackPortIsInput);
+            if (port == nullptr)
+            {
+                jack_Log ("couldn't register input " + String (i + 1));
+                continue;
+            }
+
+            activeIns.setBit (i);
+            inputPorts.add (port);
+        }
+
+        outputPorts.clearQuick();
+        for (int i = 0; i < outNames.size(); ++i)
+        {
+            if (! outputChannels [i])
+                continue;
 
-        client.registerPort ("audio_1", Jack::audioPort, JackPortIsOutput);
-        client.registerPort ("audio_2", Jack::audioPort, JackPortIsOutput);
+            jack_port_t* const port = client.registerPort (String ("out_") + String (i + 1), Jack::audioPort, JackPortIsOutput);
+            if (port == nullptr)
+            {
+                jack_Log ("couldn't register output " + String (i + 1));
+                continue;
+            }
+
+            activeOuts.setBit (i);
+            outputPorts.add (port);
+        }
+
+        midiInPort  = client.registerPort ("midi_in", Jack::midiPort, JackPortIsInput);
+        midiOutPort = client.registerPort ("midi_out", Jack::midiPort, JackPortIsOutput);
+
+        updateActivePorts();
+
+        midiIn.clear();  midiIn.ensureSize (4096);
+        midiOut.clear(); midiOut.ensureSize (4096);
 
         return lastError;
     }
 
     void close()
     {
-        lastError = client.close();
+        // deactivate before tearing down, process() uses the ports and buffers
+        stop();
+        if (client.isOpen())
+            lastError = client.close();
+
+        inputPorts.clearQuick();
+        outputPorts.clearQuick();
+        midiInPort = midiOutPort = nullptr;
+        updateActivePorts();
     }
 
     void start (AudioIODeviceCallback* newCallback)
     {
-        if (client.isOpen() && newCallback != callback)
-        {
-            if (newCallback != nullptr)
-                newCallback->audioDeviceAboutToStart (this);
+        if (! client.isOpen())
+            return;
 
-            AudioIODeviceCallback* const oldCallback = callback;
-            {
-                const ScopedLock sl (callbackLock);
-                callback = newCallback;
+        const int current = currentSlot.get();
+        AudioIODeviceCallback* const oldCallback = slots[current].callback;
+        if (newCallback == oldCallback)
+            return;
 
-                if (callback != nullptr)
-                    client.activate();
-            }
+        if (newCallback != nullptr)
+            newCallback->audioDeviceAboutToStart (this);
+
+        // the next slot is filled in, then made current. Once the process
+        // callback is seen outside a cycle nothing refers to the old one
+        const int next = 1 - current;
+        slots[next].callback     = newCallback;
+        slots[next].jackCallback = dynamic_cast<JackDeviceCallback*> (newCallback);
+        currentSlot.set (next);
+
+        while (inCallback.get() != 0)
+            Thread::yield();
 
-            if (oldCallback != nullptr)
-                oldCallback->audioDeviceStopped();
+        if (newCallback != nullptr && oldCallback == nullptr && client.activate() == 0)
+        {
+            connectPhysicalPorts();
+            // the ports registered in open() only get their ranges once
+            // latencies are recomputed with the connections in place
+            jack_recompute_total_latencies (client);
         }
+
+        if (oldCallback != nullptr)
+            oldCallback->audioDeviceStopped();
     }
 
     void stop()
@@ -140,22 +218,19 @@ public:
     }
 
     bool isOpen()                           { return client.isOpen(); }
-    bool isPlaying()                        { return callback != nullptr; }
-
+    bool isPlaying()                        { return slots [currentSlot.get()].callback != nullptr; }
 
     Array<double> getAvailableSampleRates() override
     {
         Array<double> rates;
-        const double _rates[] = { 44100.0, 48000.0 };
-        rates.addArray(_rates, 2);
+        rates.add (client.sampleRate());
         return rates;
     }
 
     Array<int> getAvailableBufferSizes() override
     {
         Array<int> sizes;
-        const int _sizes[] = { 256, 512, 1024, 2048 };
-        sizes.addArray(_sizes, 4);
+        sizes.add (client.bufferSize());
         return sizes;
     }
 
@@ -166,19 +241,17 @@ public:
     int getCurrentBitDepth()                { return 32; }
     String getLastError()                   { return lastError; }
 
-    BigInteger getActiveOutputChannels() const { return 2; }
-    BigInteger getActiveInputChannels()  const { return 2; }
+    BigInteger getActiveOutputChannels() const { return activeOuts; }
+    BigInteger getActiveInputChannels()  const { return activeIns; }
 
     int getOutputLatencyInSamples()
     {
-        int latency = 0;
-        return latency;
+        return getPortLatency (outputPorts, JackPlaybackLatency);
     }
 
     int getInputLatencyInSamples()
     {
-        int latency = 0;
-        return latency;
+        return getPortLatency (inputPorts, JackCaptureLatency);
     }
 
     void portRegistration (jack_port_id_t port, const bool wasRegistered)
@@ -197,23 +270,162 @@ public:
     String inputId, outputId;
 
 private:
+    /** Opens the client if needed and sets up its callbacks */
+    String openClient()
+    {
+        if (client.isOpen())
+            return String();
+
+        const String error (client.open (KV_JACK_NAME, 0));
+        if (error.isNotEmpty())
+            return error;
+
+        jack_on_shutdown (client, JackDevice::shutdownCallback, this);
+        jack_set_error_function (JackDevice::errorCallback);
+        jack_set_port_connect_callback (client, JackDevice::portConnectCallback, this);
+        jack_set_process_callback (client, JackDevice::processCallback, this);
+        jack_set_thread_init_callback (client, JackDevice::threadInitCallback, this);
+        jack_set_port_registration_callback (client, JackDevice::_portRegistration, this);
+        jack_set_latency_callback (client, JackDevice::latencyCallback, this);
+        return String();
+    }
+
+    /** Connects each active channel's port to the physical port it's named after */
+    void connectPhysicalPorts()
+    {
+        StringArray physical;
+        client.getPorts (physical, String(), Jack::audioPort, JackPortIsPhysical | JackPortIsOutput);
+        for (int i = 0, port = 0; i < physical.size() && port < inputPorts.size(); ++i)
+            if (activeIns [i])
+                jack_connect (client, physical [i].toRawUTF8(), jack_port_name (inputPorts.getUnchecked (port++)));
+
+        client.getPorts (physical, String(), Jack::audioPort, JackPortIsPhysical | JackPortIsInput);
+        for (int i = 0, port = 0; i < physical.size() && port < outputPorts.size(); ++i)
+            if (activeOuts [i])
+                jack_connect (client, jack_port_name (outputPorts.getUnchecked (port++)), physical [i].toRawUTF8());
+    }
+
     void process (const int numSamples)
     {
-        const ScopedLock sl (callbackLock);
+        inCallback.set (1);
+        const CallbackSlot& slot (slots [currentSlot.get()]);
 
-        if (callback != nullptr)
+        for (int i = 0; i < numActiveIns; ++i)
+            inputBuffers[i] = (float*) jack_port_get_buffer (inputPorts.getUnchecked (i), (jack_nframes_t) numSamples);
+        for (int i = 0; i < numActiveOuts; ++i)
+            outputBuffers[i] = (float*) jack_port_get_buffer (outputPorts.getUnchecked (i), (jack_nframes_t) numSamples);
+
+        if (slot.callback == nullptr)
         {
+            for (int i = 0; i < numActiveOuts; ++i)
+                FloatVectorOperations::clear (outputBuffers[i], numSamples);
+            writeMidiOutput (numSamples, false);
+            inCallback.set (0);
+            return;
+        }
 
+        if (slot.jackCallback != nullptr)
+        {
+            readMidiInput (numSamples);
+            midiOut.clear();
+            slot.jackCallback->jackDeviceIOCallback ((const float**) inputBuffers.getData(), numActiveIns,
+                                                     outputBuffers.getData(), numActiveOuts,
+                                                     midiIn, midiOut, numSamples);
+            writeMidiOutput (numSamples, true);
         }
         else
         {
-
+            slot.callback->audioDeviceIOCallback ((const float**) inputBuffers.getData(), numActiveIns,
+                                                  outputBuffers.getData(), numActiveOuts, numSamples);
+            writeMidiOutput (numSamples, false);
         }
+
+        inCallback.set (0);
+    }
+
+    void readMidiInput (const int numSamples)
+    {
+        midiIn.clear();
+        if (midiInPort == nullptr)
+            return;
+
+        void* const buffer = jack_port_get_buffer (midiInPort, (jack_nframes_t) numSamples);
+        const jack_nframes_t numEvents = jack_midi_get_event_count (buffer);
+        jack_midi_event_t event;
+        for (jack_nframes_t i = 0; i < numEvents; ++i)
+            if (jack_midi_event_get (&event, buffer, i) == 0)
+                midiIn.addEvent (event.buffer, (int) event.size, (int) event.time);
+    }
+
+    void writeMidiOutput (const int numSamples, const bool hasEvents)
+    {
+        if (midiOutPort == nullptr)
+            return;
+
+        void* const buffer = jack_port_get_buffer (midiOutPort, (jack_nframes_t) numSamples);
+        jack_midi_clear_buffer (buffer);
+        if (! hasEvents)
+            return;
+
+        MidiBuffer::Iterator iter (midiOut);
+        const uint8* data = nullptr; int size = 0, frame = 0;
+        while (iter.getNextEvent (data, size, frame) && frame < numSamples)
+            jack_midi_event_write (buffer, (jack_nframes_t) frame, data, (size_t) size);
     }
 
+    /** Sizes the buffer pointer arrays, only call this while not processing */
     void updateActivePorts()
     {
+        numActiveIns  = inputPorts.size();
+        numActiveOuts = outputPorts.size();
+        inputBuffers.calloc ((size_t) jmax (1, numActiveIns));
+        outputBuffers.calloc ((size_t) jmax (1, numActiveOuts));
+    }
+
+    /** Returns the largest latency of the ports in samples */
+    static int getPortLatency (const Array<jack_port_t*>& ports, jack_latency_callback_mode_t mode)
+    {
+        jack_nframes_t latency = 0;
+        for (jack_port_t* port : ports)
+        {
+            if (port == nullptr)
+                continue;
+
+            jack_latency_range_t range;
+            jack_port_get_latency_range (port, mode, &range);
+            latency = jmax (latency, range.max);
+        }
 
+        return static_cast<int> (latency);
+    }
+
+    /** Passes latency through from inputs to outputs, so clients downstream
+        (or upstream for playback) see the whole path's latency */
+    void updateLatency (jack_latency_callback_mode_t mode)
+    {
+        const Array<jack_port_t*>& sources (mode == JackCaptureLatency ? inputPorts : outputPorts);
+        const Array<jack_port_t*>& dests   (mode == JackCaptureLatency ? outputPorts : inputPorts);
+
+        jack_latency_range_t range = { 0, 0 };
+        for (jack_port_t* port : sources)
+        {
+            if (port == nullptr)
+                continue;
+
+            jack_latency_range_t portRange;
+            jack_port_get_latency_range (port, mode, &portRange);
+            range.min = jmax (range.min, portRange.min);
+            range.max = jmax (range.max, portRange.max);
+        }
+
+        for (jack_port_t* port : dests)
+            if (port != nullptr)
+                jack_port_set_latency_range (port, mode, &range);
+    }
+
+    static void latencyCallback (jack_latency_callback_mode_t mode, void* arg)
+    {
+        ((JackDevice*) arg)->updateLatency (mode);
     }
 
     static int processCallback (jack_nframes_t nframes, void* arg)
@@ -255,8 +467,23 @@ private:
     JackClient& client;
 
     String lastError;
-    AudioIODeviceCallback* callback;
-    CriticalSection callbackLock;
+
+    struct CallbackSlot
+    {
+        AudioIODeviceCallback* callback;
+        JackDeviceCallback* jackCallback;
+    };
+
+    CallbackSlot slots[2];
+    Atomic<int> currentSlot, inCallback;
+
+    Array<jack_port_t*> inputPorts, outputPorts;
+    jack_port_t* midiInPort;
+    jack_port_t* midiOutPort;
+    BigInteger activeIns, activeOuts;
+    int numActiveIns, numActiveOuts;
+    HeapBlock<float*> inputBuffers, outputBuffers;
+    MidiBuffer midiIn, midiOut;
 };
 
 class JackDeviceType  : public AudioIODeviceType
@@ -0,0 +1,150 @@
+/*
+    This file is part of the Kushview Modules for JUCE
+    Copyright (C) 2014-2017  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+JackTransport::JackTransport (JackClient& c)
+    : client (c),
+      state (JackTransportStopped),
+      master (false),
+      scale (new TimeScale()),
+      pendingScale (new TimeScale())
+{
+    zerostruct (position);
+    scaleChanged.set (0);
+}
+
+JackTransport::~JackTransport()
+{
+    releaseTimebase();
+}
+
+jack_transport_state_t JackTransport::query()
+{
+    state = jack_transport_query (client, &position);
+    return state;
+}
+
+void JackTransport::process (Shuttle& shuttle)
+{
+    query();
+    AudioPlayHead::CurrentPositionInfo info;
+    getCurrentPosition (info);
+    shuttle.follow (info);
+}
+
+void JackTransport::getCurrentPosition (AudioPlayHead::CurrentPositionInfo& result) const
+{
+    result.resetToDefault();
+    result.isPlaying     = isRolling();
+    result.timeInSamples = (int64) position.frame;
+    result.timeInSeconds = position.frame_rate > 0
+        ? (double) position.frame / (double) position.frame_rate : 0.0;
+
+    if ((position.valid & JackPositionBBT) == 0 || position.ticks_per_beat <= 0.0)
+    {
+        result.ppqPosition = result.timeInSeconds * (result.bpm / 60.0);
+        return;
+    }
+
+    // JACK beats are in beat_type units, JUCE ppq is in quarter notes
+    const double quartersPerBeat = position.beat_type > 0.0f ? 4.0 / (double) position.beat_type : 1.0;
+    const double beatsPerBar = (double) position.beats_per_bar;
+    const double barStart = (position.bar_start_tick > 0.0 || position.bar <= 1)
+        ? position.bar_start_tick / position.ticks_per_beat
+        : (double) (position.bar - 1) * beatsPerBar;
+
+    result.bpm                = position.beats_per_minute;
+    result.timeSigNumerator   = roundToInt (position.beats_per_bar);
+    result.timeSigDenominator = roundToInt (position.beat_type);
+    result.ppqPositionOfLastBarStart = barStart * quartersPerBeat;
+    result.ppqPosition = result.ppqPositionOfLastBarStart
+        + ((double) (position.beat - 1) + (double) position.tick / position.ticks_per_beat) * quartersPerBeat;
+}
+
+void JackTransport::start()                  { jack_transport_start (client); }
+void JackTransport::stop()                   { jack_transport_stop (client); }
+void JackTransport::locate (int64 frame)     { jack_transport_locate (client, (jack_nframes_t) jmax ((int64) 0, frame)); }
+
+bool JackTransport::setTimebaseMaster (bool conditional)
+{
+    if (master)
+        return true;
+    master = client.isOpen() &&
+        jack_set_timebase_callback (client, conditional ? 1 : 0, JackTransport::timebaseCallback, this) == 0;
+    return master;
+}
+
+void JackTransport::releaseTimebase()
+{
+    if (! master)
+        return;
+    if (client.isOpen())
+        jack_release_timebase (client);
+    master = false;
+}
+
+void JackTransport::setTimeScale (const TimeScale& newScale)
+{
+    const SpinLock::ScopedLockType sl (scaleLock);
+    pendingScale->copyFrom (newScale);
+    if (client.isOpen())
+        pendingScale->setSampleRate ((unsigned int) client.sampleRate());
+    pendingScale->updateScale();
+    scaleChanged.set (1);
+}
+
+void JackTransport::updateTimebase (jack_position_t* pos)
+{
+    if (scaleChanged.get() != 0)
+    {
+        const SpinLock::ScopedTryLockType sl (scaleLock);
+        if (sl.isLocked())
+        {
+            scale.swapWith (pendingScale);
+            scale->cursor().reset();
+            scaleChanged.set (0);
+        }
+    }
+
+    const uint64 frame = (uint64) pos->frame;
+    const TimeScale::Node* node = scale->cursor().seekFrame (frame);
+    if (node == nullptr || node->ticksPerBeat == 0)
+        return;
+
+    const uint64 tick       = node->tickFromFrame (frame);
+    const unsigned int bar = node->barFromTick (tick);
+    const unsigned int beat = node->beatFromTick (tick);
+
+    pos->valid            = (jack_position_bits_t) (pos->valid | JackPositionBBT);
+    pos->bar              = (int32_t) bar + 1;
+    pos->beat             = (int32_t) (beat - node->beatFromBar (bar)) + 1;
+    pos->tick             = (int32_t) (tick - node->tickFromBeat (beat));
+    pos->bar_start_tick   = (double) node->tickFromBar (bar);
+    pos->beats_per_bar    = (float) node->beatsPerBar;
+    pos->beat_type        = (float) (1 << node->beatDivisor);
+    pos->ticks_per_beat   = (double) node->ticksPerBeat;
+    pos->beats_per_minute = (double) node->tempo;
+}
+
+void JackTransport::timebaseCallback (jack_transport_state_t, jack_nframes_t,
+                                      jack_position_t* pos, int, void* arg)
+{
+    // BBT is derived from the frame every cycle, so a relocation needs no
+    // special handling here
+    ((JackTransport*) arg)->updateTimebase (pos);
+}
@@ -0,0 +1,87 @@
+/*
+    This file is part of the Kushview Modules for JUCE
+    Copyright (C) 2014-2017  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#ifndef EL_JACK_TRANSPORT_H
+#define EL_JACK_TRANSPORT_H
+
+/** Bridges JACK's transport with a Shuttle.
+
+    Call process() (or query()) once per cycle from the JACK process thread,
+    before anything reads the shuttle.  Nothing there allocates or locks.
+
+    The client can also become timebase master, in which case BBT is filled
+    in for all JACK clients from the tempo map given to setTimeScale().
+ */
+class JackTransport
+{
+public:
+    explicit JackTransport (JackClient& client);
+    ~JackTransport();
+
+    /** Query JACK's transport for this cycle. Realtime safe */
+    jack_transport_state_t query();
+
+    /** Query, then make the shuttle follow JACK. Realtime safe */
+    void process (Shuttle& shuttle);
+
+    /** Fill in position info from the last query() */
+    void getCurrentPosition (AudioPlayHead::CurrentPositionInfo& result) const;
+
+    /** The raw position from the last query() */
+    const jack_position_t& getPosition() const { return position; }
+
+    /** True if the transport was rolling at the last query() */
+    bool isRolling() const { return state == JackTransportRolling; }
+
+    void start();
+    void stop();
+    void locate (int64 frame);
+
+    /** Become timebase master. If conditional is true, this fails when
+        some other client is already master */
+    bool setTimebaseMaster (bool conditional = false);
+
+    /** Stop being timebase master */
+    void releaseTimebase();
+
+    bool isTimebaseMaster() const { return master; }
+
+    /** Set the tempo map used for BBT while timebase master.  This is NOT
+        realtime safe, the process thread picks up the new map on the next
+        cycle it can do so without waiting */
+    void setTimeScale (const TimeScale& scale);
+
+private:
+    JackClient& client;
+    jack_position_t position;
+    jack_transport_state_t state;
+    bool master;
+
+    ScopedPointer<TimeScale> scale, pendingScale;
+    Atomic<int> scaleChanged;
+    SpinLock scaleLock;
+
+    void updateTimebase (jack_position_t* pos);
+    static void timebaseCallback (jack_transport_state_t, jack_nframes_t,
+                                  jack_position_t*, int, void*);
+
+    JUCE_DECLARE_NON_COPYABLE (JackTransport)
+};
+
+#endif /* EL_JACK_TRANSPORT_H */
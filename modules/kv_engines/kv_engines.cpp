@@ -21,12 +21,19 @@
 
 namespace kv {
 
+#include "common/CompiledMidiSequence.cpp"
+#include "common/GraphProcessor.cpp"
+#include "common/MidiRecorder.cpp"
 #include "common/MidiSequencePlayer.cpp"
+#include "common/MidiSequencer.cpp"
 #include "common/Processor.cpp"
 #include "common/Shuttle.cpp"
 
 #if KV_JACK_AUDIO
  #include "jack/JackClient.cpp"
  #include "jack/JackDevice.cpp"
+ #include "jack/JackTransport.cpp"
 #endif
+
+#include "common/OfflineRenderer.cpp"
 }
@@ -51,18 +51,28 @@
 #if KV_JACK_AUDIO
  #include <vector>
  #include <jack/jack.h>
+ #include <jack/midiport.h>
 #endif
 
 namespace kv {
 
 #include "common/Processor.h"
+#include "common/GraphProcessor.h"
+#include "common/CompiledMidiSequence.h"
+#include "common/NoteTracker.h"
+#include "common/MidiRecorder.h"
 #include "common/MidiSequencePlayer.h"
 #include "common/Shuttle.h"
+#include "common/MidiSequencer.h"
 
 #if KV_JACK_AUDIO
  #include "jack/Jack.h"
+ #include "jack/JackTransport.h"
 #endif
 
+#include "common/DeviceClockCallback.h"
+#include "common/OfflineRenderer.h"
+
 }
 
 #endif   // KV_MODELS_H_INCLUDED
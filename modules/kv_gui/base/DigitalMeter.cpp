@@ -33,10 +33,19 @@ DigitalMeterValue::DigitalMeterValue (DigitalMeter* parent)
     value (0.0f),
     valueHold (0),
     valueDecay (DIGITAL_METER_DECAY_RATE1),
+    level (0),
     peak (0),
     peakHold (0),
     peakDecay (DIGITAL_METER_DECAY_RATE2),
-    peakColor (DigitalMeter::Color6dB)
+    peakColor (DigitalMeter::Color6dB),
+    rms (0.0f),
+    hold (0.0f),
+    hasRmsAndHold (false),
+    rmsLevel (0),
+    drawnLevel (0),
+    drawnPeak (0),
+    drawnPeakColor (DigitalMeter::Color6dB),
+    drawnRms (0)
 { }
 
 DigitalMeterValue::~DigitalMeterValue() { }
@@ -44,58 +53,57 @@ DigitalMeterValue::~DigitalMeterValue() { }
 void DigitalMeterValue::setValue (const float newValue)
 {
     value = newValue;
+    hasRmsAndHold = false;
 }
 
-void DigitalMeterValue::resetPeak()
+void DigitalMeterValue::setValues (const float newValue, const float newRms, const float newHold)
 {
-    peak = 0;
+    value = newValue;
+    rms   = newRms;
+    hold  = newHold;
+    hasRmsAndHold = true;
 }
 
-void DigitalMeterValue::refresh()
+void DigitalMeterValue::resetPeak()
 {
-    if (value > 0.001f || peak > 0)
-        repaint();
+    peak = 0;
 }
 
-
 int DigitalMeterValue::getIECScale(const float dB)  const { return meter->getIECScale(dB); }
 int DigitalMeterValue::getIECLevel(const int index) const { return meter->getIECLevel(index); }
 
-void DigitalMeterValue::paint (Graphics& g)
+static float getMeterDecibels (const float gain)
 {
-    const bool vertical = meter->isVertical();
-
-    const int w = getWidth();
-    const int h = getHeight();
-    int level = 0;
-
-    if (isEnabled())
-    {
-        g.setColour (meter->color (DigitalMeter::ColorBack));
-        g.fillRect (0, 0, w, h);
-
-        level = meter->getIECLevel (DigitalMeter::Color0dB);
-
-        g.setColour (meter->color (DigitalMeter::ColorFore));
-        (vertical) ? g.drawLine (0, h - level, w, h - level)
-                   : g.drawLine (level, 0, level, h);
-    }
-    else
-    {
-        g.setColour (Colours::black);
-        g.fillRect (0, 0, w, h);
-    }
-
     float dB = DIGITAL_METER_MIN_DB;
-    if (value > 0.0f)
-        dB = 20.0f * log10f (value);
+    if (gain > 0.0f)
+        dB = 20.0f * log10f (gain);
 
     if (dB < DIGITAL_METER_MIN_DB)
         dB = DIGITAL_METER_MIN_DB;
     else if (dB > DIGITAL_METER_MAX_DB)
         dB = DIGITAL_METER_MAX_DB;
 
-    level = meter->getIECScale (dB);
+    return dB;
+}
+
+int DigitalMeterValue::getColorForLevel (const int pos) const
+{
+    // the colour of the highest segment reached
+    int ptOver = 0;
+    int colorLevel;
+    for (colorLevel = DigitalMeter::Color10dB;
+         colorLevel > DigitalMeter::ColorOver && pos >= ptOver;
+         colorLevel--)
+    {
+        ptOver = getIECLevel (colorLevel);
+    }
+
+    return colorLevel;
+}
+
+bool DigitalMeterValue::refresh()
+{
+    level = getIECScale (getMeterDecibels (value));
     if (valueHold < level)
     {
         valueHold = level;
@@ -115,80 +123,52 @@ void DigitalMeterValue::paint (Graphics& g)
         }
     }
 
-    int ptOver = 0;
-    int ptCurr = 0;
-    int colorLevel;
-    for (colorLevel = DigitalMeter::Color10dB;
-         colorLevel > DigitalMeter::ColorOver && level >= ptOver;
-         colorLevel--)
+    if (hasRmsAndHold)
     {
-        ptCurr = meter->getIECLevel (colorLevel);
-
-//        g.setColour (m_pMeter->color (iLevel));
-
-        if (vertical) {
-            g.setGradientFill (ColourGradient (meter->color (colorLevel), 0, h - ptOver,
-                                               meter->color (colorLevel-1), 0, h - ptCurr,
-                                               false));
-        } else {
-            g.setGradientFill (ColourGradient (meter->color (colorLevel), ptOver, 0,
-                                               meter->color (colorLevel - 1), ptCurr, 0,
-                                               false));
-        }
-
-        if (level < ptCurr) {
-            (vertical) ? g.fillRect (0, h - level, w, level - ptOver)
-                       : g.fillRect (ptOver, 0, level - ptOver, h);
-        } else {
-            (vertical) ? g.fillRect (0, h - ptCurr, w, ptCurr - ptOver)
-                       : g.fillRect (ptCurr, 0, ptCurr - ptOver, h);
-        }
-
-        ptOver = ptCurr;
-    }
-
-    if (level > ptOver)
-    {
-        g.setColour (meter->color (DigitalMeter::ColorOver));
-        (level) ? g.fillRect (0, h - level, w, level - ptOver)
-                : g.fillRect (level, 0, level - ptOver, h);
+        // the source holds peaks itself
+        rmsLevel  = jmin (level, getIECScale (getMeterDecibels (rms)));
+        peak      = jmax (level, getIECScale (getMeterDecibels (hold)));
+        peakColor = getColorForLevel (peak);
     }
-
-    if (peak < level)
+    else if (peak < level)
     {
-        peak = level;
-        peakHold = 0;
+        rmsLevel  = level;
+        peak      = level;
+        peakHold  = 0;
         peakDecay = DIGITAL_METER_DECAY_RATE2;
-        peakColor = colorLevel;
+        peakColor = getColorForLevel (level);
     }
     else if (++peakHold > meter->getPeakFalloff())
     {
+        rmsLevel = level;
         peak = int (float (peak * peakDecay));
         if (peak < level) {
             peak = level;
         } else {
-            if (peak < meter->getIECLevel (DigitalMeter::Color10dB))
+            if (peak < getIECLevel (DigitalMeter::Color10dB))
                 peakColor = DigitalMeter::Color6dB;
             peakDecay *= peakDecay;
         }
     }
+    else
+    {
+        rmsLevel = level;
+    }
 
-    g.setColour (meter->color (peakColor));
-    (vertical) ? g.drawLine (0, h - peak, w, h - peak)
-               : g.drawLine (peak, 0, peak, h);
-}
-
-void DigitalMeterValue::resized()
-{
-    peak = 0;
+    return level != drawnLevel || peak != drawnPeak || peakColor != drawnPeakColor
+        || rmsLevel != drawnRms;
 }
 
 DigitalMeter::DigitalMeter (const int numPorts, bool _horizontal)
-  : portCount (numPorts), // FIXME: Default port count.
-    values (nullptr),
+  : portCount (jmax (0, numPorts)),
     scale (0.0f),
     peakFalloff (DIGITAL_METER_PEAK_FALLOFF),
-    horizontal (_horizontal)
+    horizontal (_horizontal),
+    portSize (0),
+    length (0),
+    bus (nullptr),
+    firstBusMeter (0),
+    refreshRate (0)
 {
     getLookAndFeel().setColour (DigitalMeter::levelOverColourId, Colours::yellow.darker());
     getLookAndFeel().setColour (DigitalMeter::level0dBColourId, Colours::whitesmoke);
@@ -212,27 +192,22 @@ DigitalMeter::DigitalMeter (const int numPorts, bool _horizontal)
 
 DigitalMeter::~DigitalMeter()
 {
-    for (int port = 0; port < portCount; port++)
-        delete values[port];
-    delete[] values;
+    stopTimer();
+    values.clear();
+}
+
+void DigitalMeter::createValues()
+{
+    // created on first use, since createDigitalMeterValue() is virtual
+    while (values.size() < portCount)
+        values.add (createDigitalMeterValue());
 }
 
 void DigitalMeter::resized()
 {
-    if (values == nullptr)
-    {
-        if (portCount > 0)
-        {
-            values = new DigitalMeterValue* [portCount];
-            for (int port = 0; port < portCount; port++)
-            {
-                values[port] = createDigitalMeterValue();
-                addAndMakeVisible (values[port]);
-            }
-        }
-    }
+    createValues();
 
-    const int length = horizontal ? getWidth() : getHeight();
+    length = horizontal ? getWidth() : getHeight();
     scale = 0.85f * (float) length;
 
     levels[Color0dB]  = getIECScale (0.0f);
@@ -240,24 +215,193 @@ void DigitalMeter::resized()
     levels[Color6dB]  = getIECScale (-6.0f);
     levels[Color10dB] = getIECScale (-10.0f);
 
-    const int size = (horizontal ? getHeight() : getWidth()) / portCount;
+    portSize = portCount > 0 ? (horizontal ? getHeight() : getWidth()) / portCount : 0;
+    renderCaches();
+}
 
-    for (int port = 0; port < portCount; ++port)
+void DigitalMeter::renderCaches()
+{
+    if (length <= 0 || portSize <= 0)
     {
-        if (horizontal)
-            values[port]->setBounds (0, port * size, getWidth(), size);
-        else
-            values[port]->setBounds (port * size, 0, size, getHeight());
+        strip = bar = dim = back = Image();
+        return;
+    }
+
+    const int w = horizontal ? length : portSize;
+    const int h = horizontal ? portSize : length;
+    const bool vertical = isVertical();
+
+    // background with the 0dB line
+    back = Image (Image::ARGB, w, h, true, SoftwareImageType());
+    {
+        Graphics g (back);
+        g.setColour (color (ColorBack));
+        g.fillRect (0, 0, w, h);
+
+        const int zero = getIECLevel (Color0dB);
+        g.setColour (color (ColorFore));
+        (vertical) ? g.drawLine (0, h - zero, w, h - zero)
+                   : g.drawLine (zero, 0, zero, h);
+    }
+
+    // a meter at full scale, any level is a slice of it
+    bar = Image (Image::ARGB, w, h, true, SoftwareImageType());
+    {
+        Graphics g (bar);
+        g.setColour (color (ColorBack));
+        g.fillRect (0, 0, w, h);
+
+        int ptOver = 0;
+        for (int colorLevel = Color10dB; colorLevel > ColorOver && length >= ptOver; --colorLevel)
+        {
+            const int ptCurr = jmin (length, getIECLevel (colorLevel));
+
+            if (vertical) {
+                g.setGradientFill (ColourGradient (color (colorLevel), 0, h - ptOver,
+                                                   color (colorLevel - 1), 0, h - ptCurr,
+                                                   false));
+                g.fillRect (0, h - ptCurr, w, ptCurr - ptOver);
+            } else {
+                g.setGradientFill (ColourGradient (color (colorLevel), ptOver, 0,
+                                                   color (colorLevel - 1), ptCurr, 0,
+                                                   false));
+                g.fillRect (ptOver, 0, ptCurr - ptOver, h);
+            }
+
+            ptOver = ptCurr;
+        }
+
+        if (length > ptOver)
+        {
+            g.setColour (color (ColorOver));
+            (vertical) ? g.fillRect (0, h - length, w, length - ptOver)
+                       : g.fillRect (ptOver, 0, length - ptOver, h);
+        }
+    }
+
+    // the bar faded, drawn between the RMS and the level
+    dim = Image (Image::ARGB, w, h, true, SoftwareImageType());
+    {
+        Graphics g (dim);
+        g.setColour (color (ColorBack));
+        g.fillRect (0, 0, w, h);
+        g.setOpacity (0.4f);
+        g.drawImageAt (bar, 0, 0);
     }
+
+    strip = Image (Image::ARGB, getWidth(), getHeight(), true, SoftwareImageType());
+    for (int port = 0; port < values.size(); ++port)
+        drawPort (port, *values.getUnchecked (port), 0, length);
+
+    repaint();
 }
 
-void DigitalMeter::paint (Graphics&)
+Rectangle<int> DigitalMeter::getSpan (int port, int from, int to) const
 {
-/*
-    g.drawBevel (0, 0, getWidth(), getHeight(), 1,
-                 Colours::black.withAlpha(0.2f),
-                 Colours::white.withAlpha(0.2f));
-*/
+    return horizontal ? Rectangle<int> (from, port * portSize, to - from, portSize)
+                      : Rectangle<int> (port * portSize, length - to, portSize, to - from);
+}
+
+static void copyImageArea (const Image& source, const Rectangle<int>& area, Image& dest, Point<int> destPos)
+{
+    if (area.isEmpty())
+        return;
+
+    const Image::BitmapData src (source, area.getX(), area.getY(), area.getWidth(), area.getHeight(),
+                                 Image::BitmapData::readOnly);
+    Image::BitmapData dst (dest, destPos.x, destPos.y, area.getWidth(), area.getHeight(),
+                           Image::BitmapData::writeOnly);
+
+    for (int y = 0; y < area.getHeight(); ++y)
+        memcpy (dst.getLinePointer (y), src.getLinePointer (y), (size_t) (area.getWidth() * src.pixelStride));
+}
+
+Rectangle<int> DigitalMeter::drawPort (int port, DigitalMeterValue& value, int from, int to)
+{
+    from = jlimit (0, length, from);
+    to   = jlimit (from, length, to);
+
+    if (from < to)
+    {
+        // bar up to the RMS, faded bar up to the level, background after it
+        const int rmsSplit   = jlimit (from, to, value.rmsLevel);
+        const int levelSplit = jlimit (rmsSplit, to, value.level);
+        copyImageArea (bar,  getSpan (0, from, rmsSplit),        strip, getSpan (port, from, rmsSplit).getPosition());
+        copyImageArea (dim,  getSpan (0, rmsSplit, levelSplit),  strip, getSpan (port, rmsSplit, levelSplit).getPosition());
+        copyImageArea (back, getSpan (0, levelSplit, to),        strip, getSpan (port, levelSplit, to).getPosition());
+
+        const int peakPos = jmin (value.peak, length) - 1;
+        if (peakPos >= from && peakPos < to)
+            strip.clear (getSpan (port, peakPos, peakPos + 1), color (value.peakColor));
+    }
+
+    value.drawnLevel     = value.level;
+    value.drawnPeak      = value.peak;
+    value.drawnPeakColor = value.peakColor;
+    value.drawnRms       = value.rmsLevel;
+    return from < to ? getSpan (port, from, to) : Rectangle<int>();
+}
+
+void DigitalMeter::paint (Graphics& g)
+{
+    if (! isEnabled())
+    {
+        g.fillAll (Colours::black);
+        return;
+    }
+
+    if (strip.isValid())
+        g.drawImageAt (strip, 0, 0);
+}
+
+void DigitalMeter::enablementChanged()
+{
+    repaint();
+}
+
+void DigitalMeter::visibilityChanged()
+{
+    updateTimer();
+}
+
+void DigitalMeter::parentHierarchyChanged()
+{
+    updateTimer();
+}
+
+void DigitalMeter::updateTimer()
+{
+    if (refreshRate > 0 && isShowing())
+    {
+        if (! isTimerRunning())
+            startTimerHz (refreshRate);
+    }
+    else
+    {
+        stopTimer();
+    }
+}
+
+void DigitalMeter::timerCallback()
+{
+    refresh();
+}
+
+void DigitalMeter::setRefreshRate (int framesPerSecond)
+{
+    refreshRate = jmax (0, framesPerSecond);
+    stopTimer();
+    updateTimer();
+}
+
+void DigitalMeter::setMeterBus (const MeterBus* newBus, int firstMeter)
+{
+    bus = newBus;
+    firstBusMeter = jmax (0, firstMeter);
+    busSlots.allocate ((size_t) jmax (1, portCount), true);
+
+    if (bus != nullptr && refreshRate <= 0)
+        setRefreshRate (60);
 }
 
 DigitalMeterValue* DigitalMeter::createDigitalMeterValue()
@@ -298,18 +442,48 @@ int DigitalMeter::getPeakFalloff() const { return peakFalloff; }
 
 void DigitalMeter::resetPeaks()
 {
+    createValues();
     for (int iPort = 0; iPort < portCount; iPort++)
         values[iPort]->resetPeak();
 }
 
 void DigitalMeter::refresh()
 {
+    createValues();
+
+    if (bus != nullptr)
+    {
+        // one read for every port
+        const int numToRead = jmin (portCount, bus->getNumMeters() - firstBusMeter);
+        if (numToRead > 0)
+        {
+            bus->read (busSlots, firstBusMeter, numToRead);
+            for (int port = 0; port < numToRead; ++port)
+                values[port]->setValues (busSlots[port].peak, busSlots[port].rms, busSlots[port].hold);
+        }
+    }
+
+    Rectangle<int> dirty;
     for (int port = 0; port < portCount; ++port)
-        values[port]->refresh();
+    {
+        DigitalMeterValue& value (*values.getUnchecked (port));
+        if (! value.refresh() || strip.isNull())
+            continue;
+
+        // what moved: the bar between the old and new RMS and levels, and
+        // both peaks. The RMS is never above the level
+        const int from = jmin (jmin (value.rmsLevel, value.drawnRms), jmin (value.peak, value.drawnPeak) - 1);
+        const int to   = jmax (jmax (value.level, value.drawnLevel), jmax (value.peak, value.drawnPeak));
+        dirty = dirty.getUnion (drawPort (port, value, from, to));
+    }
+
+    if (! dirty.isEmpty())
+        repaint (dirty);
 }
 
 void DigitalMeter::setValue (const int port, const float value)
 {
+    createValues();
     if (isPositiveAndBelow (port, portCount))
         values[port]->setValue (value);
 }
@@ -23,27 +23,30 @@
 class DigitalMeter;
 class DigitalMeterValue;
 
-/** Creates VU meters with scale in decibels */
-class DigitalMeterValue : public Component
+/** The level and peak of one port of a DigitalMeter, with VU ballistics
+
+    This isn't a Component, the meter draws every port itself */
+class DigitalMeterValue
 {
 public:
-    DigitalMeterValue(DigitalMeter *pMeter);
-    ~DigitalMeterValue();
+    DigitalMeterValue (DigitalMeter *pMeter);
+    virtual ~DigitalMeterValue();
 
     /** Frame value accessors. */
-    void setValue(const float newValue);
+    void setValue (const float newValue);
 
-    /** Value refreshment. */
-    void refresh();
+    /** Set the level along with its RMS and held peak, e.g. from a MeterBus.
+        The RMS is drawn solid under a faded level, and the hold replaces
+        the peak's own fall-off */
+    void setValues (const float newValue, const float newRms, const float newHold);
+
+    /** Advance the ballistics by a frame.
+        @returns true if the bar or peak needs drawing again */
+    bool refresh();
 
     /** Reset peak holder. */
     void resetPeak();
 
-    virtual void paint(Graphics& g);
-
-    /** @internal */
-    void resized();
-
 protected:
     int getIECScale (const float dB) const;
     int getIECLevel (const int index) const;
@@ -59,16 +62,34 @@ private:
     float value;
     int   valueHold;
     float valueDecay;
+    int   level;
     int   peak;
     int   peakHold;
     float peakDecay;
     int   peakColor;
+    float rms, hold;
+    bool  hasRmsAndHold;
+    int   rmsLevel;
+
+    // what's in the meter's image
+    int drawnLevel, drawnPeak, drawnPeakColor, drawnRms;
+
+    int getColorForLevel (const int pos) const;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DigitalMeterValue)
 };
 
 
-/** Creates VU meters with scale in decibels */
-class DigitalMeter : public Component
+/** Creates VU meters with scale in decibels
+
+    Every port is drawn into one cached image. A refresh only redraws the
+    part of a port between its old and new level and peak, by copying from
+    a full bar and a background rendered once per size, then repaints the
+    area that changed. With a MeterBus attached, levels are read once per
+    refresh, paced by a timer at the display's frame rate while showing.
+ */
+class DigitalMeter : public Component,
+                     private Timer
 {
 public:
     DigitalMeter (const int numPorts, bool horizontal = false);
@@ -81,9 +102,21 @@ public:
     int getIECLevel (const int index) const;
     void setPeakFalloff (const int newPeakFalloff);
     int getPeakFalloff() const;
+
+    /** Advance the meters and repaint what changed. Called by the timer if
+        there's a refresh rate, otherwise call it regularly */
     void refresh();
     void resetPeaks();
 
+    /** Read port levels from meters of a bus, starting at firstMeter, on
+        each refresh. The bus isn't owned. Pass nullptr to stop */
+    void setMeterBus (const MeterBus* bus, int firstMeter = 0);
+
+    /** Refresh this many times a second while showing, 0 to stop. Defaults
+        to 0, or 60 once a MeterBus is set */
+    void setRefreshRate (int framesPerSecond);
+    int getRefreshRate() const { return refreshRate; }
+
     bool isHorizontal() const { return horizontal; }
     bool isVertical()   const { return ! horizontal; }
 
@@ -113,9 +146,15 @@ public:
     };
 
     /** @internal */
-    void paint (Graphics& g);
+    void paint (Graphics& g) override;
+    /** @internal */
+    void resized() override;
+    /** @internal */
+    void visibilityChanged() override;
     /** @internal */
-    void resized ();
+    void parentHierarchyChanged() override;
+    /** @internal */
+    void enablementChanged() override;
 
 protected:
     virtual DigitalMeterValue* createDigitalMeterValue();
@@ -124,12 +163,28 @@ private:
     friend class DigitalMeterValue;
 
     int portCount;
-    DigitalMeterValue** values;
+    OwnedArray<DigitalMeterValue> values;
     float scale;
     int levels[LevelCount];
     Colour colors[ColorCount];
     int peakFalloff;
     bool horizontal;
+
+    int portSize, length;
+    Image strip, bar, dim, back;
+
+    const MeterBus* bus;
+    int firstBusMeter;
+    HeapBlock<MeterBus::Slot> busSlots;
+    int refreshRate;
+
+    void timerCallback() override;
+    void updateTimer();
+    void createValues();
+    void renderCaches();
+    Rectangle<int> drawPort (int port, DigitalMeterValue& value, int from, int to);
+    Rectangle<int> getSpan (int port, int from, int to) const;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DigitalMeter)
 };
 
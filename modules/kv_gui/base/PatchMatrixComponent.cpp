@@ -122,11 +122,22 @@ Component* QuadrantLayout::getQauadrantComponent (QuadrantLayout::Quadrant q) co
     return quadrants.getUnchecked (q);
 }
 
+struct PatchMatrixComponent::Tile
+{
+    int row, column;    ///< position in tiles
+    Image image;
+    uint32 lastUsed;
+};
+
 PatchMatrixComponent::PatchMatrixComponent()
 {
     hoveredRow = hoveredColumn = -1;
     verticalThickness = horizontalThickness = 30;
     offsetX = offsetY = 0;
+    cacheEnabled = false;
+    paintCount = 0;
+    cachedRows = cachedColumns = -1;
+    cachedScale = 1.0f;
 }
 
 PatchMatrixComponent::~PatchMatrixComponent()
@@ -144,35 +155,193 @@ void PatchMatrixComponent::mouseDown (const MouseEvent& ev)
     const int row = getRowForPixel (ev.y);
     const int col = getColumnForPixel (ev.x);
     if (row >= 0 && col >= 0 && row < getNumRows() && col < getNumColumns())
+    {
         matrixCellClicked (row, col, ev);
+        repaintCell (row, col);
+    }
     else
+    {
         matrixBackgroundClicked (ev);
+    }
+}
+
+void PatchMatrixComponent::updateHover (const MouseEvent* ev)
+{
+    const int oldRow = hoveredRow;
+    const int oldColumn = hoveredColumn;
+    hoveredRow    = ev != nullptr ? getRowForPixel (ev->y) : -1;
+    hoveredColumn = ev != nullptr ? getColumnForPixel (ev->x) : -1;
+
+    // the highlight is drawn by the cells when uncached, or over the tiles
+    // when cached, so either way the tiles themselves are left alone
+    if (oldRow != hoveredRow)
+    {
+        repaint (getRowArea (oldRow));
+        repaint (getRowArea (hoveredRow));
+    }
+
+    if (oldColumn != hoveredColumn)
+    {
+        repaint (getColumnArea (oldColumn));
+        repaint (getColumnArea (hoveredColumn));
+    }
+}
+
+void PatchMatrixComponent::paintMatrixHover (Graphics& g, const Rectangle<int>& row, const Rectangle<int>& column)
+{
+    RectangleList<int> area (row);
+    area.add (column);
+    g.setColour (Colours::white.withAlpha (0.08f));
+    g.fillRectList (area);
 }
 
 void PatchMatrixComponent::mouseEnter (const MouseEvent& ev)
 {
-    hoveredRow = getRowForPixel (ev.y);
-    hoveredColumn = getColumnForPixel (ev.x);
-    repaint();
+    updateHover (&ev);
 }
 
 void PatchMatrixComponent::mouseMove (const MouseEvent& ev)
 {
-    hoveredRow = getRowForPixel (ev.y);
-    hoveredColumn = getColumnForPixel (ev.x);
+    updateHover (&ev);
 }
 
-void PatchMatrixComponent::mouseExit (const MouseEvent& ev)
+void PatchMatrixComponent::mouseExit (const MouseEvent&)
 {
-    hoveredRow = hoveredColumn = -1;
-    repaint();
+    updateHover (nullptr);
+}
+
+int PatchMatrixComponent::getTileColumns() const { return jmax (1, (int) tileSize / horizontalThickness); }
+int PatchMatrixComponent::getTileRows()    const { return jmax (1, (int) tileSize / verticalThickness); }
+
+PatchMatrixComponent::Tile* PatchMatrixComponent::getTile (int tileRow, int tileColumn, bool create)
+{
+    for (Tile* const tile : tiles)
+        if (tile->row == tileRow && tile->column == tileColumn)
+            return tile;
+
+    if (! create)
+        return nullptr;
+
+    // reuse the least recently drawn tile, unless they're all on screen
+    Tile* tile = nullptr;
+    if (tiles.size() >= maxTiles)
+    {
+        for (Tile* const t : tiles)
+            if (t->lastUsed != paintCount && (tile == nullptr || t->lastUsed < tile->lastUsed))
+                tile = t;
+    }
+
+    if (tile == nullptr)
+        tile = tiles.add (new Tile());
+
+    tile->row = tileRow;
+    tile->column = tileColumn;
+    tile->lastUsed = paintCount;
+
+    const int numTileRows = getTileRows();
+    const int numTileColumns = getTileColumns();
+    const int width  = roundToInt (numTileColumns * horizontalThickness * cachedScale);
+    const int height = roundToInt (numTileRows * verticalThickness * cachedScale);
+
+    if (tile->image.getWidth() != width || tile->image.getHeight() != height)
+        tile->image = Image (Image::ARGB, width, height, true);
+
+    renderCells (*tile, tileRow * numTileRows, tileColumn * numTileColumns, numTileRows, numTileColumns);
+    return tile;
+}
+
+void PatchMatrixComponent::renderCells (Tile& tile, int firstRow, int firstColumn, int numRowsToPaint, int numColumnsToPaint)
+{
+    const int w = horizontalThickness;
+    const int h = verticalThickness;
+    const int tileFirstRow    = tile.row * getTileRows();
+    const int tileFirstColumn = tile.column * getTileColumns();
+    const int lastRow    = jmin (firstRow + numRowsToPaint, getNumRows(), tileFirstRow + getTileRows());
+    const int lastColumn = jmin (firstColumn + numColumnsToPaint, getNumColumns(), tileFirstColumn + getTileColumns());
+    firstRow    = jmax (firstRow, tileFirstRow);
+    firstColumn = jmax (firstColumn, tileFirstColumn);
+
+    if (firstRow >= lastRow || firstColumn >= lastColumn)
+        return;
+
+    // hover is drawn over the tiles, so cells are rendered as not hovered
+    const ScopedValueSetter<int> noHoveredRow (hoveredRow, -1);
+    const ScopedValueSetter<int> noHoveredColumn (hoveredColumn, -1);
+
+    const AffineTransform transform (AffineTransform::scale (cachedScale));
+    const Rectangle<int> area ((firstColumn - tileFirstColumn) * w, (firstRow - tileFirstRow) * h,
+                               (lastColumn - firstColumn) * w, (lastRow - firstRow) * h);
+    tile.image.clear (area.toFloat().transformedBy (transform).getSmallestIntegerContainer());
+
+    Graphics g (tile.image);
+    g.addTransform (transform);
+
+    for (int row = firstRow; row < lastRow; ++row)
+    {
+        for (int col = firstColumn; col < lastColumn; ++col)
+        {
+            g.saveState();
+            g.setOrigin ((col - tileFirstColumn) * w, (row - tileFirstRow) * h);
+            g.reduceClipRegion (0, 0, w, h);
+            paintMatrixCell (g, w, h, row, col);
+            g.restoreState();
+        }
+    }
 }
 
 void PatchMatrixComponent::paint (Graphics &g)
 {
-    if (getNumColumns() <= 0 || getNumRows() <= 0)
+    const int numRows = getNumRows();
+    const int numColumns = getNumColumns();
+    if (numColumns <= 0 || numRows <= 0)
         return;
-    
+
+    if (! cacheEnabled)
+        return paintUncached (g);
+
+    // tiles are rendered at the context's pixel density
+    const float scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+    if (numRows != cachedRows || numColumns != cachedColumns || scale != cachedScale)
+    {
+        tiles.clear();
+        cachedRows = numRows;
+        cachedColumns = numColumns;
+        cachedScale = scale;
+    }
+
+    ++paintCount;
+    const int tileWidth  = getTileColumns() * horizontalThickness;
+    const int tileHeight = getTileRows() * verticalThickness;
+
+    // only the tiles under the clip, in content coordinates
+    const Rectangle<int> clip (g.getClipBounds());
+    const int left   = jmax (0, clip.getX() - offsetX);
+    const int top    = jmax (0, clip.getY() - offsetY);
+    const int right  = jmin (numColumns * horizontalThickness, clip.getRight() - offsetX);
+    const int bottom = jmin (numRows * verticalThickness, clip.getBottom() - offsetY);
+
+    for (int tileRow = top / tileHeight; tileRow * tileHeight < bottom; ++tileRow)
+    {
+        for (int tileColumn = left / tileWidth; tileColumn * tileWidth < right; ++tileColumn)
+        {
+            Tile* const tile = getTile (tileRow, tileColumn, true);
+            tile->lastUsed = paintCount;
+
+            const int x = tileColumn * tileWidth + offsetX;
+            const int y = tileRow * tileHeight + offsetY;
+            if (cachedScale == 1.0f)
+                g.drawImageAt (tile->image, x, y);
+            else
+                g.drawImage (tile->image, Rectangle<float> ((float) x, (float) y, (float) tileWidth, (float) tileHeight));
+        }
+    }
+
+    if (hoveredRow >= 0 || hoveredColumn >= 0)
+        paintMatrixHover (g, getRowArea (hoveredRow), getColumnArea (hoveredColumn));
+}
+
+void PatchMatrixComponent::paintUncached (Graphics& g)
+{
     const int xs = (offsetX % horizontalThickness);
     const int ys = (offsetY % verticalThickness);
     const int cs = getColumnForPixel(0);
@@ -197,6 +366,72 @@ void PatchMatrixComponent::paint (Graphics &g)
     }
 }
 
+void PatchMatrixComponent::repaintCell (const int row, const int column)
+{
+    if (! isPositiveAndBelow (row, getNumRows()) || ! isPositiveAndBelow (column, getNumColumns()))
+        return;
+
+    if (Tile* const tile = getTile (row / getTileRows(), column / getTileColumns(), false))
+        renderCells (*tile, row, column, 1, 1);
+
+    repaint (column * horizontalThickness + offsetX, row * verticalThickness + offsetY,
+             horizontalThickness, verticalThickness);
+}
+
+void PatchMatrixComponent::repaintRow (const int row)
+{
+    if (! isPositiveAndBelow (row, getNumRows()))
+        return;
+
+    const int tileRow = row / getTileRows();
+    for (Tile* const tile : tiles)
+        if (tile->row == tileRow)
+            renderCells (*tile, row, tile->column * getTileColumns(), 1, getTileColumns());
+
+    repaint (getRowArea (row));
+}
+
+void PatchMatrixComponent::repaintColumn (const int column)
+{
+    if (! isPositiveAndBelow (column, getNumColumns()))
+        return;
+
+    const int tileColumn = column / getTileColumns();
+    for (Tile* const tile : tiles)
+        if (tile->column == tileColumn)
+            renderCells (*tile, tile->row * getTileRows(), column, getTileRows(), 1);
+
+    repaint (getColumnArea (column));
+}
+
+Rectangle<int> PatchMatrixComponent::getRowArea (const int row)
+{
+    if (! isPositiveAndBelow (row, getNumRows()))
+        return Rectangle<int>();
+    return Rectangle<int> (offsetX, row * verticalThickness + offsetY,
+                           getNumColumns() * horizontalThickness, verticalThickness);
+}
+
+Rectangle<int> PatchMatrixComponent::getColumnArea (const int column)
+{
+    if (! isPositiveAndBelow (column, getNumColumns()))
+        return Rectangle<int>();
+    return Rectangle<int> (column * horizontalThickness + offsetX, offsetY,
+                           horizontalThickness, getNumRows() * verticalThickness);
+}
+
+void PatchMatrixComponent::invalidateCache()
+{
+    tiles.clear();
+    repaint();
+}
+
+void PatchMatrixComponent::setTileCacheEnabled (const bool enabled)
+{
+    cacheEnabled = enabled;
+    invalidateCache();
+}
+
 int PatchMatrixComponent::getColumnForPixel (const int x)
 {
     return (x - offsetX) / horizontalThickness;
@@ -217,6 +452,6 @@ void PatchMatrixComponent::setMatrixCellSize (const int horizontal, const int ve
     horizontalThickness = horizontal;
     verticalThickness = vertical;
     jassert (horizontalThickness > 0 && verticalThickness > 0);
+    invalidateCache();
     resized();
 }
-
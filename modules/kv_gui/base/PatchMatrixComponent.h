@@ -48,6 +48,18 @@ private:
     void updateQuadrantBounds();
 };
 
+/** A grid of cells for routing matrices.
+
+    Cells are painted by paintMatrixCell(), only those in the visible area.
+
+    Large matrices can turn on setTileCacheEnabled(), which paints cells
+    into cached tile images in content space, so scrolling and repaints
+    only blit tiles. Clicking redraws the cell clicked, and the hover
+    highlight is drawn over the tiles by paintMatrixHover(). If a cell's
+    look changes for any other reason call repaintCell(), repaintRow() or
+    repaintColumn(), or invalidateCache() if much of the matrix changed,
+    since a plain repaint() only blits what's cached.
+ */
 class PatchMatrixComponent : public Component
 {
 public:
@@ -63,6 +75,11 @@ public:
                                   const int row, const int column) = 0;
     virtual void matrixCellClicked (const int row, const int col, const MouseEvent& ev);
     virtual void matrixBackgroundClicked (const MouseEvent& ev) { }
+
+    /** Draw the hover highlight over cached tiles. Only called when the tile
+        cache is enabled, otherwise cells draw their own highlight.  Either
+        area may be empty */
+    virtual void paintMatrixHover (Graphics& g, const Rectangle<int>& row, const Rectangle<int>& column);
     
     inline bool mouseIsOverRow (const int row) const {
         return row >= 0 && hoveredRow >= 0 && row == hoveredRow;
@@ -83,18 +100,49 @@ public:
     void mouseDown (const MouseEvent& ev) override;
     void paint (Graphics &g) override;
 
-    void setThickness (const int thickness)         { verticalThickness = horizontalThickness = thickness; repaint(); }
+    void setThickness (const int thickness)         { setMatrixCellSize (thickness); }
     int getRowThickness() const { return verticalThickness; }
     int getColumnThickness() const { return horizontalThickness; }
     
     int getColumnForPixel (const int x);
     int getRowForPixel (const int y);
-    void setOffsetX (const int x) { offsetX = x; }
-    void setOffsetY (const int y) { offsetY = y; }
+    void setOffsetX (const int x) { offsetX = x; repaint(); }
+    void setOffsetY (const int y) { offsetY = y; repaint(); }
+
+    /** Paint a cell again, e.g. after it was toggled */
+    void repaintCell (const int row, const int column);
+
+    /** Paint every cell of a row or column again */
+    void repaintRow (const int row);
+    void repaintColumn (const int column);
+
+    /** Forget all cached tiles, so everything is painted again */
+    void invalidateCache();
+
+    /** Cache tiles, off by default. With it cells are only painted again
+        after the repaint methods above, and never show as hovered */
+    void setTileCacheEnabled (const bool enabled);
 
 private:
+    struct Tile;
     int verticalThickness, horizontalThickness;
     int offsetX, offsetY, hoveredRow, hoveredColumn;
+
+    bool cacheEnabled;
+    OwnedArray<Tile> tiles;
+    uint32 paintCount;
+    int cachedRows, cachedColumns;
+    float cachedScale;
+
+    enum { tileSize = 256, maxTiles = 96 };
+    int getTileColumns() const;
+    int getTileRows() const;
+    Tile* getTile (int tileRow, int tileColumn, bool create);
+    void renderCells (Tile& tile, int firstRow, int firstColumn, int numRows, int numColumns);
+    void updateHover (const MouseEvent* ev);
+    Rectangle<int> getRowArea (const int row);
+    Rectangle<int> getColumnArea (const int column);
+    void paintUncached (Graphics& g);
 };
 
 #endif // EL_PATCH_MATRIX_COMPONENT_H
@@ -28,7 +28,15 @@ public:
           atom_Sequence  (map->map (map->handle, LV2_ATOM__Sequence)),
           atom_Sound     (map->map (map->handle, LV2_ATOM__Sound)),
           event_Event    (map->map (map->handle, LV2_EVENT__Event)),
-          midi_MidiEvent (map->map (map->handle, LV2_MIDI__MidiEvent))
+          midi_MidiEvent (map->map (map->handle, LV2_MIDI__MidiEvent)),
+          time_Position  (map->map (map->handle, LV2_TIME__Position)),
+          time_barBeat   (map->map (map->handle, LV2_TIME__barBeat)),
+          time_beat      (map->map (map->handle, LV2_TIME__beat)),
+          time_beatUnit  (map->map (map->handle, LV2_TIME__beatUnit)),
+          time_beatsPerBar    (map->map (map->handle, LV2_TIME__beatsPerBar)),
+          time_beatsPerMinute (map->map (map->handle, LV2_TIME__beatsPerMinute)),
+          time_frame     (map->map (map->handle, LV2_TIME__frame)),
+          time_speed     (map->map (map->handle, LV2_TIME__speed))
     { }
 
 	URIs(const URIs& o);
@@ -39,6 +47,14 @@ public:
     const LV2_URID atom_Sound;
     const LV2_URID event_Event;
     const LV2_URID midi_MidiEvent;
+    const LV2_URID time_Position;
+    const LV2_URID time_barBeat;
+    const LV2_URID time_beat;
+    const LV2_URID time_beatUnit;
+    const LV2_URID time_beatsPerBar;
+    const LV2_URID time_beatsPerMinute;
+    const LV2_URID time_frame;
+    const LV2_URID time_speed;
 };
 
 #endif
@@ -36,6 +36,28 @@ public:
     virtual const String& getURI() const = 0;
 };
 
+/** A feature without data, used to tell a plugin the host makes
+    some guarantee (e.g. bufsz:fixedBlockLength) */
+class LV2FlagFeature : public LV2Feature
+{
+public:
+    LV2FlagFeature (const String& featureURI)
+        : uri (featureURI)
+    {
+        feat.URI  = uri.toRawUTF8();
+        feat.data = nullptr;
+    }
+
+    ~LV2FlagFeature() { }
+
+    const String& getURI() const { return uri; }
+    const LV2_Feature* getFeature() const { return &feat; }
+
+private:
+    String uri;
+    LV2_Feature feat;
+};
+
 
 /** An array of lv2 features */
 class LV2FeatureArray
@@ -0,0 +1,70 @@
+/*
+    This file is part of the Kushview Modules for JUCE
+    Copyright (C) 2014-2017  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+LV2Options::LV2Options()
+    : numValues (0)
+{
+    uri = LV2_OPTIONS__options;
+    feat.URI = uri.toRawUTF8();
+    rebuild();
+}
+
+LV2Options::~LV2Options() { }
+
+void LV2Options::setInt (uint32 key, uint32 intType, int32 value)
+{
+    for (int i = 0; i < numValues; ++i)
+    {
+        if (options.getReference(i).key == key)
+        {
+            values [i] = value;
+            return;
+        }
+    }
+
+    values.realloc ((size_t) numValues + 1);
+    values [numValues] = value;
+
+    LV2_Options_Option opt;
+    opt.context = LV2_OPTIONS_INSTANCE;
+    opt.subject = 0;
+    opt.key     = key;
+    opt.size    = sizeof (int32);
+    opt.type    = intType;
+    opt.value   = nullptr;
+    options.insert (numValues++, opt);
+
+    rebuild();
+}
+
+void LV2Options::rebuild()
+{
+    // the terminating option is all zeros
+    if (options.size() <= numValues)
+    {
+        LV2_Options_Option end;
+        zerostruct (end);
+        options.add (end);
+    }
+
+    for (int i = 0; i < numValues; ++i)
+        options.getReference(i).value = values.getData() + i;
+
+    feat.data = (void*) options.getRawDataPointer();
+}
@@ -0,0 +1,51 @@
+/*
+    This file is part of the Kushview Modules for JUCE
+    Copyright (C) 2014-2017  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#ifndef EL_LV2OPTIONS_H
+#define EL_LV2OPTIONS_H
+
+/** Implements the LV2 Options feature for instance options */
+class LV2Options : public LV2Feature
+{
+public:
+    LV2Options();
+    ~LV2Options();
+
+    /** Add or change an integer option.  Adding an option moves the
+        array, so add everything before passing this to a plugin.  Changing
+        an existing option's value doesn't */
+    void setInt (uint32 key, uint32 intType, int32 value);
+
+    /** Get the zero terminated option array */
+    inline const LV2_Options_Option* getOptions() const { return options.getRawDataPointer(); }
+
+    inline const String& getURI() const { return uri; }
+    inline const LV2_Feature* getFeature() const { return &feat; }
+
+private:
+    String uri;
+    LV2_Feature feat;
+    Array<LV2_Options_Option> options;
+    HeapBlock<int32> values;
+    int numValues;
+
+    void rebuild();
+};
+
+#endif /* EL_LV2OPTIONS_H */
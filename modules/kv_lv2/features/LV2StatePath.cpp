@@ -0,0 +1,99 @@
+/*
+    This file is part of the Kushview Modules for JUCE
+    Copyright (C) 2014-2017  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+namespace LV2Callbacks {
+
+    /** Returns a copy of the string the plugin is expected to free */
+    inline char* copyPath (const String& path)
+    {
+        const size_t size = path.getNumBytesAsUTF8() + 1;
+        char* const result = static_cast<char*> (std::malloc (size));
+        if (result != nullptr)
+            path.copyToUTF8 (result, size);
+        return result;
+    }
+
+    char* abstractPath (LV2_State_Map_Path_Handle handle, const char* absolutePath)
+    {
+        const LV2StateMapPath& mapPath (*static_cast<LV2StateMapPath*> (handle));
+        const File& dir (mapPath.getDirectory());
+        const File& scratch (mapPath.getScratchDirectory());
+        const File file (String::fromUTF8 (absolutePath));
+
+        if (dir == File())
+            return copyPath (file.getFullPathName());
+
+        if (file.isAChildOf (dir))
+            return copyPath (file.getRelativePathFrom (dir));
+
+        if (scratch != File() && file.isAChildOf (scratch))
+        {
+            const String path (file.getRelativePathFrom (scratch));
+            const File copy (dir.getChildFile (path));
+            if (copy.getParentDirectory().createDirectory() && file.copyFileTo (copy))
+                return copyPath (path);
+        }
+
+        return copyPath (CharPointer_UTF8 (absolutePath));
+    }
+
+    char* absolutePath (LV2_State_Map_Path_Handle handle, const char* abstractPath)
+    {
+        const File& dir = static_cast<LV2StateMapPath*> (handle)->getDirectory();
+        const String path (String::fromUTF8 (abstractPath));
+
+        if (dir == File() || File::isAbsolutePath (path))
+            return copyPath (path);
+
+        return copyPath (dir.getChildFile (path).getFullPathName());
+    }
+
+    char* makePath (LV2_State_Make_Path_Handle handle, const char* path)
+    {
+        const File file (static_cast<LV2StateMakePath*> (handle)->getDirectory()
+                            .getChildFile (CharPointer_UTF8 (path)));
+        file.getParentDirectory().createDirectory();
+        return copyPath (file.getFullPathName());
+    }
+}
+
+LV2StateMapPath::LV2StateMapPath (const File& dir, const File& scratchDir)
+    : directory (dir), scratch (scratchDir)
+{
+    uri = LV2_STATE__mapPath;
+    feat.URI    = uri.toRawUTF8();
+    data.handle = this;
+    data.abstract_path = &LV2Callbacks::abstractPath;
+    data.absolute_path = &LV2Callbacks::absolutePath;
+    feat.data   = (void*) &data;
+}
+
+LV2StateMapPath::~LV2StateMapPath() { }
+
+LV2StateMakePath::LV2StateMakePath (const File& dir)
+    : directory (dir)
+{
+    uri = LV2_STATE__makePath;
+    feat.URI    = uri.toRawUTF8();
+    data.handle = this;
+    data.path   = &LV2Callbacks::makePath;
+    feat.data   = (void*) &data;
+}
+
+LV2StateMakePath::~LV2StateMakePath() { }
@@ -0,0 +1,72 @@
+/*
+    This file is part of the Kushview Modules for JUCE
+    Copyright (C) 2014-2017  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#ifndef EL_LV2STATEPATH_H
+#define EL_LV2STATEPATH_H
+
+/** Implements the LV2 State mapPath feature. Absolute paths inside the
+    directory are abstracted relative to it, all others pass through as is.
+
+    If a scratch directory is given, files the plugin made there are copied
+    in to the directory when abstracted.  This is how files made while running
+    end up next to a saved state */
+class LV2StateMapPath : public LV2Feature
+{
+public:
+    LV2StateMapPath (const File& directory, const File& scratch = File());
+    ~LV2StateMapPath();
+
+    /** The directory abstract paths are relative to */
+    inline const File& getDirectory() const { return directory; }
+
+    /** The directory files are copied from */
+    inline const File& getScratchDirectory() const { return scratch; }
+
+    inline const String& getURI() const { return uri; }
+    inline const LV2_Feature* getFeature() const { return &feat; }
+
+private:
+    String uri;
+    File directory, scratch;
+    LV2_Feature feat;
+    LV2_State_Map_Path data;
+};
+
+/** Implements the LV2 State makePath feature. Plugins use this to create
+    files, parent directories are created as needed */
+class LV2StateMakePath : public LV2Feature
+{
+public:
+    LV2StateMakePath (const File& directory);
+    ~LV2StateMakePath();
+
+    /** The directory files are created in */
+    inline const File& getDirectory() const { return directory; }
+
+    inline const String& getURI() const { return uri; }
+    inline const LV2_Feature* getFeature() const { return &feat; }
+
+private:
+    String uri;
+    File directory;
+    LV2_Feature feat;
+    LV2_State_Make_Path data;
+};
+
+#endif /* EL_LV2STATEPATH_H */
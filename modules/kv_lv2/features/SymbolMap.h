@@ -29,7 +29,8 @@ typedef std::function<const char*(LV2_URID)> URIUnmapFunction;
 
 /** Maintains a map of Strings/Symbols to integers
     This class also implements LV2 URID Map/Unmap features and is fully
-    compatible with the current LV2 (1.6.0+) specification. */
+    compatible with the current LV2 (1.6.0+) specification. Mapping is
+    thread safe, but NOT realtime safe. */
 class SymbolMap
 {
 public:
@@ -47,6 +48,7 @@ public:
     inline LV2_URID
     map (const char* key)
     {
+        const ScopedLock sl (lock);
         if (! contains (key))
         {
             const uint32_t urid ((LV2_URID) mapped.size());
@@ -82,6 +84,7 @@ public:
     inline const char*
     unmap (LV2_URID urid)
     {
+        const ScopedLock sl (lock);
         if (contains (urid))
             return (const char*) unmapped [urid].c_str();
 
@@ -92,6 +95,7 @@ public:
     inline void
     clear()
     {
+        const ScopedLock sl (lock);
         mapped.clear();
         unmapped.clear();
     }
@@ -112,6 +116,7 @@ private:
     typedef std::map<std::string, LV2_URID> Mapped;
     typedef std::map<LV2_URID, std::string> Unmapped;
     Mapped mapped; Unmapped unmapped;
+    CriticalSection lock;
 
     // LV2 URID Host Implementation follows ...
     class MapFeature :  public LV2Feature
@@ -17,6 +17,24 @@
     Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
 */
 
+#ifndef KV_LV2_STATE_MAX_INLINE
+ #define KV_LV2_STATE_MAX_INLINE (64 * 1024)
+#endif
+
+namespace LV2StateTags {
+    static const Identifier state     ("state");
+    static const Identifier port      ("port");
+    static const Identifier property  ("property");
+    static const Identifier uri       ("uri");
+    static const Identifier symbol    ("symbol");
+    static const Identifier value     ("value");
+    static const Identifier key       ("key");
+    static const Identifier type      ("type");
+    static const Identifier flags     ("flags");
+    static const Identifier file      ("file");
+    static const Identifier embedded  ("embedded");
+}
+
 namespace LV2Callbacks {
     inline unsigned uiSupported (const char* hostType, const char* uiType)
     {
@@ -30,14 +48,112 @@ namespace LV2Callbacks {
 
         return suil_ui_supported (hostType, uiType);
     }
+
+    /** Collects properties stored by the plugin while saving. Without a
+        directory, files that paths relative to embedFrom point at are
+        embedded in the state */
+    struct StateWriter
+    {
+        StateWriter (ValueTree& s, const File& d, const File& e, LV2_URID_Unmap* u)
+            : state (s), directory (d), embedFrom (e), unmap (u) { }
+        ValueTree& state;
+        const File directory, embedFrom;
+        LV2_URID_Unmap* unmap;
+    };
+
+    /** A property loaded in to memory, ready for the plugin to retrieve */
+    struct StateProperty
+    {
+        uint32 key, type, flags;
+        MemoryBlock data;
+    };
+
+    LV2_State_Status storeProperty (LV2_State_Handle handle, uint32_t key, const void* value,
+                                    size_t size, uint32_t type, uint32_t flags)
+    {
+        StateWriter& writer (*static_cast<StateWriter*> (handle));
+
+        if ((flags & LV2_STATE_IS_POD) == 0)
+            return LV2_STATE_ERR_BAD_FLAGS;
+        if (value == nullptr || writer.unmap == nullptr)
+            return LV2_STATE_ERR_UNKNOWN;
+
+        const String typeURI (CharPointer_UTF8 (writer.unmap->unmap (writer.unmap->handle, type)));
+        ValueTree prop (LV2StateTags::property);
+        prop.setProperty (LV2StateTags::key,   String (CharPointer_UTF8 (writer.unmap->unmap (writer.unmap->handle, key))), nullptr);
+        prop.setProperty (LV2StateTags::type,  typeURI, nullptr);
+        prop.setProperty (LV2StateTags::flags, (int) flags, nullptr);
+
+        if (writer.directory == File() && writer.embedFrom != File() && typeURI == LV2_ATOM__Path)
+        {
+            // nothing else keeps the file once the instance is gone
+            const String path (CharPointer_UTF8 (static_cast<const char*> (value)), size);
+            MemoryBlock contents;
+            if (! File::isAbsolutePath (path) && writer.embedFrom.getChildFile (path).loadFileAsData (contents))
+                prop.setProperty (LV2StateTags::embedded, var (contents), nullptr);
+        }
+
+        if (writer.directory != File() && size > KV_LV2_STATE_MAX_INLINE)
+        {
+            // written straight from the plugin's memory, big blobs aren't copied
+            const File file (writer.directory.getChildFile (
+                String ("property-") + String (writer.state.getNumChildren()) + ".bin"));
+            if (! file.replaceWithData (value, size))
+                return LV2_STATE_ERR_UNKNOWN;
+            prop.setProperty (LV2StateTags::file, file.getFileName(), nullptr);
+        }
+        else
+        {
+            prop.setProperty (LV2StateTags::value, var (value, size), nullptr);
+        }
+
+        writer.state.addChild (prop, -1, nullptr);
+        return LV2_STATE_SUCCESS;
+    }
+
+    const void* retrieveProperty (LV2_State_Handle handle, uint32_t key, size_t* size,
+                                  uint32_t* type, uint32_t* flags)
+    {
+        const OwnedArray<StateProperty>& props (
+            *static_cast<OwnedArray<StateProperty>*> (handle));
+
+        for (const StateProperty* prop : props)
+        {
+            if (prop->key != key)
+                continue;
+
+            *size  = prop->data.getSize();
+            *type  = prop->type;
+            *flags = prop->flags;
+            return prop->data.getData();
+        }
+
+        return nullptr;
+    }
 }
 
 class LV2Module::Private {
 public:
     Private (LV2Module& module)
-        : owner (module) { }
+        : owner (module)
+    {
+        instantiationLock = nullptr;
+        fixedBlockLength = powerOf2BlockLength = false;
+        latencyPort = LV2UI_INVALID_PORT_INDEX;
+        instantiatedBlockSize = 0;
+        zerostruct (instanceData);
+        scratchDir = File::getSpecialLocation (File::tempDirectory)
+            .getChildFile ("LV2 State").getChildFile (Uuid().toString());
+        profileId = DspProfiler::getDefault().registerNode (owner.getName() + ": run");
+    }
 
-    ~Private() { }
+    ~Private()
+    {
+        DspProfiler::getDefault().unregisterNode (profileId);
+        instanceFeatures.clear();
+        if (scratchDir.isDirectory())
+            scratchDir.deleteRecursively();
+    }
 
     SuilInstance* instantiateUI (const LilvUI* ui,
                                  const LilvNode* containerType,
@@ -65,8 +181,74 @@ public:
         return instance;
     }
 
+    /** A CV port. When not bound to host memory, the port reads/writes
+        its own buffer. Inputs are then driven by the port's control value */
+    struct CVPort
+    {
+        CVPort (uint32 p, bool input) : port (p), isInput (input), bound (false), hostData (nullptr) { }
+        const uint32 port;
+        const bool isInput;
+        bool bound;
+        void* hostData;
+
+        inline void* getData() const { return bound ? hostData : buffer.getData(); }
+        HeapBlock<float> buffer;
+        ControlRamp ramp;
+    };
+
+    /** Opens the plugin's binary and finds its descriptor. This reads the
+        plugin's data in the LilvWorld, so the world's lock must be held */
+    const LV2_Descriptor* openLibrary (const LilvPlugin* plugin, String& bundlePath)
+    {
+        const char* const libraryURI = lilv_node_as_uri (lilv_plugin_get_library_uri (plugin));
+        const char* const bundleURI  = lilv_node_as_uri (lilv_plugin_get_bundle_uri (plugin));
+        if (libraryURI == nullptr || bundleURI == nullptr)
+            return nullptr;
+
+        char* const libraryPath = lilv_file_uri_parse (libraryURI, nullptr);
+        char* const bundle      = lilv_file_uri_parse (bundleURI, nullptr);
+        bundlePath = String::fromUTF8 (bundle);
+        library = new DynamicLibrary();
+        const bool opened = libraryPath != nullptr && library->open (String::fromUTF8 (libraryPath));
+        lilv_free (libraryPath);
+        lilv_free (bundle);
+
+        const String uri (owner.getURI());
+        if (opened)
+            if (LV2_Descriptor_Function descriptors = (LV2_Descriptor_Function) library->getFunction ("lv2_descriptor"))
+                for (uint32 i = 0; const LV2_Descriptor* descriptor = descriptors (i); ++i)
+                    if (uri == descriptor->URI)
+                        return descriptor;
+
+        library = nullptr;
+        return nullptr;
+    }
+
+    template<class FeatureType>
+    FeatureType* getWorldFeature (const char* uri) const
+    {
+        if (LV2Feature* feat = owner.getWorld().getFeatureArray().getFeature (uri))
+            return (FeatureType*) feat->getFeature()->data;
+        return nullptr;
+    }
+
     ChannelConfig channels;
     HeapBlock<float> mins, maxes, defaults, values;
+    StringArray symbols;
+    OwnedArray<CVPort> cvPorts;
+    HeapBlock<int32> cvSlots; ///< port index to cvPorts index, or -1
+
+    CriticalSection* instantiationLock;
+    ScopedPointer<DynamicLibrary> library;  ///< held open while instantiated
+    LilvInstance instanceData;              ///< the instance, when there is one
+    bool fixedBlockLength, powerOf2BlockLength;
+    uint32 latencyPort;
+    uint32 instantiatedBlockSize;
+
+    File scratchDir;
+    OwnedArray<LV2Feature> instanceFeatures;
+    CriticalSection stateLock;
+    int profileId;
 
 private:
     LV2Module& owner;
@@ -80,6 +262,7 @@ LV2Module::LV2Module (LV2World& world_, const LilvPlugin* plugin_)
      active (false),
      currentSampleRate (44100.0),
      numPorts (lilv_plugin_get_num_ports (plugin_)),
+     maxBlockSize (0),
      events (nullptr)
 {
     priv = new Private (*this);
@@ -106,7 +289,7 @@ void LV2Module::activatePorts()
        }
        else if (type == PortType::Audio)
        {
-
+           // audio ports are connected by the host each cycle
        }
        else if (type == PortType::Control)
        {
@@ -116,7 +299,13 @@ void LV2Module::activatePorts()
        }
        else if (type == PortType::CV)
        {
-
+           // CV ports stay bound to host memory if they were, otherwise
+           // they use their internal buffers
+           Private::CVPort* const cv = priv->cvPorts.getUnchecked (priv->cvSlots [p]);
+           cv->ramp.reset (priv->values [p]);
+           FloatVectorOperations::fill (cv->buffer.getData(), cv->isInput ? priv->values [p] : 0.0f,
+                                        (int) maxBlockSize);
+           lilv_instance_connect_port (instance, p, cv->getData());
        }
    }
 }
@@ -128,18 +317,88 @@ void LV2Module::init()
     priv->maxes.allocate (numPorts, true);
     priv->defaults.allocate (numPorts, true);
     priv->values.allocate (numPorts, true);
+    priv->cvSlots.allocate (numPorts, true);
     lilv_plugin_get_port_ranges_float (plugin, priv->mins, priv->maxes, priv->defaults);
+    priv->instantiationLock = &world.getInstantiationLock (getURI());
+    priv->fixedBlockLength = lilv_plugin_has_feature (plugin, world.bufsz_fixedBlockLength);
+    priv->powerOf2BlockLength = lilv_plugin_has_feature (plugin, world.bufsz_powerOf2BlockLength);
 
     // initialize each port
     for (uint32 p = 0; p < numPorts; ++p)
     {
         const LilvPort* port (lilv_plugin_get_port_by_index (plugin, p));
         const bool isInput (lilv_port_is_a (plugin, port, world.lv2_InputPort));
-        priv->channels.addPort (getPortType (p), p, isInput);
+        const PortType type (getPortType (p));
+        priv->channels.addPort (type, p, isInput);
         priv->values [p] = priv->defaults [p];
+        priv->symbols.add (lilv_node_as_string (lilv_port_get_symbol (plugin, port)));
+
+        if (type == PortType::Control && ! isInput &&
+            lilv_port_has_property (plugin, port, world.lv2_ReportsLatency))
+            priv->latencyPort = p;
+
+        if (type == PortType::CV)
+        {
+            priv->cvSlots [p] = priv->cvPorts.size();
+            priv->cvPorts.add (new Private::CVPort (p, isInput));
+        }
+        else
+        {
+            priv->cvSlots [p] = -1;
+        }
+    }
+
+    // newer plugins designate the port instead
+    if (priv->latencyPort == LV2UI_INVALID_PORT_INDEX)
+        if (const LilvPort* port = lilv_plugin_get_port_by_designation (plugin, world.lv2_OutputPort, world.lv2_Latency))
+            priv->latencyPort = lilv_port_get_index (plugin, port);
+
+    setMaxBlockSize (4096);
+}
+
+void LV2Module::setMaxBlockSize (uint32 maxFrames)
+{
+    if (maxFrames == maxBlockSize)
+        return;
+
+    maxBlockSize = maxFrames;
+
+    for (Private::CVPort* cv : priv->cvPorts)
+    {
+        cv->buffer.calloc (jmax ((uint32) 1, maxBlockSize));
+        cv->ramp.setMaxBlockSize ((int) maxBlockSize);
+        cv->ramp.reset (priv->values [cv->port]);
+
+        // re-point ports still using the old internal buffer
+        if (instance != nullptr && ! cv->bound)
+            lilv_instance_connect_port (instance, cv->port, cv->buffer.getData());
     }
+
+    // the block length options are only read when instantiating
+    if (instance != nullptr && (wantsFixedBlockLength() || wantsPowerOf2BlockLength() ||
+                                maxBlockSize > priv->instantiatedBlockSize))
+        reinstantiate (currentSampleRate);
+}
+
+void LV2Module::reinstantiate (double samplerate)
+{
+    // the plugin's state goes through the scratch directory, so files it
+    // made stay where they are
+    const bool wasActive = isActive();
+    ValueTree state;
+    const bool keepState = hasStateInterface() && saveState (state, priv->scratchDir).wasOk();
+
+    freeInstance();
+    if (instantiate (samplerate).wasOk() && keepState)
+        restoreState (state, priv->scratchDir);
+
+    if (wasActive)
+        activate();
 }
 
+bool LV2Module::wantsFixedBlockLength() const       { return priv->fixedBlockLength; }
+bool LV2Module::wantsPowerOf2BlockLength() const    { return priv->powerOf2BlockLength; }
+
 Result LV2Module::instantiate (double samplerate)
 {
     freeInstance();
@@ -148,28 +407,94 @@ Result LV2Module::instantiate (double samplerate)
     features.clearQuick();
     world.getFeatures (features);
 
-    // check for a worker interface
-    LilvNodes* nodes = lilv_plugin_get_extension_data (plugin);
-    LILV_FOREACH (nodes, iter, nodes)
     {
-        const LilvNode* node = lilv_nodes_get (nodes, iter);
-        if (lilv_node_equals (node, world.work_interface))
+        // the LilvWorld is only touched while locked, so modules can be
+        // created from many threads at once
+        const ScopedLock sl (world.getLock());
+
+        // check for a worker interface
+        LilvNodes* nodes = lilv_plugin_get_extension_data (plugin);
+        LILV_FOREACH (nodes, iter, nodes)
         {
-            worker = new LV2Worker (world.getWorkThread(), 1);
-            features.add (worker->getFeature());
+            const LilvNode* node = lilv_nodes_get (nodes, iter);
+            if (lilv_node_equals (node, world.work_interface))
+            {
+                worker = new LV2Worker (world.getWorkThread(), 1);
+                features.add (worker->getFeature());
+            }
         }
+        lilv_nodes_free (nodes); nodes = nullptr;
+    }
+
+    // files the plugin makes while running go in a scratch directory, they
+    // are copied next to the state when saved
+    priv->instanceFeatures.clear();
+    priv->instanceFeatures.add (new LV2StateMapPath (priv->scratchDir));
+    priv->instanceFeatures.add (new LV2StateMakePath (priv->scratchDir));
+
+    // fixed and power of two block lengths are only promised to plugins
+    // which ask for them, the host has to honor that when running
+    if (LV2_URID_Map* map = priv->getWorldFeature<LV2_URID_Map> (LV2_URID__map))
+    {
+        const bool fixed = wantsFixedBlockLength() || wantsPowerOf2BlockLength();
+        const uint32 intType = map->map (map->handle, LV2_ATOM__Int);
+        LV2Options* options = new LV2Options();
+        options->setInt (map->map (map->handle, LV2_BUF_SIZE__minBlockLength), intType, fixed ? (int32) maxBlockSize : 0);
+        options->setInt (map->map (map->handle, LV2_BUF_SIZE__maxBlockLength), intType, (int32) maxBlockSize);
+        options->setInt (map->map (map->handle, LV2_BUF_SIZE__nominalBlockLength), intType, (int32) maxBlockSize);
+        priv->instanceFeatures.add (options);
     }
-    lilv_nodes_free (nodes); nodes = nullptr;
+
+    priv->instanceFeatures.add (new LV2FlagFeature (LV2_BUF_SIZE__boundedBlockLength));
+    if (wantsFixedBlockLength())
+        priv->instanceFeatures.add (new LV2FlagFeature (LV2_BUF_SIZE__fixedBlockLength));
+    if (wantsPowerOf2BlockLength())
+        priv->instanceFeatures.add (new LV2FlagFeature (LV2_BUF_SIZE__powerOf2BlockLength));
+
+    for (const LV2Feature* feat : priv->instanceFeatures)
+        features.add (feat->getFeature());
+    priv->instantiatedBlockSize = maxBlockSize;
 
     features.add (nullptr);
-    instance = lilv_plugin_instantiate (plugin, samplerate,
-                                        features.getRawDataPointer());
+
+    String bundlePath;
+    const LV2_Descriptor* descriptor = nullptr;
+
+    {
+        // only finding the binary and descriptor read the LilvWorld
+        const ScopedLock sl (world.getLock());
+        descriptor = priv->openLibrary (plugin, bundlePath);
+    }
+
+    if (descriptor != nullptr)
+    {
+        // the plugin's constructor runs outside the world's lock, so many
+        // plugins can be made at once. Only calls to the same plugin wait
+        const ScopedLock il (*priv->instantiationLock);
+        if (LV2_Handle handle = descriptor->instantiate (descriptor, samplerate, bundlePath.toRawUTF8(),
+                                                         features.getRawDataPointer()))
+        {
+            priv->instanceData.lv2_descriptor = descriptor;
+            priv->instanceData.lv2_handle = handle;
+            instance = &priv->instanceData;
+        }
+    }
+
     if (instance == nullptr) {
         features.clearQuick();
         worker = nullptr;
+        priv->library = nullptr;
         return Result::fail ("Could not instantiate plugin.");
     }
 
+    // like lilv, start with nothing connected
+    for (uint32 p = 0; p < numPorts; ++p)
+        lilv_instance_connect_port (instance, p, nullptr);
+
+    // CV ports point where they did before, bound or not
+    for (const Private::CVPort* cv : priv->cvPorts)
+        lilv_instance_connect_port (instance, cv->port, cv->getData());
+
     if (const void* data = getExtensionData (LV2_WORKER__interface))
     {
         jassert (worker != nullptr);
@@ -191,6 +516,7 @@ void LV2Module::activate()
    if (instance && ! active)
    {
        activatePorts();
+       const ScopedLock sl (*priv->instantiationLock);
        lilv_instance_activate (instance);
        active = true;
    }
@@ -200,7 +526,7 @@ void LV2Module::cleanup()
 {
    if (instance != nullptr)
    {
-       // TODO: Check if Lilv takes care of calling cleanup
+       // the plugin's cleanup is called by freeInstance()
    }
 }
 
@@ -208,6 +534,7 @@ void LV2Module::deactivate()
 {
    if (instance != nullptr && active)
    {
+       const ScopedLock sl (*priv->instantiationLock);
        lilv_instance_deactivate (instance);
        active = false;
    }
@@ -224,8 +551,17 @@ void LV2Module::freeInstance()
     {
         deactivate();
         worker = nullptr;
-        lilv_instance_free (instance);
+
+        {
+            // the world isn't touched, only calls to the same plugin wait
+            const ScopedLock il (*priv->instantiationLock);
+            if (instance->lv2_descriptor->cleanup != nullptr)
+                instance->lv2_descriptor->cleanup (instance->lv2_handle);
+        }
+
         instance = nullptr;
+        zerostruct (priv->instanceData);
+        priv->library = nullptr;
     }
 }
 
@@ -236,16 +572,8 @@ void LV2Module::setSampleRate (double newSampleRate)
 
     if (instance != nullptr)
     {
-        const bool wasActive = isActive();
-        deactivate();
-
-        freeInstance();
-        instantiate (newSampleRate);
-
+        reinstantiate (newSampleRate);
         jassert (currentSampleRate == newSampleRate);
-
-        if (wasActive)
-            activate();
     }
 }
 
@@ -264,6 +592,15 @@ void LV2Module::connectChannel (const PortType type, const int32 channel, void*
 
 void LV2Module::connectPort (uint32 port, void* data)
 {
+    const int32 slot = port < numPorts ? priv->cvSlots [port] : -1;
+    if (slot >= 0)
+    {
+        Private::CVPort* const cv = priv->cvPorts.getUnchecked (slot);
+        cv->bound = (data != nullptr);
+        cv->hostData = data;
+        data = cv->getData();
+    }
+
     lilv_instance_connect_port (instance, port, data);
 }
 
@@ -351,8 +688,30 @@ uint32 LV2Module::getMidiPort() const
    return LV2UI_INVALID_PORT_INDEX;
 }
 
+uint32 LV2Module::getTimePositionPort() const
+{
+    for (uint32 i = 0; i < getNumPorts(); ++i)
+    {
+        const LilvPort* port (getPort (i));
+        if (lilv_port_is_a (plugin, port, world.lv2_AtomPort) &&
+            lilv_port_is_a (plugin, port, world.lv2_InputPort) &&
+            lilv_port_supports_event (plugin, port, world.time_Position))
+            return i;
+    }
+
+    return LV2UI_INVALID_PORT_INDEX;
+}
+
 const LilvPlugin* LV2Module::getPlugin() const { return plugin; }
 
+uint32 LV2Module::getLatencyPort() const { return priv->latencyPort; }
+
+int LV2Module::getLatency() const
+{
+    return priv->latencyPort != LV2UI_INVALID_PORT_INDEX
+        ? jmax (0, roundToInt (priv->values [priv->latencyPort])) : 0;
+}
+
 uint32 LV2Module::getNotifyPort() const
 {
     for (uint32 i = 0; i < numPorts; ++i)
@@ -417,6 +776,11 @@ String LV2Module::getURI() const
 
 bool LV2Module::isLoaded() const { return instance != nullptr; }
 
+bool LV2Module::isInPlaceBroken() const
+{
+    return lilv_plugin_has_feature (plugin, world.lv2_InPlaceBroken);
+}
+
 bool LV2Module::hasEditor() const
 {
     bool hasJuceUI = false;
@@ -480,9 +844,15 @@ bool LV2Module::isPortOutput (uint32 index) const
 
 void LV2Module::run (uint32 nframes)
 {
+    DspProfiler::ScopedZone zone (DspProfiler::getDefault(), priv->profileId);
+
     if (worker)
         worker->processWorkResponses();
 
+    for (Private::CVPort* cv : priv->cvPorts)
+        if (cv->isInput && ! cv->bound)
+            cv->ramp.render (cv->buffer.getData(), (int) nframes, priv->values [cv->port]);
+
     lilv_instance_run (instance, nframes);
 
     if (worker)
@@ -496,3 +866,133 @@ void LV2Module::setControlValue (uint32 port, float value)
 
     priv->values [port] = value;
 }
+
+float LV2Module::getControlValue (uint32 port) const
+{
+    return port < numPorts ? priv->values [port] : 0.0f;
+}
+
+bool LV2Module::hasStateInterface() const
+{
+    return getExtensionData (LV2_STATE__interface) != nullptr;
+}
+
+Result LV2Module::saveState (ValueTree& state, const File& directory)
+{
+    if (instance == nullptr)
+        return Result::fail ("Plugin not instantiated");
+    if (directory != File() && ! directory.createDirectory())
+        return Result::fail ("Could not create " + directory.getFullPathName());
+
+    const ScopedLock sl (priv->stateLock);
+
+    state = ValueTree (LV2StateTags::state);
+    state.setProperty (LV2StateTags::uri, getURI(), nullptr);
+
+    for (uint32 p = 0; p < numPorts; ++p)
+    {
+        if (getPortType (p) != PortType::Control || ! isPortInput (p))
+            continue;
+
+        ValueTree port (LV2StateTags::port);
+        port.setProperty (LV2StateTags::symbol, priv->symbols [p], nullptr);
+        port.setProperty (LV2StateTags::value, priv->values [p], nullptr);
+        state.addChild (port, -1, nullptr);
+    }
+
+    const LV2_State_Interface* iface = (const LV2_State_Interface*) getExtensionData (LV2_STATE__interface);
+    if (iface == nullptr || iface->save == nullptr)
+        return Result::ok();
+
+    // without a directory, paths to files made while running are kept
+    // relative to the scratch directory and the files are embedded
+    LV2StateMapPath mapPath (directory != File() ? directory : priv->scratchDir, priv->scratchDir);
+    LV2StateMakePath makePath (directory);
+    Array<const LV2_Feature*> feats;
+    feats.add (mapPath.getFeature());
+    if (directory != File())
+        feats.add (makePath.getFeature());
+    feats.add (nullptr);
+
+    LV2Callbacks::StateWriter writer (state, directory, priv->scratchDir,
+                                      priv->getWorldFeature<LV2_URID_Unmap> (LV2_URID__unmap));
+    const LV2_State_Status status = iface->save (getHandle(), &LV2Callbacks::storeProperty, &writer,
+                                                 LV2_STATE_IS_POD | LV2_STATE_IS_PORTABLE,
+                                                 feats.getRawDataPointer());
+
+    return status == LV2_STATE_SUCCESS ? Result::ok()
+                                       : Result::fail ("Plugin could not save its state");
+}
+
+Result LV2Module::restoreState (const ValueTree& state, const File& directory)
+{
+    if (instance == nullptr)
+        return Result::fail ("Plugin not instantiated");
+    if (! state.hasType (LV2StateTags::state))
+        return Result::fail ("Invalid LV2 state");
+
+    LV2_URID_Map* map = priv->getWorldFeature<LV2_URID_Map> (LV2_URID__map);
+    if (map == nullptr)
+        return Result::fail ("URID map not available");
+
+    // everything is loaded in to memory before the plugin is touched
+    OwnedArray<LV2Callbacks::StateProperty> props;
+    for (int i = 0; i < state.getNumChildren(); ++i)
+    {
+        const ValueTree child (state.getChild (i));
+        if (! child.hasType (LV2StateTags::property))
+            continue;
+
+        LV2Callbacks::StateProperty* prop = props.add (new LV2Callbacks::StateProperty());
+        prop->key   = map->map (map->handle, child [LV2StateTags::key].toString().toRawUTF8());
+        prop->type  = map->map (map->handle, child [LV2StateTags::type].toString().toRawUTF8());
+        prop->flags = (uint32) (int) child [LV2StateTags::flags];
+
+        if (child.hasProperty (LV2StateTags::file))
+        {
+            const File file (directory.getChildFile (child [LV2StateTags::file].toString()));
+            if (directory == File() || ! file.loadFileAsData (prop->data))
+                return Result::fail ("Could not load " + file.getFullPathName());
+        }
+        else if (const MemoryBlock* const block = child [LV2StateTags::value].getBinaryData())
+        {
+            prop->data = *block;
+        }
+
+        // embedded files are written where the path will be mapped to
+        if (const MemoryBlock* const contents = child [LV2StateTags::embedded].getBinaryData())
+        {
+            const String path (CharPointer_UTF8 (static_cast<const char*> (prop->data.getData())), prop->data.getSize());
+            const File file ((directory != File() ? directory : priv->scratchDir).getChildFile (path));
+            if (! file.getParentDirectory().createDirectory()
+                || ! file.replaceWithData (contents->getData(), contents->getSize()))
+                return Result::fail ("Could not write " + file.getFullPathName());
+        }
+    }
+
+    const ScopedLock sl (priv->stateLock);
+
+    for (int i = 0; i < state.getNumChildren(); ++i)
+    {
+        const ValueTree child (state.getChild (i));
+        if (! child.hasType (LV2StateTags::port))
+            continue;
+
+        const int port = priv->symbols.indexOf (child [LV2StateTags::symbol].toString());
+        if (port >= 0)
+            setControlValue ((uint32) port, (float) child [LV2StateTags::value]);
+    }
+
+    const LV2_State_Interface* iface = (const LV2_State_Interface*) getExtensionData (LV2_STATE__interface);
+    if (iface == nullptr || iface->restore == nullptr)
+        return Result::ok();
+
+    LV2StateMapPath mapPath (directory != File() ? directory : priv->scratchDir);
+    const LV2_Feature* feats[] = { mapPath.getFeature(), nullptr };
+    const LV2_State_Status status = iface->restore (getHandle(), &LV2Callbacks::retrieveProperty,
+                                                    &props, LV2_STATE_IS_POD | LV2_STATE_IS_PORTABLE,
+                                                    feats);
+
+    return status == LV2_STATE_SUCCESS ? Result::ok()
+                                       : Result::fail ("Plugin could not restore its state");
+}
@@ -51,6 +51,10 @@ public:
     /** Get the port intended to be used as a MIDI input */
     uint32 getMidiPort() const;
 
+    /** Get the atom input that takes time:Position objects, or
+        LV2UI_INVALID_PORT_INDEX if the plugin doesn't follow the transport */
+    uint32 getTimePositionPort() const;
+
     /** Get the plugin's name */
     String getName() const;
 
@@ -58,6 +62,14 @@ public:
         used as a MIDI output */
     uint32 getNotifyPort() const;
 
+    /** Get the control output the plugin reports its latency on, or
+        LV2UI_INVALID_PORT_INDEX if it doesn't have one */
+    uint32 getLatencyPort() const;
+
+    /** Get the latency in samples last reported by the plugin
+        @note This is realtime safe */
+    int getLatency() const;
+
     /** Get the underlying LV2_Handle */
     LV2_Handle getHandle();
 
@@ -92,13 +104,61 @@ public:
     /** Returns true if the port is an Output */
     bool isPortOutput (uint32 port) const;
 
-    /** Set a control value */
+    /** Returns true if the plugin can't process with inputs and outputs
+        connected to the same buffers (lv2:inPlaceBroken) */
+    bool isInPlaceBroken() const;
+
+    /** Set a control value.  If the port is a CV input which isn't bound
+        to host memory, the value is ramped to over the next run cycle */
     void setControlValue (uint32 port, float value);
 
+    /** Get the current value of a control port */
+    float getControlValue (uint32 port) const;
+
+    /** Returns true if the plugin implements the LV2 State interface */
+    bool hasStateInterface() const;
+
+    /** Save the plugin's state and control port values
+        @param state      Receives the saved state
+        @param directory  If not File(), files the plugin makes and property values
+                          larger than KV_LV2_STATE_MAX_INLINE bytes are written here
+                          instead of being stored inline. Otherwise files the plugin
+                          made while running are embedded in the state, so it
+                          doesn't refer to anything that goes with the instance
+        @note This is NOT realtime safe, but may be called from any other thread */
+    Result saveState (ValueTree& state, const File& directory = File());
+
+    /** Restore a state created with saveState
+        @param state      The state to restore
+        @param directory  The directory the state was saved with, if any
+        @note Files are loaded before the plugin is touched, but this must
+        not be called concurrently with run */
+    Result restoreState (const ValueTree& state, const File& directory = File());
+
+    /** Set the largest number of frames run will be called with. This sizes
+        the buffers CV ports use when they aren't bound to host memory, and
+        is the block length given to the plugin in its options.  If the
+        plugin wants fixed blocks or the size grows past what it was given,
+        the plugin is re-instantiated with its state carried over.
+        @note Call this before activate */
+    void setMaxBlockSize (uint32 maxFrames);
+
+    /** Get the largest number of frames run will be called with */
+    inline uint32 getMaxBlockSize() const { return maxBlockSize; }
+
+    /** Returns true if the plugin wants run to always be called with the
+        same number of frames (bufsz:fixedBlockLength).  If it does, the host
+        must run it with getMaxBlockSize() frames each cycle */
+    bool wantsFixedBlockLength() const;
+
+    /** Returns true if the plugin wants to be run with a power of two
+        number of frames (bufsz:powerOf2BlockLength) */
+    bool wantsPowerOf2BlockLength() const;
+
     /** Set the sample rate for this plugin
         @param newSampleRate The new rate to use
-        @note This will re-instantiate the plugin, use it only if you
-        really need to */
+        @note This will re-instantiate the plugin with its state carried over,
+        use it only if you really need to */
     void setSampleRate (double newSampleRate);
 
     /** Get the plugin's extension data
@@ -109,7 +169,9 @@ public:
 
     /** Instantiate the Plugin
         @param samplerate The samplerate to use
-        @note This is in the LV2 Instantiation Threading class */
+        @note This is in the LV2 Instantiation Threading class. Different
+        modules can be instantiated from different threads at once, calls
+        for the same plugin URI are serialized */
     Result instantiate (double samplerate);
 
     /** Activate the plugin
@@ -137,7 +199,9 @@ public:
 
     /** Connect a port to a data location
         @param port The port index to connect
-        @param data A pointer to the port buffer that should be used
+        @param data A pointer to the port buffer that should be used.  CV
+                    ports may be passed nullptr to return to the module's
+                    internal, control value driven, buffer
         @note This is in the LV2 Audio (realtime) Threading class */
     void connectPort (uint32 port, void* data);
 
@@ -154,12 +218,14 @@ private:
     bool active;
     double currentSampleRate;
     uint32 numPorts;
+    uint32 maxBlockSize;
     Array<const LV2_Feature*> features;
     ScopedPointer<RingBuffer> events;
 
     Result allocateEventBuffers();
     void activatePorts();
     void freeInstance();
+    void reinstantiate (double samplerate);
     void init();
 
     class Private;
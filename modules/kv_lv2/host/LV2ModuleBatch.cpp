@@ -0,0 +1,165 @@
+/*
+    This file is part of the Kushview Modules for JUCE
+    Copyright (C) 2014-2017  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+class LV2ModuleBatch::Job : public ThreadPoolJob
+{
+public:
+    Job (LV2ModuleBatch& b, const String& u, double rate, int blockSize, bool shouldActivate)
+        : ThreadPoolJob ("LV2 Instantiate"),
+          uri (u), sampleRate (rate),
+          maxBlockSize (blockSize), activate (shouldActivate),
+          result (Result::ok()), batch (b)
+    { }
+
+    JobStatus runJob()
+    {
+        const double start = Time::getMillisecondCounterHiRes();
+        result = load (start);
+        timing.total = Time::getMillisecondCounterHiRes() - start;
+        if (result.failed())
+            module = nullptr;
+
+        batch.jobFinished();
+        return jobHasFinished;
+    }
+
+    const String uri;
+    const double sampleRate;
+    const int maxBlockSize;
+    const bool activate;
+
+    Result result;
+    Timing timing;
+    ScopedPointer<LV2Module> module;
+
+private:
+    LV2ModuleBatch& batch;
+
+    Result load (double start)
+    {
+        {
+            const ScopedLock sl (batch.world.getLock());
+            module = batch.world.createModule (uri);
+        }
+
+        double now = Time::getMillisecondCounterHiRes();
+        timing.create = now - start;
+        if (module == nullptr)
+            return Result::fail ("Plugin not found: " + uri);
+
+        module->setMaxBlockSize ((uint32) jmax (1, maxBlockSize));
+        const Result res (module->instantiate (sampleRate));
+        timing.instantiate = Time::getMillisecondCounterHiRes() - now;
+        if (res.failed())
+            return res;
+
+        if (activate)
+        {
+            now = Time::getMillisecondCounterHiRes();
+            module->activate();
+            timing.activate = Time::getMillisecondCounterHiRes() - now;
+        }
+
+        return Result::ok();
+    }
+};
+
+LV2ModuleBatch::LV2ModuleBatch (LV2World& w)
+    : world (w), finished (true), started (false)
+{ }
+
+LV2ModuleBatch::~LV2ModuleBatch()
+{
+    for (Job* job : jobs)
+        world.getThreadPool().removeJob (job, false, -1);
+    jobs.clear();
+}
+
+int LV2ModuleBatch::add (const String& uri, double sampleRate, int maxBlockSize, bool activate)
+{
+    jassert (! started);
+    jobs.add (new Job (*this, uri, sampleRate, maxBlockSize, activate));
+    return jobs.size() - 1;
+}
+
+void LV2ModuleBatch::start()
+{
+    jassert (! started);
+    if (started)
+        return;
+
+    started = true;
+    numPending.set (jobs.size());
+
+    if (jobs.size() <= 0)
+    {
+        finished.signal();
+        if (onFinished)
+            onFinished();
+        return;
+    }
+
+    ThreadPool& pool (world.getThreadPool());
+    for (Job* job : jobs)
+        pool.addJob (job, false);
+}
+
+bool LV2ModuleBatch::isFinished() const
+{
+    return started && numPending.get() == 0;
+}
+
+bool LV2ModuleBatch::waitForCompletion (int timeoutMilliseconds)
+{
+    return started && finished.wait (timeoutMilliseconds);
+}
+
+Result LV2ModuleBatch::getResult (int index) const
+{
+    jassert (isFinished());
+    if (Job* job = jobs [index])
+        return job->result;
+    return Result::fail ("Invalid job index");
+}
+
+LV2ModuleBatch::Timing LV2ModuleBatch::getTiming (int index) const
+{
+    jassert (isFinished());
+    if (Job* job = jobs [index])
+        return job->timing;
+    return Timing();
+}
+
+LV2Module* LV2ModuleBatch::releaseModule (int index)
+{
+    jassert (isFinished());
+    if (Job* job = jobs [index])
+        return job->module.release();
+    return nullptr;
+}
+
+void LV2ModuleBatch::jobFinished()
+{
+    if (--numPending == 0)
+    {
+        finished.signal();
+        if (onFinished)
+            onFinished();
+    }
+}
@@ -0,0 +1,95 @@
+/*
+    This file is part of the Kushview Modules for JUCE
+    Copyright (C) 2014-2017  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#ifndef EL_LV2MODULEBATCH_H
+#define EL_LV2MODULEBATCH_H
+
+/** Creates and instantiates many LV2Modules on a thread pool.
+
+    Modules are loaded on the LV2World's thread pool, off the calling thread.
+    The world's lock is held only while a plugin's binary and descriptor are
+    looked up. Plugin constructors, activation and everything else run
+    concurrently, calls in the LV2 Instantiation threading class are only
+    serialized per plugin URI. Hold
+    LV2World::getLock() if using the LilvWorld while a batch runs */
+class LV2ModuleBatch
+{
+public:
+    /** Time spent on a single plugin, in milliseconds */
+    struct Timing
+    {
+        Timing() : create (0.0), instantiate (0.0), activate (0.0), total (0.0) { }
+        double create, instantiate, activate, total;
+    };
+
+    LV2ModuleBatch (LV2World& world);
+
+    /** Destructor. This waits for jobs already running to finish and
+        deletes any modules which weren't released */
+    ~LV2ModuleBatch();
+
+    /** Queue a plugin to be loaded
+        @param uri           The plugin to load
+        @param sampleRate    The rate to instantiate with
+        @param maxBlockSize  The largest block the module will run with
+        @param activate      If true, the module is activated after instantiating
+        @returns The index of the job */
+    int add (const String& uri, double sampleRate, int maxBlockSize = 4096, bool activate = false);
+
+    /** Start all queued jobs */
+    void start();
+
+    /** Returns true if started and every job has finished */
+    bool isFinished() const;
+
+    /** Wait for every job to finish
+        @returns true if finished before the timeout */
+    bool waitForCompletion (int timeoutMilliseconds = -1);
+
+    /** Get the number of jobs */
+    inline int size() const { return jobs.size(); }
+
+    /** Get the result of a job */
+    Result getResult (int index) const;
+
+    /** Get how long a job took */
+    Timing getTiming (int index) const;
+
+    /** Take ownership of a loaded module.
+        @returns The module or nullptr if it failed to load */
+    LV2Module* releaseModule (int index);
+
+    /** Called from a pool thread when the last job finishes */
+    std::function<void()> onFinished;
+
+private:
+    class Job;
+    friend class Job;
+    LV2World& world;
+    OwnedArray<Job> jobs;
+    Atomic<int> numPending;
+    WaitableEvent finished;
+    bool started;
+
+    void jobFinished();
+
+    JUCE_DECLARE_NON_COPYABLE (LV2ModuleBatch)
+};
+
+#endif /* EL_LV2MODULEBATCH_H */
@@ -30,14 +30,23 @@
 
 static ScopedPointer<URIs> uris;
 
-class LV2PluginInstance     : public Processor
+class LV2PluginInstance     : public Processor,
+                              public AsyncUpdater
 {
 public:
     LV2PluginInstance (LV2World& world, LV2Module* module_)
         : wantsMidiMessages (false),
           initialised (false),
           isPowerOn (false),
+          inPlaceBroken (true),
+          fixedBlocks (false),
+          fixedBlockSize (0),
+          pluginLatency (0),
+          positionSent (false),
+          expectedFrame (0),
           tempBuffer (1, 1),
+          blockIn (1, 1), blockOut (1, 1),
+          inFifo (1, 1), outFifo (1, 1),
           module (module_)
     {
         LV2_URID_Map* map = nullptr;
@@ -52,10 +61,16 @@ public:
 
         atomSequence = map->map (map->handle, LV2_ATOM__Sequence);
         midiEvent    = map->map (map->handle, LV2_MIDI__MidiEvent);
+        lv2_atom_forge_init (&forge, map);
 
+        profileId  = DspProfiler::getDefault().registerNode (module->getName());
         numPorts   = module->getNumPorts();
         midiPort   = module->getMidiPort();
         notifyPort = module->getNotifyPort();
+        positionPort = module->getTimePositionPort();
+        inPlaceBroken = module->isInPlaceBroken();
+        positions.ensureStorageAllocated (Shuttle::maxSegments);
+        lastPosition.resetToDefault();
 
         buffers.ensureStorageAllocated (numPorts);
         while (buffers.size() < numPorts)
@@ -112,14 +127,18 @@ public:
             }
         }
 
+        // CV ports are presented to the host as audio channels following
+        // the plugin's audio ports
         const ChannelConfig& channels (module->getChannelConfig());
-        setPlayConfigDetails (channels.getNumAudioInputs(),
-                              channels.getNumAudioOutputs(), 44100.0, 1024);
+        setPlayConfigDetails (channels.getNumAudioInputs() + channels.getNumCVInputs(),
+                              channels.getNumAudioOutputs() + channels.getNumCVOutputs(),
+                              44100.0, 1024);
     }
 
 
     ~LV2PluginInstance()
     {
+        DspProfiler::getDefault().unregisterNode (profileId);
         module = nullptr;
     }
 
@@ -155,8 +174,10 @@ public:
         desc.manufacturerName = module->getAuthorName();
         desc.version = "";
 
-        desc.numInputChannels  = module->getNumPorts (PortType::Audio, true);
-        desc.numOutputChannels = module->getNumPorts (PortType::Audio, false);
+        desc.numInputChannels  = module->getNumPorts (PortType::Audio, true) +
+                                 module->getNumPorts (PortType::CV, true);
+        desc.numOutputChannels = module->getNumPorts (PortType::Audio, false) +
+                                 module->getNumPorts (PortType::CV, false);
         desc.isInstrument = module->getMidiPort() != LV2UI_INVALID_PORT_INDEX;
     }
 
@@ -190,15 +211,64 @@ public:
     void prepareToPlay (double sampleRate, int blockSize)
     {
         const ChannelConfig& channels (module->getChannelConfig());
-        setPlayConfigDetails (channels.getNumAudioInputs(),
-                              channels.getNumAudioOutputs(),
+        setPlayConfigDetails (channels.getNumAudioInputs() + channels.getNumCVInputs(),
+                              channels.getNumAudioOutputs() + channels.getNumCVOutputs(),
                               sampleRate, blockSize);
         initialise();
 
         if (initialised)
         {
+            // plugins wanting fixed or power of two blocks always run through
+            // a FIFO which re-blocks the host's audio, at the cost of one block
+            // of latency. The host may call with shorter blocks than it said,
+            // and padding those out would run the plugin on time that never
+            // happened
+            fixedBlocks = module->wantsFixedBlockLength() || module->wantsPowerOf2BlockLength();
+            fixedBlockSize = module->wantsPowerOf2BlockLength() ? nextPowerOfTwo (blockSize) : blockSize;
+
             module->setSampleRate (sampleRate);
-            tempBuffer.setSize (jmax (1, getTotalNumOutputChannels()), blockSize);
+            module->setMaxBlockSize ((uint32) fixedBlockSize);
+            positionSent = false;
+            tempBuffer.setSize (inPlaceBroken ? jmax (1, getTotalNumOutputChannels()) : 1,
+                                inPlaceBroken ? blockSize : 1);
+
+            // setting the rate or block size can re-instantiate the plugin
+            for (uint32 p = 0; p < numPorts; ++p)
+                if (PortBuffer* const buf = buffers.getUnchecked (p))
+                    module->connectPort (p, buf->getPortData());
+
+            if (fixedBlocks)
+            {
+                const int numIns  = jmax (1, getTotalNumInputChannels());
+                const int numOuts = jmax (1, getTotalNumOutputChannels());
+                blockIn.setSize (numIns, fixedBlockSize);
+                blockOut.setSize (numOuts, fixedBlockSize);
+                blockIn.clear();
+                blockOut.clear();
+
+                inFifo.setSize (numIns, fixedBlockSize + blockSize + 1);
+                outFifo.setSize (numOuts, fixedBlockSize * 2 + blockSize + 1);
+
+                // output is primed with a block of silence, which is the latency
+                outFifo.write (blockOut, fixedBlockSize);
+            }
+            else
+            {
+                inFifo.setSize (1, 1);
+                outFifo.setSize (1, 1);
+                blockIn.setSize (1, 1);
+                blockOut.setSize (1, 1);
+            }
+
+            // segments and re-blocking both build MIDI in these on the audio
+            // thread
+            midiIn.clear(); midiIn.ensureSize (4096);
+            midiOut.clear(); midiOut.ensureSize (4096);
+            midiBlock.clear(); midiBlock.ensureSize (4096);
+            midiScratch.clear(); midiScratch.ensureSize (4096);
+
+            pluginLatency = module->getLatency();
+            setLatencySamples (pluginLatency + getBufferingLatency());
             module->activate();
         }
     }
@@ -213,6 +283,7 @@ public:
 
     void processBlock (AudioSampleBuffer& audio, MidiBuffer& midi)
     {
+        DspProfiler::ScopedZone zone (DspProfiler::getDefault(), profileId);
         const int32 numSamples = audio.getNumSamples();
 
         if (! initialised)
@@ -223,66 +294,31 @@ public:
             return;
         }
 
-        if (AudioPlayHead* const playHead = getPlayHead ())
+        // re-blocked plugins aren't sent time:Position, their blocks lag the
+        // host's by the buffering latency so no segment lines up with them
+        if (fixedBlocks)
         {
-            AudioPlayHead::CurrentPositionInfo position;
-            playHead->getCurrentPosition (position);
-
-            if (position.isLooping)
-            { }
-            else
-            { }
-        }
-
-        const ChannelConfig& chans (module->getChannelConfig());
-
-        for (PortBuffer* buf : buffers) {
-            if (buf)
-                buf->clear();
+            processFixedBlocks (audio, midi);
+            return;
         }
 
-        if (wantsMidiMessages)
+        // run once per transport segment, so the plugin's blocks start
+        // exactly where the loop wraps or the transport jumps
+        if (Shuttle* const shuttle = dynamic_cast<Shuttle*> (getPlayHead()))
         {
-            PortBuffer* const buf = buffers.getUnchecked (midiPort);
-
-            MidiBuffer::Iterator iter (midi);
-            const uint8* d = nullptr;  int s = 0, f = 0;
-
-            while (iter.getNextEvent (d, s, f)) {
-                buf->addEvent (f, (uint32)s, midiEvent, d);
+            if (shuttle->prepareBlock (numSamples) > 1)
+            {
+                processSegments (*shuttle, audio, midi);
+                return;
             }
         }
 
-        for (int32 i = getTotalNumInputChannels(); --i >= 0;)
-            module->connectPort (chans.getAudioInputPort(i), audio.getWritePointer (i));
-
-        for (int32 i = getTotalNumOutputChannels(); --i >= 0;)
-            module->connectPort (chans.getAudioOutputPort(i), tempBuffer.getWritePointer (i));
-
-        module->run ((uint32) numSamples);
-
-        for (int32 i = getTotalNumOutputChannels(); --i >= 0;)
-            audio.copyFrom (i, 0, tempBuffer.getWritePointer (i), numSamples);
-
-        if (notifyPort != LV2UI_INVALID_PORT_INDEX)
-        {
-            PortBuffer* const buf = buffers.getUnchecked (notifyPort);
-            jassert (buf != nullptr);
+        queueBlockPositions (numSamples);
+        runCycle (audio, inPlaceBroken ? tempBuffer : audio, numSamples, midi, midi);
 
-            midi.clear();
-            LV2_ATOM_SEQUENCE_FOREACH ((LV2_Atom_Sequence*) buf->getPortData(), ev)
-            {
-                if (ev->body.type == uris->midi_MidiEvent)
-                {
-                    midi.addEvent (LV2_ATOM_BODY_CONST (&ev->body),
-                                   ev->body.size, (int32)ev->time.frames);
-                }
-            }
-        }
-        else
-        {
-            midi.clear();
-        }
+        if (inPlaceBroken)
+            for (int32 i = getTotalNumOutputChannels(); --i >= 0;)
+                audio.copyFrom (i, 0, tempBuffer.getReadPointer (i), numSamples);
     }
 
     bool hasEditor() const { return module->hasEditor(); }
@@ -292,9 +328,12 @@ public:
     const String getInputChannelName (int index) const
     {
         const ChannelConfig& chans (module->getChannelConfig());
-        if (! isPositiveAndBelow (index, chans.getNumAudioInputs()))
-            return String ("Audio In ") + String (index + 1);
-        return module->getPortName (chans.getAudioPort (index, true));
+        const int numAudio = chans.getNumAudioInputs();
+        if (isPositiveAndBelow (index, numAudio))
+            return module->getPortName (chans.getAudioPort (index, true));
+        if (isPositiveAndBelow (index - numAudio, chans.getNumCVInputs()))
+            return module->getPortName (chans.getCVPort (index - numAudio, true));
+        return String ("Audio In ") + String (index + 1);
     }
 
     bool isInputChannelStereoPair (int index) const { return false; }
@@ -302,10 +341,12 @@ public:
     const String getOutputChannelName (int index) const
     {
         const ChannelConfig& chans (module->getChannelConfig());
-        if (! isPositiveAndBelow (index, chans.getNumAudioOutputs()))
-            return String ("Audio Out ") + String (index + 1);
-
-        return module->getPortName (chans.getAudioPort (index, false));
+        const int numAudio = chans.getNumAudioOutputs();
+        if (isPositiveAndBelow (index, numAudio))
+            return module->getPortName (chans.getAudioPort (index, false));
+        if (isPositiveAndBelow (index - numAudio, chans.getNumCVOutputs()))
+            return module->getPortName (chans.getCVPort (index - numAudio, false));
+        return String ("Audio Out ") + String (index + 1);
     }
 
     bool isOutputChannelStereoPair (int index) const { return false; }
@@ -389,26 +430,318 @@ public:
     void changeProgramName (int /*index*/, const String& /*name*/) { }
 
     //==============================================================================
-    void getStateInformation (MemoryBlock& mb)                  { ; }
+    void getStateInformation (MemoryBlock& mb)
+    {
+        // the plugin is allowed to save while running
+        ValueTree state;
+        if (module->saveState (state).wasOk())
+        {
+            MemoryOutputStream stream (mb, false);
+            state.writeToStream (stream);
+        }
+    }
+
     void getCurrentProgramStateInformation (MemoryBlock& mb)    { ; }
-    void setStateInformation (const void* data, int size)               { ; }
+
+    void setStateInformation (const void* data, int size)
+    {
+        const ValueTree state (ValueTree::readFromData (data, (size_t) size));
+        if (! state.isValid())
+            return;
+
+        // restoring can't happen during run, but the state is decoded first
+        // so processing is only held off while the plugin applies it
+        suspendProcessing (true);
+        const Result res (module->restoreState (state));
+        suspendProcessing (false);
+
+        if (res.failed())
+            return;
+
+        for (LV2Parameter* param : params)
+            param->setValue (module->getControlValue (param->getPortIndex()));
+    }
+
     void setCurrentProgramStateInformation (const void* data, int size) { ; }
 
+    //==============================================================================
+    /** Runs the plugin once. Inputs are bound to ins, outputs to outs and
+        MIDI before numSamples is sent to the plugin's MIDI port */
+    void runCycle (AudioSampleBuffer& ins, AudioSampleBuffer& outs, const int numSamples,
+                   const MidiBuffer& midiInput, MidiBuffer& midiOutput)
+    {
+        const ChannelConfig& chans (module->getChannelConfig());
+
+        for (PortBuffer* buf : buffers) {
+            if (buf)
+                buf->clear();
+        }
+
+        // positions share the MIDI port's sequence on most plugins, so they
+        // are merged in time order, ahead of notes at the same frame
+        int nextPosition = 0;
+        PortBuffer* const positionBuf = positionPort != LV2UI_INVALID_PORT_INDEX
+                                      ? buffers.getUnchecked (positionPort) : nullptr;
+
+        if (wantsMidiMessages)
+        {
+            PortBuffer* const buf = buffers.getUnchecked (midiPort);
+
+            MidiBuffer::Iterator iter (midiInput);
+            const uint8* d = nullptr;  int s = 0, f = 0;
+
+            while (iter.getNextEvent (d, s, f) && f < numSamples) {
+                if (positionBuf == buf)
+                    while (nextPosition < positions.size() && positions.getReference (nextPosition).frame <= f)
+                        writePosition (*buf, positions.getReference (nextPosition++));
+                buf->addEvent (f, (uint32)s, midiEvent, d);
+            }
+        }
+
+        if (positionBuf != nullptr)
+            while (nextPosition < positions.size())
+                writePosition (*positionBuf, positions.getReference (nextPosition++));
+        positions.clearQuick();
+
+        const int32 numAudioIns  = chans.getNumAudioInputs();
+        const int32 numAudioOuts = chans.getNumAudioOutputs();
+
+        // inputs, audio and CV, are bound straight to the host's buffers
+        for (int32 i = numAudioIns; --i >= 0;)
+            module->connectPort (chans.getAudioInputPort (i), ins.getWritePointer (i));
+        for (int32 i = chans.getNumCVInputs(); --i >= 0;)
+            module->connectPort (chans.getCVInputPort (i), ins.getWritePointer (numAudioIns + i));
+
+        // so are outputs, the caller decides if that's in-place
+        for (int32 i = numAudioOuts; --i >= 0;)
+            module->connectPort (chans.getAudioOutputPort (i), outs.getWritePointer (i));
+        for (int32 i = chans.getNumCVOutputs(); --i >= 0;)
+            module->connectPort (chans.getCVOutputPort (i), outs.getWritePointer (numAudioOuts + i));
+
+        module->run ((uint32) numSamples);
+
+        // the host is told about latency changes from the message thread
+        const int latency = module->getLatency();
+        if (latency != pluginLatency)
+        {
+            pluginLatency = latency;
+            triggerAsyncUpdate();
+        }
+
+        midiOutput.clear();
+        if (notifyPort != LV2UI_INVALID_PORT_INDEX)
+        {
+            PortBuffer* const buf = buffers.getUnchecked (notifyPort);
+            jassert (buf != nullptr);
+
+            LV2_ATOM_SEQUENCE_FOREACH ((LV2_Atom_Sequence*) buf->getPortData(), ev)
+            {
+                if (ev->body.type == uris->midi_MidiEvent)
+                {
+                    midiOutput.addEvent (LV2_ATOM_BODY_CONST (&ev->body),
+                                         ev->body.size, (int32)ev->time.frames);
+                }
+            }
+        }
+    }
+
+    /** Re-blocks the host's audio and MIDI in to fixed size blocks */
+    void processFixedBlocks (AudioSampleBuffer& audio, MidiBuffer& midi)
+    {
+        const int numSamples = audio.getNumSamples();
+        jassert (numSamples <= fixedBlockSize);
+
+        // incoming MIDI is timed from the FIFO's read position
+        midiIn.addEvents (midi, 0, numSamples, inFifo.getNumReady());
+        inFifo.write (getTotalNumInputChannels() > 0 ? audio : blockIn, numSamples);
+
+        while (inFifo.getNumReady() >= fixedBlockSize)
+        {
+            inFifo.readFromFifo (blockIn, fixedBlockSize);
+            runCycle (blockIn, blockOut, fixedBlockSize, midiIn, midiBlock);
+            shiftMidi (midiIn, fixedBlockSize);
+
+            midiOut.addEvents (midiBlock, 0, fixedBlockSize, outFifo.getNumReady());
+            outFifo.write (blockOut, fixedBlockSize);
+        }
+
+        midi.clear();
+        midi.addEvents (midiOut, 0, numSamples, 0);
+        shiftMidi (midiOut, numSamples);
+
+        if (getTotalNumOutputChannels() > 0)
+            outFifo.readFromFifo (audio, numSamples);
+        else
+            outFifo.readFromFifo (blockOut, numSamples);
+    }
+
+    /** Runs the plugin for each segment of the shuttle's block */
+    void processSegments (Shuttle& shuttle, AudioSampleBuffer& audio, MidiBuffer& midi)
+    {
+        AudioSampleBuffer& outs (inPlaceBroken ? tempBuffer : audio);
+        midiOut.clear();
+
+        for (int i = 0; i < shuttle.getNumSegments(); ++i)
+        {
+            const Shuttle::Segment& segment (shuttle.getSegment (i));
+            shuttle.setCurrentSegment (i);
+
+            AudioSampleBuffer segmentIn (audio.getArrayOfWritePointers(), audio.getNumChannels(),
+                                         segment.offset, segment.numFrames);
+            AudioSampleBuffer segmentOut (outs.getArrayOfWritePointers(), outs.getNumChannels(),
+                                          segment.offset, segment.numFrames);
+
+            midiIn.clear();
+            midiIn.addEvents (midi, segment.offset, segment.numFrames, -segment.offset);
+            queuePosition (shuttle, 0, segment.numFrames);
+            runCycle (segmentIn, segmentOut, segment.numFrames, midiIn, midiBlock);
+            midiOut.addEvents (midiBlock, 0, segment.numFrames, segment.offset);
+        }
+
+        shuttle.setCurrentSegment (0);
+
+        // copied rather than swapped, so midiOut keeps its reserved storage
+        midi.clear();
+        midi.addEvents (midiOut, 0, -1, 0);
+
+        if (inPlaceBroken)
+            for (int32 i = getTotalNumOutputChannels(); --i >= 0;)
+                audio.copyFrom (i, 0, tempBuffer.getReadPointer (i), audio.getNumSamples());
+    }
+
+    //==============================================================================
+    /** A time:Position for the next run, at a frame in it */
+    struct PendingPosition
+    {
+        int frame;
+        AudioPlayHead::CurrentPositionInfo info;
+    };
+
+    /** Queues the play head's position for the next run if it moved other
+        than by playing on since the last one sent */
+    void queuePosition (AudioPlayHead& playHead, int frame, int numFrames)
+    {
+        AudioPlayHead::CurrentPositionInfo info;
+        if (positionPort == LV2UI_INVALID_PORT_INDEX || ! playHead.getCurrentPosition (info))
+            return;
+
+        const bool changed = ! positionSent
+            || info.isPlaying != lastPosition.isPlaying
+            || info.bpm != lastPosition.bpm
+            || info.timeSigNumerator != lastPosition.timeSigNumerator
+            || info.timeSigDenominator != lastPosition.timeSigDenominator
+            || info.timeInSamples != expectedFrame;
+
+        expectedFrame = info.timeInSamples + (info.isPlaying ? numFrames : 0);
+        if (! changed || positions.size() >= Shuttle::maxSegments)
+            return;
+
+        const PendingPosition position = { frame, info };
+        positions.add (position);
+        lastPosition = info;
+        positionSent = true;
+    }
+
+    /** Queues the position of each segment of the block in one run. A
+        Shuttle's segments start at their offsets, other play heads are
+        sent at the start of the block */
+    void queueBlockPositions (int numSamples)
+    {
+        AudioPlayHead* const playHead = getPlayHead();
+        if (positionPort == LV2UI_INVALID_PORT_INDEX || playHead == nullptr)
+            return;
+
+        Shuttle* const shuttle = dynamic_cast<Shuttle*> (playHead);
+        if (shuttle == nullptr)
+        {
+            queuePosition (*playHead, 0, numSamples);
+            return;
+        }
+
+        const int numSegments = shuttle->prepareBlock (numSamples);
+        for (int i = 0; i < numSegments; ++i)
+        {
+            const Shuttle::Segment& segment (shuttle->getSegment (i));
+            shuttle->setCurrentSegment (i);
+            queuePosition (*shuttle, segment.offset, segment.numFrames);
+        }
+
+        shuttle->setCurrentSegment (0);
+    }
+
+    /** Adds a time:Position object to a port's sequence */
+    void writePosition (PortBuffer& buf, const PendingPosition& position)
+    {
+        const AudioPlayHead::CurrentPositionInfo& info (position.info);
+        const double beatUnit = info.timeSigDenominator > 0 ? (double) info.timeSigDenominator : 4.0;
+        const double beat = info.ppqPosition * beatUnit / 4.0;
+        const double barBeat = (info.ppqPosition - info.ppqPositionOfLastBarStart) * beatUnit / 4.0;
+
+        uint8 space [256];
+        lv2_atom_forge_set_buffer (&forge, space, sizeof (space));
+
+        LV2_Atom_Forge_Frame frame;
+        LV2_Atom* const atom = lv2_atom_forge_deref (&forge, lv2_atom_forge_object (&forge, &frame, 0, uris->time_Position));
+        lv2_atom_forge_key (&forge, uris->time_frame);
+        lv2_atom_forge_long (&forge, info.timeInSamples);
+        lv2_atom_forge_key (&forge, uris->time_speed);
+        lv2_atom_forge_float (&forge, info.isPlaying ? 1.f : 0.f);
+        lv2_atom_forge_key (&forge, uris->time_beat);
+        lv2_atom_forge_double (&forge, beat);
+        lv2_atom_forge_key (&forge, uris->time_barBeat);
+        lv2_atom_forge_float (&forge, (float) barBeat);
+        lv2_atom_forge_key (&forge, uris->time_beatUnit);
+        lv2_atom_forge_int (&forge, (int32) beatUnit);
+        lv2_atom_forge_key (&forge, uris->time_beatsPerBar);
+        lv2_atom_forge_float (&forge, (float) info.timeSigNumerator);
+        lv2_atom_forge_key (&forge, uris->time_beatsPerMinute);
+        lv2_atom_forge_float (&forge, (float) info.bpm);
+        lv2_atom_forge_pop (&forge, &frame);
+
+        if (atom != nullptr)
+            buf.addEvent (position.frame, atom->size, atom->type, (const uint8*) LV2_ATOM_BODY_CONST (atom));
+    }
+
+    /** Drops events before numSamples and moves the rest earlier */
+    void shiftMidi (MidiBuffer& buffer, const int numSamples)
+    {
+        midiScratch.clear();
+        midiScratch.addEvents (buffer, numSamples, -1, -numSamples);
+        buffer.swapWith (midiScratch);
+    }
+
     //==============================================================================
     void timerCallback() { }
 
+    /** Latency added by re-blocking the host's audio */
+    inline int getBufferingLatency() const { return fixedBlocks ? fixedBlockSize : 0; }
+
     void handleAsyncUpdate()
     {
+        setLatencySamples (pluginLatency + getBufferingLatency());
+
         // indicates that something about the plugin has changed..
         // updateHostDisplay();
     }
 
 private:
     CriticalSection lock, midiInLock;
-    bool wantsMidiMessages, initialised, isPowerOn;
+    bool wantsMidiMessages, initialised, isPowerOn, inPlaceBroken;
+    bool fixedBlocks;
+    int fixedBlockSize;
+    int pluginLatency;
     mutable StringArray programNames;
 
+    LV2_Atom_Forge forge;
+    Array<PendingPosition> positions;
+    AudioPlayHead::CurrentPositionInfo lastPosition;
+    bool positionSent;
+    int64 expectedFrame;
+
     AudioSampleBuffer tempBuffer;
+    AudioSampleBuffer blockIn, blockOut;
+    AudioRingBuffer<float> inFifo, outFifo;
+    MidiBuffer midiIn, midiOut, midiBlock, midiScratch;
     ScopedPointer<LV2Module> module;
     OwnedArray<LV2Parameter> params;
     OwnedArray<PortBuffer> buffers;
@@ -416,7 +749,9 @@ private:
     uint32 numPorts;
     uint32 midiPort;
     uint32 notifyPort;
+    uint32 positionPort;
     uint32 atomSequence, midiEvent;
+    int profileId;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LV2PluginInstance)
 };
@@ -0,0 +1,155 @@
+/*
+    This file is part of the Kushview Modules for JUCE
+    Copyright (C) 2014-2017  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+class LV2StateBatch::Job : public ThreadPoolJob
+{
+public:
+    Job (LV2StateBatch& b, LV2Module* m, const File& d, bool save)
+        : ThreadPoolJob (save ? "LV2 State Save" : "LV2 State Restore"),
+          batch (b), module (m), directory (d), isSave (save),
+          result (Result::ok())
+    {
+        jassert (module != nullptr);
+    }
+
+    JobStatus runJob()
+    {
+        result = isSave ? save() : restore();
+        batch.jobFinished();
+        return jobHasFinished;
+    }
+
+    Result getResult() const { return result; }
+
+private:
+    LV2StateBatch& batch;
+    LV2Module* module;
+    const File directory;
+    const bool isSave;
+    Result result;
+
+    File getStateFile() const { return directory.getChildFile ("state.bin"); }
+
+    Result save()
+    {
+        ValueTree state;
+        const Result res (module->saveState (state, directory));
+        if (res.failed())
+            return res;
+
+        MemoryOutputStream data;
+        state.writeToStream (data);
+        if (! getStateFile().replaceWithData (data.getData(), data.getDataSize()))
+            return Result::fail ("Could not write " + getStateFile().getFullPathName());
+
+        return Result::ok();
+    }
+
+    Result restore()
+    {
+        FileInputStream stream (getStateFile());
+        if (! stream.openedOk())
+            return Result::fail ("Could not read " + getStateFile().getFullPathName());
+
+        const ValueTree state (ValueTree::readFromStream (stream));
+        return module->restoreState (state, directory);
+    }
+};
+
+LV2StateBatch::LV2StateBatch (LV2World& w)
+    : world (w), finished (true), started (false)
+{ }
+
+LV2StateBatch::~LV2StateBatch()
+{
+    for (Job* job : jobs)
+        world.getThreadPool().removeJob (job, false, -1);
+    jobs.clear();
+}
+
+void LV2StateBatch::addSave (LV2Module* module, const File& directory)
+{
+    jassert (! started);
+    jobs.add (new Job (*this, module, directory, true));
+}
+
+void LV2StateBatch::addRestore (LV2Module* module, const File& directory)
+{
+    jassert (! started);
+    jobs.add (new Job (*this, module, directory, false));
+}
+
+void LV2StateBatch::start()
+{
+    jassert (! started);
+    if (started)
+        return;
+
+    started = true;
+    numPending.set (jobs.size());
+
+    if (jobs.size() <= 0)
+    {
+        finished.signal();
+        if (onFinished)
+            onFinished();
+        return;
+    }
+
+    ThreadPool& pool (world.getThreadPool());
+    for (Job* job : jobs)
+        pool.addJob (job, false);
+}
+
+bool LV2StateBatch::isFinished() const
+{
+    return started && numPending.get() == 0;
+}
+
+bool LV2StateBatch::waitForCompletion (int timeoutMilliseconds)
+{
+    return started && finished.wait (timeoutMilliseconds);
+}
+
+Result LV2StateBatch::getResult (int index) const
+{
+    jassert (isFinished());
+    if (Job* job = jobs [index])
+        return job->getResult();
+    return Result::fail ("Invalid job index");
+}
+
+Result LV2StateBatch::getResult() const
+{
+    jassert (isFinished());
+    for (const Job* job : jobs)
+        if (job->getResult().failed())
+            return job->getResult();
+    return Result::ok();
+}
+
+void LV2StateBatch::jobFinished()
+{
+    if (--numPending == 0)
+    {
+        finished.signal();
+        if (onFinished)
+            onFinished();
+    }
+}
@@ -0,0 +1,80 @@
+/*
+    This file is part of the Kushview Modules for JUCE
+    Copyright (C) 2014-2017  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#ifndef EL_LV2STATEBATCH_H
+#define EL_LV2STATEBATCH_H
+
+/** Saves or restores the state of many LV2Modules in parallel.
+
+    Jobs run on the LV2World's thread pool, so neither the message thread nor
+    the audio thread waits on plugins serializing state or on disk I/O. Each
+    module's state is kept in its own directory, along with any files the
+    plugin made and property values too large to store inline */
+class LV2StateBatch
+{
+public:
+    LV2StateBatch (LV2World& world);
+
+    /** Destructor. This waits for jobs already running to finish */
+    ~LV2StateBatch();
+
+    /** Queue a module to be saved in to a directory */
+    void addSave (LV2Module* module, const File& directory);
+
+    /** Queue a module to be restored from a directory
+        @note The module must not be running while the batch is */
+    void addRestore (LV2Module* module, const File& directory);
+
+    /** Start all queued jobs */
+    void start();
+
+    /** Returns true if started and every job has finished */
+    bool isFinished() const;
+
+    /** Wait for every job to finish
+        @returns true if finished before the timeout */
+    bool waitForCompletion (int timeoutMilliseconds = -1);
+
+    /** Get the number of jobs */
+    inline int size() const { return jobs.size(); }
+
+    /** Get the result of a job, in the order it was added */
+    Result getResult (int index) const;
+
+    /** Get the first failed result, or ok if everything succeeded */
+    Result getResult() const;
+
+    /** Called from a pool thread when the last job finishes */
+    std::function<void()> onFinished;
+
+private:
+    class Job;
+    friend class Job;
+    LV2World& world;
+    OwnedArray<Job> jobs;
+    Atomic<int> numPending;
+    WaitableEvent finished;
+    bool started;
+
+    void jobFinished();
+
+    JUCE_DECLARE_NON_COPYABLE (LV2StateBatch)
+};
+
+#endif /* EL_LV2STATEBATCH_H */
@@ -70,6 +70,13 @@ void touchFunction (SuilController controller,
 
 }
 
+struct LV2World::InstantiationLock
+{
+    InstantiationLock (const String& u) : uri (u) { }
+    const String uri;
+    CriticalSection lock;
+};
+
 LV2World::LV2World()
 {
     world = lilv_world_new();
@@ -82,7 +89,13 @@ LV2World::LV2World()
     lv2_ControlPort = lilv_new_uri (world, LV2_CORE__ControlPort);
     lv2_EventPort   = lilv_new_uri (world, LV2_EVENT__EventPort);
     lv2_CVPort      = lilv_new_uri (world, LV2_CORE__CVPort);
+    lv2_InPlaceBroken = lilv_new_uri (world, LV2_CORE__inPlaceBroken);
+    lv2_ReportsLatency = lilv_new_uri (world, LV2_CORE__reportsLatency);
+    lv2_Latency     = lilv_new_uri (world, LV2_CORE__latency);
+    bufsz_fixedBlockLength = lilv_new_uri (world, LV2_BUF_SIZE__fixedBlockLength);
+    bufsz_powerOf2BlockLength = lilv_new_uri (world, LV2_BUF_SIZE__powerOf2BlockLength);
     midi_MidiEvent  = lilv_new_uri (world, LV2_MIDI__MidiEvent);
+    time_Position   = lilv_new_uri (world, LV2_TIME__Position);
     work_schedule   = lilv_new_uri (world, LV2_WORKER__schedule);
     work_interface  = lilv_new_uri (world, LV2_WORKER__interface);
     ui_X11UI        = lilv_new_uri (world, LV2_UI__X11UI);
@@ -99,6 +112,8 @@ LV2World::LV2World()
 
 LV2World::~LV2World()
 {
+    pool = nullptr;
+
 #define _node_free(n) lilv_node_free (const_cast<LilvNode*> (n))
     _node_free (lv2_InputPort);
     _node_free (lv2_OutputPort);
@@ -107,7 +122,13 @@ LV2World::~LV2World()
     _node_free (lv2_ControlPort);
     _node_free (lv2_EventPort);
     _node_free (lv2_CVPort);
+    _node_free (lv2_InPlaceBroken);
+    _node_free (lv2_ReportsLatency);
+    _node_free (lv2_Latency);
+    _node_free (bufsz_fixedBlockLength);
+    _node_free (bufsz_powerOf2BlockLength);
     _node_free (midi_MidiEvent);
+    _node_free (time_Position);
     _node_free (work_schedule);
     _node_free (work_interface);
 
@@ -144,8 +165,10 @@ void LV2World::fillPluginDescription (const String& uri, PluginDescription& desc
         desc.lastFileModTime = Time();
         desc.manufacturerName = model.getAuthorName();
         desc.name = model.getName();
-        desc.numInputChannels  = model.getNumPorts (PortType::Audio, true);
-        desc.numOutputChannels = model.getNumPorts (PortType::Audio, false);
+        desc.numInputChannels  = model.getNumPorts (PortType::Audio, true) +
+                                 model.getNumPorts (PortType::CV, true);
+        desc.numOutputChannels = model.getNumPorts (PortType::Audio, false) +
+                                 model.getNumPorts (PortType::CV, false);
         desc.pluginFormatName = String ("LV2");
         desc.uid = desc.fileOrIdentifier.hashCode();
         desc.version = String::empty;
@@ -180,6 +203,23 @@ WorkThread& LV2World::getWorkThread()
     return *threads.getUnchecked (threadIndex);
 }
 
+ThreadPool& LV2World::getThreadPool()
+{
+    const ScopedLock sl (lock);
+    if (pool == nullptr)
+        pool = new ThreadPool (jmax (1, SystemStats::getNumCpus()));
+    return *pool;
+}
+
+CriticalSection& LV2World::getInstantiationLock (const String& uri)
+{
+    const ScopedLock sl (lock);
+    for (InstantiationLock* il : instantiationLocks)
+        if (il->uri == uri)
+            return il->lock;
+    return instantiationLocks.add (new InstantiationLock (uri))->lock;
+}
+
 bool LV2World::isFeatureSupported (const String& featureURI)
 {
    if (features.contains (featureURI))
@@ -188,6 +228,12 @@ bool LV2World::isFeatureSupported (const String& featureURI)
    if (featureURI == LV2_WORKER__schedule)
       return true;
 
+   // provided per instance by LV2Module
+   if (featureURI == LV2_STATE__mapPath || featureURI == LV2_STATE__makePath ||
+       featureURI == LV2_OPTIONS__options || featureURI == LV2_BUF_SIZE__boundedBlockLength ||
+       featureURI == LV2_BUF_SIZE__fixedBlockLength || featureURI == LV2_BUF_SIZE__powerOf2BlockLength)
+      return true;
+
    return false;
 }
 
@@ -40,7 +40,13 @@ public:
     const LilvNode*   lv2_ControlPort;
     const LilvNode*   lv2_EventPort;
     const LilvNode*   lv2_CVPort;
+    const LilvNode*   lv2_InPlaceBroken;
+    const LilvNode*   lv2_ReportsLatency;
+    const LilvNode*   lv2_Latency;
+    const LilvNode*   bufsz_fixedBlockLength;
+    const LilvNode*   bufsz_powerOf2BlockLength;
     const LilvNode*   midi_MidiEvent;
+    const LilvNode*   time_Position;
     const LilvNode*   work_schedule;
     const LilvNode*   work_interface;
     const LilvNode*   ui_X11UI;
@@ -92,6 +98,19 @@ public:
     /** Returns the total number of available worker threads */
     inline int32 getNumWorkThreads() const { return numThreads; }
 
+    /** Get a pool of threads for non-realtime jobs, like saving and
+        restoring plugin state.  The pool is created on first use with
+        a thread for each CPU */
+    ThreadPool& getThreadPool();
+
+    /** Lock used to serialize access to the LilvWorld when modules are
+        created or instantiated from more than one thread */
+    inline CriticalSection& getLock() { return lock; }
+
+    /** Get the lock which serializes Instantiation class calls (instantiate,
+        activate, deactivate, cleanup) for every instance of a plugin */
+    CriticalSection& getInstantiationLock (const String& uri);
+
     inline SuilHost* getSuilHost() { return suil; }
 
 private:
@@ -102,6 +121,11 @@ private:
     // a simple rotating thread pool
     int32 currentThread, numThreads;
     OwnedArray<WorkThread> threads;
+    ScopedPointer<ThreadPool> pool;
+
+    CriticalSection lock;
+    struct InstantiationLock;
+    OwnedArray<InstantiationLock> instantiationLocks;
 };
 
 #endif /* EL_LV2WORLD_H */
@@ -40,12 +40,16 @@ namespace kv {
 #include "common/PortBuffer.cpp"
 #include "common/PortWriter.cpp"
 #include "features/LV2Log.cpp"
+#include "features/LV2Options.cpp"
+#include "features/LV2StatePath.cpp"
 #include "features/LV2Worker.cpp"
 
 #if KV_LV2_PLUGIN_HOST
  #include "host/LV2Module.cpp"
+ #include "host/LV2ModuleBatch.cpp"
  #include "host/LV2PluginFormat.cpp"
  #include "host/LV2PluginModel.cpp"
+ #include "host/LV2StateBatch.cpp"
  #include "host/LV2World.cpp"
 #endif
 }
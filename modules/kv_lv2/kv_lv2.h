@@ -58,10 +58,15 @@
 #include <lv2/lv2plug.in/ns/lv2core/lv2.h>
 #include <lv2/lv2plug.in/ns/extensions/ui/ui.h>
 #include <lv2/lv2plug.in/ns/ext/atom/atom.h>
+#include <lv2/lv2plug.in/ns/ext/atom/forge.h>
 #include <lv2/lv2plug.in/ns/ext/atom/util.h>
+#include <lv2/lv2plug.in/ns/ext/buf-size/buf-size.h>
 #include <lv2/lv2plug.in/ns/ext/event/event.h>
 #include <lv2/lv2plug.in/ns/ext/log/log.h>
 #include <lv2/lv2plug.in/ns/ext/midi/midi.h>
+#include <lv2/lv2plug.in/ns/ext/options/options.h>
+#include <lv2/lv2plug.in/ns/ext/state/state.h>
+#include <lv2/lv2plug.in/ns/ext/time/time.h>
 #include <lv2/lv2plug.in/ns/ext/urid/urid.h>
 #include <lv2/lv2plug.in/ns/ext/uri-map/uri-map.h>
 #include <lv2/lv2plug.in/ns/ext/worker/worker.h>
@@ -76,15 +81,19 @@ namespace kv {
  #include "common/PortWriter.h"
  #include "features/LV2Features.h"
  #include "features/LV2Log.h"
+ #include "features/LV2Options.h"
+ #include "features/LV2StatePath.h"
  #include "features/LV2Worker.h"
  #include "features/SymbolMap.h"
 
 #if KV_LV2_PLUGIN_HOST
  #include "host/LV2World.h"
  #include "host/LV2Module.h"
+ #include "host/LV2ModuleBatch.h"
  #include "host/LV2Parameter.h"
  #include "host/LV2PluginFormat.h"
  #include "host/LV2PluginModel.h"
+ #include "host/LV2StateBatch.h"
 #endif
 }
 